@@ -0,0 +1,66 @@
+/*
+ Title: ArenaConfig.h
+  Description: The RAM budget of the controller on the Uno
+	(2K of SRAM) in one place. Every buffer the libraries queue
+	data in is sized here and lives in the BufferArena, so
+	making one bigger for throughput is a change to this file
+	and the checks below say at compile time whether it still
+	fits:
+		ARENA_SERIAL_RX		SoftwareSerial receive queue
+							(Maestro replies, 2 bytes each)
+		ARENA_TRACE_CHUNK	InputTrace records batched per '~'
+							chunk of telemetry
+		ARENA_COMMAND_LINE	operator command line (parameter
+							menu), including the terminating 0
+		ARENA_JOURNAL		EventJournal actuator events waiting
+							to be sent, 8 bytes each
+	The rest of RAM is counted as:
+		ARENA_CORE_RAM		the Arduino core: Serial's 64 byte
+							RX and TX queues, state and vtable,
+							millis
+		ARENA_STATIC_RAM	allowance for every other global of
+							the sketch and libraries, vtables
+							included (.data + .bss). Keep it
+							up to date from the static RAM that
+							avr-size (or Tools/AvrBenchReport)
+							reports, less ARENA_SIZE.
+		ARENA_STACK_RESERVE	stack needed by the deepest call
+							plus the interrupts on top of it
+	The allowance can't be checked when compiling; the stack
+	probe (BufferArena.h) measures the real free RAM at boot and
+	its headroom shows how much of the reserve has been used.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+#ifndef ArenaConfig_h
+#define ArenaConfig_h
+
+// Buffers (bytes)
+#define ARENA_SERIAL_RX 8
+#define ARENA_TRACE_CHUNK 32
+#define ARENA_COMMAND_LINE 32
+#define ARENA_JOURNAL_EVENTS 8
+#define ARENA_JOURNAL (ARENA_JOURNAL_EVENTS * 8)
+#define ARENA_SIZE (ARENA_SERIAL_RX + ARENA_TRACE_CHUNK + ARENA_COMMAND_LINE + ARENA_JOURNAL)
+
+// Rest of RAM (bytes)
+#if defined(RAMEND) && defined(RAMSTART)
+#define ARENA_RAM_SIZE (RAMEND - RAMSTART + 1)
+#else
+#define ARENA_RAM_SIZE 2048				// ATmega328P
+#endif
+#define ARENA_CORE_RAM 184
+#define ARENA_STATIC_RAM 1340
+#define ARENA_STACK_RESERVE 384
+
+// Budget checks
+static_assert (ARENA_SERIAL_RX >= 2 && ARENA_SERIAL_RX <= 256, "ARENA_SERIAL_RX: SoftwareSerial indexes it with a byte");
+static_assert (ARENA_TRACE_CHUNK >= 16 && ARENA_TRACE_CHUNK <= 255, "ARENA_TRACE_CHUNK: one record takes up to 16 bytes");
+static_assert (ARENA_COMMAND_LINE >= 24 && ARENA_COMMAND_LINE <= 255, "ARENA_COMMAND_LINE: too short for <name>=<value>");
+static_assert (ARENA_JOURNAL_EVENTS >= 1 && ARENA_JOURNAL_EVENTS <= 255, "ARENA_JOURNAL_EVENTS: EventJournal counts them with a byte");
+static_assert (ARENA_SIZE + ARENA_CORE_RAM + ARENA_STATIC_RAM + ARENA_STACK_RESERVE <= ARENA_RAM_SIZE,
+	"RAM budget exceeded: make a buffer in ArenaConfig.h smaller");
+
+#endif
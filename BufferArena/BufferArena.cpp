@@ -0,0 +1,118 @@
+/*
+ Title: BufferArena.cpp
+  Description: One statically sized block of RAM that holds
+	every buffer the libraries queue data in (sizes and the
+	RAM budget are in ArenaConfig.h), and a probe of the RAM
+	left over for the stack.
+	The buffers are plain arrays at fixed addresses (the global
+	'arena'), so using one costs the same as a static array in
+	the library did:
+		arena.serialRx		SoftwareSerial receive queue
+		arena.traceChunk	InputTrace chunk
+		arena.commandLine	operator command line
+		arena.journal		EventJournal events
+	The stack grows down from the top of RAM towards the globals
+	(there is no heap; nothing calls malloc) and nothing stops it
+	running into them. The probe 'stackProbe' paints the free RAM
+	with a fixed pattern when begin() is called (first thing in
+	setup) and then finds the lowest byte the stack has written
+	since:
+		getFree()		bytes between the stack and the
+						globals now
+		getHeadroom()	least free there has been (stack high
+						water mark, interrupts included)
+		isOverBudget()	the stack has used more than
+						ARENA_STACK_RESERVE or there was less
+						than that free at boot (the budget in
+						ArenaConfig.h is wrong)
+	getHeadroom() only looks below the last high water mark, so
+	it is a few cycles unless the stack went deeper. On the PC
+	(Tools) there is nothing to measure and both report
+	ARENA_STACK_RESERVE.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+
+#include "Arduino.h"
+#include "BufferArena.h"
+
+BufferArena arena;
+StackProbe stackProbe;
+
+#if defined(__AVR__)
+extern uint8_t __heap_start;		// end of .bss (avr-libc)
+#endif
+
+/*
+	Paints the RAM between the globals and the stack. Call it
+	first thing in setup(); anything deeper than setup() is
+	measured from then on.
+*/
+void StackProbe::begin ()
+{
+#if defined(__AVR__)
+	_bottom = &__heap_start;
+	uint8_t *top = (uint8_t *) SP;		// everything below SP is free
+	_bootFree = top - _bottom;
+	for (uint8_t *p = _bottom; p < top; p++)
+		*p = ARENA_PAINT;
+	_low = top;
+#endif
+}
+
+/*
+	Bytes between the stack pointer and the globals now
+*/
+unsigned int StackProbe::getFree ()
+{
+#if defined(__AVR__)
+	return (uint8_t *) SP - _bottom;
+#else
+	return ARENA_STACK_RESERVE;
+#endif
+}
+
+/*
+	Least free RAM there has been since begin() (the bytes the stack
+	has never written). Only the bytes below the last high water mark
+	are looked at, and a run of ARENA_PAINT_RUN painted bytes ends
+	the search so a stack byte that happens to hold the pattern
+	isn't taken for the end.
+*/
+unsigned int StackProbe::getHeadroom ()
+{
+#if defined(__AVR__)
+	uint8_t *p = _low;
+	byte run = 0;
+	while ((p > _bottom) && (run < ARENA_PAINT_RUN))
+	{
+		p--;
+		if (*p == ARENA_PAINT)
+			run++;
+		else
+		{
+			run = 0;
+			_low = p;
+		}
+	}
+	return _low - _bottom;
+#else
+	return ARENA_STACK_RESERVE;
+#endif
+}
+
+/*
+	True if the budget in ArenaConfig.h doesn't hold: the globals left
+	less than ARENA_STACK_RESERVE free at boot or the stack has since
+	used more than that
+*/
+boolean StackProbe::isOverBudget ()
+{
+#if defined(__AVR__)
+	return (_bootFree < ARENA_STACK_RESERVE) || (_bootFree - getHeadroom () > ARENA_STACK_RESERVE);
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,72 @@
+/*
+ Title: BufferArena.h
+  Description: One statically sized block of RAM that holds
+	every buffer the libraries queue data in (sizes and the
+	RAM budget are in ArenaConfig.h), and a probe of the RAM
+	left over for the stack.
+	The buffers are plain arrays at fixed addresses (the global
+	'arena'), so using one costs the same as a static array in
+	the library did:
+		arena.serialRx		SoftwareSerial receive queue
+		arena.traceChunk	InputTrace chunk
+		arena.commandLine	operator command line
+		arena.journal		EventJournal events
+	The stack grows down from the top of RAM towards the globals
+	(there is no heap; nothing calls malloc) and nothing stops it
+	running into them. The probe 'stackProbe' paints the free RAM
+	with a fixed pattern when begin() is called (first thing in
+	setup) and then finds the lowest byte the stack has written
+	since:
+		getFree()		bytes between the stack and the
+						globals now
+		getHeadroom()	least free there has been (stack high
+						water mark, interrupts included)
+		isOverBudget()	the stack has used more than
+						ARENA_STACK_RESERVE or there was less
+						than that free at boot (the budget in
+						ArenaConfig.h is wrong)
+	getHeadroom() only looks below the last high water mark, so
+	it is a few cycles unless the stack went deeper. On the PC
+	(Tools) there is nothing to measure and both report
+	ARENA_STACK_RESERVE.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+#ifndef BufferArena_h
+#define BufferArena_h
+
+#include "Arduino.h"
+#include "ArenaConfig.h"
+
+#define ARENA_PAINT 0xA5		// pattern the free RAM is painted with
+#define ARENA_PAINT_RUN 4		// painted bytes in a row that end the stack
+
+struct BufferArena
+{
+	char serialRx[ARENA_SERIAL_RX];
+	char traceChunk[ARENA_TRACE_CHUNK];
+	char commandLine[ARENA_COMMAND_LINE];
+	uint8_t journal[ARENA_JOURNAL];
+};
+
+static_assert (sizeof (BufferArena) == ARENA_SIZE, "BufferArena and ARENA_SIZE differ");
+
+class StackProbe
+{
+	public:
+		void begin ();
+		unsigned int getFree ();
+		unsigned int getHeadroom ();
+		boolean isOverBudget ();
+	private:
+		uint8_t *_bottom;		// first byte after the globals
+		uint8_t *_low;			// lowest byte the stack has written
+		unsigned int _bootFree;
+};
+
+extern BufferArena arena;
+extern StackProbe stackProbe;
+
+#endif
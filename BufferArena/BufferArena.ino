@@ -0,0 +1,59 @@
+/*
+ Title: BufferArena (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the BufferArena library. It prints the
+	RAM budget from ArenaConfig.h and the free RAM measured at
+	boot, then calls a function that goes one level deeper each
+	pass so the stack headroom can be seen falling.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <BufferArena.h>
+
+volatile byte sink;
+
+/*
+	Uses about 'depth' * 20 bytes of stack
+*/
+byte goDeeper (byte depth)
+{
+	volatile byte local[16];
+	local[0] = depth;
+	if (depth == 0)
+		return local[0];
+	return goDeeper (depth - 1) + local[0];
+}
+
+void setup ()
+{
+	stackProbe.begin();
+	Serial.begin(57600);
+	Serial.print (F("Arena: "));
+	Serial.print (ARENA_SIZE);
+	Serial.print (F(" bytes of "));
+	Serial.print (ARENA_RAM_SIZE);
+	Serial.print (F(", stack reserve "));
+	Serial.println (ARENA_STACK_RESERVE);
+	Serial.print (F("Free RAM at boot: "));
+	Serial.println (stackProbe.getFree());
+	if (stackProbe.isOverBudget() == true)
+		Serial.println (F("Over budget: ARENA_STATIC_RAM is too small"));
+}
+
+void loop ()
+{
+	static byte depth = 0;
+	sink = goDeeper (depth);
+	Serial.print (F("depth "));
+	Serial.print (depth);
+	Serial.print (F(", headroom "));
+	Serial.print (stackProbe.getHeadroom());
+	if (stackProbe.isOverBudget() == true)
+		Serial.print (F(" - over budget"));
+	Serial.println ();
+	if (depth < 20)
+		depth++;
+	delay (500);
+}
@@ -0,0 +1,205 @@
+/*
+ Title: ChannelTable.cpp
+  Description: A table driven set of sensor channels. Each
+	channel is one row of a const SensorChannel array stored
+	in PROGMEM (so every field must be a compile time constant):
+		name
+			column header (PROGMEM), eg. "enginePSI"
+		type
+			CHANNEL_ANALOG
+				analogRead(source), health checked, filtered
+				(optional) and passed to convert as 'raw'
+			CHANNEL_DEVICE
+				convert reads the device (eg. a thermocouple or
+				servo position). NAN means the read failed and
+				is flagged as a device fault.
+			CHANNEL_DERIVED
+				convert calculates the value from other channels.
+				Derived channels are calculated after every 
+				analog and device channel has been read, in 
+				table order.
+		source
+			analog pin (CHANNEL_ANALOG only)
+		param
+			passed to convert so one function can serve several
+			channels (eg. a calibration or device number)
+		decimals
+			digits printed after the decimal point
+		filter
+			SensorFilter for the raw reading (NULL = none)
+		convert
+			float convert (byte param, int raw)
+	The latest value of channel 'n' is values[n], so other 
+	table driven code (eg. SafetyMonitor rules) can point 
+	straight at it. Channel 'n' is also SensorHealth channel 'n'
+	so bit 'n' of the status bitmap belongs to column 'n'. 
+	Adding a sensor is one row in the table. A table longer than
+	CHANNEL_MAX (the SensorHealth limit) is rejected as a whole:
+	getCount() returns 0 and no channel is read or printed.
+	
+	read() walks the table once per sample, and printHeader()/
+	printValues() print it as CSV columns. Each copies one row
+	at a time out of flash. The raw analog readings can be 
+	passed through a hook (setInputHook()) as they are read.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+
+#include "Arduino.h"
+#include "ChannelTable.h"
+
+int (*ChannelTable::_inputHook)(int raw) = NULL;
+
+/*
+	'values' must have room for 'count' floats. A table of more
+	than CHANNEL_MAX (the SensorHealth limit) channels is rejected
+	rather than cut short, so no column or health bit is silently
+	lost: the table is left empty and every value stays NAN.
+*/
+ChannelTable::ChannelTable (const SensorChannel *channels, byte count, float *values, SensorHealth &health)
+	: _health (health)
+{
+	_channels = channels;
+	_count = (count > CHANNEL_MAX) ? 0 : count;
+	_values = values;
+	_minRaw = 0;
+	_maxRaw = 1023;
+	for (byte i = 0; i < count; i++)
+		_values[i] = NAN;
+}
+
+/*
+	Passes every raw analog reading through 'hook' before it is
+	checked and converted, eg. to record it (NULL = none)
+*/
+void ChannelTable::setInputHook (int (*hook)(int raw))
+{
+	_inputHook = hook;
+}
+
+/*
+	Raw analog readings outside this range are flagged as out of
+	range (default 0 - 1023, ie. never)
+*/
+void ChannelTable::setAnalogRange (int minRaw, int maxRaw)
+{
+	_minRaw = minRaw;
+	_maxRaw = maxRaw;
+}
+
+/*
+	Reads every analog and device channel in table order, then
+	calculates the derived channels
+*/
+void ChannelTable::read ()
+{
+	SensorChannel ch;
+	for (byte i = 0; i < _count; i++)
+	{
+		getChannel (i, &ch);
+		if (ch.type == CHANNEL_ANALOG)
+		{
+			int raw = analogRead(ch.source);
+			if (_inputHook != NULL)
+				raw = _inputHook (raw);
+			_health.checkAnalog (i, raw, _minRaw, _maxRaw);
+			if (ch.filter != NULL)
+				raw = ch.filter->filter (raw);
+			_values[i] = ch.convert (ch.param, raw);
+		}
+		else if (ch.type == CHANNEL_DEVICE)
+		{
+			_values[i] = ch.convert (ch.param, 0);
+			_health.checkDevice (i, isnan (_values[i]));
+		}
+	}
+	for (byte i = 0; i < _count; i++)
+	{
+		getChannel (i, &ch);
+		if (ch.type == CHANNEL_DERIVED)
+			_values[i] = ch.convert (ch.param, 0);
+	}
+}
+
+/*
+	Copies row 'index' of the table out of PROGMEM
+*/
+void ChannelTable::getChannel (byte index, SensorChannel *channel)
+{
+	memcpy_P (channel, &_channels[index], sizeof (SensorChannel));
+}
+
+/*
+	Restarts every channel's filter from its next reading
+*/
+void ChannelTable::resetFilters ()
+{
+	SensorChannel ch;
+	for (byte i = 0; i < _count; i++)
+	{
+		getChannel (i, &ch);
+		if (ch.filter != NULL)
+			ch.filter->reset ();
+	}
+}
+
+/*
+	Number of channels in use (0 if the table was rejected)
+*/
+byte ChannelTable::getCount ()
+{
+	return _count;
+}
+
+/*
+	Prints the channel names separated by commas (no newline)
+*/
+void ChannelTable::printHeader (Print &out)
+{
+	SensorChannel ch;
+	for (byte i = 0; i < _count; i++)
+	{
+		getChannel (i, &ch);
+		if (i > 0)
+			out.print ((char) ',');
+		out.print ((const __FlashStringHelper *) ch.name);
+	}
+}
+
+/*
+	Prints the channel values separated by commas (no newline)
+*/
+void ChannelTable::printValues (Print &out)
+{
+	for (byte i = 0; i < _count; i++)
+	{
+		if (i > 0)
+			out.print ((char) ',');
+		out.print (_values[i], pgm_read_byte (&_channels[i].decimals));
+	}
+}
+
+/*
+	Prints the name and SensorHealth fault bits of every faulty 
+	channel on one line
+*/
+void ChannelTable::printFaults (Print &out)
+{
+	out.print (F("Sensor faults:"));
+	for (byte i = 0; i < _count; i++)
+	{
+		byte faults = _health.getFaults (i);
+		if (faults != HEALTH_OK)
+		{
+			SensorChannel ch;
+			getChannel (i, &ch);
+			out.print ((char) ' ');
+			out.print ((const __FlashStringHelper *) ch.name);
+			out.print ((char) ':');
+			out.print (faults);
+		}
+	}
+	out.println();
+}
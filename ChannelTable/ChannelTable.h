@@ -0,0 +1,97 @@
+/*
+ Title: ChannelTable.h
+  Description: A table driven set of sensor channels. Each
+	channel is one row of a const SensorChannel array stored
+	in PROGMEM (so every field must be a compile time constant):
+		name
+			column header (PROGMEM), eg. "enginePSI"
+		type
+			CHANNEL_ANALOG
+				analogRead(source), health checked, filtered
+				(optional) and passed to convert as 'raw'
+			CHANNEL_DEVICE
+				convert reads the device (eg. a thermocouple or
+				servo position). NAN means the read failed and
+				is flagged as a device fault.
+			CHANNEL_DERIVED
+				convert calculates the value from other channels.
+				Derived channels are calculated after every 
+				analog and device channel has been read, in 
+				table order.
+		source
+			analog pin (CHANNEL_ANALOG only)
+		param
+			passed to convert so one function can serve several
+			channels (eg. a calibration or device number)
+		decimals
+			digits printed after the decimal point
+		filter
+			SensorFilter for the raw reading (NULL = none)
+		convert
+			float convert (byte param, int raw)
+	The latest value of channel 'n' is values[n], so other 
+	table driven code (eg. SafetyMonitor rules) can point 
+	straight at it. Channel 'n' is also SensorHealth channel 'n'
+	so bit 'n' of the status bitmap belongs to column 'n'. 
+	Adding a sensor is one row in the table. A table longer than
+	CHANNEL_MAX (the SensorHealth limit) is rejected as a whole:
+	getCount() returns 0 and no channel is read or printed.
+	
+	read() walks the table once per sample, and printHeader()/
+	printValues() print it as CSV columns. Each copies one row
+	at a time out of flash. The raw analog readings can be 
+	passed through a hook (setInputHook()) as they are read.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+#ifndef ChannelTable_h
+#define ChannelTable_h
+
+#include "Arduino.h"
+#include <SensorFilter.h>
+#include <SensorHealth.h>
+
+#define CHANNEL_MAX HEALTH_MAX_CHANNELS
+
+// Channel types
+#define CHANNEL_ANALOG 0
+#define CHANNEL_DEVICE 1
+#define CHANNEL_DERIVED 2
+
+typedef struct
+{
+	const char *name;						// column header stored in PROGMEM
+	byte type;								// CHANNEL_ANALOG, CHANNEL_DEVICE or CHANNEL_DERIVED
+	byte source;							// analog pin
+	byte param;								// passed to convert
+	byte decimals;							// digits printed after the decimal point
+	SensorFilter *filter;					// raw reading filter (NULL = none)
+	float (*convert) (byte param, int raw);	// raw reading (0 unless analog) to value
+} SensorChannel;
+
+class ChannelTable
+{
+	public:
+		ChannelTable (const SensorChannel *channels, byte count, float *values, SensorHealth &health);
+		void setAnalogRange (int minRaw, int maxRaw);
+		void read ();
+		void resetFilters ();
+		byte getCount ();
+		void printHeader (Print &out);
+		void printValues (Print &out);
+		void printFaults (Print &out);
+		static void setInputHook (int (*hook)(int raw));
+	private:
+		static int (*_inputHook)(int raw);
+		void getChannel (byte index, SensorChannel *channel);
+		const SensorChannel *_channels;
+		byte _count;
+		float *_values;
+		SensorHealth &_health;
+		int _minRaw;
+		int _maxRaw;
+};
+
+#endif
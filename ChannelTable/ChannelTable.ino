@@ -0,0 +1,65 @@
+/*
+ Title: ChannelTable (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the ChannelTable library. Two analog
+	inputs (A0 filtered, A1 unfiltered) are converted to 
+	volts, their difference is a derived channel and the 
+	table is printed as CSV with the health status bitmap 
+	every half second. Disconnect an input or tie it to a rail
+	to see its fault bit set.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <SensorFilter.h>
+#include <SensorHealth.h>
+#include <ChannelTable.h>
+
+#define CH_A0 0
+#define CH_A1 1
+#define CH_DIFF 2
+#define CH_COUNT 3
+
+float values[CH_COUNT];
+SensorHealth health (100);
+SensorFilter a0filter (3, 2.0, 10.0);		// median 3, 2Hz low-pass at 10Hz
+
+float toVolts (byte unused, int raw)
+{
+	return raw * 5.0 / 1023.0;
+}
+
+float difference (byte unused, int raw)
+{
+	return values[CH_A0] - values[CH_A1];
+}
+
+const char nameA0[] PROGMEM = "A0(V)";
+const char nameA1[] PROGMEM = "A1(V)";
+const char nameDiff[] PROGMEM = "A0-A1(V)";
+const SensorChannel channels[CH_COUNT] PROGMEM =
+{
+	// name		type				source	param	decimals	filter		convert
+	{ nameA0,	CHANNEL_ANALOG,		A0,		0,		3,			&a0filter,	toVolts },
+	{ nameA1,	CHANNEL_ANALOG,		A1,		0,		3,			NULL,		toVolts },
+	{ nameDiff,	CHANNEL_DERIVED,	0,		0,		3,			NULL,		difference },
+};
+ChannelTable sensors (channels, CH_COUNT, values, health);
+
+void setup ()
+{
+	Serial.begin(57600);
+	sensors.setAnalogRange (20, 1003);
+	sensors.printHeader (Serial);
+	Serial.println (F(",status(hex)"));
+}
+
+void loop ()
+{
+	sensors.read ();
+	sensors.printValues (Serial);
+	Serial.print (',');
+	Serial.println (health.getStatus (), HEX);
+	delay(100);
+}
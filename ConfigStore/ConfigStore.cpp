@@ -0,0 +1,443 @@
+/*
+ Title: ConfigStore.cpp
+  Description: A table of named configuration parameters that
+	can be read and changed over a serial link and saved to
+	EEPROM, so a test configuration can be changed without
+	recompiling. Each parameter is one row of a const ConfigParam
+	array stored in PROGMEM:
+		name
+			parameter name (PROGMEM), eg. "servoOpened"
+		value
+			address of the variable holding the parameter
+		type
+			CONFIG_FLOAT, CONFIG_INT (int), CONFIG_UINT
+			(unsigned int) or CONFIG_BYTE
+		decimals
+			digits printed after the decimal point (floats)
+		minValue / maxValue
+			allowed range. Values outside it are rejected by
+			set and load.
+	The variables keep their compiled in values until load()
+	finds a valid saved configuration. The saved block is
+	getSize() bytes: magic, version, parameter count, the values
+	in table order and a CRC. It is ignored if any of these do
+	not match, so change the version whenever rows are added,
+	removed or reordered.
+
+	command() runs one line of the parameter protocol and ends
+	its reply with "OK" or "ERR <reason>":
+		list			prints every parameter as name=value
+		name			prints name=value
+		name=value		sets (RAM only) and prints name=value
+		save			saves every parameter to EEPROM
+		load			reloads the saved parameters
+		erase			invalidates the saved block (the compiled
+						in values are used from the next reset)
+		exit			returns CONFIG_CMD_EXIT
+	Values derived from the parameters (eg. areas) are not
+	updated by the store. CONFIG_CMD_CHANGED is returned when
+	they need to be recalculated.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+
+#include "Arduino.h"
+#include <EEPROM.h>
+#include "ConfigStore.h"
+
+#define CONFIG_MAGIC 0x43	// 'C'
+
+/*
+	Dallas/Maxim CRC-8 of 'len' EEPROM bytes starting at 'address'.
+	Shared by the other libraries that keep a block in EEPROM
+	(TransducerCal, LoadCell).
+*/
+byte eepromCRC (int address, int len)
+{
+	byte crc = 0;
+	for (int i = 0; i < len; i++)
+	{
+		byte b = EEPROM.read (address + i);
+		for (byte bit = 0; bit < 8; bit++)
+		{
+			byte mix = (crc ^ b) & 0x01;
+			crc >>= 1;
+			if (mix)
+				crc ^= 0x8C;
+			b >>= 1;
+		}
+	}
+	return crc;
+}
+
+/*
+	Writes a byte only if it differs so repeated saves of an
+	unchanged configuration don't wear the EEPROM
+*/
+static void eepromUpdate (int address, byte value)
+{
+	if (EEPROM.read (address) != value)
+		EEPROM.write (address, value);
+}
+
+/*
+	Bytes a parameter of the given type uses in EEPROM. Integers
+	are always saved as 16 bits, low byte first (as on the AVR), so
+	a saved block reads the same on a PC (Tools/TraceReplay).
+*/
+static byte typeSize (byte type)
+{
+	switch (type)
+	{
+		case CONFIG_FLOAT:
+			return sizeof (float);
+		case CONFIG_INT:
+		case CONFIG_UINT:
+			return 2;
+		default:
+			return sizeof (byte);
+	}
+}
+
+/*
+	Converts a parameter's variable to its saved bytes
+*/
+static void toSaved (const void *value, byte type, byte *buf)
+{
+	unsigned int word;
+	switch (type)
+	{
+		case CONFIG_FLOAT:
+			memcpy (buf, value, sizeof (float));
+			return;
+		case CONFIG_INT:
+			word = *(const int *) value;
+			break;
+		case CONFIG_UINT:
+			word = *(const unsigned int *) value;
+			break;
+		default:
+			buf[0] = *(const byte *) value;
+			return;
+	}
+	buf[0] = word & 0xFF;
+	buf[1] = (word >> 8) & 0xFF;
+}
+
+/*
+	Converts the saved bytes of a parameter to a float
+*/
+static float savedToFloat (const byte *buf, byte type)
+{
+	float value;
+	switch (type)
+	{
+		case CONFIG_FLOAT:
+			memcpy (&value, buf, sizeof (float));
+			return value;
+		case CONFIG_INT:
+			return (int16_t) (buf[0] | (buf[1] << 8));
+		case CONFIG_UINT:
+			return (uint16_t) (buf[0] | (buf[1] << 8));
+		default:
+			return buf[0];
+	}
+}
+
+/*
+	Writes 'value' to a parameter's variable
+*/
+static void storeValue (const ConfigParam *param, float value)
+{
+	switch (param->type)
+	{
+		case CONFIG_FLOAT:
+			*(float *) param->value = value;
+			break;
+		case CONFIG_INT:
+			*(int *) param->value = (int) value;
+			break;
+		case CONFIG_UINT:
+			*(unsigned int *) param->value = (unsigned int) value;
+			break;
+		default:
+			*(byte *) param->value = (byte) value;
+	}
+}
+
+/*
+	Converts the bytes of a parameter of the given type to a float
+*/
+static float toFloat (const void *value, byte type)
+{
+	switch (type)
+	{
+		case CONFIG_FLOAT:
+			return *(const float *) value;
+		case CONFIG_INT:
+			return *(const int *) value;
+		case CONFIG_UINT:
+			return *(const unsigned int *) value;
+		default:
+			return *(const byte *) value;
+	}
+}
+
+/*
+	'params' must be stored in PROGMEM. The saved configuration
+	lives at eepromAddress and may use up to eepromSize bytes
+	(see getSize).
+*/
+ConfigStore::ConfigStore (const ConfigParam *params, byte count, byte version, int eepromAddress, int eepromSize)
+{
+	_params = params;
+	_count = count;
+	_version = version;
+	_eepromAddress = eepromAddress;
+	_eepromSize = eepromSize;
+}
+
+/*
+	Copies row 'index' of the table out of PROGMEM
+*/
+void ConfigStore::getParam (byte index, ConfigParam *param)
+{
+	memcpy_P (param, &_params[index], sizeof (ConfigParam));
+}
+
+/*
+	EEPROM bytes needed to save the table. load and save fail if
+	this is more than the eepromSize given to the constructor.
+*/
+int ConfigStore::getSize ()
+{
+	int size = CONFIG_EEPROM_OVERHEAD;
+	ConfigParam param;
+	for (byte i = 0; i < _count; i++)
+	{
+		getParam (i, &param);
+		size += typeSize (param.type);
+	}
+	return size;
+}
+
+/*
+	Loads the saved configuration into the parameter variables.
+	Returns false, leaving every variable unchanged, if nothing
+	valid has been saved (wrong magic, version, count or CRC) or
+	any saved value is out of range.
+*/
+boolean ConfigStore::load ()
+{
+	int size = getSize ();
+	if (size > _eepromSize)
+		return false;
+	if ((EEPROM.read (_eepromAddress) != CONFIG_MAGIC) ||
+		(EEPROM.read (_eepromAddress + 1) != _version) ||
+		(EEPROM.read (_eepromAddress + 2) != _count))
+		return false;
+	if (eepromCRC (_eepromAddress, size - 1) != EEPROM.read (_eepromAddress + size - 1))
+		return false;
+	
+	// range check every value before changing any of them
+	ConfigParam param;
+	byte buf[sizeof (float)];
+	for (byte pass = 0; pass < 2; pass++)
+	{
+		int address = _eepromAddress + 3;
+		for (byte i = 0; i < _count; i++)
+		{
+			getParam (i, &param);
+			byte len = typeSize (param.type);
+			for (byte j = 0; j < len; j++)
+				buf[j] = EEPROM.read (address + j);
+			address += len;
+			float value = savedToFloat (buf, param.type);
+			if (pass == 0)
+			{
+				if (!(value >= param.minValue && value <= param.maxValue))
+					return false;
+			}
+			else
+				storeValue (&param, value);
+		}
+	}
+	return true;
+}
+
+/*
+	Saves every parameter to EEPROM. Returns false if the table
+	does not fit in eepromSize.
+*/
+boolean ConfigStore::save ()
+{
+	int size = getSize ();
+	if (size > _eepromSize)
+		return false;
+	eepromUpdate (_eepromAddress, CONFIG_MAGIC);
+	eepromUpdate (_eepromAddress + 1, _version);
+	eepromUpdate (_eepromAddress + 2, _count);
+	int address = _eepromAddress + 3;
+	ConfigParam param;
+	for (byte i = 0; i < _count; i++)
+	{
+		getParam (i, &param);
+		byte len = typeSize (param.type);
+		byte buf[sizeof (float)];
+		toSaved (param.value, param.type, buf);
+		for (byte j = 0; j < len; j++)
+			eepromUpdate (address + j, buf[j]);
+		address += len;
+	}
+	eepromUpdate (_eepromAddress + size - 1, eepromCRC (_eepromAddress, size - 1));
+	return true;
+}
+
+/*
+	Invalidates the saved configuration. The variables keep their
+	current values; the compiled in values are used after a reset.
+*/
+void ConfigStore::erase ()
+{
+	eepromUpdate (_eepromAddress, 0xFF);
+}
+
+/*
+	Number of parameters in the table
+*/
+byte ConfigStore::getCount ()
+{
+	return _count;
+}
+
+/*
+	Returns the index of the named parameter or -1 if there
+	isn't one (names are case sensitive)
+*/
+int ConfigStore::find (const char *name)
+{
+	ConfigParam param;
+	for (byte i = 0; i < _count; i++)
+	{
+		getParam (i, &param);
+		if (strcmp_P (name, param.name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/*
+	Current value of parameter 'index'
+*/
+float ConfigStore::get (byte index)
+{
+	ConfigParam param;
+	getParam (index, &param);
+	return toFloat (param.value, param.type);
+}
+
+/*
+	Sets parameter 'index' (RAM only, see save). Integer types are
+	rounded to the nearest whole number. Returns false and leaves
+	the value unchanged if it is out of range.
+*/
+boolean ConfigStore::set (byte index, float value)
+{
+	ConfigParam param;
+	getParam (index, &param);
+	if (param.type != CONFIG_FLOAT)
+		value = floor (value + 0.5);
+	if (!(value >= param.minValue && value <= param.maxValue))
+		return false;
+	storeValue (&param, value);
+	return true;
+}
+
+/*
+	Prints parameter 'index' as name=value (with a newline)
+*/
+void ConfigStore::print (Print &out, byte index)
+{
+	ConfigParam param;
+	getParam (index, &param);
+	out.print ((const __FlashStringHelper *) param.name);
+	out.print ((char) '=');
+	if (param.type == CONFIG_FLOAT)
+		out.println (*(float *) param.value, param.decimals);
+	else
+		out.println ((long) toFloat (param.value, param.type));
+}
+
+/*
+	Prints every parameter, one per line
+*/
+void ConfigStore::printAll (Print &out)
+{
+	for (byte i = 0; i < _count; i++)
+		print (out, i);
+}
+
+/*
+	Runs one line of the parameter protocol (see top of file) and
+	prints the reply to 'out'. The line is modified.
+*/
+byte ConfigStore::command (char *line, Print &out)
+{
+	byte result = CONFIG_CMD_OK;
+	if (strcmp_P (line, PSTR("list")) == 0)
+		printAll (out);
+	else if (strcmp_P (line, PSTR("save")) == 0)
+	{
+		if (save () == false)
+		{
+			out.println (F("ERR too big"));
+			return CONFIG_CMD_ERROR;
+		}
+	}
+	else if (strcmp_P (line, PSTR("load")) == 0)
+	{
+		if (load () == false)
+		{
+			out.println (F("ERR nothing saved"));
+			return CONFIG_CMD_ERROR;
+		}
+		result = CONFIG_CMD_CHANGED;
+	}
+	else if (strcmp_P (line, PSTR("erase")) == 0)
+		erase ();
+	else if (strcmp_P (line, PSTR("exit")) == 0)
+		result = CONFIG_CMD_EXIT;
+	else
+	{
+		char *text = strchr (line, '=');
+		if (text != NULL)
+			*text++ = '\0';
+		int index = find (line);
+		if (index < 0)
+		{
+			out.println (F("ERR unknown name"));
+			return CONFIG_CMD_ERROR;
+		}
+		if (text != NULL)
+		{
+			char *end;
+			float value = strtod (text, &end);
+			if ((end == text) || (*end != '\0'))
+			{
+				out.println (F("ERR bad value"));
+				return CONFIG_CMD_ERROR;
+			}
+			if (set (index, value) == false)
+			{
+				out.println (F("ERR out of range"));
+				return CONFIG_CMD_ERROR;
+			}
+			result = CONFIG_CMD_CHANGED;
+		}
+		print (out, index);
+	}
+	out.println (F("OK"));
+	return result;
+}
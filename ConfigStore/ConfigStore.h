@@ -0,0 +1,100 @@
+/*
+ Title: ConfigStore.h
+  Description: A table of named configuration parameters that
+	can be read and changed over a serial link and saved to
+	EEPROM, so a test configuration can be changed without
+	recompiling. Each parameter is one row of a const ConfigParam
+	array stored in PROGMEM:
+		name
+			parameter name (PROGMEM), eg. "servoOpened"
+		value
+			address of the variable holding the parameter
+		type
+			CONFIG_FLOAT, CONFIG_INT (int), CONFIG_UINT
+			(unsigned int) or CONFIG_BYTE
+		decimals
+			digits printed after the decimal point (floats)
+		minValue / maxValue
+			allowed range. Values outside it are rejected by
+			set and load.
+	The variables keep their compiled in values until load()
+	finds a valid saved configuration. The saved block is
+	getSize() bytes: magic, version, parameter count, the values
+	in table order and a CRC. It is ignored if any of these do
+	not match, so change the version whenever rows are added,
+	removed or reordered.
+
+	command() runs one line of the parameter protocol and ends
+	its reply with "OK" or "ERR <reason>":
+		list			prints every parameter as name=value
+		name			prints name=value
+		name=value		sets (RAM only) and prints name=value
+		save			saves every parameter to EEPROM
+		load			reloads the saved parameters
+		erase			invalidates the saved block (the compiled
+						in values are used from the next reset)
+		exit			returns CONFIG_CMD_EXIT
+	Values derived from the parameters (eg. areas) are not
+	updated by the store. CONFIG_CMD_CHANGED is returned when
+	they need to be recalculated.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+#ifndef ConfigStore_h
+#define ConfigStore_h
+
+#include "Arduino.h"
+
+#define CONFIG_EEPROM_OVERHEAD 4	// magic + version + count + crc
+
+// Parameter types
+#define CONFIG_FLOAT 0
+#define CONFIG_INT 1
+#define CONFIG_UINT 2
+#define CONFIG_BYTE 3
+
+// command() results
+#define CONFIG_CMD_OK 0			// nothing changed
+#define CONFIG_CMD_CHANGED 1	// one or more values changed
+#define CONFIG_CMD_ERROR 2
+#define CONFIG_CMD_EXIT 3
+
+typedef struct
+{
+	const char *name;		// parameter name stored in PROGMEM
+	void *value;			// variable holding the parameter
+	byte type;				// CONFIG_FLOAT, CONFIG_INT, CONFIG_UINT or CONFIG_BYTE
+	byte decimals;			// digits printed after the decimal point
+	float minValue;			// allowed range
+	float maxValue;
+} ConfigParam;
+
+byte eepromCRC (int address, int len);
+
+class ConfigStore
+{
+	public:
+		ConfigStore (const ConfigParam *params, byte count, byte version, int eepromAddress, int eepromSize);
+		int getSize ();
+		boolean load ();
+		boolean save ();
+		void erase ();
+		byte getCount ();
+		int find (const char *name);
+		float get (byte index);
+		boolean set (byte index, float value);
+		void print (Print &out, byte index);
+		void printAll (Print &out);
+		byte command (char *line, Print &out);
+	private:
+		void getParam (byte index, ConfigParam *param);
+		const ConfigParam *_params;
+		byte _count;
+		byte _version;
+		int _eepromAddress;
+		int _eepromSize;
+};
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ Title: ConfigStore (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the ConfigStore library. Three 
+	parameters (an orifice diameter, a servo position and a 
+	sample count) can be read and changed from the serial 
+	monitor (newline terminated), eg:
+		list
+		diameter=0.031
+		save
+	The orifice area is recalculated whenever the diameter
+	changes and the saved values are loaded at the next reset.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <EEPROM.h>
+#include <ConfigStore.h>
+
+#define CONFIG_VERSION 1
+#define EEPROM_CONFIG 0
+#define EEPROM_CONFIG_SIZE 16
+
+float diameter = 0.023;		// in
+int servoOpened = 1600;		// us
+byte samples = 10;
+float area;					// in^2, derived from diameter
+
+const char nameDiameter[] PROGMEM = "diameter";
+const char nameServoOpened[] PROGMEM = "servoOpened";
+const char nameSamples[] PROGMEM = "samples";
+const ConfigParam params[] PROGMEM =
+{
+	// name				value			type			decimals	min		max
+	{ nameDiameter,		&diameter,		CONFIG_FLOAT,	3,			0.001,	0.5 },
+	{ nameServoOpened,	&servoOpened,	CONFIG_INT,		0,			500,	2500 },
+	{ nameSamples,		&samples,		CONFIG_BYTE,	0,			1,		100 },
+};
+ConfigStore config (params, sizeof(params) / sizeof(params[0]), CONFIG_VERSION, EEPROM_CONFIG, EEPROM_CONFIG_SIZE);
+
+char line[24];
+byte lineLength = 0;
+
+void applyConfig ()
+{
+	area = 3.141592654 * (diameter / 2) * (diameter / 2);
+	Serial.print (F("area (in^2): "));
+	Serial.println (area, 6);
+}
+
+void setup ()
+{
+	Serial.begin(57600);
+	if (config.load () == false)
+		Serial.println (F("No saved configuration, using defaults"));
+	applyConfig ();
+	config.printAll (Serial);
+}
+
+void loop ()
+{
+	int inbyte = Serial.read ();
+	if (inbyte < 0 || inbyte == '\r')
+		return;
+	if (inbyte != '\n')
+	{
+		if (lineLength < sizeof(line) - 1)
+			line[lineLength++] = inbyte;
+		return;
+	}
+	line[lineLength] = '\0';
+	lineLength = 0;
+	if (config.command (line, Serial) == CONFIG_CMD_CHANGED)
+		applyConfig ();
+}
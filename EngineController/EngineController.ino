@@ -15,40 +15,146 @@
     - Upon resetting the code shuts off all vales
       and the ignition source.
     - Any input durring the test automatically aborts the engine
+    - While valves are being actuated the ground station must send
+      a keep alive character ('K') every 250ms. The valves are closed
+      if 4 are missed in a row (link loss) or if the code stops
+      running (hardware watchdog)
   Configuration: Configurable variables can be found in the 
     Global Vars section. Anything that can be configured will
-    be documented.
+    be documented. The ones listed in configParams can also be
+    changed over serial (menu option 6) and saved to EEPROM.
   Revision History:
     2014-07-20 - Original Version
     2014-09-08 - Added support for dynamic input of orifice diameters
+    2026-10-19 - Added running total impulse, Isp, C* and O/F (ImpulseCalc)
+    2026-10-19 - Enabled redline checks via a table driven SafetyMonitor
+    2026-10-19 - Non-blocking emergencyStop() using direct port writes (FastStop)
+      with the shutdown transient logged after a danger trip or abort
+    2026-10-19 - Added heartbeat on the operator link + watchdog (FailSafe)
+    2026-10-19 - Added per channel sensor health status to the telemetry (SensorHealth)
+    2026-10-19 - Per channel transducer calibration loaded from EEPROM (TransducerCal)
+    2026-10-19 - Transducer and load cell conversions use the measured Vcc (SupplyMonitor)
+    2026-10-19 - Load cell is tared during the countdown, tracks drift while idle and saves its zero
+    2026-10-19 - Pressure and load cell readings are median + low-pass filtered (SensorFilter)
+    2026-10-19 - Thermocouples use the cold junction compensated NIST type K conversion
+    2026-10-19 - Thermocouples are read in one burst per conversion period (ThermocoupleBank)
+    2026-10-19 - Sensors are read, logged and health checked from one channel table (ChannelTable)
+    2026-10-19 - Engine, orifice, load cell and timing parameters can be changed over serial
+      and saved to EEPROM (ConfigStore). Orifice diameters set from the menu are saved.
+    2026-10-19 - Optional closed loop chamber pressure and O/F control while firing (ThrottleControl)
+    2026-10-19 - Main valves open and close along timed motion profiles (ServoProfile)
+    2026-10-19 - Optional input trace so a session can be replayed on a PC (InputTrace, Tools/TraceReplay)
+    2026-10-19 - Engine thrust uses the exit pressure of the nozzle area ratio and allows for separation
+    2026-10-19 - Optional fuel and ox line thermocouples and propellant property tables for the flows (Propellant)
+    2026-10-19 - PMCtrl can run over any serial port (PMCtrlT), eg. a hardware UART for the Maestro
+    2026-10-19 - Maestro replies are received bit by bit from Timer1 interrupts (SoftwareSerial), so Timer1 is in use
+    2026-10-19 - Buffers are sized against a RAM budget in one place (BufferArena/ArenaConfig.h) and the stack
+      headroom is logged
+    2026-10-19 - Every solenoid, igniter and servo command is logged with its time and source (EventJournal)
+      and sent with the telemetry
+    2026-10-19 - The igniter and ox lead times kick the watchdog and can be aborted; both are limited to 1s
+    2026-10-19 - The engine excess limits are also checked while the main valves open
+    2026-10-19 - The throttle period is at least 50ms (two telemetry lines), as the throttle ticks from the firing loop
+    2026-10-19 - A watchdog trip stops the valve profile and the throttle and aborts the run if the loop comes back
 */
 ////////////////////////////////////
 #include <EngineMath.h>
-#include <Transducer.h>
-#include <Adafruit_MAX31855.h>
+#include <EEPROM.h>
+#include <TransducerCal.h>
+#include <ThermocoupleBank.h>
+#include <ChannelTable.h>
 #include <StopWatch.h>
 #include <SoftwareSerial.h>
 #include <PMCtrl.h>
+#include <ServoProfile.h>
 #include <LoadCell.h>
+#include <ImpulseCalc.h>
+#include <SafetyMonitor.h>
+#include <FastStop.h>
+#include <FailSafe.h>
+#include <SensorHealth.h>
+#include <SupplyMonitor.h>
+#include <SensorFilter.h>
+#include <TypeK.h>
+#include <ConfigStore.h>
+#include <ThrottleControl.h>
+#include <InputTrace.h>
+#include <Propellant.h>
+#include <BufferArena.h>
+#include <EventJournal.h>
+
+// Function prototypes. The Arduino IDE makes these itself; they are
+// here so the sketch also builds as plain C++ (Tools/TraceReplay).
+void setup();
+void loop();
+void testSensors();
+void testControl();
+void manualValveCheck();
+void runEngine();
+void startValveProfile(ProfilePoint *fuelPoints, byte fuelCount, ProfilePoint *oxPoints, byte oxCount);
+void setOrificeDiameters();
+void parameterMenu();
+void applyConfig();
+void sensorRead();
+float readServo(byte feed, int raw);
+float readPSI(byte transducer, int raw);
+float readThermo(byte device, int raw);
+float readLoadCell(byte unused, int raw);
+float readFeedTemp(byte feed, int raw);
+float calcFuelFlow(byte unused, int raw);
+float calcOxFlow(byte unused, int raw);
+float calcIgniterForce(byte unused, int raw);
+float calcEngineFlow(byte unused, int raw);
+float calcEngineForce(byte unused, int raw);
+void applySupplyVoltage();
+int analogReadChecked(int pin, byte healthChannel);
+void setInputHooks();
+unsigned long traceMillis();
+unsigned long traceMicros();
+int traceAnalog(int raw);
+uint32_t traceWord(uint32_t raw);
+unsigned int traceServo(unsigned int reply);
+void sensorDisplay(boolean showHeader);
+void burnSummary();
+void getSerial();
+void getSerialLine(char *line, byte size);
+boolean isAbort();
+boolean isAbortAutoCheck(unsigned long sleepTime);
+boolean isAbortAutoTare(unsigned long sleepTime);
+boolean isShutdownAutoCheck(unsigned long sleepTime);
+byte abortSource();
+void tareSummary();
+void trackLoadCellDrift();
+boolean isDanger(int toCheck);
+boolean isShutdown(int toCheck);
+void emergencyStop();
+void watchdogTrip();
+void closeServos();
+void journalValvesClosed();
+void completeShutdown();
+void shutdownTransient();
+float orificeArea(float orificeDiameter);
 
 ///////////////////////////////////////
 // Start of Global Variables Section //
 ///////////////////////////////////////
 // Pins (Configurable)
-int servoWrite = 12;
-int servoRead = 11;
+const int servoWrite = 12;
+const int servoRead = 11;
 int igniterPin = 10;
 int solenoidFuelValve = 9;
 int solenoidOxValve = 8;
-int thermoDO = 7;
-int igniterThermoCS = 6;    // Igniter Thermocouple Pin
-int engineThermoCS = 5;     // Engine Thermocouple Pin
-int thermoCLK = 4;
-int fuelPSIpin = A0;
-int oxPSIpin = A1;
-int igniterPSIpin = A2;
-int enginePSIpin = A3;
-int loadCellPin = A4;
+const int thermoDO = 7;
+const int igniterThermoCS = 6;    // Igniter Thermocouple Pin
+const int engineThermoCS = 5;     // Engine Thermocouple Pin (more can share thermoCLK/thermoDO, see setup)
+const int fuelThermoCS = -1;      // Fuel line Thermocouple Pin, -1 = not fitted
+const int oxThermoCS = -1;        // Ox line Thermocouple Pin, -1 = not fitted
+const int thermoCLK = 4;
+const byte fuelPSIpin = A0;
+const byte oxPSIpin = A1;
+const byte igniterPSIpin = A2;
+const byte enginePSIpin = A3;
+const byte loadCellPin = A4;
 
 // mathematical constants
 const float pi = 3.141592654;
@@ -58,7 +164,7 @@ int servoClosed = 800;
 int servoOpened = 1600;
 unsigned char fuelChannel = 0;
 unsigned char oxChannel = 1;
-int deviceID = 12;               //servo device ID # (Default is 12)
+const int deviceID = 12;         //servo device ID # (Default is 12)
 
 
 // Known Engine Properties (Configurable)
@@ -72,23 +178,106 @@ float aThroatE = 0.00017;	 // Nozzle throat area for the engine m^2
 float aExitE = 0.00038; 	 // Nozzle exit area for the engine m^2
 
 // additional properties
-float p2PSI = 14.696; 	         // exit pressure (PSI)
+float p2PSI = 0; 	         // exit pressure (PSI). 0 = from the nozzle area ratio and chamber pressure
 float p3PSI = 14.696; 	         // atmospheric pressure (PSI)
 
 // Engine Gas (Ox) Flow Properties (Configurable)
 float gcd = 0.32;                // Coefficient of Discharge (Dimensionless)
 float gk = 1.40;                 // Gas Specific Heat Ratio (Dimensionless)
 float gz = 0.98;                 // Gas Compressability Factor (Dimensionless). Typically .975
-float gtemp = 277.0;             // Gas Temperature at inlet (Kelvin)
+float gtemp = 277.0;             // Gas Temperature at inlet (Kelvin) when there is no ox line thermocouple
+byte oxType = PROP_FIXED;        // PROP_FIXED uses gk, gz and gm. PROP_O2, PROP_N2 or PROP_AIR look them up (Propellant)
 float gm = 32;                   // Gas Molecular Mass  (mol). Ox is 32, Nitrogen, 28.02, Air = 28.97
 float gd = 0.141;                // Orifice Diameter in (in^2)
-float ga = orificeArea(gd);      // Orifice Area (m^2)
+float ga;                        // Orifice Area (m^2), calculated from gd by applyConfig
            
 // Engine Liquid (Fuel) Flow Properties (Configurable)
 float lcd = 0.7;   	         // Coefficient of Discharge (Dimensionless) *** 0.65 igniter, .47 main engine
 float lden = 800;     	         // Liquid Density (kg/m^3) *** 800 ethanol, 1000 water
+float ltemp = 293.0;             // Liquid Temperature (Kelvin) when there is no fuel line thermocouple
+byte fuelType = PROP_FIXED;      // PROP_FIXED uses lden. PROP_ETHANOL or PROP_WATER look it up (Propellant)
 float ld = 0.023;                // Orifice Diameter (in^2)
-float la = orificeArea(ld);      // Orifice Area (m^2)
+float la;                        // Orifice Area (m^2), calculated from ld by applyConfig
+
+// Fail Safe Properties (Configurable)
+byte keepAliveChar = 'K';        // heartbeat character sent by the ground station
+unsigned int heartbeatPeriod = 250; // ms between heartbeats
+byte heartbeatMissedMax = 4;     // missed heartbeats before shutdown (0 = heartbeat not required)
+byte watchdogTimeout = WDTO_250MS; // hung loop timeout
+
+// Sensor Health (Configurable). Raw analog readings outside this range are
+// flagged as out of range (0.5V - 4.5V sensors with a 0.1V margin)
+const int analogMinRaw = 82;     // 0.4V
+const int analogMaxRaw = 941;    // 4.6V
+const byte stuckSamples = 100;   // identical raw readings before a channel is flagged as stuck
+
+// Sensor Filters (Configurable). Applied to the raw pressure and load cell
+// readings after the health check. A median of 3 removes single sample spikes
+// (eg. in enginePSI, which feeds both flow calculations) for one sample of
+// delay; the low-pass adds roughly another sample at 10Hz. Tools/FilterBench
+// shows the response for other settings.
+const float sensorSampleHz = 40.0;   // rate sensorDisplay runs at while logging
+const byte psiMedianWindow = 3;      // 3 or 5, 0 = off
+const float psiCutoffHz = 10.0;      // 0 = off
+const byte loadCellMedianWindow = 3; // 3 or 5, 0 = off
+const float loadCellCutoffHz = 10.0; // 0 = off
+
+// Thermocouple device numbers (the order they are added to the bank in setup)
+#define THERMO_IGNITER 0
+#define THERMO_ENGINE 1
+
+// Feed lines (param of the servo position and feed temperature channels)
+#define FEED_FUEL 0
+#define FEED_OX 1
+
+// Sensor Channels. One per CSV column after Millis, in column order (see
+// sensorChannels below). Channel 'n' is also bit 'n' of the status column.
+// To add a sensor add a channel number here and a row to sensorChannels.
+#define CH_FUEL_POS 0              // fuel servo position (us)
+#define CH_FUEL_PSI 1
+#define CH_FUEL_FLOW 2             // kg/sec
+#define CH_OX_POS 3                // ox servo position (us)
+#define CH_OX_PSI 4
+#define CH_OX_FLOW 5               // kg/sec
+#define CH_IGNITER_PSI 6
+#define CH_IGNITER_TEMP 7          // Celsius
+#define CH_IGNITER_FORCE 8         // lbf
+#define CH_ENGINE_PSI 9
+#define CH_ENGINE_FLOW 10          // kg/sec
+#define CH_ENGINE_TEMP 11          // Celsius
+#define CH_ENGINE_FORCE_CALC 12    // calculated value (lbf)
+#define CH_ENGINE_FORCE_SENSOR 13  // read from a load cell (lbf)
+#define CH_FUEL_TEMP 14            // Celsius (ltemp if no thermocouple)
+#define CH_OX_TEMP 15              // Celsius (gtemp if no thermocouple)
+#define CH_COUNT 16
+static_assert (CH_COUNT <= CHANNEL_MAX, "CH_COUNT: ChannelTable and the SensorHealth status bitmap take CHANNEL_MAX channels");
+
+// Pressure transducer numbers (param of the PSI channels)
+#define PSI_FUEL 0
+#define PSI_OX 1
+#define PSI_IGNITER 2
+#define PSI_ENGINE 3
+
+// Transducer Models (Configurable). Used when no calibration table has been
+// saved to the channel's EEPROM address (see TransducerCal example sketch)
+const byte fuelPSImodel = TRANSDUCER_MSI;
+const byte oxPSImodel = TRANSDUCER_MSI;
+const byte igniterPSImodel = TRANSDUCER_MSI;
+const byte enginePSImodel = TRANSDUCER_MSI;
+
+// EEPROM Layout
+#define EEPROM_FUEL_PSI_CAL 0
+#define EEPROM_OX_PSI_CAL (EEPROM_FUEL_PSI_CAL + TRANSDUCER_CAL_EEPROM_SIZE)
+#define EEPROM_IGNITER_PSI_CAL (EEPROM_OX_PSI_CAL + TRANSDUCER_CAL_EEPROM_SIZE)
+#define EEPROM_ENGINE_PSI_CAL (EEPROM_IGNITER_PSI_CAL + TRANSDUCER_CAL_EEPROM_SIZE)
+#define EEPROM_LOAD_CELL_ZERO (EEPROM_ENGINE_PSI_CAL + TRANSDUCER_CAL_EEPROM_SIZE)
+#define EEPROM_CONFIG (EEPROM_LOAD_CELL_ZERO + LOADCELL_EEPROM_SIZE)
+#define EEPROM_CONFIG_SIZE 192     // room for configParams to grow (it needs config.getSize())
+#define EEPROM_END (EEPROM_CONFIG + EEPROM_CONFIG_SIZE)
+
+// Supply Voltage Measurement (Configurable)
+const unsigned int vccInterval = 64; // sensor reads between Vcc measurements (~0.3ms each)
+const float bandgapV = 1.1;          // internal reference of this micro (nominal 1.1V +/-10%)
 
 // Load Cell Calibration Parameters
 float inV = 5.0;		        // input supply voltage
@@ -96,28 +285,278 @@ float noLoadCalcV = 0.547;		// no load calculated voltage (used for calibration)
 float loadMassV = 4.0;			// the calibrated output voltage at full mass
 float loadMassLBF = 100.0;		// the mass of the calibration input;
 
+// Load Cell Zero Tracking (Configurable). noLoadCalcV is only used until a
+// zero has been saved to EEPROM
+unsigned int tareSamples = 200;   // readings averaged during the countdown
+unsigned int tarePeriod = 20;     // ms between tare readings (200 * 20ms = first 4s of the countdown)
+float tareMaxNoiseLBF = 0.5;      // tare is rejected (saved zero kept) if noisier than this
+unsigned int driftPeriod = 100;   // ms between drift tracker readings while idle
+float driftWindowLBF = 2.0;       // idle readings further than this from zero are not tracked
+
+// Firing Sequence Timing (Configurable). All in ms. The lead times are
+// limited to 1000ms (configParams); the operator can abort during them.
+unsigned int igniterLeadTime = 425;  // igniter on before the igniter ox valve opens
+unsigned int oxLeadTime = 75;        // igniter ox valve open before the igniter fuel valve
+unsigned int startupTime = 1000;     // igniter only run before the main valves open
+unsigned int mainValveTime = 2000;   // main valves must report open by this time
+unsigned int shutdownTime = 3000;    // longest wait for the igniter pressure to fall after a run
+
+// Main Valve Motion (Configurable). Points are ms from the start of the
+// opening or closing and percent open (see ServoProfile). The defaults
+// match the old servo speeds: fuel 25 (1280ms) and ox 200 (160ms) when
+// opening, the other way round when closing. Closing starts from where
+// each valve is.
+ProfilePoint fuelOpenProfile[] = { { 0, 0, PROFILE_STEP }, { 1280, 100, PROFILE_LINEAR } };
+ProfilePoint oxOpenProfile[] = { { 0, 0, PROFILE_STEP }, { 160, 100, PROFILE_LINEAR } };
+ProfilePoint fuelCloseProfile[] = { { 0, PROFILE_CURRENT, PROFILE_STEP }, { 160, 0, PROFILE_LINEAR } };
+ProfilePoint oxCloseProfile[] = { { 0, PROFILE_CURRENT, PROFILE_STEP }, { 1280, 0, PROFILE_LINEAR } };
+unsigned int profilePeriod = PROFILE_PERIOD; // ms between setpoints
+
+// Throttling (Configurable). With both targets at 0 the main valves are
+// simply opened fully. Gains were tuned with Tools/ThrottleSim.
+float throttlePSI = 0;                 // chamber pressure target (psi), 0 = off
+float throttleMR = 0;                  // mixture ratio (O/F) target, 0 = off
+unsigned int throttlePeriod = 50;      // ms between control ticks (min 50, 2 telemetry lines)
+unsigned int throttleServoSpeed = 100; // servo speed while throttling (Maestro units)
+float pressureGainP = THROTTLE_PRESSURE_KP;
+float pressureGainI = THROTTLE_PRESSURE_KI;
+float mixtureGainP = THROTTLE_MIXTURE_KP;
+float mixtureGainI = THROTTLE_MIXTURE_KI;
+
+// Input Trace (Configurable). 1 = every input is sent in '~' chunks
+// with the output (from the next reset) so Tools/TraceReplay can
+// replay the session. It roughly halves the telemetry rate.
+byte traceInputs = 0;
+
 // do not edit past this line
-float fuelPSI;
-float fuelFlow;            // kg/sec
-float oxPSI;
-float oxFlow;              // kg/sec
-float igniterPSI;
-double igniterTemp;        // Celsius
-float igniterForce;        // lbf
-float enginePSI;
-float engineFlow;          // kg/sec
-double engineTemp;         // Celsius
-float engineForceCalc;     // calculated value (lbf)
-float engineForceSensor;   // read from a load cell (lbf)
-float g = 9.80665;         // Gravity m/sec^2
+float sensorValues[CH_COUNT];   // latest value of each sensor channel
+int feedThermo[2] = { -1, -1 }; // bank device number of the fuel and ox line thermocouples, -1 = none
+const float g = 9.80665;   // Gravity m/sec^2
 long serialData;
 StopWatch sw;
 EngineMath em;
-Transducer transducer;
-Adafruit_MAX31855 igniterThermo(thermoCLK, igniterThermoCS, thermoDO); // igniter thermocouple
-Adafruit_MAX31855 engineThermo(thermoCLK, engineThermoCS, thermoDO);   // engine thermocouple
-PMCtrl servoCtrl (servoRead, servoWrite, 57600);                       // RX, TX, Baud
+TransducerCal fuelPSIcal (fuelPSImodel);
+TransducerCal oxPSIcal (oxPSImodel);
+TransducerCal igniterPSIcal (igniterPSImodel);
+TransducerCal enginePSIcal (enginePSImodel);
+TransducerCal *psiCal[] = { &fuelPSIcal, &oxPSIcal, &igniterPSIcal, &enginePSIcal }; // by PSI_ number
+ThermocoupleBank thermos (thermoCLK, thermoDO);                        // all thermocouples (MAX31855)
+PMCtrl servoCtrl (servoRead, servoWrite, 57600);                       // RX, TX, Baud. With a spare UART (eg. Mega):
+                                                                       //   PMCtrlT<HardwareSerial> servoCtrl (Serial1); + Serial1.begin(57600)
+ServoProfile valveProfile (servoCtrl, deviceID, servoClosed, servoOpened, profilePeriod); // main valve motion
 LoadCell loadCell (inV, noLoadCalcV, loadMassV, loadMassLBF);          // load cell calibration
+ImpulseCalc burnCalc (aThroatE);                                       // running impulse, Isp, C*, O/F
+ThrottleControl throttle (servoClosed, servoOpened, throttlePeriod);   // chamber pressure + O/F loops
+
+// Redlines (Configurable). Checked every time the sensors are read while
+// the engine is running. 'persist' is the number of consecutive bad samples
+// needed to trip, so the worst case latency is persist * sample period
+// (~25ms per sample with the full CSV output at 57600 baud). The table is
+// kept in PROGMEM.
+#define DANGER_IGNITER 0x01        // igniter excess limits
+#define DANGER_IGNITER_NOGO 0x02   // igniter not producing pressure
+#define DANGER_ENGINE 0x04         // engine excess limits
+#define DANGER_ENGINE_NOGO 0x08    // engine not producing pressure
+const char dangerIgniterPSI[] PROGMEM = "igniterPSI";
+const char dangerIgniterTemp[] PROGMEM = "igniterTemp";
+const char dangerEnginePSI[] PROGMEM = "enginePSI";
+const char dangerEngineTemp[] PROGMEM = "engineTemp";
+const SafetyRule dangerRules[] PROGMEM =
+{
+  // value                           min              max              rate (/sec)      persist  group                name
+  { &sensorValues[CH_IGNITER_PSI],   SAFETY_NO_LIMIT, 150,             SAFETY_NO_LIMIT, 3,       DANGER_IGNITER,      dangerIgniterPSI },
+  { &sensorValues[CH_IGNITER_TEMP],  SAFETY_NO_LIMIT, 400,             SAFETY_NO_LIMIT, 3,       DANGER_IGNITER,      dangerIgniterTemp },
+  { &sensorValues[CH_IGNITER_PSI],   50,              SAFETY_NO_LIMIT, SAFETY_NO_LIMIT, 3,       DANGER_IGNITER_NOGO, dangerIgniterPSI },
+  { &sensorValues[CH_ENGINE_PSI],    SAFETY_NO_LIMIT, 200,             SAFETY_NO_LIMIT, 3,       DANGER_ENGINE,       dangerEnginePSI },
+  { &sensorValues[CH_ENGINE_PSI],    SAFETY_NO_LIMIT, SAFETY_NO_LIMIT, 5000,            2,       DANGER_ENGINE,       dangerEnginePSI },
+  { &sensorValues[CH_ENGINE_TEMP],   SAFETY_NO_LIMIT, 400,             SAFETY_NO_LIMIT, 3,       DANGER_ENGINE,       dangerEngineTemp },
+  { &sensorValues[CH_ENGINE_PSI],    50,              SAFETY_NO_LIMIT, SAFETY_NO_LIMIT, 3,       DANGER_ENGINE_NOGO,  dangerEnginePSI },
+};
+static_assert (sizeof(dangerRules) / sizeof(dangerRules[0]) <= SAFETY_MAX_RULES, "dangerRules: SafetyMonitor only checks the first SAFETY_MAX_RULES rules");
+SafetyMonitor safety (dangerRules, sizeof(dangerRules) / sizeof(dangerRules[0]));
+FastStop valveStop;                                                    // direct port shutdown of valves + igniter
+FailSafe failSafe (watchdogTrip, keepAliveChar, heartbeatPeriod, heartbeatMissedMax); // link loss + watchdog
+volatile boolean watchdogTripped = false;                              // set by watchdogTrip() until the menu
+SensorHealth health (stuckSamples);                                    // per channel fault tracking
+SupplyMonitor supply (vccInterval, bandgapV);                          // Vcc (ADC reference + sensor supply)
+SensorFilter fuelPSIfilter (psiMedianWindow, psiCutoffHz, sensorSampleHz);
+SensorFilter oxPSIfilter (psiMedianWindow, psiCutoffHz, sensorSampleHz);
+SensorFilter igniterPSIfilter (psiMedianWindow, psiCutoffHz, sensorSampleHz);
+SensorFilter enginePSIfilter (psiMedianWindow, psiCutoffHz, sensorSampleHz);
+SensorFilter loadCellFilter (loadCellMedianWindow, loadCellCutoffHz, sensorSampleHz);
+
+// Sensor Channel Table. Analog channels are filtered and then converted,
+// device channels read their device and derived channels are calculated
+// once everything else has been read. Output is the CSV column order. The
+// table is kept in PROGMEM, so every field is a constant (the servo channels
+// are looked up by feed line when they are read).
+float readServo (byte feed, int raw);
+float readPSI (byte transducer, int raw);
+float readThermo (byte device, int raw);
+float readLoadCell (byte unused, int raw);
+float readFeedTemp (byte feed, int raw);
+float calcFuelFlow (byte unused, int raw);
+float calcOxFlow (byte unused, int raw);
+float calcIgniterForce (byte unused, int raw);
+float calcEngineFlow (byte unused, int raw);
+float calcEngineForce (byte unused, int raw);
+const char chFuelPos[] PROGMEM = "fuelPos(us)";
+const char chFuelPSI[] PROGMEM = "fuelPSI";
+const char chFuelFlow[] PROGMEM = "fuelFlow(kg/sec)";
+const char chOxPos[] PROGMEM = "oxPos(us)";
+const char chOxPSI[] PROGMEM = "oxPSI";
+const char chOxFlow[] PROGMEM = "oxFlow(kg/sec)";
+const char chIgniterPSI[] PROGMEM = "igniterPSI";
+const char chIgniterTemp[] PROGMEM = "igniterTemp(C)";
+const char chIgniterForce[] PROGMEM = "igniterForce(lbf)";
+const char chEnginePSI[] PROGMEM = "enginePSI";
+const char chEngineFlow[] PROGMEM = "engineFlow(kg/sec)";
+const char chEngineTemp[] PROGMEM = "engineTemp(C)";
+const char chEngineForceCalc[] PROGMEM = "engineForceCalc(lbf)";
+const char chEngineForceSensor[] PROGMEM = "engineForceSensor(lbf)";
+const char chFuelTemp[] PROGMEM = "fuelTemp(C)";
+const char chOxTemp[] PROGMEM = "oxTemp(C)";
+const SensorChannel sensorChannels[CH_COUNT] PROGMEM =
+{
+  // name              type             source         param           decimals filter             convert
+  { chFuelPos,         CHANNEL_DEVICE,  0,             FEED_FUEL,      0,       NULL,              readServo },
+  { chFuelPSI,         CHANNEL_ANALOG,  fuelPSIpin,    PSI_FUEL,       2,       &fuelPSIfilter,    readPSI },
+  { chFuelFlow,        CHANNEL_DERIVED, 0,             0,              8,       NULL,              calcFuelFlow },
+  { chOxPos,           CHANNEL_DEVICE,  0,             FEED_OX,        0,       NULL,              readServo },
+  { chOxPSI,           CHANNEL_ANALOG,  oxPSIpin,      PSI_OX,         2,       &oxPSIfilter,      readPSI },
+  { chOxFlow,          CHANNEL_DERIVED, 0,             0,              8,       NULL,              calcOxFlow },
+  { chIgniterPSI,      CHANNEL_ANALOG,  igniterPSIpin, PSI_IGNITER,    2,       &igniterPSIfilter, readPSI },
+  { chIgniterTemp,     CHANNEL_DEVICE,  0,             THERMO_IGNITER, 2,       NULL,              readThermo },
+  { chIgniterForce,    CHANNEL_DERIVED, 0,             0,              2,       NULL,              calcIgniterForce },
+  { chEnginePSI,       CHANNEL_ANALOG,  enginePSIpin,  PSI_ENGINE,     2,       &enginePSIfilter,  readPSI },
+  { chEngineFlow,      CHANNEL_DERIVED, 0,             0,              8,       NULL,              calcEngineFlow },
+  { chEngineTemp,      CHANNEL_DEVICE,  0,             THERMO_ENGINE,  2,       NULL,              readThermo },
+  { chEngineForceCalc, CHANNEL_DERIVED, 0,             0,              2,       NULL,              calcEngineForce },
+  { chEngineForceSensor, CHANNEL_ANALOG, loadCellPin,  0,              2,       &loadCellFilter,   readLoadCell },
+  { chFuelTemp,        CHANNEL_DEVICE,  0,             FEED_FUEL,      2,       NULL,              readFeedTemp },
+  { chOxTemp,          CHANNEL_DEVICE,  0,             FEED_OX,        2,       NULL,              readFeedTemp },
+};
+ChannelTable sensors (sensorChannels, CH_COUNT, sensorValues, health);
+
+// Configuration Parameters. Can be listed and changed over serial (menu
+// option 6) and saved to EEPROM. A valid saved configuration replaces the
+// values above at boot. Change CONFIG_VERSION whenever rows are added,
+// removed or reordered so an old saved configuration is ignored instead
+// of being misread. Names must not contain the keep alive character.
+#define CONFIG_VERSION 5
+const char cfgServoClosed[] PROGMEM = "servoClosed";
+const char cfgServoOpened[] PROGMEM = "servoOpened";
+const char cfgKI[] PROGMEM = "kI";
+const char cfgAThroatI[] PROGMEM = "aThroatI";
+const char cfgAExitI[] PROGMEM = "aExitI";
+const char cfgKE[] PROGMEM = "kE";
+const char cfgAThroatE[] PROGMEM = "aThroatE";
+const char cfgAExitE[] PROGMEM = "aExitE";
+const char cfgP2PSI[] PROGMEM = "p2PSI";
+const char cfgP3PSI[] PROGMEM = "p3PSI";
+const char cfgGcd[] PROGMEM = "gcd";
+const char cfgGk[] PROGMEM = "gk";
+const char cfgGz[] PROGMEM = "gz";
+const char cfgGtemp[] PROGMEM = "gtemp";
+const char cfgGm[] PROGMEM = "gm";
+const char cfgOxType[] PROGMEM = "oxType";
+const char cfgGd[] PROGMEM = "gd";
+const char cfgLcd[] PROGMEM = "lcd";
+const char cfgLden[] PROGMEM = "lden";
+const char cfgLd[] PROGMEM = "ld";
+const char cfgLtemp[] PROGMEM = "ltemp";
+const char cfgFuelType[] PROGMEM = "fuelType";
+const char cfgInV[] PROGMEM = "inV";
+const char cfgNoLoadCalcV[] PROGMEM = "noLoadCalcV";
+const char cfgLoadMassV[] PROGMEM = "loadMassV";
+const char cfgLoadMassLBF[] PROGMEM = "loadMassLBF";
+const char cfgTareSamples[] PROGMEM = "tareSamples";
+const char cfgTarePeriod[] PROGMEM = "tarePeriod";
+const char cfgTareMaxNoiseLBF[] PROGMEM = "tareMaxNoiseLBF";
+const char cfgDriftPeriod[] PROGMEM = "driftPeriod";
+const char cfgDriftWindowLBF[] PROGMEM = "driftWindowLBF";
+const char cfgIgniterLeadTime[] PROGMEM = "igniterLeadTime";
+const char cfgOxLeadTime[] PROGMEM = "oxLeadTime";
+const char cfgStartupTime[] PROGMEM = "startupTime";
+const char cfgMainValveTime[] PROGMEM = "mainValveTime";
+const char cfgShutdownTime[] PROGMEM = "shutdownTime";
+const char cfgFuelOpenTime[] PROGMEM = "fuelOpenTime";
+const char cfgFuelOpenShape[] PROGMEM = "fuelOpenShape";
+const char cfgOxOpenTime[] PROGMEM = "oxOpenTime";
+const char cfgOxOpenShape[] PROGMEM = "oxOpenShape";
+const char cfgFuelCloseTime[] PROGMEM = "fuelCloseTime";
+const char cfgFuelCloseShape[] PROGMEM = "fuelCloseShape";
+const char cfgOxCloseTime[] PROGMEM = "oxCloseTime";
+const char cfgOxCloseShape[] PROGMEM = "oxCloseShape";
+const char cfgProfilePeriod[] PROGMEM = "profilePeriod";
+const char cfgThrottlePSI[] PROGMEM = "throttlePSI";
+const char cfgThrottleMR[] PROGMEM = "throttleMR";
+const char cfgThrottlePeriod[] PROGMEM = "throttlePeriod";
+const char cfgThrottleServoSpeed[] PROGMEM = "throttleServoSpeed";
+const char cfgPressureGainP[] PROGMEM = "pressureGainP";
+const char cfgPressureGainI[] PROGMEM = "pressureGainI";
+const char cfgMixtureGainP[] PROGMEM = "mixtureGainP";
+const char cfgMixtureGainI[] PROGMEM = "mixtureGainI";
+const char cfgTraceInputs[] PROGMEM = "traceInputs";
+const ConfigParam configParams[] PROGMEM =
+{
+  // name              value             type          decimals min       max
+  { cfgServoClosed,    &servoClosed,     CONFIG_INT,   0,       500,      2500 },
+  { cfgServoOpened,    &servoOpened,     CONFIG_INT,   0,       500,      2500 },
+  { cfgKI,             &kI,              CONFIG_FLOAT, 3,       1.0,      2.0 },
+  { cfgAThroatI,       &aThroatI,        CONFIG_FLOAT, 8,       1e-7,     0.01 },
+  { cfgAExitI,         &aExitI,          CONFIG_FLOAT, 8,       1e-7,     0.01 },
+  { cfgKE,             &kE,              CONFIG_FLOAT, 3,       1.0,      2.0 },
+  { cfgAThroatE,       &aThroatE,        CONFIG_FLOAT, 8,       1e-7,     0.01 },
+  { cfgAExitE,         &aExitE,          CONFIG_FLOAT, 8,       1e-7,     0.01 },
+  { cfgP2PSI,          &p2PSI,           CONFIG_FLOAT, 3,       0,        1000 },
+  { cfgP3PSI,          &p3PSI,           CONFIG_FLOAT, 3,       0,        30 },
+  { cfgGcd,            &gcd,             CONFIG_FLOAT, 3,       0.01,     1.0 },
+  { cfgGk,             &gk,              CONFIG_FLOAT, 3,       1.0,      2.0 },
+  { cfgGz,             &gz,              CONFIG_FLOAT, 3,       0.5,      1.5 },
+  { cfgGtemp,          &gtemp,           CONFIG_FLOAT, 1,       50,       500 },
+  { cfgGm,             &gm,              CONFIG_FLOAT, 2,       1,        100 },
+  { cfgOxType,         &oxType,          CONFIG_BYTE,  0,       0,        PROP_GASES },
+  { cfgGd,             &gd,              CONFIG_FLOAT, 3,       0,        1.0 },
+  { cfgLcd,            &lcd,             CONFIG_FLOAT, 3,       0.01,     1.0 },
+  { cfgLden,           &lden,            CONFIG_FLOAT, 1,       100,      2000 },
+  { cfgLd,             &ld,              CONFIG_FLOAT, 3,       0,        1.0 },
+  { cfgLtemp,          &ltemp,           CONFIG_FLOAT, 1,       200,      400 },
+  { cfgFuelType,       &fuelType,        CONFIG_BYTE,  0,       0,        PROP_LIQUIDS },
+  { cfgInV,            &inV,             CONFIG_FLOAT, 3,       4.0,      5.5 },
+  { cfgNoLoadCalcV,    &noLoadCalcV,     CONFIG_FLOAT, 4,       0,        5.0 },
+  { cfgLoadMassV,      &loadMassV,       CONFIG_FLOAT, 3,       0.1,      5.0 },
+  { cfgLoadMassLBF,    &loadMassLBF,     CONFIG_FLOAT, 1,       1,        10000 },
+  { cfgTareSamples,    &tareSamples,     CONFIG_UINT,  0,       1,        1000 },
+  { cfgTarePeriod,     &tarePeriod,      CONFIG_UINT,  0,       1,        1000 },
+  { cfgTareMaxNoiseLBF, &tareMaxNoiseLBF, CONFIG_FLOAT, 2,      0,        100 },
+  { cfgDriftPeriod,    &driftPeriod,     CONFIG_UINT,  0,       10,       60000 },
+  { cfgDriftWindowLBF, &driftWindowLBF,  CONFIG_FLOAT, 2,       0,        100 },
+  { cfgIgniterLeadTime, &igniterLeadTime, CONFIG_UINT, 0,       0,        1000 },
+  { cfgOxLeadTime,     &oxLeadTime,      CONFIG_UINT,  0,       0,        1000 },
+  { cfgStartupTime,    &startupTime,     CONFIG_UINT,  0,       0,        10000 },
+  { cfgMainValveTime,  &mainValveTime,   CONFIG_UINT,  0,       0,        10000 },
+  { cfgShutdownTime,   &shutdownTime,    CONFIG_UINT,  0,       0,        30000 },
+  { cfgFuelOpenTime,   &fuelOpenProfile[1].timeMs,  CONFIG_UINT, 0, 0,    10000 },
+  { cfgFuelOpenShape,  &fuelOpenProfile[1].shape,   CONFIG_BYTE, 0, 0,    PROFILE_SCURVE },
+  { cfgOxOpenTime,     &oxOpenProfile[1].timeMs,    CONFIG_UINT, 0, 0,    10000 },
+  { cfgOxOpenShape,    &oxOpenProfile[1].shape,     CONFIG_BYTE, 0, 0,    PROFILE_SCURVE },
+  { cfgFuelCloseTime,  &fuelCloseProfile[1].timeMs, CONFIG_UINT, 0, 0,    10000 },
+  { cfgFuelCloseShape, &fuelCloseProfile[1].shape,  CONFIG_BYTE, 0, 0,    PROFILE_SCURVE },
+  { cfgOxCloseTime,    &oxCloseProfile[1].timeMs,   CONFIG_UINT, 0, 0,    10000 },
+  { cfgOxCloseShape,   &oxCloseProfile[1].shape,    CONFIG_BYTE, 0, 0,    PROFILE_SCURVE },
+  { cfgProfilePeriod,  &profilePeriod,   CONFIG_UINT,  0,       1,        1000 },
+  { cfgThrottlePSI,    &throttlePSI,     CONFIG_FLOAT, 1,       0,        1000 },
+  { cfgThrottleMR,     &throttleMR,      CONFIG_FLOAT, 2,       0,        10 },
+  { cfgThrottlePeriod, &throttlePeriod,  CONFIG_UINT,  0,       50,       1000 },
+  { cfgThrottleServoSpeed, &throttleServoSpeed, CONFIG_UINT, 0, 0,        1000 },
+  { cfgPressureGainP,  &pressureGainP,   CONFIG_FLOAT, 3,       0,        10 },
+  { cfgPressureGainI,  &pressureGainI,   CONFIG_FLOAT, 3,       0,        100 },
+  { cfgMixtureGainP,   &mixtureGainP,    CONFIG_FLOAT, 3,       0,        10 },
+  { cfgMixtureGainI,   &mixtureGainI,    CONFIG_FLOAT, 3,       0,        100 },
+  { cfgTraceInputs,    &traceInputs,     CONFIG_BYTE,  0,       0,        1 },
+};
+ConfigStore config (configParams, sizeof(configParams) / sizeof(configParams[0]), CONFIG_VERSION, EEPROM_CONFIG, EEPROM_CONFIG_SIZE);
 
 //////////////////////////////////////
 // End of Global Variables Section //
@@ -125,21 +564,58 @@ LoadCell loadCell (inV, noLoadCalcV, loadMassV, loadMassLBF);          // load c
 
 void setup ()
 {
+  boolean watchdogReset = FailSafe::bootCheck();
+  stackProbe.begin();
+  setInputHooks();
   Serial.begin(57600); //57600 needed for xbee modules
   
+  // Load the saved configuration. The input trace (if on) has to start
+  // before any input is read.
+  boolean configLoaded = config.load();
+  if (traceInputs == 1)
+    inputTrace.begin (Serial, EEPROM_END);
+  if (inputTrace.input (TRACE_BOOT, watchdogReset) != 0)
+    Serial.println (F("WARNING: Reset by watchdog. Valves were forced closed."));
+  if (configLoaded == false)
+    Serial.println (F("No saved configuration. Using defaults."));
+  if (inputTrace.input (TRACE_WORD, stackProbe.getFree()) < ARENA_STACK_RESERVE)
+    Serial.println (F("WARNING: Less free RAM than ARENA_STACK_RESERVE. Check the budget in ArenaConfig.h."));
+  
   // Setup Pins
   pinMode (solenoidFuelValve, OUTPUT);
   pinMode (solenoidOxValve, OUTPUT);
   pinMode (igniterPin, OUTPUT);   
+  thermos.addDevice (igniterThermoCS);   // THERMO_IGNITER
+  thermos.addDevice (engineThermoCS);    // THERMO_ENGINE
+  if (fuelThermoCS >= 0)
+    feedThermo[FEED_FUEL] = thermos.addDevice (fuelThermoCS);
+  if (oxThermoCS >= 0)
+    feedThermo[FEED_OX] = thermos.addDevice (oxThermoCS);
+  thermos.begin ();
+  sensors.setAnalogRange (analogMinRaw, analogMaxRaw);
   
-  // Set the global servo speed (Can be modified further below). Note - 50 is ~1 second to open and hgher numbers are faster
- //servoCtrl.setServoSpeed (25, fuelChannel, deviceID);
- //servoCtrl.setServoSpeed (200, oxChannel, deviceID);
+  // Apply the configuration and load any transducer calibration tables
+  applyConfig();
+  fuelPSIcal.load (EEPROM_FUEL_PSI_CAL);
+  oxPSIcal.load (EEPROM_OX_PSI_CAL);
+  igniterPSIcal.load (EEPROM_IGNITER_PSI_CAL);
+  enginePSIcal.load (EEPROM_ENGINE_PSI_CAL);
+  supply.measure();
+  applySupplyVoltage();
+  valveStop.addPin (solenoidFuelValve);
+  valveStop.addPin (solenoidOxValve);
+  valveStop.addPin (igniterPin);
+  servoCtrl.setJournal (&journal);
 }
 
 void loop () 
 {
   emergencyStop();
+  failSafe.end();
+  watchdogTripped = false;
+  completeShutdown();
+  journal.flush(Serial);
+  journal.setSource(JOURNAL_SEQUENCER);
   
   //////////////////////
   ///// Main Menu /////
@@ -153,6 +629,7 @@ void loop ()
   Serial.print (gd,3);
   Serial.println (F(" F/O in)"));
   Serial.println (F("(5) Run Engine"));
+  Serial.println (F("(6) Parameters"));
 
   getSerial();
   switch (serialData)
@@ -180,6 +657,12 @@ void loop ()
       case 5: // Run Engine
       {
         runEngine();
+        burnSummary();
+        break;
+      }
+      case 6: // Read/Change Configuration Parameters
+      {
+        parameterMenu();
         break;
       }
   }
@@ -199,6 +682,8 @@ void testSensors()
   sensorDisplay(true);
   while (isAbort() == false)
   {  
+    if (health.getStatus() != 0)
+      sensors.printFaults(Serial);
     sw.millisToSleep(2000);
     sensorDisplay(false);
   }
@@ -210,33 +695,34 @@ void testSensors()
 */
 void testControl()
 {
+  failSafe.begin(watchdogTimeout);
   Serial.println(F("Opening fuel igniter valve"));
-  digitalWrite(solenoidFuelValve, HIGH); 
+  journal.digitalWrite(solenoidFuelValve, HIGH); 
   if (isAbortAutoCheck(2000) == true)
     return;
 
   Serial.println(F("Opening ox igniter valve"));
-  digitalWrite(solenoidOxValve, HIGH); 
+  journal.digitalWrite(solenoidOxValve, HIGH); 
   if (isAbortAutoCheck(2000) == true)
     return;
 
   Serial.println(F("Turning on igniter"));
-  digitalWrite(igniterPin, HIGH); 
+  journal.digitalWrite(igniterPin, HIGH); 
   if (isAbortAutoCheck(2000) == true)
     return;
   
   Serial.println(F("Closing fuel igniter valve"));
-  digitalWrite(solenoidFuelValve, LOW); 
+  journal.digitalWrite(solenoidFuelValve, LOW); 
   if (isAbortAutoCheck(2000) == true)
     return;
 
   Serial.println(F("Closing ox igniter valve"));
-  digitalWrite(solenoidOxValve, LOW); 
+  journal.digitalWrite(solenoidOxValve, LOW); 
   if (isAbortAutoCheck(2000) == true)
     return;
 
   Serial.println(F("Turning off igniter"));
-  digitalWrite(igniterPin, LOW); 
+  journal.digitalWrite(igniterPin, LOW); 
   if (isAbortAutoCheck(2000) == true)
     return;
   
@@ -262,18 +748,18 @@ void testControl()
 
 
   Serial.println(F("On all at once"));
-  digitalWrite(solenoidFuelValve, HIGH); 
-  digitalWrite(solenoidOxValve, HIGH);
-  digitalWrite(igniterPin, HIGH);
+  journal.digitalWrite(solenoidFuelValve, HIGH); 
+  journal.digitalWrite(solenoidOxValve, HIGH);
+  journal.digitalWrite(igniterPin, HIGH);
   servoCtrl.setTarget (servoOpened, fuelChannel, deviceID);
   servoCtrl.setTarget (servoOpened, oxChannel, deviceID);
   if (isAbortAutoCheck(5000) == true)
     return;
   
   Serial.println(F("Off all at once"));
-  digitalWrite(solenoidFuelValve, LOW); 
-  digitalWrite(solenoidOxValve, LOW);
-  digitalWrite(igniterPin, LOW);
+  journal.digitalWrite(solenoidFuelValve, LOW); 
+  journal.digitalWrite(solenoidOxValve, LOW);
+  journal.digitalWrite(igniterPin, LOW);
   servoCtrl.setTarget (servoClosed, fuelChannel, deviceID);
   servoCtrl.setTarget (servoClosed, oxChannel, deviceID);
 }
@@ -291,16 +777,17 @@ void manualValveCheck()
   
   Serial.println(F("Which valve? 1=IgniterFuel, 2=IgniterOx, 3=EngineFuel, 4=EngineOx"));
   getSerial();
+  failSafe.begin(watchdogTimeout);
   switch (serialData)
   {
       case 1:
       {
-        digitalWrite(solenoidFuelValve, HIGH); 
+        journal.digitalWrite(solenoidFuelValve, HIGH); 
         break;
       }
       case 2:
       {
-        digitalWrite(solenoidOxValve, HIGH);
+        journal.digitalWrite(solenoidOxValve, HIGH);
         break;
       }
       case 3:
@@ -331,71 +818,109 @@ void runEngine ()
     if (serialData <= 0)
       return;
     engineRunTime = serialData;
+    failSafe.begin(watchdogTimeout);
+    loadCell.beginTare(tareSamples, tareMaxNoiseLBF);
     Serial.print(F("Starting Engine in: "));
     for (int i=5; i>0; i--)
     {
-      if (isAbortAutoCheck(1000) == true)
+      if (isAbortAutoTare(1000) == true)
         return;
       Serial.print (i);
       Serial.print (F(", "));
     }
     Serial.print(F("\n"));
-    digitalWrite(igniterPin, HIGH);
-    sw.millisToSleep(425);
-    digitalWrite(solenoidOxValve, HIGH);
-    sw.millisToSleep(75);
-    digitalWrite(solenoidFuelValve, HIGH); 
+    tareSummary();
+    safety.reset();
+    journal.digitalWrite(igniterPin, HIGH);
+    if (isShutdownAutoCheck(igniterLeadTime) == true)
+      return;
+    journal.digitalWrite(solenoidOxValve, HIGH);
+    if (isShutdownAutoCheck(oxLeadTime) == true)
+      return;
+    journal.digitalWrite(solenoidFuelValve, HIGH); 
     sw.startTimer(engineRunTime);
     sensorDisplay(true);
-    // run for up to 1000ms to give it a chance for pressure to come up
-    while (sw.timeElapsed() < 1000 && (sw.timerStatus() == true))
+    // run for up to startupTime to give it a chance for pressure to come up
+    while (sw.timeElapsed() < startupTime && (sw.timerStatus() == true))
     {
-      if (isAbort() == true)
-        return; 
       sensorDisplay(false);
+      if (isShutdown(3) == true)
+        return; 
     }
     Serial.println(F("Initial Startup Complete. Opening Main Valves..."));
-    servoCtrl.setServoSpeed (25, fuelChannel, deviceID);
-    servoCtrl.setServoSpeed (200, oxChannel, deviceID);
-    servoCtrl.setTarget (servoOpened, fuelChannel, deviceID);
-    servoCtrl.setTarget (servoOpened, oxChannel, deviceID);
-    while (sw.timeElapsed() < 2000 && (sw.timerStatus() == true))
+    startValveProfile (fuelOpenProfile, PROFILE_POINTS(fuelOpenProfile), oxOpenProfile, PROFILE_POINTS(oxOpenProfile));
+    while (sw.timeElapsed() < mainValveTime && (sw.timerStatus() == true))
     {
+      valveProfile.update (sw.timeElapsed());   // once per telemetry line, so setpoints land up to ~25ms late
       sensorDisplay(false);
-      if (/*(isDanger(1) == true) OR */(isAbort() == true))
+      if (isShutdown(4) == true)
         return; 
-      if ((servoCtrl.getPosition(fuelChannel, deviceID) >= servoOpened - 10) &&
-          (servoCtrl.getPosition(oxChannel, deviceID) >= servoOpened - 10))
+      if ((sensorValues[CH_FUEL_POS] >= servoOpened - 10) && (sensorValues[CH_OX_POS] >= servoOpened - 10))
           break;
     }
-    digitalWrite(solenoidFuelValve, LOW); 
-    digitalWrite(solenoidOxValve, LOW);
+    journal.digitalWrite(solenoidFuelValve, LOW); 
+    journal.digitalWrite(solenoidOxValve, LOW);
     Serial.println(F("Main Valves Open. Firing..."));
+    boolean throttling = (throttlePSI > 0) || (throttleMR > 0);
+    boolean throttleStarted = false;
     while (sw.timerStatus() == true)
     {
+      valveProfile.update (sw.timeElapsed());   // an opening that is still going is finished
       sensorDisplay(false); 
-      // Check for Dangerous Conditions or Aborts
-      if (/*(isDanger() == true) OR */(isAbort() == true))
+      if ((throttling == true) && (throttleStarted == false) && (valveProfile.isRunning() == false))
+      {
+        servoCtrl.setServoSpeed (throttleServoSpeed, fuelChannel, deviceID);
+        servoCtrl.setServoSpeed (throttleServoSpeed, oxChannel, deviceID);
+        throttle.start (sw.timeElapsed(), 1.0, 1.0);   // the valves are fully open
+        throttleStarted = true;
+      }
+      // the throttle ticks from this loop, once per telemetry line (~25ms)
+      if ((throttleStarted == true) && (throttle.update (sw.timeElapsed(), sensorValues[CH_ENGINE_PSI], 
+          sensorValues[CH_FUEL_FLOW], sensorValues[CH_OX_FLOW]) == true))
+      {
+        servoCtrl.setTarget (throttle.getFuelTarget(), fuelChannel, deviceID);
+        servoCtrl.setTarget (throttle.getOxTarget(), oxChannel, deviceID);
+      }
+      // Check for Dangerous Conditions or Aborts. The igniter valves are
+      // closed by now so only the engine is checked.
+      if (isShutdown(2) == true)
         return;
     }
-    digitalWrite(solenoidFuelValve, LOW); 
-    digitalWrite(solenoidOxValve, LOW);
-    servoCtrl.setServoSpeed (200, fuelChannel, deviceID);
-    servoCtrl.setServoSpeed (25, oxChannel, deviceID);
-    servoCtrl.setTarget (servoClosed, fuelChannel, deviceID);
-    servoCtrl.setTarget (servoClosed, oxChannel, deviceID);
+    journal.digitalWrite(solenoidFuelValve, LOW); 
+    journal.digitalWrite(solenoidOxValve, LOW);
+    startValveProfile (fuelCloseProfile, PROFILE_POINTS(fuelCloseProfile), oxCloseProfile, PROFILE_POINTS(oxCloseProfile));
     Serial.println(F("Run Complete. Shutting Down..."));
-    digitalWrite(igniterPin, LOW);
-    while ((igniterPSI > 30) && (sw.timeElapsed() < engineRunTime + 3000))
+    journal.digitalWrite(igniterPin, LOW);
+    while (((sensorValues[CH_IGNITER_PSI] > 30) || (valveProfile.isRunning() == true)) && 
+           (sw.timeElapsed() < engineRunTime + shutdownTime))
     {
-      if (/*(isDanger(0) == true) OR */(isAbort() == true))
-        return;
+      valveProfile.update (sw.timeElapsed());
       sensorDisplay(false);
+      if (isShutdown(3) == true)
+        return;
     }
+    valveProfile.finish();
 }
 
 /*
-    Dynamically set the Orifice Diameters and calculate the resulting orifice Areas
+  Starts moving the main valves along the given fuel and ox profiles.
+  Profiles that start from PROFILE_CURRENT use the last servo readings
+  (a servo that isn't replying goes straight to its next point).
+*/
+void startValveProfile (ProfilePoint *fuelPoints, byte fuelCount, ProfilePoint *oxPoints, byte oxCount)
+{
+  int fuelPos = isnan(sensorValues[CH_FUEL_POS]) ? -1 : (int)sensorValues[CH_FUEL_POS];
+  int oxPos = isnan(sensorValues[CH_OX_POS]) ? -1 : (int)sensorValues[CH_OX_POS];
+  valveProfile.clear();
+  if ((valveProfile.addChannel (fuelChannel, fuelPoints, fuelCount, fuelPos) == false) ||
+      (valveProfile.addChannel (oxChannel, oxPoints, oxCount, oxPos) == false))
+    Serial.println(F("Bad valve profile (times must not go backwards)"));
+  valveProfile.start (sw.timeElapsed());
+}
+
+/*
+    Dynamically set the Orifice Diameters, calculate the resulting orifice Areas
+    and save them with the rest of the configuration
 */
 void setOrificeDiameters ()
 {
@@ -410,80 +935,305 @@ void setOrificeDiameters ()
     Serial.println (F("Enter new fuel Orifice Diameter: "));
     getSerial();
     ld = (serialData / 1000.0);
-    la = orificeArea (ld);
     Serial.println (F("Enter new oxidizer Orifice Diameter: "));
     getSerial();
     gd = (serialData / 1000.0);
-    ga = orificeArea (gd);
+    applyConfig();
+    config.save();
     Serial.println (F("Orifice diameters are now: "));
     Serial.print (ld,3);
     Serial.print (F("/"));
     Serial.print (gd,3);
-    Serial.println (F(" F/O in."));
+    Serial.println (F(" F/O in (saved)."));
   }
 }
+
+/*
+    Lists and changes the configuration parameters (see configParams),
+    one command per line, until 'exit' is received. Changes are used
+    straight away and kept after a reset once saved. See ConfigStore
+    for the commands.
+*/
+void parameterMenu ()
+{
+  byte result;
+  Serial.println (F("Parameters: list, <name>, <name>=<value>, save, load, erase, exit"));
+  do
+  {
+    getSerialLine (arena.commandLine, sizeof(arena.commandLine));
+    result = config.command (arena.commandLine, Serial);
+    if (result == CONFIG_CMD_CHANGED)
+      applyConfig();
+  } while (result != CONFIG_CMD_EXIT);
+}
+
+/*
+  Recalculates everything derived from the configuration parameters
+  (orifice areas, the load cell calibration, the C* throat area, the
+  valve profiles and the throttle loops).
+  Called at boot and whenever a parameter changes.
+*/
+void applyConfig ()
+{
+  la = orificeArea (ld);
+  ga = orificeArea (gd);
+  burnCalc.setThroatArea (aThroatE);
+  loadCell.setCalibration (inV, noLoadCalcV, loadMassV, loadMassLBF);
+  loadCell.load (EEPROM_LOAD_CELL_ZERO);
+  valveProfile.setLimits (servoClosed, servoOpened);
+  valveProfile.setPeriod (profilePeriod);
+  throttle.setLimits (servoClosed, servoOpened);
+  throttle.setPeriod (throttlePeriod);
+  throttle.setPressureGains (pressureGainP, pressureGainI);
+  throttle.setMixtureGains (mixtureGainP, mixtureGainI);
+  throttle.setTarget (throttlePSI, throttleMR);
+}
 /*
   Gets Sensor data and sets the corresponding sensor values  
 */
 void sensorRead()
 {
-  
+  if (supply.update() == true)
+    applySupplyVoltage();
+  thermos.update();
+  sensors.read();
+}
+
+/*
+  Channel converters (see sensorChannels). 'raw' is the filtered
+  analog reading for analog channels and 0 otherwise.
+*/
+float readServo (byte feed, int raw)
+{
+  unsigned int pos = servoCtrl.getPosition((feed == FEED_FUEL) ? fuelChannel : oxChannel, deviceID);
+  if (servoCtrl.isReadOk() == false)
+    return NAN;
+  return pos;
+}
+
+float readPSI (byte transducer, int raw)
+{
+  return psiCal[transducer]->getPSI(raw);
+}
 
-  fuelPSI = transducer.getPSI(transducer.getVoltage(analogRead(fuelPSIpin)));
-  oxPSI = transducer.getPSI(transducer.getVoltage(analogRead(oxPSIpin)));
-  igniterPSI = transducer.getPSI(transducer.getVoltage(analogRead(igniterPSIpin)));
-  enginePSI = transducer.getPSI(transducer.getVoltage(analogRead(enginePSIpin)));
-  fuelFlow = em.LiquidMassFlow (lcd, lden, fuelPSI, enginePSI, la);
-  oxFlow = em.GasMassFlow (gcd, g, gk, gz, gtemp, gm, oxPSI, enginePSI, ga);   
-  igniterTemp = igniterThermo.readCelsius();
-  igniterForce = em.thrustCalc(kI, igniterPSI, enginePSI, p3PSI, aExitI, aThroatI);
-  engineFlow = oxFlow + fuelFlow; // Can this be made more sophisticated?
-  engineTemp = engineThermo.readCelsius();
-  engineForceCalc = em.thrustCalc(kE, enginePSI, p2PSI, p3PSI, aExitE, aThroatE);
-  engineForceSensor = loadCell.getForce (analogRead(loadCellPin));
+float readThermo (byte device, int raw)
+{
+  return thermos.getCelsius(device);
+}
+
+float readLoadCell (byte unused, int raw)
+{
+  return loadCell.getForce(raw);
+}
+
+/*
+  Feed line temperature (C): the line's thermocouple if it has one,
+  otherwise the configured temperature
+*/
+float readFeedTemp (byte feed, int raw)
+{
+  if (feedThermo[feed] >= 0)
+    return thermos.getCelsius(feedThermo[feed]);
+  return ((feed == FEED_FUEL) ? ltemp : gtemp) - 273.15;
+}
+
+/*
+  Propellant flows. With a propellant type set the density (fuel) or
+  Z, k and molecular mass (ox) are looked up at the feed line
+  temperature and pressure instead of using the fixed values. A failed
+  thermocouple falls back to ltemp / gtemp.
+*/
+float calcFuelFlow (byte unused, int raw)
+{
+  float den = lden;
+  if (fuelType != PROP_FIXED)
+  {
+    float kelvin = sensorValues[CH_FUEL_TEMP] + 273.15;
+    den = Propellant::getLiquidDensity(fuelType, isnan(kelvin) ? ltemp : kelvin);
+  }
+  return em.LiquidMassFlow (lcd, den, sensorValues[CH_FUEL_PSI], sensorValues[CH_ENGINE_PSI], la);
+}
+
+float calcOxFlow (byte unused, int raw)
+{
+  float kelvin = sensorValues[CH_OX_TEMP] + 273.15;
+  if (isnan(kelvin))
+    kelvin = gtemp;
+  if (oxType == PROP_FIXED)
+    return em.GasMassFlow (gcd, g, gk, gz, kelvin, gm, sensorValues[CH_OX_PSI], sensorValues[CH_ENGINE_PSI], ga);
+  float psi = sensorValues[CH_OX_PSI];
+  return em.GasMassFlow (gcd, g, Propellant::getGasK(oxType, kelvin, psi), Propellant::getGasZ(oxType, kelvin, psi),
+                         kelvin, Propellant::getGasMolecularMass(oxType), psi, sensorValues[CH_ENGINE_PSI], ga);
+}
+
+float calcIgniterForce (byte unused, int raw)
+{
+  return em.thrustCalc(kI, sensorValues[CH_IGNITER_PSI], sensorValues[CH_ENGINE_PSI], p3PSI, aExitI, aThroatI);
+}
+
+float calcEngineFlow (byte unused, int raw)
+{
+  return sensorValues[CH_OX_FLOW] + sensorValues[CH_FUEL_FLOW]; // Can this be made more sophisticated?
+}
+
+float calcEngineForce (byte unused, int raw)
+{
+  if (p2PSI > 0)
+    return em.thrustCalc(kE, sensorValues[CH_ENGINE_PSI], p2PSI, p3PSI, aExitE, aThroatE);
+  return em.nozzleThrust(kE, sensorValues[CH_ENGINE_PSI], p3PSI, aExitE, aThroatE);
+}
+
+/*
+  Feeds the measured Vcc into the sensor conversions. Vcc is both the
+  ADC reference and the sensor supply on this board.
+*/
+void applySupplyVoltage()
+{
+  float vcc = supply.getVcc();
+  for (byte i = 0; i < sizeof(psiCal) / sizeof(psiCal[0]); i++)
+  {
+    psiCal[i]->setReferenceVoltage(vcc);
+    psiCal[i]->setSupplyVoltage(vcc);
+  }
+  loadCell.setReferenceVoltage(vcc);
+  loadCell.setSupplyVoltage(vcc);
+}
+
+/*
+  Reads an analog pin and records its health against the given
+  SensorHealth channel
+*/
+int analogReadChecked(int pin, byte healthChannel)
+{
+  int raw = inputTrace.input (TRACE_ANALOG, analogRead(pin));
+  health.checkAnalog(healthChannel, raw, analogMinRaw, analogMaxRaw);
+  return raw;
+}
+
+/*
+  Gives the libraries clocks and input hooks that read through the
+  input trace, so every input they read is recorded while a trace is
+  running (traceInputs) and fed back by Tools/TraceReplay. The 
+  libraries themselves read millis(), micros() and their pins as 
+  usual.
+*/
+void setInputHooks()
+{
+  StopWatch::setClock(traceMillis);
+  FailSafe::setClock(traceMillis);
+  FastStop::setClock(traceMillis, traceMicros);
+  ThermocoupleBank::setClock(traceMillis, traceMicros);
+  ThermocoupleBank::setInputHook(traceWord);
+  ChannelTable::setInputHook(traceAnalog);
+  SupplyMonitor::setInputHook(traceAnalog);
+  PMCtrlBase::setInputHook(traceServo);
+  EventJournal::setClock(traceMicros);
+}
+
+/*
+  The clocks and input hooks given to the libraries by setInputHooks()
+*/
+unsigned long traceMillis()
+{
+  return inputTrace.millis();
+}
+
+unsigned long traceMicros()
+{
+  return inputTrace.micros();
+}
+
+int traceAnalog(int raw)
+{
+  return inputTrace.input (TRACE_ANALOG, raw);
+}
+
+uint32_t traceWord(uint32_t raw)
+{
+  return inputTrace.input (TRACE_WORD, raw);
+}
+
+// Maestro replies, position + 1 (0 = no reply)
+unsigned int traceServo(unsigned int reply)
+{
+  return inputTrace.input (TRACE_SERVO, reply);
 }
 
 /*
   Displays sensor information to the client. An optional boolean flag
-  if set to true tells the method to display the column headers
+  if set to true tells the method to display the column headers.
+  The last column is the SensorHealth status bitmap (bit 'n' set =
+  sensor channel 'n' is faulty, so its value should be discarded).
+  The one before it is the least free RAM there has been between the
+  stack and the globals (see BufferArena). Near 0 the stack is about
+  to overwrite the globals.
+  Actuator commands logged since the last line (EventJournal) are
+  sent first as a '{...}' line; the header logs a JOURNAL_SYNC event
+  so Tools/JournalDecode can put them on the Millis clock.
+  The filters restart with each header so a new run doesn't start
+  from stale readings (eg. testSensors samples every 2s).
+  Every input of the row is read before it is printed: InputTrace
+  sends its buffer as soon as it fills, and a chunk sent mid-row
+  would split the CSV. Its flush() follows the row's newline.
 */
 void sensorDisplay(boolean showHeader)
 {
+  failSafe.kick();
+  if (showHeader == true)
+    sensors.resetFilters();
   sensorRead();
+  unsigned long timeElapsed = sw.timeElapsed();
+  unsigned int headroom = inputTrace.input (TRACE_WORD, stackProbe.getHeadroom());
   
   if (showHeader == true)
   {
-    Serial.println(F("Millis,fuelPos(us),fuelPSI,fuelFlow(kg/sec),oxPos(us),oxPSI,oxFlow(kg/sec),igniterPSI,igniterTemp(C),igniterForce(lbf),enginePSI,engineFlow(kg/sec),engineTemp(C),engineForceCalc(lbf),engineForceSensor(lbf)"));
+    journal.sync(timeElapsed);
+    journal.flush(Serial);
+    burnCalc.reset();
+    Serial.print(F("Millis,"));
+    sensors.printHeader(Serial);
+    Serial.println(F(",stackHeadroom(bytes),status(hex)"));
   }
-  Serial.print(sw.timeElapsed());
-  Serial.print ((char) ',');
-  Serial.print (servoCtrl.getPosition(fuelChannel, deviceID));
-  Serial.print ((char) ',');
-  Serial.print(fuelPSI);
-  Serial.print ((char) ',');
-  Serial.print(fuelFlow,8);
-  Serial.print ((char) ',');
-  Serial.print (servoCtrl.getPosition(oxChannel, deviceID));
+  burnCalc.addSample(timeElapsed, sensorValues[CH_ENGINE_FORCE_SENSOR], sensorValues[CH_ENGINE_FORCE_CALC], 
+                     sensorValues[CH_FUEL_FLOW], sensorValues[CH_OX_FLOW], sensorValues[CH_ENGINE_PSI]);
+  journal.flush(Serial);
+  Serial.print(timeElapsed);
   Serial.print ((char) ',');
-  Serial.print(oxPSI);
+  sensors.printValues(Serial);
   Serial.print ((char) ',');
-  Serial.print(oxFlow,8);
+  Serial.print(headroom);
   Serial.print ((char) ',');
-  Serial.print(igniterPSI);
-  Serial.print ((char) ',');
-  Serial.print(igniterTemp);
-  Serial.print ((char) ',');
-  Serial.print(igniterForce);
-  Serial.print ((char) ',');
-  Serial.print(enginePSI);
-  Serial.print ((char) ',');
-  Serial.print(engineFlow,8);
-  Serial.print ((char) ',');
-  Serial.print(engineTemp);
-  Serial.print ((char) ',');
-  Serial.print(engineForceCalc);
-  Serial.print ((char) ',');
-  Serial.println(engineForceSensor);
+  Serial.println(health.getStatus(), HEX);
+  inputTrace.flush();
+}
+
+/*
+  Outputs the totals integrated over the last run 
+*/
+void burnSummary()
+{
+  Serial.print(F("Burn Time (sec): "));
+  Serial.println(burnCalc.getBurnTime(), 3);
+  Serial.print(F("Total Impulse (N-sec): "));
+  Serial.print(burnCalc.getImpulse(), 3);
+  Serial.print(F(" (calc "));
+  Serial.print(burnCalc.getImpulseCalc(), 3);
+  Serial.println(F(")"));
+  Serial.print(F("Propellant Mass F/O (kg): "));
+  Serial.print(burnCalc.getFuelMass(), 5);
+  Serial.print(F("/"));
+  Serial.println(burnCalc.getOxMass(), 5);
+  Serial.print(F("Isp (sec): "));
+  Serial.print(burnCalc.getIsp());
+  Serial.print(F(" (calc "));
+  Serial.print(burnCalc.getIspCalc());
+  Serial.println(F(")"));
+  Serial.print(F("C* (m/sec): "));
+  Serial.println(burnCalc.getCStar());
+  Serial.print(F("O/F: "));
+  Serial.println(burnCalc.getMixtureRatio(), 3);
+  if (inputTrace.input (TRACE_WORD, stackProbe.isOverBudget()) != 0)
+    Serial.println(F("WARNING: The stack used more than ARENA_STACK_RESERVE. Check the budget in ArenaConfig.h."));
 }
 
 /*
@@ -493,28 +1243,81 @@ void sensorDisplay(boolean showHeader)
 void getSerial()
 {
   int newline = '/';
-  int inbyte;
+  int inbyte = 0;
   serialData = 0; //clear any old serial data before proceeding.
 
   while (inbyte !=  newline)
   {
-    inbyte = Serial.read(); 
+    trackLoadCellDrift();
+    inbyte = inputTrace.input (TRACE_SERIAL, Serial.read()); 
+    if (failSafe.isKeepAlive(inbyte) == true)
+      continue;
     if (inbyte > 0 && inbyte != newline)
       serialData = serialData * 10 + inbyte - '0';
   }
   Serial.println(serialData);
 }
 
+/*
+  Reads a line of text from the user terminal until a newline or
+  '/' is received (empty lines are skipped). The line is echoed
+  back and saved to 'line', truncated to fit 'size' bytes.
+*/
+void getSerialLine(char *line, byte size)
+{
+  byte length = 0;
+  int inbyte;
+
+  while (true)
+  {
+    trackLoadCellDrift();
+    inbyte = inputTrace.input (TRACE_SERIAL, Serial.read());
+    if (failSafe.isKeepAlive(inbyte) == true)
+      continue;
+    if (inbyte <= 0 || inbyte == '\r')
+      continue;
+    if (inbyte == '/' || inbyte == '\n')
+    {
+      if (length > 0)
+        break;
+      continue;
+    }
+    if (length < size - 1)
+      line[length++] = inbyte;
+  }
+  line[length] = '\0';
+  Serial.println(line);
+}
+
 /*
   Reads from the user input serial buffer to see if any data 
   is present. If data is present assume the user is trying to
   abort the current operation and return true. Otherwise
-  false is returned.
+  false is returned. Keep alive characters are not treated as
+  input, but true is also returned if too many have been missed or
+  the watchdog has tripped (a loop that stalled and came back).
+  This is called on every pass of every loop that runs while valves
+  may be open so it also kicks the watchdog and sends any journaled
+  actuator commands.
 */
 boolean isAbort ()
 {
   int inbyte;
-  inbyte = Serial.read(); 
+  failSafe.kick();
+  journal.flush(Serial);
+  if (watchdogTripped == true)
+  {
+    Serial.println(F("Watchdog tripped. Aborting..."));
+    return true;
+  }
+  inbyte = inputTrace.input (TRACE_SERIAL, Serial.read()); 
+  if (failSafe.isKeepAlive(inbyte) == true)
+    inbyte = -1;
+  if (failSafe.isLinkLost() == true)
+  {
+    Serial.println(F("Link lost. Aborting..."));
+    return true;
+  }
   if (inbyte > 0)
     return true;
   else
@@ -523,7 +1326,8 @@ boolean isAbort ()
 
 /*
   A function that calls isAbort repeatedly for 'x' milliseconds.
-  It will return true if an abort is detected.
+  It will return true if an abort is detected, including a watchdog
+  trip while the loop was held up past the end of the wait.
 */
 boolean isAbortAutoCheck (unsigned long sleepTime)
 {
@@ -535,82 +1339,260 @@ boolean isAbortAutoCheck (unsigned long sleepTime)
        return true;
      }
    }
+   if (watchdogTripped == true)
+     return isAbort();
    return false;
 }
 
 /*
-  Checks for dangerous conditions. If one is found true is returned.
-  False otherwise.
+  Same as isAbortAutoCheck but also adds a load cell tare reading
+  every tarePeriod ms. The tare is started with beginTare and
+  stops taking readings once it has tareSamples of them. A watchdog
+  trip is caught as in isAbortAutoCheck.
+*/
+boolean isAbortAutoTare (unsigned long sleepTime)
+{
+   unsigned long lastSample = 0;
+   sw.startTimer(sleepTime);
+   while (sw.timerStatus() == true)
+   {
+     if (isAbort() == true)
+     {
+       return true;
+     }
+     if (sw.timeElapsed() - lastSample >= tarePeriod)
+     {
+       lastSample = sw.timeElapsed();
+       loadCell.addTareSample(analogReadChecked(loadCellPin, CH_ENGINE_FORCE_SENSOR));
+     }
+   }
+   if (watchdogTripped == true)
+     return isAbort();
+   return false;
+}
+
+/*
+  Waits 'sleepTime' ms while the igniter valves are being opened,
+  kicking the watchdog and checking for aborts and link loss the
+  same way isAbortAutoCheck does (a plain sleep here would let the
+  watchdog fire with the igniter on). On an abort the engine is shut
+  down and true is returned.
+*/
+boolean isShutdownAutoCheck (unsigned long sleepTime)
+{
+  if (isAbortAutoCheck(sleepTime) == false)
+    return false;
+  journal.setSource(abortSource());
+  emergencyStop();
+  return true;
+}
+
+/*
+  Journal source of a stop that isAbort() asked for: the watchdog,
+  a lost link or the operator
+*/
+byte abortSource ()
+{
+  if (watchdogTripped == true)
+    return JOURNAL_WATCHDOG;
+  if (failSafe.isLinkLost() == true)
+    return JOURNAL_SAFETY;
+  return JOURNAL_ABORT;
+}
+
+/*
+  Applies the countdown tare if it was quiet enough and saves the
+  new zero to EEPROM. Otherwise the previous zero is kept.
+*/
+void tareSummary()
+{
+  Serial.print(F("Load cell tare: "));
+  Serial.print(loadCell.getTareCount());
+  Serial.print(F(" samples, noise "));
+  Serial.print(loadCell.getTareNoise(), 3);
+  if (loadCell.applyTare() == true)
+  {
+    loadCell.save(EEPROM_LOAD_CELL_ZERO);
+    Serial.print(F(" lbf, zero "));
+  }
+  else
+    Serial.print(F(" lbf, REJECTED - keeping zero "));
+  Serial.print(loadCell.getZeroVoltage(), 4);
+  Serial.println(F(" V"));
+}
+
+/*
+  Lets the load cell zero follow slow drift while waiting for
+  user input (nothing is running). Rate limited to driftPeriod.
+*/
+void trackLoadCellDrift()
+{
+  static unsigned long lastSample = 0;
+  if (inputTrace.millis() - lastSample < driftPeriod)
+    return;
+  lastSample = inputTrace.millis();
+  loadCell.trackDrift(inputTrace.input (TRACE_ANALOG, analogRead(loadCellPin)), driftWindowLBF);
+}
+
+/*
+  Checks for dangerous conditions against the dangerRules table using
+  the most recent sensor readings. If one is found the rule that fired
+  is logged and true is returned. False otherwise. A failed sensor
+  (a reading that is not a number) trips the rules armed on it.
   0 = [Default] check engine and igniter
   1 = check igniter only
   2 = check engine only
+  3 = check engine and igniter excess limits only (no-go limits are 
+      skipped, eg. while pressure is building or during shutdown)
+  4 = check igniter and engine excess limits (while the main valves
+      open the engine is not yet expected to make pressure)
   * = (Anthying Else) return true
 */
 boolean isDanger(int toCheck = 0)
 {
-    switch (serialData)
+  switch (toCheck)
   {
       case 0: // check engine and igniter
-      {
-        if ((isDanger(1) == true) && (isDanger(2) == true))
-          return true;
-        else 
-          return false;
-      }
+        safety.arm(DANGER_IGNITER | DANGER_IGNITER_NOGO | DANGER_ENGINE | DANGER_ENGINE_NOGO);
+        break;
       case 1: // check igniter only
-      {
-        if ((igniterPSI > 150) || (igniterTemp > 400)) // Check for excessive conditions
-          return true;
-        else if (igniterPSI < 50) // Check for no-go conditions
-          return true;
-        else 
-          return false;
-      }
+        safety.arm(DANGER_IGNITER | DANGER_IGNITER_NOGO);
+        break;
       case 2: // check engine only
-      {
-        if ((enginePSI > 200) || (engineTemp > 400)) // Check for excessive conditions
-          return true;
-        else if (enginePSI < 50) // Check for no-go conditions
-          return true;
-        else 
-          return false;
+        safety.arm(DANGER_ENGINE | DANGER_ENGINE_NOGO);
+        break;
+      case 3: // check excess limits only
+        safety.arm(DANGER_IGNITER | DANGER_ENGINE);
+        break;
+      case 4: // check igniter and engine excess limits
+        safety.arm(DANGER_IGNITER | DANGER_IGNITER_NOGO | DANGER_ENGINE);
         break;
-      }
       default: // (Anthying Else) return true
         return true;
   }
+  if (safety.check(sw.timeElapsed()) == SAFETY_OK)
+    return false;
+  safety.printTrip(Serial);
+  return true;
+}
+
+/*
+  Checks for dangerous conditions (see isDanger) and user aborts. If
+  either is found the engine is shut down, the shutdown transient is
+  logged and true is returned. False otherwise. The shutdown is
+  journaled as a safety stop for a redline or lost link, as a
+  watchdog stop after a watchdog trip and as an abort for operator
+  input.
+*/
+boolean isShutdown(int toCheck)
+{
+  if (isDanger(toCheck) == true)
+    journal.setSource(JOURNAL_SAFETY);
+  else if (isAbort() == true)
+    journal.setSource(abortSource());
+  else
+    return false;
+  emergencyStop();
+  shutdownTransient();
+  return true;
 }
 
 /*
-  Shuts down all controllers (valves & igniter)
+  Shuts down all controllers (valves & igniter). The solenoids and
+  igniter are closed with a direct port write and the servo close
+  commands are sent straight after. Nothing here waits; the repeats
+  are made by completeShutdown() or shutdownTransient().
 */
 void emergencyStop ()
 {
-    digitalWrite (solenoidFuelValve, LOW);
-    digitalWrite (solenoidOxValve, LOW);
-    digitalWrite (igniterPin, LOW);
-    servoCtrl.setTarget (servoClosed, fuelChannel, deviceID);
-    servoCtrl.setTarget (servoClosed, oxChannel, deviceID);
-    sw.millisToSleep(50); 
-    digitalWrite (solenoidFuelValve, LOW);
-    digitalWrite (solenoidOxValve, LOW);
-    digitalWrite (igniterPin, LOW);
-    servoCtrl.setTarget (servoClosed, fuelChannel, deviceID);
-    servoCtrl.setTarget (servoClosed, oxChannel, deviceID);
-    sw.millisToSleep(100); 
-    digitalWrite (solenoidFuelValve, LOW);
-    digitalWrite (solenoidOxValve, LOW);
-    digitalWrite (igniterPin, LOW);
-    servoCtrl.setTarget (servoClosed, fuelChannel, deviceID);
-    servoCtrl.setTarget (servoClosed, oxChannel, deviceID);
-    sw.millisToSleep(500); 
-    digitalWrite (solenoidFuelValve, LOW);
-    digitalWrite (solenoidOxValve, LOW);
-    digitalWrite (igniterPin, LOW);
+    valveStop.trigger();
+    journalValvesClosed();
+    valveProfile.stop();
+    throttle.stop();
+    closeServos();
+}
+
+/*
+  Called from the watchdog interrupt when a loop has hung. The servo
+  commands may cut into a packet the main code was sending; the
+  Maestro drops the partial packet when it sees the new start byte.
+  The valve profile and the throttle are stopped so nothing reopens
+  the main valves, and watchdogTripped makes isAbort() end the run
+  if the loop was only held up and comes back before the reset.
+*/
+void watchdogTrip ()
+{
+    valveStop.closeAll();
+    valveProfile.stop();
+    throttle.stop();
+    watchdogTripped = true;
+    journal.setSource(JOURNAL_WATCHDOG);
+    journalValvesClosed();
+    closeServos();
+}
+
+/*
+  Logs the solenoids and igniter closing (FastStop writes the port
+  directly, so they are not logged by journal.digitalWrite)
+*/
+void journalValvesClosed ()
+{
+    journal.log(JOURNAL_PIN, solenoidFuelValve, LOW);
+    journal.log(JOURNAL_PIN, solenoidOxValve, LOW);
+    journal.log(JOURNAL_PIN, igniterPin, LOW);
+}
+
+/*
+  Sends the close command to both main valve servos
+*/
+void closeServos ()
+{
     servoCtrl.setTarget (servoClosed, fuelChannel, deviceID);
     servoCtrl.setTarget (servoClosed, oxChannel, deviceID);
 }
 
+/*
+  Waits for the emergencyStop() repeats to finish
+*/
+void completeShutdown ()
+{
+    while (valveStop.isActive() == true)
+    {
+      if (valveStop.update() == true)
+        closeServos();
+    }
+}
+
+/*
+  Keeps logging sensor data after an emergencyStop() until the repeats
+  are done and both servos report closed (or 1 second passes), then
+  reports how long the valves and servos took to close.
+*/
+void shutdownTransient ()
+{
+    unsigned long servoCloseTime = 0;
+    while ((valveStop.isActive() == true) || 
+           ((servoCloseTime == 0) && (valveStop.timeSinceTrigger() < 1000)))
+    {
+      if (valveStop.update() == true)
+        closeServos();
+      sensorDisplay(false);
+      if ((servoCloseTime == 0) &&   // false while either servo isn't replying (NAN)
+          (sensorValues[CH_FUEL_POS] <= servoClosed + 10) && (sensorValues[CH_OX_POS] <= servoClosed + 10))
+        servoCloseTime = valveStop.timeSinceTrigger();
+    }
+    Serial.print(F("Shutdown: valves closed in "));
+    Serial.print(valveStop.getLatencyMicros());
+    Serial.print(F("us, servos closed in "));
+    if (servoCloseTime == 0)
+      Serial.println(F("(not confirmed)"));
+    else
+    {
+      Serial.print(servoCloseTime);
+      Serial.println(F("ms"));
+    }
+}
+
 
 /*
   computes the orifice area in m^2 for a given orifice diameter supplied in in
@@ -13,6 +13,11 @@
 			-> [1] kg/min
 			-> [2] lbs/sec
 			-> [3] lbs/min
+		(4) thrustCalc.
+			-> Returns lbf given the exit pressure
+		(5) nozzleThrust.
+			-> Returns lbf, working out the exit pressure
+			   from the nozzle area ratio
     Note that this library will not setup any pins. It
 	is expected that these will be defined by the calling 
 	program.
@@ -26,10 +31,10 @@
 #include "Arduino.h"
 #include "EngineMath.h"
 
-//Empty Constructor
 EngineMath::EngineMath()
 {
-
+	_k = 0;				// no nozzle solved yet
+	_separated = false;
 }
 
 /*
@@ -63,7 +68,7 @@ float EngineMath::LiquidMassFlow ( float cd,   	// Coefficient of Discharge (Dim
 	calculates flow appropriately.
 */
 float EngineMath::GasMassFlow (	float cd,  		// Coefficient of Discharge (Dimensionless)
-								float g,    	// Gravity 9.80665 (m/sec^2)
+								float g,    	// Gravity 9.80665 (m/sec^2). Unused, kept for existing callers
 								float k,   		// Gas Specific Heat Ratio (Dimensionless)
 								float z,    	// Gas Compressability Factor (Dimensionless) 
 								float temp, 	// Gas Temperature at inlet (Kelvin)
@@ -72,6 +77,7 @@ float EngineMath::GasMassFlow (	float cd,  		// Coefficient of Discharge (Dimens
 								float p2,  		// Outlet Pressure (psi)
 								float a)   		// Orifice Area (m^2)
 {
+  (void) g;				// SI units, no g_c
   float r = 8314.4621;	// 	J/Kg^-1*mol^-1
   //Convert psi to kg/(m*s^2)
   p1 = (p1*6894.75729);
@@ -83,7 +89,7 @@ float EngineMath::GasMassFlow (	float cd,  		// Coefficient of Discharge (Dimens
   if ((pcritical * p1) > p2) // choked
 	gasmf = cd * a * sqrt( k * density * p1 * pow ((2 / (k + 1)), ((k + 1) / (k - 1))));
   else // non-choked
-	gasmf = a*(cd*p1*sqrt(((2*m*g)/(z*r*temp))*(k/(k-1)) * (pow(pratio,(2/k))- pow(pratio,((k+1)/k)))));
+	gasmf = a*(cd*p1*sqrt(((2*m)/(z*r*temp))*(k/(k-1)) * (pow(pratio,(2/k))- pow(pratio,((k+1)/k)))));
   return gasmf;
 }
 
@@ -102,4 +108,101 @@ float EngineMath::thrustCalc (	float k,		// specific heat ratio for the engine
 	float p3Mpa = p3PSI * 0.00689475729;
 	float Cf = sqrt(((2.0 * pow(k,2.0))/(k - 1.0)) * pow(2.0 / (k + 1.0), (k + 1.0)/(k - 1.0)) * (1.0 - pow(p2Mpa / p1Mpa, (k - 1.0) / k) )) + ((p2Mpa - p3Mpa)/ p1Mpa)*(aExit / aThroat);
 	return Cf * p1Mpa * aThroat * 1000000.0 * 0.22481;
-}
\ No newline at end of file
+}
+
+/*
+	Nozzle area / throat area at Mach number 'mach'
+*/
+float EngineMath::machAreaRatio (float k, float mach)
+{
+	return pow ((2.0 / (k + 1.0)) * (1.0 + 0.5 * (k - 1.0) * mach * mach), (k + 1.0) / (2.0 * (k - 1.0))) / mach;
+}
+
+/*
+	Returns exit pressure / chamber pressure for a nozzle flowing
+	full (supersonic all the way to the exit). This depends only
+	on k and the areas, so the exit Mach number is solved once by
+	bisection and kept until one of them changes; after that it
+	costs a few compares per call.
+*/
+float EngineMath::exitPressureRatio (float k,		// specific heat ratio for the engine
+									 float aExit, 	// Nozzle exit area m^2
+									 float aThroat)	// Nozzle throat area m^2
+{
+	if ((k == _k) && (aExit == _aExit) && (aThroat == _aThroat))
+		return _exitRatio;
+	float areaRatio = aExit / aThroat;
+	float lo = 1.0;
+	float hi = 1.0;
+	while ((machAreaRatio (k, hi) < areaRatio) && (hi < 50.0))	// area grows with Mach above 1
+		hi *= 2.0;
+	for (byte i = 0; i < MACH_SOLVER_STEPS; i++)
+	{
+		float mid = 0.5 * (lo + hi);
+		if (machAreaRatio (k, mid) < areaRatio)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	_k = k;
+	_aExit = aExit;
+	_aThroat = aThroat;
+	_exitMach = 0.5 * (lo + hi);
+	_exitRatio = pow (1.0 + 0.5 * (k - 1.0) * _exitMach * _exitMach, -k / (k - 1.0));
+	_criticalRatio = pow (2.0 / (k + 1.0), k / (k - 1.0));
+	return _exitRatio;
+}
+
+/*
+	Exit Mach number of the last nozzle solved by exitPressureRatio
+*/
+float EngineMath::getExitMach ()
+{
+	return _exitMach;
+}
+
+/*
+	Returns true if the last nozzleThrust call found the nozzle
+	not flowing full (separated or not choked)
+*/
+boolean EngineMath::isSeparated ()
+{
+	return _separated;
+}
+
+/*
+	Returns thrust in lbf with the exit pressure worked out from
+	the nozzle area ratio, scaled by the chamber pressure.
+	- Flowing full: thrustCalc at that exit pressure
+	- Over expanded below SEPARATION_RATIO * ambient: the flow
+	  leaves the wall where it reaches that pressure, so the
+	  nozzle is treated as cut off there (never less than a nozzle
+	  cut off at the throat)
+	- Chamber pressure too low to choke the throat: the gas
+	  expands to ambient at the throat
+*/
+float EngineMath::nozzleThrust (float k,		// specific heat ratio for the engine
+								float p1PSI, 	// chamber pressure (PSI)
+								float p3PSI, 	// atmospheric pressure (PSI)
+								float aExit, 	// Nozzle exit area m^2
+								float aThroat)	// Nozzle throat area m^2
+{
+	float exitRatio = exitPressureRatio (k, aExit, aThroat);
+	_separated = true;
+	if (p1PSI <= p3PSI)
+		return 0;
+	float pCritical = _criticalRatio;
+	if (p3PSI >= pCritical * p1PSI)		// not choked
+		return thrustCalc (k, p1PSI, p3PSI, p3PSI, aThroat, aThroat);
+	float pSep = SEPARATION_RATIO * p3PSI;
+	if (exitRatio * p1PSI >= pSep)
+	{
+		_separated = false;
+		return thrustCalc (k, p1PSI, exitRatio * p1PSI, p3PSI, aExit, aThroat);
+	}
+	float mach2 = 2.0 / (k - 1.0) * (pow (p1PSI / pSep, (k - 1.0) / k) - 1.0);
+	float aSep = aThroat * machAreaRatio (k, sqrt (mach2));
+	float cutAtSep = thrustCalc (k, p1PSI, pSep, p3PSI, aSep, aThroat);
+	float cutAtThroat = thrustCalc (k, p1PSI, pCritical * p1PSI, p3PSI, aThroat, aThroat);
+	return (cutAtSep > cutAtThroat) ? cutAtSep : cutAtThroat;
+}
@@ -13,15 +13,23 @@
 			-> [1] kg/min
 			-> [2] lbs/sec
 			-> [3] lbs/min
+		(4) thrustCalc.
+			-> Returns lbf given the exit pressure
+		(5) nozzleThrust.
+			-> Returns lbf, working out the exit pressure
+			   from the nozzle area ratio
     Note that this library will not setup any pins. It
 	is expected that these will be defined by the calling 
 	program.
 */
 #ifndef EngineMath_h
-#define Engine_h
+#define EngineMath_h
 
 #include "Arduino.h"
 
+#define SEPARATION_RATIO 0.4		// nozzle flow separates where it expands below this fraction of ambient (Summerfield)
+#define MACH_SOLVER_STEPS 32		// bisection steps for the exit Mach number
+
 class EngineMath
 {
   public:
@@ -32,7 +40,7 @@ class EngineMath
 							float p2,  		// Outlet Pressure (psi)
 							float a);  		// Orifice Area (m^2)
 	float GasMassFlow (		float cd,  		// Coefficient of Discharge (Dimensionless)
-							float g,    	// Gravity 9.80665 (m/sec2)
+							float g,    	// Gravity 9.80665 (m/sec2). Unused
 							float k,   		// Gas Specific Heat Ratio (Dimensionless)
 							float z,    	// Gas Compressability Factor (Dimensionless) 
 							float temp, 	// Gas Temperature at inlet (Kelvin)
@@ -47,7 +55,25 @@ class EngineMath
 							float p3PSI, 	// atmospheric pressure (PSI)
 							float aExit, 	// Nozzle exit area m^2
 							float aThroat);	// Nozzle throat area m^2
-	
+	float nozzleThrust (	float k,		// specific heat ratio for the engine
+							float p1PSI, 	// chamber pressure (PSI)
+							float p3PSI, 	// atmospheric pressure (PSI)
+							float aExit, 	// Nozzle exit area m^2
+							float aThroat);	// Nozzle throat area m^2
+	float exitPressureRatio (float k,		// specific heat ratio for the engine
+							float aExit, 	// Nozzle exit area m^2
+							float aThroat);	// Nozzle throat area m^2
+	float getExitMach ();
+	boolean isSeparated ();
+  private:
+	float machAreaRatio (float k, float mach);
+	float _k;						// geometry of the cached solution
+	float _aExit;
+	float _aThroat;
+	float _exitMach;				// cached exit Mach number
+	float _exitRatio;				// cached exit / chamber pressure
+	float _criticalRatio;			// cached throat / chamber pressure when choked
+	boolean _separated;				// last nozzleThrust found the flow separated
 };
 
 #endif
\ No newline at end of file
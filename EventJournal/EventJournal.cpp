@@ -0,0 +1,190 @@
+/*
+ Title: EventJournal.cpp
+  Description: Records every command sent to an actuator (a
+	digital output such as a solenoid valve or igniter, or a
+	Pololu Maestro servo through PMCtrl) with the time it was
+	sent and what asked for it, and sends the records with the
+	telemetry so a log shows exactly when each valve was told to
+	move relative to the sensor readings.
+	Each event is 8 bytes, queued in the BufferArena
+	(ARENA_JOURNAL_EVENTS of them):
+		time		micros() after the command went out (4)
+		type		JOURNAL_PIN, JOURNAL_TARGET ... (high nibble)
+		source		JOURNAL_SEQUENCER ... (low nibble)
+		actuator	pin or servo channel
+		value		pin state, servo target (us), speed ... (2)
+	Logging an event is a micros() read and 8 stores with
+	interrupts off. The caller sets the source before a run of
+	commands (setSource) and writes its outputs through
+	digitalWrite() here; PMCtrl logs its own commands once given
+	the journal (PMCtrlBase::setJournal).
+	flush() sends the queued events as one line of upper case
+	hex between '{' and '}': the events dropped since the last
+	flush (2 digits, the queue was full), then 16 digits per
+	event in the order above (time, type + source, actuator,
+	value). Tools/JournalDecode turns the lines back into events
+	and puts them on the same clock as the Millis column using
+	the JOURNAL_SYNC event logged with each CSV header (sync()),
+	which holds 24 bits of ms (4.6 hours): the low 16 in value 
+	and the high 8 in actuator.
+
+	Time is read with micros() unless another clock is given to
+	setClock() (eg. one that records it, so a traced session 
+	replays the journal too) except for JOURNAL_WATCHDOG events,
+	which come from the watchdog interrupt and read micros() 
+	directly. Logging from any other interrupt is only safe if
+	the clock is.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+
+#include "Arduino.h"
+#include <BufferArena.h>
+#include "EventJournal.h"
+
+EventJournal journal;
+unsigned long (*EventJournal::_clock)() = micros;
+
+static const char hexDigits[] PROGMEM = "0123456789ABCDEF";
+
+/*
+	Empty journal, source JOURNAL_SEQUENCER
+*/
+EventJournal::EventJournal ()
+{
+	_first = 0;
+	_count = 0;
+	_lost = 0;
+	_source = JOURNAL_SEQUENCER;
+}
+
+/*
+	Source of the events logged from now on (JOURNAL_SEQUENCER etc.)
+*/
+void EventJournal::setSource (byte source)
+{
+	_source = source;
+}
+
+byte EventJournal::getSource ()
+{
+	return _source;
+}
+
+/*
+	digitalWrite() and log it as a JOURNAL_PIN event
+*/
+void EventJournal::digitalWrite (uint8_t pin, uint8_t state)
+{
+	::digitalWrite (pin, state);
+	log (JOURNAL_PIN, pin, state);
+}
+
+/*
+	Reads the time of the events through 'clock' instead of 
+	micros() (eg. one that records it so a session can be 
+	replayed). Events from the watchdog interrupt still read
+	micros().
+*/
+void EventJournal::setClock (unsigned long (*clock)())
+{
+	_clock = clock;
+}
+
+/*
+	Queues an event at the current time. If the queue is full the
+	event is dropped and counted in the next flush.
+*/
+void EventJournal::log (byte type, byte actuator, unsigned int value)
+{
+	unsigned long now = (_source == JOURNAL_WATCHDOG) ? ::micros () : _clock ();
+	uint8_t oldSREG = SREG;
+	cli();
+	if (_count >= ARENA_JOURNAL_EVENTS)
+	{
+		if (_lost < 0xFF)
+			_lost++;
+	}
+	else
+	{
+		byte slot = _first + _count;
+		if (slot >= ARENA_JOURNAL_EVENTS)
+			slot -= ARENA_JOURNAL_EVENTS;
+		uint8_t *e = &arena.journal[slot * JOURNAL_EVENT_SIZE];
+		e[0] = now;
+		e[1] = now >> 8;
+		e[2] = now >> 16;
+		e[3] = now >> 24;
+		e[4] = (type << 4) | _source;
+		e[5] = actuator;
+		e[6] = value;
+		e[7] = value >> 8;
+		_count++;
+	}
+	SREG = oldSREG;
+}
+
+/*
+	Logs a JOURNAL_SYNC event: 'ms' is the time on the telemetry 
+	clock now. The low 16 bits go in value and the next 8 in 
+	actuator, so it is not cut to 65.5s.
+*/
+void EventJournal::sync (unsigned long ms)
+{
+	log (JOURNAL_SYNC, ms >> 16, ms);
+}
+
+/*
+	Sends the queued events to 'out' as one line (see the top of
+	the file). Nothing is sent if there are none.
+*/
+void EventJournal::flush (Print &out)
+{
+	if ((_count == 0) && (_lost == 0))
+		return;
+	uint8_t e[JOURNAL_EVENT_SIZE];
+	uint8_t oldSREG = SREG;
+	cli();
+	byte lost = _lost;
+	_lost = 0;
+	SREG = oldSREG;
+	out.print ('{');
+	putHex (out, lost);
+	while (_count > 0)
+	{
+		oldSREG = SREG;
+		cli();
+		memcpy (e, &arena.journal[_first * JOURNAL_EVENT_SIZE], JOURNAL_EVENT_SIZE);
+		_first = (_first + 1 < ARENA_JOURNAL_EVENTS) ? _first + 1 : 0;
+		_count--;
+		SREG = oldSREG;
+		putHex (out, e[3]);
+		putHex (out, e[2]);
+		putHex (out, e[1]);
+		putHex (out, e[0]);
+		putHex (out, e[4]);
+		putHex (out, e[5]);
+		putHex (out, e[7]);
+		putHex (out, e[6]);
+	}
+	out.println ('}');
+}
+
+/*
+	Events waiting to be sent
+*/
+byte EventJournal::getCount ()
+{
+	return _count;
+}
+
+/*
+	Prints a byte as 2 hex digits
+*/
+void EventJournal::putHex (Print &out, uint8_t b)
+{
+	out.print ((char) pgm_read_byte (&hexDigits[b >> 4]));
+	out.print ((char) pgm_read_byte (&hexDigits[b & 0x0F]));
+}
@@ -0,0 +1,89 @@
+/*
+ Title: EventJournal.h
+  Description: Records every command sent to an actuator (a
+	digital output such as a solenoid valve or igniter, or a
+	Pololu Maestro servo through PMCtrl) with the time it was
+	sent and what asked for it, and sends the records with the
+	telemetry so a log shows exactly when each valve was told to
+	move relative to the sensor readings.
+	Each event is 8 bytes, queued in the BufferArena
+	(ARENA_JOURNAL_EVENTS of them):
+		time		micros() after the command went out (4)
+		type		JOURNAL_PIN, JOURNAL_TARGET ... (high nibble)
+		source		JOURNAL_SEQUENCER ... (low nibble)
+		actuator	pin or servo channel
+		value		pin state, servo target (us), speed ... (2)
+	Logging an event is a micros() read and 8 stores with
+	interrupts off. The caller sets the source before a run of
+	commands (setSource) and writes its outputs through
+	digitalWrite() here; PMCtrl logs its own commands once given
+	the journal (PMCtrlBase::setJournal).
+	flush() sends the queued events as one line of upper case
+	hex between '{' and '}': the events dropped since the last
+	flush (2 digits, the queue was full), then 16 digits per
+	event in the order above (time, type + source, actuator,
+	value). Tools/JournalDecode turns the lines back into events
+	and puts them on the same clock as the Millis column using
+	the JOURNAL_SYNC event logged with each CSV header (sync()),
+	which holds 24 bits of ms (4.6 hours): the low 16 in value 
+	and the high 8 in actuator.
+
+	Time is read with micros() unless another clock is given to
+	setClock() (eg. one that records it, so a traced session 
+	replays the journal too) except for JOURNAL_WATCHDOG events,
+	which come from the watchdog interrupt and read micros() 
+	directly. Logging from any other interrupt is only safe if
+	the clock is.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+#ifndef EventJournal_h
+#define EventJournal_h
+
+#include "Arduino.h"
+#include <ArenaConfig.h>
+
+#define JOURNAL_EVENT_SIZE 8
+
+// Event types
+#define JOURNAL_PIN 0			// digital output, value = LOW / HIGH
+#define JOURNAL_TARGET 1		// servo target (us)
+#define JOURNAL_SPEED 2			// servo speed (0.25us / 10ms)
+#define JOURNAL_ACCEL 3			// servo acceleration
+#define JOURNAL_HOME 4			// all servos home
+#define JOURNAL_SYNC 5			// ms on the telemetry clock (Millis column), see sync()
+
+// Sources
+#define JOURNAL_SEQUENCER 0		// the firing sequence or a test
+#define JOURNAL_ABORT 1			// operator abort
+#define JOURNAL_SAFETY 2		// redline trip or link loss
+#define JOURNAL_WATCHDOG 3		// watchdog interrupt (hung loop)
+
+static_assert (ARENA_JOURNAL == ARENA_JOURNAL_EVENTS * JOURNAL_EVENT_SIZE, "ARENA_JOURNAL is not ARENA_JOURNAL_EVENTS events");
+
+class EventJournal
+{
+	public:
+		EventJournal ();
+		void setSource (byte source);
+		byte getSource ();
+		void digitalWrite (uint8_t pin, uint8_t state);
+		void log (byte type, byte actuator, unsigned int value);
+		void sync (unsigned long ms);
+		void flush (Print &out);
+		byte getCount ();
+		static void setClock (unsigned long (*clock)());
+	private:
+		static unsigned long (*_clock)();
+		void putHex (Print &out, uint8_t b);
+		volatile byte _first;		// oldest event
+		volatile byte _count;
+		volatile byte _lost;		// dropped since the last flush
+		volatile byte _source;
+};
+
+extern EventJournal journal;
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ Title: EventJournal (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the EventJournal library. It blinks the
+	LED on pin 13 through the journal and sends the queued events
+	once a second, after a sync event that ties them to millis().
+	Sending 'a' logs the next blink as an abort. Paste the
+	output into Tools/JournalDecode to read it.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <BufferArena.h>
+#include <EventJournal.h>
+
+#define LED_PIN 13
+
+void setup ()
+{
+	Serial.begin(57600);
+	pinMode (LED_PIN, OUTPUT);
+}
+
+void loop ()
+{
+	static byte state = LOW;
+	static byte blinks = 0;
+	if (Serial.read() == 'a')
+		journal.setSource (JOURNAL_ABORT);
+	state = (state == LOW) ? HIGH : LOW;
+	journal.digitalWrite (LED_PIN, state);
+	journal.setSource (JOURNAL_SEQUENCER);
+	if (++blinks == 4)
+	{
+		journal.sync (millis());
+		journal.flush (Serial);
+		blinks = 0;
+	}
+	delay (250);
+}
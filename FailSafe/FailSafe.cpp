@@ -0,0 +1,174 @@
+/*
+ Title: FailSafe.cpp
+  Description: This library shuts things down when the 
+	operator link or the micro itself stops behaving. It 
+	combines two checks:
+		(1) Heartbeat. While armed, the ground station must 
+			send the keep alive character at least every 
+			'beatPeriod' ms. Once 'maxMissed' beats in a row 
+			are missed isLinkLost() returns true.
+		(2) Hardware watchdog. While armed the AVR watchdog 
+			runs in interrupt + reset mode. If kick() is not 
+			called within the timeout (eg. a loop has hung) 
+			the watchdog interrupt calls the trip function 
+			supplied by the caller (which should close the 
+			valves) and the micro is reset on the following
+			timeout.
+	The worst case time to safe is therefore:
+		link loss: beatPeriod * maxMissed (+ one loop)
+		lock up: the watchdog timeout
+	
+	Call bootCheck() first thing in setup(). It clears the
+	watchdog (which otherwise stays running after a watchdog
+	reset) and reports whether the last reset was one.
+	The heartbeat is timed with millis() unless another clock
+	is given to setClock().
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+
+#include "Arduino.h"
+#include <avr/wdt.h>
+#include <avr/interrupt.h>
+#include "FailSafe.h"
+
+void (*FailSafe::_trip)() = 0;
+unsigned long (*FailSafe::_clock)() = millis;
+
+/*
+	trip:		function called from the watchdog interrupt. It must
+				be interrupt safe (eg. FastStop::closeAll)
+	keepAlive:	the heartbeat character sent by the ground station
+	beatPeriod:	ms between heartbeats
+	maxMissed:	beats that may be missed before the link is lost
+				(0 = heartbeat not checked)
+*/
+FailSafe::FailSafe (void (*trip)(), byte keepAlive, unsigned int beatPeriod, byte maxMissed)
+{
+	_trip = trip;
+	_keepAlive = keepAlive;
+	_beatPeriod = beatPeriod;
+	_maxMissed = maxMissed;
+	_armed = false;
+	_lastBeat = 0;
+}
+
+/*
+	Reads the time of the heartbeat through 'clock' instead of 
+	millis() (eg. one that records it so a session can be replayed)
+*/
+void FailSafe::setClock (unsigned long (*clock)())
+{
+	_clock = clock;
+}
+
+/*
+	Turns the watchdog off and returns true if the last reset was 
+	caused by the watchdog.
+*/
+boolean FailSafe::bootCheck ()
+{
+	uint8_t resetFlags = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+	return ((resetFlags & _BV(WDRF)) != 0);
+}
+
+/*
+	Arms the heartbeat and the watchdog. wdtTimeout is one of the
+	avr-libc WDTO_ constants (eg. WDTO_250MS).
+*/
+void FailSafe::begin (byte wdtTimeout)
+{
+	_lastBeat = _clock();
+	_armed = true;
+	
+	// interrupt + reset mode. The timed sequence must complete 
+	// within 4 clock cycles of setting WDCE.
+	uint8_t prescale = (wdtTimeout & 0x07) | ((wdtTimeout & 0x08) ? _BV(WDP3) : 0);
+	uint8_t oldSREG = SREG;
+	cli();
+	wdt_reset();
+	WDTCSR |= _BV(WDCE) | _BV(WDE);
+	WDTCSR = _BV(WDIE) | _BV(WDE) | prescale;
+	SREG = oldSREG;
+}
+
+/*
+	Disarms the heartbeat and the watchdog
+*/
+void FailSafe::end ()
+{
+	wdt_disable();
+	_armed = false;
+}
+
+/*
+	Resets the watchdog. Call this every loop while armed.
+*/
+void FailSafe::kick ()
+{
+	wdt_reset();
+}
+
+/*
+	Returns true (and records the beat) if 'inbyte' is the keep
+	alive character. Keep alives are accepted even when disarmed so
+	callers can always filter them out of user input.
+*/
+boolean FailSafe::isKeepAlive (int inbyte)
+{
+	if (inbyte != _keepAlive)
+		return false;
+	_lastBeat = _clock();
+	return true;
+}
+
+/*
+	Returns true if armed and too many heartbeats have been missed
+*/
+boolean FailSafe::isLinkLost ()
+{
+	if ((_armed == false) || (_maxMissed == 0))
+		return false;
+	return (getMissedBeats() >= _maxMissed);
+}
+
+/*
+	Returns the number of whole heartbeat periods since the last beat
+*/
+byte FailSafe::getMissedBeats ()
+{
+	unsigned long missed = timeSinceBeat() / _beatPeriod;
+	return (missed > 255) ? 255 : missed;
+}
+
+/*
+	Returns the ms since the last keep alive (or since begin())
+*/
+unsigned long FailSafe::timeSinceBeat ()
+{
+	return _clock() - _lastBeat;
+}
+
+boolean FailSafe::isArmed ()
+{
+	return _armed;
+}
+
+/*
+	Called from the watchdog interrupt. The hardware clears WDIE 
+	when this interrupt runs so the next timeout resets the micro.
+*/
+void FailSafe::handleWatchdog ()
+{
+	if (_trip)
+		_trip();
+}
+
+ISR(WDT_vect)
+{
+	FailSafe::handleWatchdog();
+}
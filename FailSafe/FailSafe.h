@@ -0,0 +1,62 @@
+/*
+ Title: FailSafe.h
+  Description: This library shuts things down when the 
+	operator link or the micro itself stops behaving. It 
+	combines two checks:
+		(1) Heartbeat. While armed, the ground station must 
+			send the keep alive character at least every 
+			'beatPeriod' ms. Once 'maxMissed' beats in a row 
+			are missed isLinkLost() returns true.
+		(2) Hardware watchdog. While armed the AVR watchdog 
+			runs in interrupt + reset mode. If kick() is not 
+			called within the timeout (eg. a loop has hung) 
+			the watchdog interrupt calls the trip function 
+			supplied by the caller (which should close the 
+			valves) and the micro is reset on the following
+			timeout.
+	The worst case time to safe is therefore:
+		link loss: beatPeriod * maxMissed (+ one loop)
+		lock up: the watchdog timeout
+	
+	Call bootCheck() first thing in setup(). It clears the
+	watchdog (which otherwise stays running after a watchdog
+	reset) and reports whether the last reset was one.
+	The heartbeat is timed with millis() unless another clock
+	is given to setClock().
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+#ifndef FailSafe_h
+#define FailSafe_h
+
+#include "Arduino.h"
+#include <avr/wdt.h>
+
+class FailSafe
+{
+	public:
+		FailSafe (void (*trip)(), byte keepAlive, unsigned int beatPeriod, byte maxMissed);
+		static boolean bootCheck ();
+		void begin (byte wdtTimeout);
+		void end ();
+		void kick ();
+		boolean isKeepAlive (int inbyte);
+		boolean isLinkLost ();
+		byte getMissedBeats ();
+		unsigned long timeSinceBeat ();
+		boolean isArmed ();
+		static void handleWatchdog ();
+		static void setClock (unsigned long (*clock)());
+	private:
+		static void (*_trip)();
+		static unsigned long (*_clock)();
+		byte _keepAlive;
+		unsigned int _beatPeriod;
+		byte _maxMissed;
+		boolean _armed;
+		unsigned long _lastBeat;
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ Title: FailSafe (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the FailSafe library. The LED on pin 13
+	stands in for a valve. Send 'K' at least every 250ms to keep 
+	the link alive (eg. from a script). 
+		- Stop sending 'K' and the link loss is reported along
+		  with the time from the last beat to the valve closing.
+		- Send 'L' to simulate a lock up. The watchdog closes 
+		  the valve and resets the board, which is reported 
+		  on the next boot.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <FastStop.h>
+#include <FailSafe.h>
+
+int valvePin = 13;
+FastStop valveStop;
+
+/*
+	Called from the watchdog interrupt
+*/
+void watchdogTrip ()
+{
+	valveStop.closeAll();
+}
+
+FailSafe failSafe (watchdogTrip, 'K', 250, 4);
+
+void setup ()
+{
+	boolean watchdogReset = FailSafe::bootCheck();
+	Serial.begin(57600);
+	pinMode (valvePin, OUTPUT);
+	valveStop.addPin (valvePin);
+	if (watchdogReset == true)
+		Serial.println (F("Watchdog reset - valve was forced closed (time to safe <= 250ms)"));
+}
+
+void loop ()
+{
+	Serial.println (F("Valve open. Send 'K' every 250ms, 'L' to lock up"));
+	digitalWrite (valvePin, HIGH);
+	failSafe.begin (WDTO_250MS);
+	while (true)
+	{
+		failSafe.kick();
+		int inbyte = Serial.read();
+		failSafe.isKeepAlive (inbyte);
+		if (inbyte == 'L')
+			while (true);		// simulated lock up
+		if (failSafe.isLinkLost() == true)
+		{
+			valveStop.trigger();
+			Serial.print (F("Link lost - valve closed "));
+			Serial.print (failSafe.timeSinceBeat());
+			Serial.println (F("ms after the last beat"));
+			break;
+		}
+	}
+	failSafe.end();
+	delay (5000);
+}
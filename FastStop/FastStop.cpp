@@ -0,0 +1,150 @@
+/*
+ Title: FastStop.cpp
+  Description: This library closes a set of digital outputs
+	(eg. solenoid valves and an igniter) as fast as the micro 
+	allows and then repeats the close on a fixed schedule 
+	without blocking the caller. 
+	
+	The port register and bit mask of every pin are looked up
+	once when the pin is added and pins on the same port are 
+	merged, so trigger() is one masked write per port with
+	interrupts disabled. On the Uno pins 8-13 all live on 
+	PORTB so the igniter and both solenoids close in a single 
+	write. trigger() is safe to call from an interrupt as long
+	as the clocks are (millis() and micros() unless others are
+	given to setClock()); closeAll() always is.
+	
+	Retries are made by update(), which the caller should run 
+	every loop (eg. while logging the shutdown transient). It 
+	returns true whenever a retry was made so the caller can
+	re-send any other shutdown commands (eg. servo targets).
+	
+	Note that pins are written directly, so they must not be
+	driven with analogWrite() (the PWM timer would not be 
+	disconnected as it is by digitalWrite()). Pin modes 
+	must be set by the calling program.
+*/
+
+#include "Arduino.h"
+#include "FastStop.h"
+
+// Retry times in ms after the trigger. These match the waits the 
+// original blocking emergencyStop() used between its repeats.
+static const unsigned int retryMillis[] PROGMEM = { 50, 150, 650 };
+#define FASTSTOP_RETRIES (sizeof(retryMillis) / sizeof(retryMillis[0]))
+
+unsigned long (*FastStop::_millisClock)() = millis;
+unsigned long (*FastStop::_microsClock)() = micros;
+
+/*
+	Empty Constructor
+*/
+FastStop::FastStop ()
+{
+	_ports = 0;
+	_triggerMillis = 0;
+	_latencyMicros = 0;
+	_retry = FASTSTOP_RETRIES;
+}
+
+/*
+	Reads the time of every FastStop through these clocks instead 
+	of millis() and micros() (eg. ones that record it so a session
+	can be replayed)
+*/
+void FastStop::setClock (unsigned long (*millisClock)(), unsigned long (*microsClock)())
+{
+	_millisClock = millisClock;
+	_microsClock = microsClock;
+}
+
+/*
+	Adds a pin to the set that is closed (driven LOW). Returns 
+	false if the pin is not valid or too many ports are in use.
+*/
+boolean FastStop::addPin (uint8_t pin)
+{
+	uint8_t port = digitalPinToPort(pin);
+	if (port == NOT_A_PIN)
+		return false;
+	volatile uint8_t *reg = portOutputRegister(port);
+	uint8_t mask = digitalPinToBitMask(pin);
+	for (byte i = 0; i < _ports; i++)
+	{
+		if (_port[i] == reg)
+		{
+			_mask[i] |= mask;
+			return true;
+		}
+	}
+	if (_ports >= FASTSTOP_MAX_PORTS)
+		return false;
+	_port[_ports] = reg;
+	_mask[_ports] = mask;
+	_ports++;
+	return true;
+}
+
+/*
+	Drives every pin LOW. One masked write per port.
+*/
+void FastStop::closeAll ()
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	for (byte i = 0; i < _ports; i++)
+		*_port[i] &= ~_mask[i];
+	SREG = oldSREG;
+}
+
+/*
+	Closes everything now and starts the retry schedule. The time
+	taken to close the pins is available from getLatencyMicros().
+*/
+void FastStop::trigger ()
+{
+	unsigned long start = _microsClock();
+	closeAll();
+	_latencyMicros = _microsClock() - start;
+	_triggerMillis = _millisClock();
+	_retry = 0;
+}
+
+/*
+	Re-closes the pins when the next retry is due. Returns true if
+	a retry was made, false otherwise.
+*/
+boolean FastStop::update ()
+{
+	if (_retry >= FASTSTOP_RETRIES)
+		return false;
+	if (_millisClock() - _triggerMillis < pgm_read_word (&retryMillis[_retry]))
+		return false;
+	closeAll();
+	_retry++;
+	return true;
+}
+
+/*
+	Returns true while retries are still pending
+*/
+boolean FastStop::isActive ()
+{
+	return (_retry < FASTSTOP_RETRIES);
+}
+
+/*
+	Returns the ms since the last trigger
+*/
+unsigned long FastStop::timeSinceTrigger ()
+{
+	return _millisClock() - _triggerMillis;
+}
+
+/*
+	Returns the time in us it took trigger() to close the pins
+*/
+unsigned long FastStop::getLatencyMicros ()
+{
+	return _latencyMicros;
+}
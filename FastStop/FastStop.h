@@ -0,0 +1,57 @@
+/*
+ Title: FastStop.h
+  Description: This library closes a set of digital outputs
+	(eg. solenoid valves and an igniter) as fast as the micro 
+	allows and then repeats the close on a fixed schedule 
+	without blocking the caller. 
+	
+	The port register and bit mask of every pin are looked up
+	once when the pin is added and pins on the same port are 
+	merged, so trigger() is one masked write per port with
+	interrupts disabled. On the Uno pins 8-13 all live on 
+	PORTB so the igniter and both solenoids close in a single 
+	write. trigger() is safe to call from an interrupt as long
+	as the clocks are (millis() and micros() unless others are
+	given to setClock()); closeAll() always is.
+	
+	Retries are made by update(), which the caller should run 
+	every loop (eg. while logging the shutdown transient). It 
+	returns true whenever a retry was made so the caller can
+	re-send any other shutdown commands (eg. servo targets).
+	
+	Note that pins are written directly, so they must not be
+	driven with analogWrite() (the PWM timer would not be 
+	disconnected as it is by digitalWrite()). Pin modes 
+	must be set by the calling program.
+*/
+#ifndef FastStop_h
+#define FastStop_h
+
+#include "Arduino.h"
+
+#define FASTSTOP_MAX_PORTS 3
+
+class FastStop
+{
+	public:
+		FastStop ();
+		boolean addPin (uint8_t pin);
+		void trigger ();
+		void closeAll ();
+		boolean update ();
+		boolean isActive ();
+		unsigned long timeSinceTrigger ();
+		unsigned long getLatencyMicros ();
+		static void setClock (unsigned long (*millisClock)(), unsigned long (*microsClock)());
+	private:
+		static unsigned long (*_millisClock)();
+		static unsigned long (*_microsClock)();
+		volatile uint8_t *_port[FASTSTOP_MAX_PORTS];
+		uint8_t _mask[FASTSTOP_MAX_PORTS];
+		byte _ports;
+		volatile unsigned long _triggerMillis;
+		volatile unsigned long _latencyMicros;
+		volatile byte _retry;
+};
+
+#endif
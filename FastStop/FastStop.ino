@@ -0,0 +1,52 @@
+/*
+ Title: FastStop (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the FastStop library. Three outputs 
+	are switched on and then closed with trigger(). The loop 
+	keeps running (as it would while logging sensor data) and 
+	reports each retry as it happens along with the measured 
+	close latency.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <FastStop.h>
+
+int igniterPin = 10;
+int solenoidFuelValve = 9;
+int solenoidOxValve = 8;
+FastStop valveStop;
+
+void setup ()
+{
+	Serial.begin(57600);
+	pinMode (igniterPin, OUTPUT);
+	pinMode (solenoidFuelValve, OUTPUT);
+	pinMode (solenoidOxValve, OUTPUT);
+	valveStop.addPin (igniterPin);
+	valveStop.addPin (solenoidFuelValve);
+	valveStop.addPin (solenoidOxValve);
+}
+
+void loop ()
+{
+	digitalWrite (igniterPin, HIGH);
+	digitalWrite (solenoidFuelValve, HIGH);
+	digitalWrite (solenoidOxValve, HIGH);
+	delay (1000);
+	
+	valveStop.trigger();
+	Serial.print (F("Closed in (us): "));
+	Serial.println (valveStop.getLatencyMicros());
+	while (valveStop.isActive())
+	{
+		if (valveStop.update())
+		{
+			Serial.print (F("Retry at (ms): "));
+			Serial.println (valveStop.timeSinceTrigger());
+		}
+	}
+	Serial.println (F("Done!\n"));
+	delay (5000);
+}
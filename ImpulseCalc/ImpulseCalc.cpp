@@ -0,0 +1,247 @@
+/*
+ Title: ImpulseCalc.cpp
+  Description: This library incrementally integrates the 
+	engine data produced each time the sensors are read and
+	keeps the following running totals:
+		(1) Total Impulse (N-sec) from the load cell and from
+			the calculated thrust
+		(2) Propellant mass consumed (kg) for fuel and ox
+		(3) Specific Impulse, Isp (sec)
+		(4) Characteristic Velocity, C* (m/sec)
+		(5) Mixture Ratio, O/F (Dimensionless)
+	Each sample costs a fixed amount of work regardless of the 
+	length of the burn so it can be run in the acquisition loop.
+	Samples do not need to be evenly spaced. Simpson's rule is 
+	used by default and falls back to the trapezoidal rule when 
+	neighbouring intervals are too uneven for Simpson to be
+	trusted.
+	
+	The same code is used by the host tool in Tools/ImpulseLog
+	to integrate recorded logs.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+
+#include "Arduino.h"
+#include "ImpulseCalc.h"
+
+const float lbf2N = 4.44822162;		// 1 lbf in Newtons
+const float psi2Pa = 6894.75729;	// 1 psi in Pascals
+const float g0 = 9.80665;			// standard gravity m/sec^2
+
+/*
+	Empty Constructor
+*/
+RunningIntegral::RunningIntegral ()
+{
+	reset();
+}
+
+void RunningIntegral::reset ()
+{
+	_closed = 0;
+	_pending = 0;
+	_h0 = 0;
+	_f0 = 0;
+	_f1 = 0;
+	_started = false;
+}
+
+/*
+	Adds the value 'f' sampled 'h' seconds after the previous 
+	value. Simpson's rule for two uneven intervals h0, h1 is:
+		(h0+h1)/6 * [(2 - h1/h0)f0 + ((h0+h1)^2/(h0*h1))f1 + (2 - h0/h1)f2]
+	When the intervals differ by more than 2:1 the weights 
+	become badly behaved so the pair is kept as two trapezoids.
+	Readings that are not a number (eg. a negative pressure drop
+	through an orifice) are counted as zero.
+*/
+void RunningIntegral::add (float h, float f, byte method)
+{
+	if (isnan(f))
+		f = 0;
+	if (_started == false)
+	{
+		_f1 = f;
+		_started = true;
+		return;
+	}
+	float trap = 0.5 * h * (_f1 + f);
+	if (_h0 == 0)
+	{
+		// first interval of a pair
+		_h0 = h;
+		_f0 = _f1;
+		_pending = trap;
+	}
+	else
+	{
+		// second interval of a pair
+		float h0 = _h0;
+		if ((method == IMPULSE_SIMPSON) && (h <= 2.0 * h0) && (h0 <= 2.0 * h))
+		{
+			float hs = h0 + h;
+			_closed += (hs / 6.0) * ((2.0 - h / h0) * _f0 + 
+						((hs * hs) / (h0 * h)) * _f1 + 
+						(2.0 - h0 / h) * f);
+		}
+		else
+			_closed += _pending + trap;
+		_h0 = 0;
+		_pending = 0;
+	}
+	_f1 = f;
+}
+
+float RunningIntegral::getTotal ()
+{
+	return _closed + _pending;
+}
+
+/*
+	aThroat is the nozzle throat area (m^2) used to calculate C*.
+	method is IMPULSE_SIMPSON (default) or IMPULSE_TRAPEZOID
+*/
+ImpulseCalc::ImpulseCalc (float aThroat, byte method)
+{
+	_aThroat = aThroat;
+	_method = method;
+	reset();
+}
+
+/*
+	Changes the nozzle throat area (m^2) used to calculate C*
+*/
+void ImpulseCalc::setThroatArea (float aThroat)
+{
+	_aThroat = aThroat;
+}
+
+/*
+	Clears all running totals. Call this at the start of each burn.
+*/
+void ImpulseCalc::reset ()
+{
+	_started = false;
+	_firstMillis = 0;
+	_lastMillis = 0;
+	_forceSensor.reset();
+	_forceCalc.reset();
+	_fuelFlow.reset();
+	_oxFlow.reset();
+	_chamberPa.reset();
+}
+
+/*
+	Adds one set of readings to the running totals. Samples with
+	a time stamp that is not later than the previous one are ignored.
+*/
+void ImpulseCalc::addSample (unsigned long millisElapsed,
+							float forceSensorLBF,
+							float forceCalcLBF,
+							float fuelFlow,
+							float oxFlow,
+							float chamberPSI)
+{
+	float h = 0;
+	if (_started == false)
+	{
+		_firstMillis = millisElapsed;
+		_started = true;
+	}
+	else
+	{
+		if (millisElapsed <= _lastMillis)
+			return;
+		h = (millisElapsed - _lastMillis) / 1000.0;
+	}
+	_lastMillis = millisElapsed;
+	_forceSensor.add (h, forceSensorLBF * lbf2N, _method);
+	_forceCalc.add (h, forceCalcLBF * lbf2N, _method);
+	_fuelFlow.add (h, fuelFlow, _method);
+	_oxFlow.add (h, oxFlow, _method);
+	_chamberPa.add (h, chamberPSI * psi2Pa, _method);
+}
+
+/*
+	Returns the time covered by the samples in seconds
+*/
+float ImpulseCalc::getBurnTime ()
+{
+	return (_lastMillis - _firstMillis) / 1000.0;
+}
+
+/*
+	Returns the total impulse measured by the load cell (N-sec)
+*/
+float ImpulseCalc::getImpulse ()
+{
+	return _forceSensor.getTotal();
+}
+
+/*
+	Returns the total impulse of the calculated thrust (N-sec)
+*/
+float ImpulseCalc::getImpulseCalc ()
+{
+	return _forceCalc.getTotal();
+}
+
+float ImpulseCalc::getFuelMass ()
+{
+	return _fuelFlow.getTotal();
+}
+
+float ImpulseCalc::getOxMass ()
+{
+	return _oxFlow.getTotal();
+}
+
+float ImpulseCalc::getPropellantMass ()
+{
+	return _fuelFlow.getTotal() + _oxFlow.getTotal();
+}
+
+/*
+	Isp = I / (m * g0) in seconds. Returns 0 until some propellant
+	has been consumed.
+*/
+float ImpulseCalc::getIsp ()
+{
+	float m = getPropellantMass();
+	if (m <= 0)
+		return 0;
+	return getImpulse() / (m * g0);
+}
+
+float ImpulseCalc::getIspCalc ()
+{
+	float m = getPropellantMass();
+	if (m <= 0)
+		return 0;
+	return getImpulseCalc() / (m * g0);
+}
+
+/*
+	C* = integral(Pc * At dt) / m in m/sec
+*/
+float ImpulseCalc::getCStar ()
+{
+	float m = getPropellantMass();
+	if (m <= 0)
+		return 0;
+	return (_chamberPa.getTotal() * _aThroat) / m;
+}
+
+/*
+	O/F mixture ratio of the propellant consumed so far
+*/
+float ImpulseCalc::getMixtureRatio ()
+{
+	float fuel = getFuelMass();
+	if (fuel <= 0)
+		return 0;
+	return getOxMass() / fuel;
+}
@@ -0,0 +1,90 @@
+/*
+ Title: ImpulseCalc.h
+  Description: This library incrementally integrates the 
+	engine data produced each time the sensors are read and
+	keeps the following running totals:
+		(1) Total Impulse (N-sec) from the load cell and from
+			the calculated thrust
+		(2) Propellant mass consumed (kg) for fuel and ox
+		(3) Specific Impulse, Isp (sec)
+		(4) Characteristic Velocity, C* (m/sec)
+		(5) Mixture Ratio, O/F (Dimensionless)
+	Each sample costs a fixed amount of work regardless of the 
+	length of the burn so it can be run in the acquisition loop.
+	Samples do not need to be evenly spaced. Simpson's rule is 
+	used by default and falls back to the trapezoidal rule when 
+	neighbouring intervals are too uneven for Simpson to be
+	trusted.
+	
+	The same code is used by the host tool in Tools/ImpulseLog
+	to integrate recorded logs.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+#ifndef ImpulseCalc_h
+#define ImpulseCalc_h
+
+#include "Arduino.h"
+
+#define IMPULSE_TRAPEZOID 0
+#define IMPULSE_SIMPSON 1
+
+/*
+	Running integral of a single channel. Completed interval 
+	pairs are integrated with Simpson's rule, the trailing odd 
+	interval is carried as a trapezoid until its partner arrives.
+*/
+class RunningIntegral
+{
+	public:
+		RunningIntegral ();
+		void reset ();
+		void add (float h, float f, byte method);
+		float getTotal ();
+	private:
+		float _closed;		// integral over completed intervals
+		float _pending;		// trapezoid over the trailing odd interval
+		float _h0;			// width of the trailing odd interval (0 = none)
+		float _f0;			// value at the start of the trailing odd interval
+		float _f1;			// most recent value
+		boolean _started;
+};
+
+class ImpulseCalc
+{
+	public:
+		ImpulseCalc (float aThroat, byte method = IMPULSE_SIMPSON);
+		void setThroatArea (float aThroat);
+		void reset ();
+		void addSample (unsigned long millisElapsed,	// sample time (ms)
+						float forceSensorLBF,			// load cell thrust (lbf)
+						float forceCalcLBF,				// calculated thrust (lbf)
+						float fuelFlow,					// fuel mass flow (kg/sec)
+						float oxFlow,					// ox mass flow (kg/sec)
+						float chamberPSI);				// chamber pressure (psi)
+		float getBurnTime ();
+		float getImpulse ();
+		float getImpulseCalc ();
+		float getFuelMass ();
+		float getOxMass ();
+		float getPropellantMass ();
+		float getIsp ();
+		float getIspCalc ();
+		float getCStar ();
+		float getMixtureRatio ();
+	private:
+		float _aThroat;
+		byte _method;
+		boolean _started;
+		unsigned long _firstMillis;
+		unsigned long _lastMillis;
+		RunningIntegral _forceSensor;
+		RunningIntegral _forceCalc;
+		RunningIntegral _fuelFlow;
+		RunningIntegral _oxFlow;
+		RunningIntegral _chamberPa;
+};
+
+#endif
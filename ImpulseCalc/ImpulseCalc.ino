@@ -0,0 +1,53 @@
+/*
+ Title: ImpulseCalc (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the ImpulseCalc library. A synthetic
+	2 second burn with a 250ms ramp at each end is integrated 
+	at an uneven sample rate and the totals are printed. The
+	expected answers are printed alongside for comparison.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <ImpulseCalc.h>
+
+float aThroat = 0.00017;		// Nozzle throat area m^2
+ImpulseCalc burn (aThroat);
+
+/*
+	Trapezoidal thrust/flow profile: ramps up over 250ms, holds
+	and ramps down over the last 250ms of a 2000ms burn
+*/
+float profile (unsigned long t)
+{
+	if (t < 250)
+		return t / 250.0;
+	if (t > 1750)
+		return (2000 - t) / 250.0;
+	return 1.0;
+}
+
+void setup ()
+{
+	Serial.begin(57600);
+}
+
+void loop ()
+{
+	unsigned long t = 0;
+	burn.reset();
+	while (t <= 2000)
+	{
+		float p = profile (t);
+		burn.addSample (t, 50.0 * p, 48.0 * p, 0.02 * p, 0.04 * p, 200.0 * p);
+		t += 7 + (t % 5);	// uneven sample spacing
+	}
+	Serial.println (F("Quantity,Calculated,Expected"));
+	Serial.print (F("Impulse(N-sec),")); Serial.print (burn.getImpulse(), 3); Serial.println (F(",389.219"));
+	Serial.print (F("PropellantMass(kg),")); Serial.print (burn.getPropellantMass(), 5); Serial.println (F(",0.10500"));
+	Serial.print (F("Isp(sec),")); Serial.print (burn.getIsp(), 2); Serial.println (F(",377.99"));
+	Serial.print (F("C*(m/sec),")); Serial.print (burn.getCStar(), 2); Serial.println (F(",3907.03"));
+	Serial.print (F("O/F,")); Serial.print (burn.getMixtureRatio(), 3); Serial.println (F(",2.000"));
+	delay (10000);
+}
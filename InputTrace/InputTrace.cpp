@@ -0,0 +1,248 @@
+/*
+ Title: InputTrace.cpp
+  Description: Records every input the controller reads (time,
+	ADC counts, thermocouple words, Maestro replies, operator
+	serial bytes) so a session can be replayed through the same
+	code on a PC (Tools/TraceReplay) and make the same decisions
+	and print the same output. The calling program reads its 
+	inputs through the global 'inputTrace':
+		raw = inputTrace.input (TRACE_ANALOG, analogRead (pin));
+		now = inputTrace.millis ();
+	which returns the value unchanged unless a trace is running,
+	and gives the libraries clocks and input hooks that do the
+	same (eg. StopWatch::setClock, ChannelTable::setInputHook),
+	so the libraries themselves do not depend on this one.
+	Code is deterministic between inputs, so each input type is 
+	traced as its own stream of values in the order they were 
+	read, and each stream is run length coded (a read returning
+	the same value as the last read of that type costs nothing
+	until the value changes). Time streams hold the change from
+	the last reading, so a polling loop costs one record per ms.
+
+	begin() writes the EEPROM contents (the rest of the state 
+	at power up) and then records are sent to the same Print as
+	the normal output, batched into chunks between '~' marks so
+	they can be stripped back out of the log:
+		~!<TRACE_VERSION>:<EEPROM size>:<EEPROM bytes>~
+		~<records>~
+	A record is a type letter, an optional repeat count and ':',
+	then the new value (empty = 0), all in hex. The count is 
+	the number of extra reads that returned the previous value
+	before this one. eg. m1F4:1 = 500 more reads of the last
+	time, then a reading 1ms later. Call flush() once per pass
+	so a lost link or power loses at most one pass of records.
+	Sending the records slows the controller; tracing is meant
+	to be switched on for test runs.
+
+	In replay (PC) every input() after begin() returns the next
+	value from the function given to replay() instead.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+
+#include "Arduino.h"
+#include <EEPROM.h>
+#include "InputTrace.h"
+#include <BufferArena.h>
+
+InputTrace inputTrace;
+
+static const char traceLetters[] PROGMEM = TRACE_LETTERS;
+static const char hexDigits[] PROGMEM = "0123456789ABCDEF";
+
+/*
+	Empty trace (not running, not replaying)
+*/
+InputTrace::InputTrace ()
+{
+	_out = NULL;
+	_next = NULL;
+	_running = false;
+	_length = 0;
+}
+
+/*
+	Starts a trace. The first eepromSize bytes of EEPROM are 
+	written to 'out' straight away, then records as they fill a
+	chunk (or flush() is called). Only inputs read after this
+	are traced, so call it before anything reads an input. 
+	When replaying nothing is written.
+*/
+void InputTrace::begin (Print &out, int eepromSize)
+{
+	_out = &out;
+	for (byte i = 0; i < TRACE_TYPES; i++)
+	{
+		_last[i] = 0;
+		_repeats[i] = 0;
+	}
+	_length = 0;
+	if (_next == NULL)
+	{
+		out.print (F("~!"));
+		putHex (TRACE_VERSION);
+		out.print (':');
+		putHex (eepromSize);
+		out.print (':');
+		for (int i = 0; i < eepromSize; i++)
+		{
+			byte b = EEPROM.read (i);
+			out.print ((char) pgm_read_byte (&hexDigits[b >> 4]));
+			out.print ((char) pgm_read_byte (&hexDigits[b & 0x0F]));
+		}
+		out.print ('~');
+	}
+	_running = true;
+}
+
+/*
+	Sends any records still held and stops tracing
+*/
+void InputTrace::end ()
+{
+	flush ();
+	_running = false;
+}
+
+/*
+	Sends every record held, including reads of a repeated value
+	that have not been recorded yet
+*/
+void InputTrace::flush ()
+{
+	if ((_running == false) || (_next != NULL))
+		return;
+	for (byte i = 0; i < TRACE_TYPES; i++)
+	{
+		if (_repeats[i] > 0)
+		{
+			record (i, _repeats[i] - 1, (i <= TRACE_MICROS) ? 0 : _last[i]);
+			_repeats[i] = 0;
+		}
+	}
+	sendChunk ();
+}
+
+/*
+	Switches to replay: from begin() on, input() returns next(type)
+	instead of the value read. Used by Tools/TraceReplay.
+*/
+void InputTrace::replay (long (*next)(byte type))
+{
+	_next = next;
+}
+
+/*
+	Returns true between begin() and end()
+*/
+boolean InputTrace::isRunning ()
+{
+	return _running;
+}
+
+/*
+	Records 'value' as the next input of 'type' (TRACE_ANALOG etc.)
+	and returns it, or returns the replayed value instead. For the
+	time types pass the reading; the change is worked out here.
+*/
+long InputTrace::input (byte type, long value)
+{
+	if (_running == false)
+		return value;
+	if (_next != NULL)
+		return _next (type);
+
+	long change = (type <= TRACE_MICROS) ? (long)((unsigned long)value - (unsigned long)_last[type]) : value;
+	long same = (type <= TRACE_MICROS) ? 0 : _last[type];
+	if (change == same)
+	{
+		if (_repeats[type] == 0xFFFF)
+		{
+			record (type, 0xFFFE, same);
+			_repeats[type] = 0;
+		}
+		_repeats[type]++;
+		return value;
+	}
+	record (type, _repeats[type], change);
+	_repeats[type] = 0;
+	_last[type] = value;
+	return value;
+}
+
+/*
+	millis() through the trace
+*/
+unsigned long InputTrace::millis ()
+{
+	return input (TRACE_MILLIS, ::millis ());
+}
+
+/*
+	micros() through the trace
+*/
+unsigned long InputTrace::micros ()
+{
+	return input (TRACE_MICROS, ::micros ());
+}
+
+/*
+	Adds one record to the chunk, sending the chunk first if the
+	record might not fit
+*/
+void InputTrace::record (byte type, unsigned int count, long value)
+{
+	if (_length > TRACE_BUFFER_SIZE - 16)	// letter + 4 + ':' + '-' + 8 digits
+		sendChunk ();
+	arena.traceChunk[_length++] = pgm_read_byte (&traceLetters[type]);
+	if (count > 0)
+	{
+		putHex (count);
+		arena.traceChunk[_length++] = ':';
+	}
+	if ((value < 0) && (type > TRACE_MICROS))
+	{
+		arena.traceChunk[_length++] = '-';
+		value = -value;
+	}
+	putHex (value);
+}
+
+/*
+	Sends the records held as one chunk
+*/
+void InputTrace::sendChunk ()
+{
+	if (_length == 0)
+		return;
+	_out->print ('~');
+	_out->write ((const uint8_t *) arena.traceChunk, _length);
+	_out->print ('~');
+	_length = 0;
+}
+
+/*
+	Adds 'value' in hex (nothing for 0) to the chunk, or prints it
+	straight to the output before the trace has started
+*/
+void InputTrace::putHex (unsigned long value)
+{
+	byte shift = 28;
+	while ((shift > 0) && ((value >> shift) == 0))
+		shift -= 4;
+	if (value == 0)
+		return;
+	for (;;)
+	{
+		char digit = pgm_read_byte (&hexDigits[(value >> shift) & 0x0F]);
+		if (_running == true)
+			arena.traceChunk[_length++] = digit;
+		else
+			_out->print (digit);
+		if (shift == 0)
+			break;
+		shift -= 4;
+	}
+}
@@ -0,0 +1,96 @@
+/*
+ Title: InputTrace.h
+  Description: Records every input the controller reads (time,
+	ADC counts, thermocouple words, Maestro replies, operator
+	serial bytes) so a session can be replayed through the same
+	code on a PC (Tools/TraceReplay) and make the same decisions
+	and print the same output. The calling program reads its 
+	inputs through the global 'inputTrace':
+		raw = inputTrace.input (TRACE_ANALOG, analogRead (pin));
+		now = inputTrace.millis ();
+	which returns the value unchanged unless a trace is running,
+	and gives the libraries clocks and input hooks that do the
+	same (eg. StopWatch::setClock, ChannelTable::setInputHook),
+	so the libraries themselves do not depend on this one.
+	Code is deterministic between inputs, so each input type is 
+	traced as its own stream of values in the order they were 
+	read, and each stream is run length coded (a read returning
+	the same value as the last read of that type costs nothing
+	until the value changes). Time streams hold the change from
+	the last reading, so a polling loop costs one record per ms.
+
+	begin() writes the EEPROM contents (the rest of the state 
+	at power up) and then records are sent to the same Print as
+	the normal output, batched into chunks between '~' marks so
+	they can be stripped back out of the log:
+		~!<TRACE_VERSION>:<EEPROM size>:<EEPROM bytes>~
+		~<records>~
+	A record is a type letter, an optional repeat count and ':',
+	then the new value (empty = 0), all in hex. The count is 
+	the number of extra reads that returned the previous value
+	before this one. eg. m1F4:1 = 500 more reads of the last
+	time, then a reading 1ms later. Call flush() once per pass
+	so a lost link or power loses at most one pass of records,
+	right after a newline. A chunk is also sent whenever the 
+	buffer fills, so read all the inputs of a line (eg. a CSV
+	row) before printing it: the chunks then only fall between
+	lines and a line is never split by one.
+	Sending the records slows the controller; tracing is meant
+	to be switched on for test runs.
+
+	In replay (PC) every input() after begin() returns the next
+	value from the function given to replay() instead.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+#ifndef InputTrace_h
+#define InputTrace_h
+
+#include "Arduino.h"
+#include <ArenaConfig.h>
+
+#define TRACE_VERSION 1
+#define TRACE_BUFFER_SIZE ARENA_TRACE_CHUNK	// records batched per chunk (arena.traceChunk)
+
+// Input types (streams)
+#define TRACE_MILLIS 0			// millis(), change since the last reading
+#define TRACE_MICROS 1			// micros(), change since the last reading
+#define TRACE_ANALOG 2			// ADC counts
+#define TRACE_WORD 3			// raw device words (eg. MAX31855)
+#define TRACE_SERVO 4			// Maestro replies, position + 1 (0 = no reply)
+#define TRACE_SERIAL 5			// operator serial bytes (-1 = none)
+#define TRACE_BOOT 6			// reset cause
+#define TRACE_TYPES 7
+
+// type letters in the order above
+#define TRACE_LETTERS "muawsrb"
+
+class InputTrace
+{
+	public:
+		InputTrace ();
+		void begin (Print &out, int eepromSize);
+		void end ();
+		void flush ();
+		void replay (long (*next)(byte type));
+		boolean isRunning ();
+		long input (byte type, long value);
+		unsigned long millis ();
+		unsigned long micros ();
+	private:
+		void record (byte type, unsigned int count, long value);
+		void sendChunk ();
+		void putHex (unsigned long value);
+		Print *_out;
+		long (*_next)(byte type);
+		boolean _running;
+		long _last[TRACE_TYPES];
+		unsigned int _repeats[TRACE_TYPES];
+		byte _length;
+};
+
+extern InputTrace inputTrace;
+
+#endif
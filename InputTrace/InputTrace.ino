@@ -0,0 +1,51 @@
+/*
+ Title: InputTrace (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the InputTrace library. A pot on A0 is
+	read every 100ms and printed with the time. Characters typed
+	in the serial monitor are echoed. The trace chunks between
+	'~' marks show how the inputs are recorded: the time stream
+	costs one record per ms of polling, the A0 stream a record
+	only when the reading changes and the serial stream one per
+	key. Send 't' to switch the trace off (it is left running
+	otherwise).
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <EEPROM.h>
+#include <InputTrace.h>
+
+unsigned long lastRead = 0;
+
+void setup ()
+{
+	Serial.begin(57600);
+	inputTrace.begin (Serial, 16);	// first 16 bytes of EEPROM only
+	Serial.println (F("Millis,A0"));
+}
+
+void loop ()
+{
+	int c = inputTrace.input (TRACE_SERIAL, Serial.read());
+	if (c == 't')
+	{
+		inputTrace.end ();
+		Serial.println (F("Trace off"));
+	}
+	else if (c > 0)
+	{
+		Serial.print (F("Key: "));
+		Serial.println ((char) c);
+	}
+
+	unsigned long now = inputTrace.millis();
+	if (now - lastRead < 100)
+		return;
+	lastRead = now;
+	Serial.print (now);
+	Serial.print ((char) ',');
+	Serial.println (inputTrace.input (TRACE_ANALOG, analogRead(A0)));
+	inputTrace.flush ();
+}
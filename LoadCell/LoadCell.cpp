@@ -14,6 +14,27 @@
 			the full load mass in pounds force
 	measurement input:
 		loadCellAnalogIn:
+	live correction (optional):
+		setSupplyVoltage:
+			the measured supply voltage. The load cell is
+			ratiometric so both the zero and the span are
+			scaled with it.
+		setReferenceVoltage:
+			the measured ADC reference voltage
+	zero tracking (optional):
+		beginTare / addTareSample / applyTare:
+			averages 'n' no load samples (eg. during a 
+			countdown) and, if they were quiet enough, uses
+			the mean as the new zero.
+		trackDrift:
+			slowly follows the zero while the stand is idle.
+			Samples more than a window away from the current
+			zero are ignored so a real load is not tared out.
+		load / save:
+			stores the zero in EEPROM (LOADCELL_EEPROM_SIZE 
+			bytes, CRC checked) so it survives a reset.
+		Both use an incremental mean/variance so each sample
+		costs a few float operations and no buffer.
 	output:
 		mass:
 			outputs the calculated mass given the aforementioned
@@ -26,20 +47,200 @@
 */
 
 #include "Arduino.h"
+#include <EEPROM.h>
+#include <ConfigStore.h>
 #include "LoadCell.h"
 
+#define LOADCELL_MAGIC 0x4C	// 'L'
+
 /*
 	Calibration parameters for the load cell
 */
 LoadCell::LoadCell(float inV, float noLoadCalcV, float loadMassV, float loadMassLBF)
 {
-	// Calculate the ratiometric scale factor given the fact that
-	// the nominal input voltage should be 5V (per datasheet)
-	_ratiometricScaleFactor = (inV / 5.0);
+	_vRef = 5.0;
+	_vSupply = inV;
+	setCalibration (inV, noLoadCalcV, loadMassV, loadMassLBF);
 	
-	_calibratedSpan = (loadMassV / loadMassLBF) * _ratiometricScaleFactor;
-	_noLoadCalcV = noLoadCalcV;
+	_tareSamples = 0;
+	_tareCount = 0;
+	_tareMaxNoise = 0;
+	_tareMean = 0;
+	_tareM2 = 0;
+	_driftVar = 0;
+}
+
+/*
+	Replaces the calibration parameters (eg. after they were 
+	changed at runtime). The zero goes back to noLoadCalcV so
+	load any saved zero again afterwards. The last measured
+	supply voltage is kept.
+*/
+void LoadCell::setCalibration (float inV, float noLoadCalcV, float loadMassV, float loadMassLBF)
+{
+	// kept so the calibration can be re-scaled to a measured supply
+	_inV = inV;
+	_nominalSpan = (loadMassV / loadMassLBF);
+	_noLoadCalV = noLoadCalcV;
 	
+	// Calculate the ratiometric scale factor given the fact that
+	// the nominal input voltage should be 5V (per datasheet)
+	setSupplyVoltage (_vSupply);
+}
+
+/*
+	Re-scales the calibration to the measured supply voltage. The
+	span is scaled from the nominal 5V and the zero from the
+	supply it was calibrated at (inV).
+*/
+void LoadCell::setSupplyVoltage (float vSupply)
+{
+	_calibratedSpan = _nominalSpan * (vSupply / 5.0);
+	_noLoadCalcV = _noLoadCalV * (vSupply / _inV);
+	_vSupply = vSupply;
+}
+
+/*
+	Sets the measured ADC reference voltage (default 5V)
+*/
+void LoadCell::setReferenceVoltage (float vRef)
+{
+	_vRef = vRef;
+}
+
+/*
+	Starts a tare of 'samples' no load readings. The tare is
+	only applied if the standard deviation of the readings is
+	no more than maxNoiseLBF (ie. nothing was touching the
+	stand). The current zero is kept until applyTare.
+*/
+void LoadCell::beginTare (unsigned int samples, float maxNoiseLBF)
+{
+	_tareSamples = samples;
+	_tareMaxNoise = maxNoiseLBF;
+	_tareCount = 0;
+	_tareMean = 0;
+	_tareM2 = 0;
+}
+
+/*
+	Adds a no load reading to the tare (Welford's running mean
+	and variance). Returns true once 'samples' readings have 
+	been added; further readings are ignored.
+*/
+boolean LoadCell::addTareSample (int loadCellAnalogIn)
+{
+	if (_tareCount >= _tareSamples)
+		return true;
+	float v = getVoltage (loadCellAnalogIn);
+	_tareCount++;
+	float delta = v - _tareMean;
+	_tareMean += delta / _tareCount;
+	_tareM2 += delta * (v - _tareMean);
+	return (_tareCount >= _tareSamples);
+}
+
+/*
+	Uses the tare mean as the new zero. Returns false (and 
+	keeps the current zero) if the tare is incomplete or too
+	noisy.
+*/
+boolean LoadCell::applyTare ()
+{
+	if (_tareSamples == 0 || _tareCount < _tareSamples)
+		return false;
+	if (getTareNoise () > _tareMaxNoise)
+		return false;
+	_noLoadCalcV = _tareMean;
+	_noLoadCalV = _tareMean * (_inV / _vSupply);
+	_driftVar = 0;
+	return true;
+}
+
+/*
+	Number of readings added to the current tare
+*/
+unsigned int LoadCell::getTareCount ()
+{
+	return _tareCount;
+}
+
+/*
+	Standard deviation of the tare readings (lbf)
+*/
+float LoadCell::getTareNoise ()
+{
+	if (_tareCount < 2)
+		return 0;
+	return (sqrt (_tareM2 / (_tareCount - 1)) / _calibratedSpan);
+}
+
+/*
+	Moves the zero a small step (1/LOADCELL_DRIFT_WEIGHT) towards
+	an idle reading. Readings more than windowLBF from the 
+	current zero are treated as a real load and ignored. Call
+	this at a steady rate while the engine is not running.
+*/
+void LoadCell::trackDrift (int loadCellAnalogIn, float windowLBF)
+{
+	float delta = getVoltage (loadCellAnalogIn) - _noLoadCalcV;
+	if (abs (delta) > windowLBF * _calibratedSpan)
+		return;
+	float step = delta / LOADCELL_DRIFT_WEIGHT;
+	_noLoadCalcV += step;
+	_noLoadCalV = _noLoadCalcV * (_inV / _vSupply);
+	_driftVar = (1.0 - 1.0 / LOADCELL_DRIFT_WEIGHT) * (_driftVar + delta * step);
+}
+
+/*
+	Standard deviation (lbf) of the idle readings seen by 
+	trackDrift (exponentially weighted)
+*/
+float LoadCell::getDriftNoise ()
+{
+	return (sqrt (_driftVar) / _calibratedSpan);
+}
+
+/*
+	The current zero (no load voltage at the current supply)
+*/
+float LoadCell::getZeroVoltage ()
+{
+	return _noLoadCalcV;
+}
+
+/*
+	Loads a zero saved with save(). Returns false if there is
+	no valid zero at eepromAddress (the constructor's noLoadCalcV
+	is kept). The zero is stored at the calibration supply (inV).
+*/
+boolean LoadCell::load (int eepromAddress)
+{
+	if (EEPROM.read (eepromAddress) != LOADCELL_MAGIC)
+		return false;
+	if (eepromCRC (eepromAddress, LOADCELL_EEPROM_SIZE - 1) != 
+		EEPROM.read (eepromAddress + LOADCELL_EEPROM_SIZE - 1))
+		return false;
+	float zero;
+	byte *p = (byte *) &zero;
+	for (byte i = 0; i < sizeof (zero); i++)
+		p[i] = EEPROM.read (eepromAddress + 1 + i);
+	_noLoadCalV = zero;
+	_noLoadCalcV = zero * (_vSupply / _inV);
+	return true;
+}
+
+/*
+	Saves the current zero to EEPROM
+*/
+void LoadCell::save (int eepromAddress)
+{
+	byte *p = (byte *) &_noLoadCalV;
+	EEPROM.write (eepromAddress, LOADCELL_MAGIC);
+	for (byte i = 0; i < sizeof (_noLoadCalV); i++)
+		EEPROM.write (eepromAddress + 1 + i, p[i]);
+	EEPROM.write (eepromAddress + LOADCELL_EEPROM_SIZE - 1, 
+				  eepromCRC (eepromAddress, LOADCELL_EEPROM_SIZE - 1));
 }
 
 /*
@@ -58,7 +259,7 @@ float LoadCell::getForce (int loadCellAnalogIn)
 
 float LoadCell::getVoltage (int loadCellAnalogIn)
 {
-  float voltage = ((5.0 * loadCellAnalogIn) / 1023.0);
+  float voltage = ((_vRef * loadCellAnalogIn) / 1023.0);
   return voltage;
   
 }
\ No newline at end of file
@@ -12,8 +12,31 @@
 			the full load mass voltage
 		loadMassLBF:
 			the full load mass in pounds force
+		setCalibration:
+			replaces the above at runtime
 	measurement input:
 		loadCellAnalogIn:
+	live correction (optional):
+		setSupplyVoltage:
+			the measured supply voltage. The load cell is
+			ratiometric so both the zero and the span are
+			scaled with it.
+		setReferenceVoltage:
+			the measured ADC reference voltage
+	zero tracking (optional):
+		beginTare / addTareSample / applyTare:
+			averages 'n' no load samples (eg. during a 
+			countdown) and, if they were quiet enough, uses
+			the mean as the new zero.
+		trackDrift:
+			slowly follows the zero while the stand is idle.
+			Samples more than a window away from the current
+			zero are ignored so a real load is not tared out.
+		load / save:
+			stores the zero in EEPROM (LOADCELL_EEPROM_SIZE 
+			bytes, CRC checked) so it survives a reset.
+		Both use an incremental mean/variance so each sample
+		costs a few float operations and no buffer.
 	output:
 		mass:
 			outputs the calculated mass given the aforementioned
@@ -30,16 +53,42 @@
 #include "Arduino.h"
 #include "LoadCell.h"
 
+#define LOADCELL_EEPROM_SIZE 6		// magic + zero (float) + crc
+#define LOADCELL_DRIFT_WEIGHT 256.0	// drift tracker time constant (samples)
+
 class LoadCell
 {
 	public:
 		LoadCell (float inV, float noLoadCalcV, float loadMassV, float loadMassLBF);	
+		void setCalibration (float inV, float noLoadCalcV, float loadMassV, float loadMassLBF);
 		float getForce (int loadCellAnalogIn);
+		void setSupplyVoltage (float vSupply);
+		void setReferenceVoltage (float vRef);
+		void beginTare (unsigned int samples, float maxNoiseLBF);
+		boolean addTareSample (int loadCellAnalogIn);
+		boolean applyTare ();
+		unsigned int getTareCount ();
+		float getTareNoise ();
+		void trackDrift (int loadCellAnalogIn, float windowLBF);
+		float getDriftNoise ();
+		float getZeroVoltage ();
+		boolean load (int eepromAddress);
+		void save (int eepromAddress);
 	private:
 		float getVoltage (int loadCellAnalogIn);
-		float _ratiometricScaleFactor;
 		float _calibratedSpan;
 		float _noLoadCalcV;
+		float _inV;
+		float _nominalSpan;
+		float _noLoadCalV;
+		float _vRef;
+		float _vSupply;
+		unsigned int _tareSamples;
+		unsigned int _tareCount;
+		float _tareMaxNoise;
+		float _tareMean;
+		float _tareM2;
+		float _driftVar;
 
 };
 
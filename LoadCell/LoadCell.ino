@@ -1,3 +1,4 @@
+#include <ConfigStore.h>
 #include <LoadCell.h>
 
 int sensorPin = A0;    			// force sensor input
@@ -10,15 +11,40 @@ float noLoadCalcV = 0.500;		// no load calculated voltage (used for calibration)
 float loadMassV = 4.0;			// the calibrated output voltage at full mass
 float loadMassLBF = 100.0;		// the mass of the calibration input;
 LoadCell loadCell (inV, noLoadCalcV, loadMassV, loadMassLBF);
+
+//Zero Tracking Parameters
+unsigned int tareSamples = 100;	// readings averaged by the startup tare
+float tareMaxNoiseLBF = 0.5;	// tare is rejected if the readings are noisier than this
+float driftWindowLBF = 2.0;		// idle readings further than this from zero are not tracked
+int zeroAddress = 0;			// EEPROM address of the saved zero
   
 void setup() {
 
   Serial.begin(57600);
+  if (loadCell.load (zeroAddress) == true)
+    Serial.println ("Loaded saved zero");
+  
+  // tare with nothing on the load cell
+  loadCell.beginTare (tareSamples, tareMaxNoiseLBF);
+  while (loadCell.addTareSample (analogRead(sensorPin)) == false)
+    delay(10);
+  Serial.print ("Tare noise (lbf): ");
+  Serial.println (loadCell.getTareNoise(),3);
+  if (loadCell.applyTare() == true)
+  {
+    loadCell.save (zeroAddress);
+    Serial.println ("Tare applied and saved");
+  }
+  else
+    Serial.println ("Tare rejected, keeping previous zero");
+  Serial.print ("Zero (V): ");
+  Serial.println (loadCell.getZeroVoltage(),4);
   Serial.println ("Signal (0 - 1023),Force (lbf)");
 }
 
 void loop() {
   sensorValue = analogRead(sensorPin);
+  loadCell.trackDrift (sensorValue, driftWindowLBF);
   calcForce = loadCell.getForce (sensorValue);
   Serial.print (sensorValue);	//Analog Signal
   Serial.print (",");
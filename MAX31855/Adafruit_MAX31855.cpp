@@ -21,6 +21,7 @@
  ****************************************************/
 
 #include "Adafruit_MAX31855.h"
+#include <TypeK.h>
 #include <avr/pgmspace.h>
 #include <util/delay.h>
 #include <stdlib.h>
@@ -30,6 +31,7 @@ Adafruit_MAX31855::Adafruit_MAX31855(int8_t SCLK, int8_t CS, int8_t MISO) {
   sclk = SCLK;
   cs = CS;
   miso = MISO;
+  lastFault = 0;
 
   //define pin modes
   pinMode(cs, OUTPUT);
@@ -48,12 +50,13 @@ double Adafruit_MAX31855::readInternal(void) {
   // ignore bottom 4 bits - they're just thermocouple data
   v >>= 4;
 
-  // pull the bottom 11 bits off
-  float internal = v & 0x7FF;
-  internal *= 0.0625; // LSB = 0.0625 degrees
+  // pull the bottom 12 bits off (two's complement)
+  int16_t raw = v & 0xFFF;
   // check sign bit!
   if (v & 0x800) 
-    internal *= -1;
+    raw |= 0xF000;
+  float internal = raw;
+  internal *= 0.0625; // LSB = 0.0625 degrees
   //Serial.print("\tInternal Temp: "); Serial.println(internal);
   return internal;
 }
@@ -91,17 +94,53 @@ double Adafruit_MAX31855::readCelsius(void) {
     temp |= 0xC000;
   //Serial.println(temp);
   
-  double centigrade = v;
+  double centigrade = temp;
 
   // LSB = 0.25 degrees C
   centigrade *= 0.25;
   return centigrade;
 }
 
+/*
+  Same as readCelsius() but linearised. The chip assumes the
+  thermocouple is linear (41.276uV/C) which is several degrees out
+  over most of the range (~20C at 1250C). The thermocouple and cold
+  junction readings from one SPI transaction are converted back to
+  voltages and through the NIST type K reference function instead.
+*/
+double Adafruit_MAX31855::readCelsiusNIST(void) {
+  uint32_t v;
+
+  v = spiread32();
+  if (v & 0x7) {
+    return NAN; 
+  }
+
+  // cold junction: bits 4 - 15, LSB = 0.0625 degrees
+  int16_t internal = (v >> 4) & 0xFFF;
+  if (internal & 0x800)
+    internal |= 0xF000;
+
+  // thermocouple: bits 18 - 31, LSB = 0.25 degrees
+  int16_t temp = (v >> 18) & 0x3FFF;
+  if (temp & 0x2000)
+    temp |= 0xC000;
+
+  return TypeK::compensate(temp * 0.25, internal * 0.0625);
+}
+
 uint8_t Adafruit_MAX31855::readError() {
   return spiread32() & 0x7;
 }
 
+/*
+  Fault bits (OC = 0x1, SCG = 0x2, SCV = 0x4) seen by the last 
+  read. Use this after readCelsius() returns NAN to find out why.
+*/
+uint8_t Adafruit_MAX31855::lastError(void) {
+  return lastFault;
+}
+
 double Adafruit_MAX31855::readFarenheit(void) {
   float f = readCelsius();
   f *= 9.0;
@@ -134,5 +173,6 @@ uint32_t Adafruit_MAX31855::spiread32(void) {
 
   digitalWrite(cs, HIGH);
   //Serial.println(d, HEX);
+  lastFault = d & 0x7;
   return d;
 }
@@ -27,10 +27,13 @@ class Adafruit_MAX31855 {
 
   double readInternal(void);
   double readCelsius(void);
+  double readCelsiusNIST(void);
   double readFarenheit(void);
   uint8_t readError();
+  uint8_t lastError(void);
 
  private:
   int8_t sclk, miso, cs;
+  uint8_t lastFault;
   uint32_t spiread32(void);
 };
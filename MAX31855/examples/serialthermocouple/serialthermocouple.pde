@@ -15,6 +15,7 @@
  ****************************************************/
 
 #include "Adafruit_MAX31855.h"
+#include <TypeK.h>
 
 int thermoDO = 3;
 int thermoCS = 4;
@@ -41,6 +42,8 @@ void loop() {
    } else {
      Serial.print("C = "); 
      Serial.println(c);
+     Serial.print("C (NIST) = "); 
+     Serial.println(thermocouple.readCelsiusNIST());
    }
    //Serial.print("F = ");
    //Serial.println(thermocouple.readFarenheit());
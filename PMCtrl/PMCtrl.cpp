@@ -35,144 +35,66 @@
 	Sets the transit and receive pins on the 
 	SoftwareSerial Interface.
 */
-PMCtrl::PMCtrl (int rxPin, int txPin, long baudRate) : _serialCtrl (rxPin, txPin)	// RX, TX
+PMCtrl::PMCtrl (int rxPin, int txPin, long baudRate) : PMCtrlT<SoftwareSerial> (_serialCtrl), _serialCtrl (rxPin, txPin)	// RX, TX
 {
+	_rxPin = rxPin;
+	_txPin = txPin;
 	// The highest Baud rate the micro seems to support is 57600 (un-confirmed)
 	_serialCtrl.begin (baudRate);
 }
 
-/*
-  sets the servo to the desired 'pos'ition in 
-  microseconds.
-*/
-void PMCtrl::setTarget (unsigned int pos, unsigned char channel, int deviceID)
-{
-  //Maestro uses quarter microseconds so convert accordingly
-  pos = pos * 4;
-  
-  _serialCtrl.write(0xAA);               // start byte
-  _serialCtrl.write(deviceID);           // device id
-  _serialCtrl.write(0x04);               // command number
-  _serialCtrl.write(channel);            // servo number
-  _serialCtrl.write(pos & 0x7F);         // target low bits
-  _serialCtrl.write((pos >> 7) & 0x7F);  // target high bits
-
-}
+unsigned int (*PMCtrlBase::_inputHook)(unsigned int reply) = NULL;
 
-
-/* 
-  Sets the speed that the servo moves at. Note that 
-  this does not have to be set. If left alone it will
-  take the default value, which should be instantaneous. 
-  Although this is of course limited by the physical speed 
-  of the servo. Speed is set set in units of .25us/10ms. 
-  For example, setting a value of 140 corresponds to a 
-  speed of 3.5 us/ms eg. 
-	3.5 = 140 * (.25 us / 10ms)
-  In practical terms this means that the servo can move 
-  3.5us in 1 ms. For example, moving from 1000us to 1350us
-   would take 100ms 
+/*
+	Passes every reply read by getPosition or getErrors through 
+	'hook' (eg. to record it) as the value + 1, 0 meaning there
+	was no reply. The hook returns the reply to use in the same
+	form. NULL = none.
 */
-void PMCtrl::setServoSpeed (unsigned int servoSpeed, unsigned char channel, int deviceID)
+void PMCtrlBase::setInputHook (unsigned int (*hook)(unsigned int reply))
 {
-  
-  _serialCtrl.write(0xAA);                      // start byte
-  _serialCtrl.write(deviceID);                  // device id
-  _serialCtrl.write(0x07);                      // command number
-  _serialCtrl.write(channel);                   // servo number
-  _serialCtrl.write(servoSpeed & 0x7F);         // target low bits
-  _serialCtrl.write((servoSpeed >> 7) & 0x7F);  // target high bits
+	_inputHook = hook;
 }
 
-/* 
-	Sets the acceleration of the servo
+/*
+	Finishes a reply read by getPosition or getErrors (valid if 
+	_readOk) by passing it through the input hook, if there is
+	one. Returns the value, or 0 if there was no reply.
 */
-void PMCtrl::setAcceleration (unsigned int acceleration, unsigned char channel, int deviceID)
+unsigned int PMCtrlBase::checkReply (unsigned int value)
 {
-  
-  _serialCtrl.write(0xAA);                      // start byte
-  _serialCtrl.write(deviceID);                  // device id
-  _serialCtrl.write(0x09);                      // command number
-  _serialCtrl.write(channel);                   // servo number
-  _serialCtrl.write(acceleration & 0x7F);         // target low bits
-  _serialCtrl.write((acceleration >> 7) & 0x7F);  // target high bits
+	unsigned int reply = _readOk ? value + 1 : 0;
+	if (_inputHook != NULL)
+		reply = _inputHook (reply);
+	_readOk = (reply != 0);
+	return _readOk ? reply - 1 : 0;
 }
 
 /*
-  Sends all servos to their home positions
+	Logs every command that moves a servo from now on to 'journal'
+	(NULL = none), with the journal's current source
 */
-void PMCtrl::goHome (int deviceID)
+void PMCtrlBase::setJournal (EventJournal *journal)
 {
-  _serialCtrl.write(0xAA);               // start byte
-  _serialCtrl.write(deviceID);           // device id
-  _serialCtrl.write(0x22);               // command number
+	_journal = journal;
 }
 
 /*
-   Returns the position of the specified servo in microseconds
-   Note that if the microcontroller is unable to read from the 
-   servo for any reason than Null or some other obscure value
-   could be returned.
+	Logs a command that has been sent, if there is a journal
 */
-unsigned int PMCtrl::getPosition (unsigned char channel, int deviceID)
+void PMCtrlBase::logCommand (byte type, unsigned char channel, unsigned int value)
 {
-  unsigned int servoPosition = 0;
-
-  // Clear any un-read data from the buffer
-  while (_serialCtrl.available())
-	_serialCtrl.read();
-  
-  _serialCtrl.write(0xAA);                      // start byte
-  _serialCtrl.write(deviceID);                  // device id
-  _serialCtrl.write(0x10);                      // command number
-  _serialCtrl.write(channel);                   // servo number
-  
-  
-  // try 'i' times to read from the buffer (this accounts for latency)
-  for (int i = 0; i < 10; i += 1)
-  {
-	  if ( _serialCtrl.available() >= 2)
-	  {
-	  
-		servoPosition = _serialCtrl.read();
-		if ( _serialCtrl.available() )
-		{
-		  servoPosition += ( _serialCtrl.read() * 256 );
-		  servoPosition = servoPosition / 4;
-		  break;
-		}
-	  }
-  }
-  return servoPosition;
+	if (_journal != NULL)
+		_journal->log (type, channel, value);
 }
 
-
 /*
-  Returns error codes from the maestro. 
-  See: http://www.pololu.com/docs/0J40/all#4.b for a list of error
-  codes.
+	Returns true if the last getPosition or getErrors call received
+	a reply from the maestro, false if it timed out.
 */
-unsigned int PMCtrl::getErrors (unsigned char channel, int deviceID)
+boolean PMCtrlBase::isReadOk ()
 {
-  unsigned int errors = 0;
- 
-  _serialCtrl.write(0xAA);                      // start byte
-  _serialCtrl.write(deviceID);                  // device id
-  _serialCtrl.write(0x21);                      // command number
-  
-  for (int i = 0; i < 10; i += 1)
-  {  
-	  if ( _serialCtrl.available() )
-	  {
-		errors = _serialCtrl.read();
-		if ( _serialCtrl.available() )
-		{
-		  errors += _serialCtrl.read() * 256;
-		  break;
-		}
-	  }
-  }	
-  return errors;
+	return _readOk;
 }
 
 /*
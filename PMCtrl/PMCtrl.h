@@ -21,8 +21,30 @@
 	#included in the calling code as the Arduino can
 	sometimes have problems if this isn't done.
 	
+	The commands can be sent over any serial port:
+		PMCtrl servoCtrl (rxPin, txPin, baud);
+			owns a SoftwareSerial port (as before)
+		PMCtrlT<HardwareSerial> servoCtrl (Serial1);
+			any port type with write(uint8_t), available() and
+			read(): HardwareSerial, SoftwareSerial, or a Maestro
+			simulator on the host (see Tools/PMCtrlBench). The
+			caller calls begin() on the port.
+		PMStreamPort port (stream); PMCtrlT<PMStreamPort> servoCtrl (port);
+			a Stream picked at run time
+	PMCtrlT calls the port's own write (a qualified call, so the
+	compiler does not go through the Stream vtable) for every 
+	byte. Code that only sends commands (eg. ServoProfile) takes
+	a PMCtrlBase &, which costs one virtual call per command
+	rather than per byte.
+	
+	Given an EventJournal (setJournal), every command that moves
+	a servo (setTarget, setServoSpeed, setAcceleration, goHome)
+	is logged to it once it has been sent. The replies read by
+	getPosition and getErrors can be passed through a hook 
+	(setInputHook()).
+	
 	Function descriptions and change history can be found in the 
-	.cpp file of the same name.
+	.cpp file of the same name (the PMCtrlT functions are below).
 */
 
 
@@ -31,22 +53,227 @@
 
 #include "Arduino.h"
 #include "SoftwareSerial.h"
+#include <EventJournal.h>
+
+#define PM_READ_TRIES 10			// polls of the port for a reply (accounts for latency)
 
-class PMCtrl
+/*
+	The Maestro commands, whatever the port
+*/
+class PMCtrlBase
 {
 	public:
-		PMCtrl (int rxPin, int txPin, long baudRate);
-		~PMCtrl();
+		virtual ~PMCtrlBase () {}
+		virtual void setTarget (unsigned int pos, unsigned char channel, int deviceID) = 0;
+		virtual void setServoSpeed (unsigned int servoSpeed, unsigned char channel, int deviceID) = 0;
+		virtual void setAcceleration (unsigned int acceleration, unsigned char channel, int deviceID) = 0;
+		virtual void goHome (int deviceID) = 0;
+		virtual unsigned int getPosition (unsigned char channel, int deviceID) = 0;
+		virtual unsigned int getErrors (unsigned char channel, int deviceID) = 0;
+		boolean isReadOk ();
+		void setJournal (EventJournal *journal);
+		static void setInputHook (unsigned int (*hook)(unsigned int reply));
+	protected:
+		unsigned int checkReply (unsigned int value);
+		void logCommand (byte type, unsigned char channel, unsigned int value);
+		boolean _readOk;
+		EventJournal *_journal;
+		static unsigned int (*_inputHook)(unsigned int reply);
+};
+
+template <class Port> class PMCtrlT : public PMCtrlBase
+{
+	public:
+		PMCtrlT (Port &port);
 		void setTarget (unsigned int pos, unsigned char channel, int deviceID);
 		void setServoSpeed (unsigned int servoSpeed, unsigned char channel, int deviceID);
 		void setAcceleration (unsigned int acceleration, unsigned char channel, int deviceID);
-		void goHome (int deviceID);	
+		void goHome (int deviceID);
 		unsigned int getPosition (unsigned char channel, int deviceID);
 		unsigned int getErrors (unsigned char channel, int deviceID);
+	private:
+		void command (unsigned char command, unsigned char channel, unsigned int value, int deviceID);
+		void send (uint8_t b);
+		Port &_port;
+};
+
+/*
+	The original PMCtrl: commands over its own SoftwareSerial port
+*/
+class PMCtrl : public PMCtrlT<SoftwareSerial>
+{
+	public:
+		PMCtrl (int rxPin, int txPin, long baudRate);
+		~PMCtrl();
 	private:
 		int _rxPin;
 		int _txPin;
 		SoftwareSerial _serialCtrl;
 };
 
+/*
+	Port for a Stream chosen at run time. Every byte is a virtual
+	call, so prefer PMCtrlT of the port's own type where it is 
+	known when compiling. The Stream must outlive the PMStreamPort.
+*/
+class PMStreamPort
+{
+	public:
+		PMStreamPort (Stream &stream) : _stream (stream) {}
+		size_t write (uint8_t b) { return _stream.write (b); }
+		int available () { return _stream.available (); }
+		int read () { return _stream.read (); }
+	private:
+		Stream &_stream;
+};
+
+/*
+	Sends commands over 'port', which the caller has begun
+*/
+template <class Port> PMCtrlT<Port>::PMCtrlT (Port &port) : _port (port)
+{
+	_readOk = false;
+	_journal = NULL;
+}
+
+/*
+	Writes one byte. Port:: picks the port's own write at compile
+	time (no vtable lookup, and it can be inlined).
+*/
+template <class Port> inline void PMCtrlT<Port>::send (uint8_t b)
+{
+	_port.Port::write (b);
+}
+
+/*
+	Sends a command that takes a channel and a 14 bit value
+*/
+template <class Port> void PMCtrlT<Port>::command (unsigned char command, unsigned char channel, unsigned int value, int deviceID)
+{
+	send (0xAA);					// start byte
+	send (deviceID);				// device id
+	send (command);					// command number
+	send (channel);					// servo number
+	send (value & 0x7F);			// low bits
+	send ((value >> 7) & 0x7F);		// high bits
+}
+
+/*
+  sets the servo to the desired 'pos'ition in 
+  microseconds.
+*/
+template <class Port> void PMCtrlT<Port>::setTarget (unsigned int pos, unsigned char channel, int deviceID)
+{
+	//Maestro uses quarter microseconds so convert accordingly
+	command (0x04, channel, pos * 4, deviceID);
+	logCommand (JOURNAL_TARGET, channel, pos);
+}
+
+/* 
+  Sets the speed that the servo moves at. Note that 
+  this does not have to be set. If left alone it will
+  take the default value, which should be instantaneous. 
+  Although this is of course limited by the physical speed 
+  of the servo. Speed is set set in units of .25us/10ms. 
+  For example, setting a value of 140 corresponds to a 
+  speed of 3.5 us/ms eg. 
+	3.5 = 140 * (.25 us / 10ms)
+  In practical terms this means that the servo can move 
+  3.5us in 1 ms. For example, moving from 1000us to 1350us
+   would take 100ms 
+*/
+template <class Port> void PMCtrlT<Port>::setServoSpeed (unsigned int servoSpeed, unsigned char channel, int deviceID)
+{
+	command (0x07, channel, servoSpeed, deviceID);
+	logCommand (JOURNAL_SPEED, channel, servoSpeed);
+}
+
+/* 
+	Sets the acceleration of the servo
+*/
+template <class Port> void PMCtrlT<Port>::setAcceleration (unsigned int acceleration, unsigned char channel, int deviceID)
+{
+	command (0x09, channel, acceleration, deviceID);
+	logCommand (JOURNAL_ACCEL, channel, acceleration);
+}
+
+/*
+  Sends all servos to their home positions
+*/
+template <class Port> void PMCtrlT<Port>::goHome (int deviceID)
+{
+	send (0xAA);					// start byte
+	send (deviceID);				// device id
+	send (0x22);					// command number
+	logCommand (JOURNAL_HOME, 0, 0);
+}
+
+/*
+   Returns the position of the specified servo in microseconds
+   Note that if the microcontroller is unable to read from the 
+   servo for any reason than Null or some other obscure value
+   could be returned (0 if it timed out). Use isReadOk() to check.
+*/
+template <class Port> unsigned int PMCtrlT<Port>::getPosition (unsigned char channel, int deviceID)
+{
+	unsigned int servoPosition = 0;
+	_readOk = false;
+
+	// Clear any un-read data from the buffer
+	while (_port.Port::available ())
+		_port.Port::read ();
+
+	send (0xAA);					// start byte
+	send (deviceID);				// device id
+	send (0x10);					// command number
+	send (channel);					// servo number
+
+	// try PM_READ_TRIES times to read from the buffer
+	for (byte i = 0; i < PM_READ_TRIES; i++)
+	{
+		if (_port.Port::available () >= 2)
+		{
+			servoPosition = _port.Port::read ();
+			if (_port.Port::available ())
+			{
+				servoPosition += (_port.Port::read () * 256);
+				servoPosition = servoPosition / 4;
+				_readOk = true;
+				break;
+			}
+		}
+	}
+	return checkReply (servoPosition);
+}
+
+/*
+  Returns error codes from the maestro. 
+  See: http://www.pololu.com/docs/0J40/all#4.b for a list of error
+  codes.
+*/
+template <class Port> unsigned int PMCtrlT<Port>::getErrors (unsigned char channel, int deviceID)
+{
+	unsigned int errors = 0;
+	_readOk = false;
+
+	send (0xAA);					// start byte
+	send (deviceID);				// device id
+	send (0x21);					// command number
+
+	for (byte i = 0; i < PM_READ_TRIES; i++)
+	{
+		if (_port.Port::available ())
+		{
+			errors = _port.Port::read ();
+			if (_port.Port::available ())
+			{
+				errors += _port.Port::read () * 256;
+				_readOk = true;
+				break;
+			}
+		}
+	}
+	return checkReply (errors);
+}
+
 #endif
\ No newline at end of file
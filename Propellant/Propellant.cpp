@@ -0,0 +1,257 @@
+/*
+ Title: Propellant.cpp
+  Description: Propellant properties that change with the feed
+	conditions, for the EngineMath flow calculations:
+		getGasZ, getGasK:
+			compressibility factor and k of oxygen, nitrogen or
+			air from PROP_GAS_MIN_K to PROP_GAS_MAX_K and 0 to
+			PROP_GAS_MAX_PSI. k is the isentropic exponent: the
+			specific heat ratio for an ideal gas, and the value
+			that keeps GasMassFlow right for a real one.
+		getGasDensity:
+			density from Z (p M / Z R T)
+		getGasMolecularMass:
+			molecular mass to go with the gas
+		getLiquidDensity:
+			density of ethanol or water from PROP_LIQUID_MIN_K
+			to PROP_LIQUID_MAX_K (water below 0C is taken as
+			at 0C)
+	Working these out on the Arduino would mean solving an
+	equation of state (a cubic plus logs and powers) per sample.
+	Instead each property is a table on an even grid (stored in
+	PROGMEM as 16 bit integers, about 1.9KB), so a lookup is a
+	multiply to find the cell and a linear (liquids) or bilinear
+	(gases) interpolation: 2 or 4 table reads and no pow(). Values
+	outside the grid are clamped to its edge. Tools/PropellantCheck
+	regenerates the tables from the Peng-Robinson equation of
+	state (gases) and density correlations (liquids), and checks
+	the interpolation error.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+
+#include "Arduino.h"
+#include "Propellant.h"
+
+// Generated by Tools/PropellantCheck -g. Table value / PROP_GAS_SCALE
+// (or PROP_LIQUID_SCALE) is the property.
+const uint16_t propGasZ[PROP_GASES][PROP_GAS_T_STEPS][PROP_GAS_P_STEPS] PROGMEM =
+{
+	{	// O2
+		{10000, 9624, 9249, 8876, 8507, 8145, 7796, 7465, 7161},	// 200K
+		{10000, 9677, 9358, 9044, 8738, 8441, 8158, 7891, 7646},	// 210K
+		{10000, 9722, 9449, 9183, 8926, 8679, 8445, 8226, 8024},	// 220K
+		{10000, 9759, 9525, 9298, 9080, 8873, 8678, 8496, 8328},	// 230K
+		{10000, 9791, 9589, 9395, 9210, 9034, 8870, 8717, 8578},	// 240K
+		{10000, 9819, 9644, 9477, 9319, 9170, 9031, 8902, 8785},	// 250K
+		{10000, 9842, 9691, 9548, 9412, 9285, 9167, 9058, 8959},	// 260K
+		{10000, 9863, 9732, 9608, 9492, 9383, 9283, 9191, 9107},	// 270K
+		{10000, 9880, 9767, 9660, 9560, 9468, 9382, 9304, 9234},	// 280K
+		{10000, 9896, 9798, 9706, 9620, 9541, 9468, 9402, 9343},	// 290K
+		{10000, 9909, 9825, 9745, 9672, 9604, 9543, 9488, 9438},	// 300K
+		{10000, 9921, 9848, 9780, 9717, 9660, 9608, 9562, 9521},	// 310K
+		{10000, 9932, 9869, 9811, 9757, 9709, 9666, 9627, 9594},	// 320K
+		{10000, 9941, 9887, 9838, 9793, 9752, 9716, 9684, 9657},	// 330K
+		{10000, 9950, 9904, 9862, 9824, 9790, 9761, 9735, 9714},	// 340K
+		{10000, 9957, 9918, 9883, 9852, 9824, 9800, 9780, 9764},	// 350K
+		{10000, 9964, 9931, 9902, 9876, 9854, 9835, 9820, 9808}	// 360K
+	},
+	{	// N2
+		{10000, 9719, 9455, 9211, 8988, 8790, 8618, 8475, 8362},	// 200K
+		{10000, 9765, 9546, 9345, 9163, 9003, 8865, 8751, 8660},	// 210K
+		{10000, 9803, 9621, 9455, 9307, 9177, 9067, 8976, 8904},	// 220K
+		{10000, 9835, 9683, 9547, 9426, 9321, 9233, 9161, 9105},	// 230K
+		{10000, 9861, 9736, 9624, 9525, 9441, 9371, 9315, 9273},	// 240K
+		{10000, 9884, 9781, 9689, 9609, 9542, 9488, 9445, 9414},	// 250K
+		{10000, 9904, 9819, 9744, 9681, 9628, 9586, 9555, 9534},	// 260K
+		{10000, 9921, 9851, 9791, 9742, 9701, 9670, 9649, 9636},	// 270K
+		{10000, 9935, 9879, 9832, 9794, 9764, 9742, 9729, 9723},	// 280K
+		{10000, 9948, 9904, 9867, 9839, 9818, 9804, 9798, 9799},	// 290K
+		{10000, 9959, 9925, 9898, 9878, 9865, 9858, 9858, 9864},	// 300K
+		{10000, 9968, 9943, 9924, 9911, 9905, 9904, 9909, 9920},	// 310K
+		{10000, 9976, 9959, 9947, 9941, 9940, 9945, 9954, 9969},	// 320K
+		{10000, 9984, 9973, 9967, 9967, 9971, 9980, 9994, 10012},	// 330K
+		{10000, 9990, 9985, 9985, 9989, 9998, 10011, 10028, 10049},	// 340K
+		{10000, 9996, 9996, 10000, 10009, 10021, 10038, 10058, 10082},	// 350K
+		{10000, 10001, 10005, 10014, 10026, 10042, 10062, 10084, 10110}	// 360K
+	},
+	{	// air
+		{10000, 9699, 9411, 9139, 8884, 8651, 8443, 8261, 8110},	// 200K
+		{10000, 9746, 9505, 9279, 9070, 8880, 8711, 8565, 8441},	// 210K
+		{10000, 9785, 9583, 9395, 9223, 9067, 8929, 8810, 8710},	// 220K
+		{10000, 9818, 9648, 9492, 9349, 9221, 9109, 9012, 8932},	// 230K
+		{10000, 9846, 9703, 9573, 9454, 9350, 9258, 9180, 9116},	// 240K
+		{10000, 9870, 9750, 9641, 9544, 9458, 9384, 9321, 9270},	// 250K
+		{10000, 9890, 9790, 9699, 9619, 9549, 9490, 9441, 9401},	// 260K
+		{10000, 9908, 9824, 9749, 9684, 9628, 9581, 9542, 9513},	// 270K
+		{10000, 9923, 9853, 9792, 9740, 9695, 9658, 9630, 9609},	// 280K
+		{10000, 9936, 9879, 9830, 9788, 9753, 9725, 9705, 9691},	// 290K
+		{10000, 9947, 9901, 9862, 9829, 9803, 9784, 9770, 9763},	// 300K
+		{10000, 9957, 9921, 9890, 9866, 9847, 9834, 9827, 9825},	// 310K
+		{10000, 9966, 9938, 9915, 9897, 9885, 9878, 9876, 9879},	// 320K
+		{10000, 9974, 9952, 9936, 9925, 9918, 9917, 9919, 9926},	// 330K
+		{10000, 9980, 9966, 9955, 9949, 9948, 9950, 9957, 9968},	// 340K
+		{10000, 9986, 9977, 9972, 9971, 9974, 9980, 9990, 10004},	// 350K
+		{10000, 9992, 9987, 9987, 9990, 9996, 10006, 10020, 10036}	// 360K
+	}
+};
+
+const uint16_t propGasK[PROP_GASES][PROP_GAS_T_STEPS][PROP_GAS_P_STEPS] PROGMEM =
+{
+	{	// O2
+		{13998, 14065, 14196, 14405, 14713, 15142, 15722, 16481, 17448},	// 200K
+		{13996, 14072, 14202, 14395, 14663, 15019, 15477, 16051, 16752},	// 210K
+		{13994, 14077, 14204, 14384, 14623, 14929, 15309, 15769, 16315},	// 220K
+		{13991, 14078, 14204, 14373, 14590, 14859, 15184, 15568, 16013},	// 230K
+		{13987, 14078, 14201, 14361, 14561, 14801, 15086, 15416, 15791},	// 240K
+		{13983, 14075, 14196, 14349, 14533, 14752, 15006, 15295, 15620},	// 250K
+		{13977, 14071, 14190, 14335, 14508, 14709, 14938, 15196, 15483},	// 260K
+		{13970, 14065, 14181, 14321, 14483, 14669, 14879, 15112, 15369},	// 270K
+		{13962, 14057, 14171, 14305, 14459, 14633, 14826, 15039, 15271},	// 280K
+		{13954, 14049, 14160, 14289, 14435, 14598, 14778, 14974, 15187},	// 290K
+		{13945, 14039, 14148, 14272, 14411, 14565, 14734, 14916, 15112},	// 300K
+		{13935, 14028, 14135, 14255, 14388, 14534, 14692, 14862, 15044},	// 310K
+		{13924, 14016, 14121, 14237, 14364, 14503, 14652, 14812, 14982},	// 320K
+		{13912, 14004, 14106, 14218, 14341, 14473, 14614, 14765, 14925},	// 330K
+		{13900, 13990, 14090, 14199, 14317, 14443, 14578, 14721, 14871},	// 340K
+		{13887, 13976, 14074, 14180, 14293, 14414, 14543, 14678, 14821},	// 350K
+		{13874, 13962, 14057, 14160, 14269, 14386, 14509, 14638, 14773}	// 360K
+	},
+	{	// N2
+		{13999, 14158, 14389, 14697, 15088, 15564, 16127, 16773, 17494},	// 200K
+		{13999, 14159, 14378, 14660, 15006, 15417, 15892, 16427, 17018},	// 210K
+		{13999, 14159, 14368, 14628, 14940, 15302, 15713, 16170, 16670},	// 220K
+		{13999, 14158, 14358, 14601, 14885, 15209, 15572, 15971, 16403},	// 230K
+		{13999, 14156, 14348, 14576, 14838, 15132, 15458, 15812, 16192},	// 240K
+		{13998, 14154, 14339, 14554, 14797, 15067, 15362, 15681, 16021},	// 250K
+		{13998, 14151, 14330, 14533, 14760, 15010, 15281, 15571, 15879},	// 260K
+		{13998, 14148, 14320, 14514, 14728, 14961, 15211, 15478, 15759},	// 270K
+		{13997, 14145, 14311, 14496, 14698, 14916, 15149, 15396, 15655},	// 280K
+		{13996, 14141, 14302, 14479, 14671, 14877, 15095, 15324, 15564},	// 290K
+		{13995, 14137, 14293, 14463, 14646, 14840, 15045, 15260, 15484},	// 300K
+		{13994, 14133, 14285, 14448, 14622, 14807, 15001, 15203, 15413},	// 310K
+		{13993, 14129, 14276, 14433, 14600, 14776, 14960, 15151, 15349},	// 320K
+		{13991, 14124, 14267, 14419, 14579, 14747, 14922, 15103, 15290},	// 330K
+		{13989, 14119, 14258, 14405, 14559, 14720, 14886, 15059, 15236},	// 340K
+		{13987, 14114, 14249, 14391, 14539, 14694, 14853, 15018, 15187},	// 350K
+		{13985, 14109, 14240, 14378, 14521, 14669, 14822, 14979, 15141}	// 360K
+	},
+	{	// air
+		{13998, 14134, 14338, 14619, 14985, 15443, 15997, 16647, 17391},	// 200K
+		{13998, 14137, 14332, 14589, 14912, 15304, 15766, 16298, 16895},	// 210K
+		{13998, 14138, 14325, 14563, 14853, 15197, 15594, 16043, 16541},	// 220K
+		{13997, 14137, 14318, 14540, 14804, 15111, 15460, 15849, 16275},	// 230K
+		{13996, 14136, 14310, 14519, 14762, 15040, 15352, 15695, 16067},	// 240K
+		{13995, 14134, 14302, 14499, 14725, 14980, 15262, 15569, 15900},	// 250K
+		{13994, 14131, 14293, 14481, 14692, 14927, 15185, 15464, 15762},	// 260K
+		{13992, 14127, 14284, 14463, 14662, 14881, 15119, 15374, 15645},	// 270K
+		{13990, 14123, 14275, 14446, 14634, 14840, 15060, 15296, 15545},	// 280K
+		{13987, 14119, 14266, 14430, 14609, 14802, 15008, 15227, 15457},	// 290K
+		{13985, 14114, 14257, 14414, 14584, 14767, 14961, 15165, 15380},	// 300K
+		{13982, 14108, 14247, 14399, 14561, 14734, 14918, 15110, 15310},	// 310K
+		{13978, 14102, 14238, 14383, 14539, 14704, 14878, 15059, 15248},	// 320K
+		{13974, 14096, 14228, 14368, 14518, 14675, 14840, 15012, 15190},	// 330K
+		{13970, 14090, 14218, 14354, 14497, 14648, 14805, 14969, 15138},	// 340K
+		{13966, 14083, 14207, 14339, 14477, 14622, 14772, 14928, 15089},	// 350K
+		{13961, 14075, 14197, 14324, 14458, 14597, 14741, 14890, 15043}	// 360K
+	}
+};
+
+const uint16_t propLiquidDensity[PROP_LIQUIDS][PROP_LIQUID_T_STEPS] PROGMEM =
+{
+	{8400, 8321, 8241, 8159, 8076, 7991, 7904, 7814, 7723, 7629, 7532, 7433, 7330},	// ethanol
+	{9998, 9998, 9998, 9998, 9998, 9997, 9982, 9956, 9922, 9880, 9832, 9778, 9718}	// water
+};
+
+const float propGasMolecularMass[PROP_GASES] PROGMEM = { 31.999, 28.013, 28.97 };
+
+/*
+	Position of 'value' on an even grid of 'steps' points from 'min'
+	to 'max': the cell in *cell and the fraction across it returned
+	(clamped to the grid)
+*/
+static float gridPosition (float value, float min, float max, byte steps, byte *cell)
+{
+	float x = (value - min) * ((steps - 1) / (max - min));
+	if (!(x > 0))				// also catches NAN
+		x = 0;
+	if (x >= steps - 1)
+		x = steps - 1;
+	byte i = (byte) x;
+	if (i >= steps - 1)
+		i = steps - 2;
+	*cell = i;
+	return x - i;
+}
+
+/*
+	Bilinear interpolation of one gas's table
+*/
+float Propellant::gasLookup (const uint16_t *table, float kelvin, float psi)
+{
+	byte row, column;
+	float u = gridPosition (kelvin, PROP_GAS_MIN_K, PROP_GAS_MAX_K, PROP_GAS_T_STEPS, &row);
+	float v = gridPosition (psi, 0, PROP_GAS_MAX_PSI, PROP_GAS_P_STEPS, &column);
+	const uint16_t *c = table + row * PROP_GAS_P_STEPS + column;
+	float low = pgm_read_word (c) + v * ((float) pgm_read_word (c + 1) - pgm_read_word (c));
+	c += PROP_GAS_P_STEPS;
+	float high = pgm_read_word (c) + v * ((float) pgm_read_word (c + 1) - pgm_read_word (c));
+	return (low + u * (high - low)) / PROP_GAS_SCALE;
+}
+
+/*
+	Compressibility factor of 'gas' (PROP_O2, PROP_N2 or PROP_AIR)
+	at 'kelvin' and 'psi'. NAN for any other gas.
+*/
+float Propellant::getGasZ (byte gas, float kelvin, float psi)
+{
+	if ((gas == PROP_FIXED) || (gas > PROP_GASES))
+		return NAN;
+	return gasLookup (&propGasZ[gas - 1][0][0], kelvin, psi);
+}
+
+/*
+	Specific heat ratio (Cp / Cv) of 'gas' at 'kelvin' and 'psi'.
+	NAN for an unknown gas.
+*/
+float Propellant::getGasK (byte gas, float kelvin, float psi)
+{
+	if ((gas == PROP_FIXED) || (gas > PROP_GASES))
+		return NAN;
+	return gasLookup (&propGasK[gas - 1][0][0], kelvin, psi);
+}
+
+/*
+	Molecular mass (g/mol) of 'gas'. NAN for an unknown gas.
+*/
+float Propellant::getGasMolecularMass (byte gas)
+{
+	if ((gas == PROP_FIXED) || (gas > PROP_GASES))
+		return NAN;
+	return pgm_read_float (&propGasMolecularMass[gas - 1]);
+}
+
+/*
+	Density (kg/m^3) of 'gas' at 'kelvin' and 'psi'
+*/
+float Propellant::getGasDensity (byte gas, float kelvin, float psi)
+{
+	float r = 8314.4621;	// J/(kmol K)
+	return psi * 6894.75729 * getGasMolecularMass (gas) / (getGasZ (gas, kelvin, psi) * r * kelvin);
+}
+
+/*
+	Density (kg/m^3) of 'liquid' (PROP_ETHANOL or PROP_WATER) at
+	'kelvin'. NAN for any other liquid.
+*/
+float Propellant::getLiquidDensity (byte liquid, float kelvin)
+{
+	if ((liquid == PROP_FIXED) || (liquid > PROP_LIQUIDS))
+		return NAN;
+	byte cell;
+	float u = gridPosition (kelvin, PROP_LIQUID_MIN_K, PROP_LIQUID_MAX_K, PROP_LIQUID_T_STEPS, &cell);
+	const uint16_t *c = &propLiquidDensity[liquid - 1][cell];
+	return (pgm_read_word (c) + u * ((float) pgm_read_word (c + 1) - pgm_read_word (c))) / PROP_LIQUID_SCALE;
+}
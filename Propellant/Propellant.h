@@ -0,0 +1,75 @@
+/*
+ Title: Propellant.h
+  Description: Propellant properties that change with the feed
+	conditions, for the EngineMath flow calculations:
+		getGasZ, getGasK:
+			compressibility factor and k of oxygen, nitrogen or
+			air from PROP_GAS_MIN_K to PROP_GAS_MAX_K and 0 to
+			PROP_GAS_MAX_PSI. k is the isentropic exponent: the
+			specific heat ratio for an ideal gas, and the value
+			that keeps GasMassFlow right for a real one.
+		getGasDensity:
+			density from Z (p M / Z R T)
+		getGasMolecularMass:
+			molecular mass to go with the gas
+		getLiquidDensity:
+			density of ethanol or water from PROP_LIQUID_MIN_K
+			to PROP_LIQUID_MAX_K (water below 0C is taken as
+			at 0C)
+	Working these out on the Arduino would mean solving an
+	equation of state (a cubic plus logs and powers) per sample.
+	Instead each property is a table on an even grid (stored in
+	PROGMEM as 16 bit integers, about 1.9KB), so a lookup is a
+	multiply to find the cell and a linear (liquids) or bilinear
+	(gases) interpolation: 2 or 4 table reads and no pow(). Values
+	outside the grid are clamped to its edge. Tools/PropellantCheck
+	regenerates the tables from the Peng-Robinson equation of
+	state (gases) and density correlations (liquids), and checks
+	the interpolation error.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+#ifndef Propellant_h
+#define Propellant_h
+
+#include "Arduino.h"
+
+// Propellants. PROP_FIXED means use the configured constants instead.
+#define PROP_FIXED 0
+#define PROP_O2 1					// gases
+#define PROP_N2 2
+#define PROP_AIR 3
+#define PROP_GASES 3
+#define PROP_ETHANOL 1				// liquids
+#define PROP_WATER 2
+#define PROP_LIQUIDS 2
+
+// Gas grid
+#define PROP_GAS_MIN_K 200.0
+#define PROP_GAS_MAX_K 360.0
+#define PROP_GAS_T_STEPS 17			// 10K apart
+#define PROP_GAS_MAX_PSI 1200.0
+#define PROP_GAS_P_STEPS 9			// 150psi apart
+#define PROP_GAS_SCALE 10000.0		// table value / scale = Z or k
+
+// Liquid grid
+#define PROP_LIQUID_MIN_K 233.15	// -40C
+#define PROP_LIQUID_MAX_K 353.15	// 80C
+#define PROP_LIQUID_T_STEPS 13		// 10C apart
+#define PROP_LIQUID_SCALE 10.0		// table value / scale = kg/m^3
+
+class Propellant
+{
+	public:
+		static float getGasZ (byte gas, float kelvin, float psi);
+		static float getGasK (byte gas, float kelvin, float psi);
+		static float getGasDensity (byte gas, float kelvin, float psi);
+		static float getGasMolecularMass (byte gas);
+		static float getLiquidDensity (byte liquid, float kelvin);
+	private:
+		static float gasLookup (const uint16_t *table, float kelvin, float psi);
+};
+
+#endif
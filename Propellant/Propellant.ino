@@ -0,0 +1,70 @@
+/*
+ Title: Propellant (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the Propellant library. It prints Z, k
+	and density of oxygen as a tank blows down (pressure and
+	temperature falling together), the ox mass flow through an
+	orifice with those properties and with the fixed ones
+	(Z 0.98, k 1.40, 277K), ethanol density from -20C to 40C and
+	the time each lookup takes on this micro.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <EngineMath.h>
+#include <Propellant.h>
+
+EngineMath em;
+float ga = 0.0000101;			// ox orifice area (m^2)
+
+void setup ()
+{
+	Serial.begin(57600);
+	Serial.println (F("psi,K,Z,k,density(kg/m^3),flow(kg/sec),fixed flow(kg/sec)"));
+	for (float psi = 1000; psi >= 200; psi -= 100)
+	{
+		float kelvin = 277.0 - (1000 - psi) * 0.08;	// cools as it blows down
+		float z = Propellant::getGasZ (PROP_O2, kelvin, psi);
+		float k = Propellant::getGasK (PROP_O2, kelvin, psi);
+		Serial.print (psi, 0);
+		Serial.print (',');
+		Serial.print (kelvin, 1);
+		Serial.print (',');
+		Serial.print (z, 4);
+		Serial.print (',');
+		Serial.print (k, 4);
+		Serial.print (',');
+		Serial.print (Propellant::getGasDensity (PROP_O2, kelvin, psi), 2);
+		Serial.print (',');
+		Serial.print (em.GasMassFlow (0.32, 9.80665, k, z, kelvin, 32, psi, 150, ga), 5);
+		Serial.print (',');
+		Serial.println (em.GasMassFlow (0.32, 9.80665, 1.40, 0.98, 277.0, 32, psi, 150, ga), 5);
+	}
+
+	Serial.println (F("C,ethanol(kg/m^3)"));
+	for (float celsius = -20; celsius <= 40; celsius += 10)
+	{
+		Serial.print (celsius, 0);
+		Serial.print (',');
+		Serial.println (Propellant::getLiquidDensity (PROP_ETHANOL, celsius + 273.15), 1);
+	}
+
+	volatile float out;
+	unsigned long start = micros();
+	for (int i = 0; i < 1000; i++)
+		out = Propellant::getGasZ (PROP_O2, 200.0 + i * 0.15, i);
+	Serial.print (F("getGasZ: "));
+	Serial.print ((micros() - start) / 1000.0, 1);
+	Serial.println (F(" us"));
+	start = micros();
+	for (int i = 0; i < 1000; i++)
+		out = Propellant::getLiquidDensity (PROP_ETHANOL, 233.0 + i * 0.1);
+	Serial.print (F("getLiquidDensity: "));
+	Serial.print ((micros() - start) / 1000.0, 1);
+	Serial.println (F(" us"));
+}
+
+void loop ()
+{
+}
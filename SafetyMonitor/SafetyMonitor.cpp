@@ -0,0 +1,207 @@
+/*
+ Title: SafetyMonitor.cpp
+  Description: This library evaluates a table of redline
+	rules against live sensor values. Each rule watches one 
+	channel (a pointer to the variable holding the latest 
+	reading) and may have:
+		(1) a minimum and/or maximum limit
+		(2) a maximum rate of change (units per second)
+		(3) a persistence window - the number of consecutive
+			samples that must violate the rule before it trips
+	A reading that is not a number (a failed or disconnected 
+	sensor) violates every armed rule on its channel, so a lost 
+	sensor trips the monitor rather than switching its redlines 
+	off. Rules are assigned to groups so that the calling program
+	can arm only the rules that make sense for the current 
+	phase of a run (eg. no-go limits are only armed once the
+	engine should be making pressure). The rule table is kept
+	in PROGMEM so it takes no RAM; check() copies out one rule
+	at a time.
+	
+	Each call to check() visits every rule once so the cost
+	is fixed and bounded by SAFETY_MAX_RULES. The worst case 
+	trip latency of a rule is its persistence multiplied by 
+	the time between calls to check().
+	
+    Note that this library will not setup any pins or shut
+	anything down. It is expected that the calling program
+	will act on the result of check().
+*/
+
+#include "Arduino.h"
+#include "SafetyMonitor.h"
+
+/*
+	'rules' is the rule table in PROGMEM (kept by reference, not 
+	copied) and 'ruleCount' the number of entries. Only the first 
+	SAFETY_MAX_RULES rules are used. All rules start disarmed.
+*/
+SafetyMonitor::SafetyMonitor (const SafetyRule *rules, byte ruleCount)
+{
+	_rules = rules;
+	_ruleCount = (ruleCount > SAFETY_MAX_RULES) ? SAFETY_MAX_RULES : ruleCount;
+	_armed = 0;
+	reset();
+}
+
+/*
+	Arms the rules whose group matches any bit in 'groups'. Rules
+	that are disarmed have their persistence count cleared.
+*/
+void SafetyMonitor::arm (byte groups)
+{
+	SafetyRule rule;
+	for (byte i = 0; i < _ruleCount; i++)
+	{
+		getRule (i, &rule);
+		if ((rule.group & groups) == 0)
+			_count[i] = 0;
+	}
+	_armed = groups;
+}
+
+/*
+	Clears all persistence counts, rate history and the last trip.
+	Call this at the start of each run.
+*/
+void SafetyMonitor::reset ()
+{
+	_havePrevious = false;
+	_prevMillis = 0;
+	for (byte i = 0; i < SAFETY_MAX_RULES; i++)
+	{
+		_prevValue[i] = 0;
+		_count[i] = 0;
+		_firstMillis[i] = 0;
+	}
+	_tripRule = SAFETY_OK;
+	_tripReason = 0;
+	_tripValue = 0;
+	_tripLatency = 0;
+}
+
+/*
+	Evaluates every armed rule against the current channel values.
+	Should be called once per acquisition tick with the time the 
+	sensors were read. Returns the index of the first rule that
+	tripped or SAFETY_OK. A rule only counts as violated on a tick
+	if it is out of limits on that tick; a single good sample 
+	resets its persistence count. A reading that is not a number
+	violates an armed rule (the rule fails closed).
+*/
+int SafetyMonitor::check (unsigned long millisNow)
+{
+	float dt = 0;
+	if (_havePrevious && (millisNow > _prevMillis))
+		dt = (millisNow - _prevMillis) / 1000.0;
+	int tripped = SAFETY_OK;
+	SafetyRule rule;
+
+	for (byte i = 0; i < _ruleCount; i++)
+	{
+		getRule (i, &rule);
+		float v = *rule.value;
+		byte reason = 0;
+		if (rule.group & _armed)
+		{
+			if (isnan(v))
+				reason = SAFETY_TRIP_INVALID;
+			else if (!isnan(rule.minValue) && (v < rule.minValue))
+				reason = SAFETY_TRIP_LOW;
+			else if (!isnan(rule.maxValue) && (v > rule.maxValue))
+				reason = SAFETY_TRIP_HIGH;
+			else if (!isnan(rule.maxRate) && (dt > 0) && 
+					 (fabs(v - _prevValue[i]) > rule.maxRate * dt))
+				reason = SAFETY_TRIP_RATE;
+		}
+		if (reason == 0)
+			_count[i] = 0;
+		else
+		{
+			if (_count[i] == 0)
+				_firstMillis[i] = (unsigned int) millisNow;
+			if (_count[i] < 255)
+				_count[i]++;
+			if ((_count[i] >= rule.persistence) && (tripped == SAFETY_OK))
+			{
+				tripped = i;
+				_tripRule = i;
+				_tripReason = reason;
+				_tripValue = v;
+				_tripLatency = (unsigned int) ((unsigned int) millisNow - _firstMillis[i]);
+			}
+		}
+		_prevValue[i] = v;
+	}
+	_prevMillis = millisNow;
+	_havePrevious = true;
+	return tripped;
+}
+
+/*
+	Copies rule 'index' of the table out of PROGMEM
+*/
+void SafetyMonitor::getRule (byte index, SafetyRule *rule)
+{
+	memcpy_P (rule, &_rules[index], sizeof (SafetyRule));
+}
+
+/*
+	Returns the index of the last rule that tripped or SAFETY_OK
+*/
+int SafetyMonitor::lastTrip ()
+{
+	return _tripRule;
+}
+
+/*
+	Returns SAFETY_TRIP_LOW, SAFETY_TRIP_HIGH, SAFETY_TRIP_RATE or
+	SAFETY_TRIP_INVALID
+*/
+byte SafetyMonitor::lastTripReason ()
+{
+	return _tripReason;
+}
+
+/*
+	Returns the channel value that caused the last trip
+*/
+float SafetyMonitor::lastTripValue ()
+{
+	return _tripValue;
+}
+
+/*
+	Returns the milliseconds between the first violating sample 
+	and the trip (ie. the time spent in the persistence window)
+*/
+unsigned long SafetyMonitor::lastTripLatency ()
+{
+	return _tripLatency;
+}
+
+/*
+	Prints a one line description of the last trip eg.
+		DANGER: enginePSI high (212.50) after 12ms
+*/
+void SafetyMonitor::printTrip (Print &out)
+{
+	if (_tripRule == SAFETY_OK)
+		return;
+	SafetyRule rule;
+	getRule (_tripRule, &rule);
+	out.print (F("DANGER: "));
+	out.print ((const __FlashStringHelper *) rule.name);
+	if (_tripReason == SAFETY_TRIP_LOW)
+		out.print (F(" low ("));
+	else if (_tripReason == SAFETY_TRIP_HIGH)
+		out.print (F(" high ("));
+	else if (_tripReason == SAFETY_TRIP_RATE)
+		out.print (F(" rate ("));
+	else
+		out.print (F(" invalid ("));
+	out.print (_tripValue);
+	out.print (F(") after "));
+	out.print (_tripLatency);
+	out.println (F("ms"));
+}
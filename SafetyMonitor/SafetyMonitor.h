@@ -0,0 +1,86 @@
+/*
+ Title: SafetyMonitor.h
+  Description: This library evaluates a table of redline
+	rules against live sensor values. Each rule watches one 
+	channel (a pointer to the variable holding the latest 
+	reading) and may have:
+		(1) a minimum and/or maximum limit
+		(2) a maximum rate of change (units per second)
+		(3) a persistence window - the number of consecutive
+			samples that must violate the rule before it trips
+	A reading that is not a number (a failed or disconnected 
+	sensor) violates every armed rule on its channel, so a lost 
+	sensor trips the monitor rather than switching its redlines 
+	off. Rules are assigned to groups so that the calling program
+	can arm only the rules that make sense for the current 
+	phase of a run (eg. no-go limits are only armed once the
+	engine should be making pressure). The rule table is kept
+	in PROGMEM so it takes no RAM; check() copies out one rule
+	at a time.
+	
+	Each call to check() visits every rule once so the cost
+	is fixed and bounded by SAFETY_MAX_RULES. The worst case 
+	trip latency of a rule is its persistence multiplied by 
+	the time between calls to check(). The time a rule first
+	failed is kept to 16 bits, so latencies are only reported
+	correctly below 65 seconds.
+	
+    Note that this library will not setup any pins or shut
+	anything down. It is expected that the calling program
+	will act on the result of check().
+*/
+#ifndef SafetyMonitor_h
+#define SafetyMonitor_h
+
+#include "Arduino.h"
+
+#define SAFETY_MAX_RULES 8
+#define SAFETY_OK -1
+#define SAFETY_NO_LIMIT NAN		// use for a limit that should not be checked
+
+// Reasons a rule tripped
+#define SAFETY_TRIP_LOW 1
+#define SAFETY_TRIP_HIGH 2
+#define SAFETY_TRIP_RATE 3
+#define SAFETY_TRIP_INVALID 4	// reading is not a number
+
+typedef struct
+{
+	const float *value;		// channel to watch
+	float minValue;			// trip below this value (SAFETY_NO_LIMIT = unchecked)
+	float maxValue;			// trip above this value (SAFETY_NO_LIMIT = unchecked)
+	float maxRate;			// trip when |rate| exceeds this (units/sec, SAFETY_NO_LIMIT = unchecked)
+	byte persistence;		// consecutive violating samples before tripping (min 1)
+	byte group;				// bit mask used by arm()
+	const char *name;		// rule name stored in PROGMEM
+} SafetyRule;
+
+class SafetyMonitor
+{
+	public:
+		SafetyMonitor (const SafetyRule *rules, byte ruleCount);
+		void arm (byte groups);
+		void reset ();
+		int check (unsigned long millisNow);
+		int lastTrip ();
+		byte lastTripReason ();
+		float lastTripValue ();
+		unsigned long lastTripLatency ();
+		void printTrip (Print &out);
+	private:
+		void getRule (byte index, SafetyRule *rule);
+		const SafetyRule *_rules;
+		byte _ruleCount;
+		byte _armed;
+		boolean _havePrevious;
+		unsigned long _prevMillis;
+		float _prevValue[SAFETY_MAX_RULES];
+		byte _count[SAFETY_MAX_RULES];
+		unsigned int _firstMillis[SAFETY_MAX_RULES];	// low 16 bits of millis()
+		int _tripRule;
+		byte _tripReason;
+		float _tripValue;
+		unsigned long _tripLatency;
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ Title: SafetyMonitor (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the SafetyMonitor library. A simple
+	simulated chamber pressure is run at a 10ms tick and a 
+	fault is injected after 1 second. Each fault type is run
+	in turn and the trip latency (from fault injection to the
+	trip) is printed along with the time check() took.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <SafetyMonitor.h>
+
+#define GROUP_LIMITS 0x01
+#define GROUP_NOGO 0x02
+
+float chamberPSI;
+float chamberTemp;
+
+const char nameChamberPSI[] PROGMEM = "chamberPSI";
+const char nameChamberTemp[] PROGMEM = "chamberTemp";
+const char nameChamberRate[] PROGMEM = "chamberPSI";
+
+const SafetyRule rules[] PROGMEM = 
+{
+	// value         min              max              rate             persist group          name
+	{ &chamberPSI,   SAFETY_NO_LIMIT, 200,             SAFETY_NO_LIMIT, 3,      GROUP_LIMITS,  nameChamberPSI },
+	{ &chamberTemp,  SAFETY_NO_LIMIT, 400,             SAFETY_NO_LIMIT, 5,      GROUP_LIMITS,  nameChamberTemp },
+	{ &chamberPSI,   SAFETY_NO_LIMIT, SAFETY_NO_LIMIT, 5000,            2,      GROUP_LIMITS,  nameChamberRate },
+	{ &chamberPSI,   50,              SAFETY_NO_LIMIT, SAFETY_NO_LIMIT, 5,      GROUP_NOGO,    nameChamberPSI },
+};
+SafetyMonitor safety (rules, sizeof(rules) / sizeof(rules[0]));
+
+const unsigned long tick = 10;			// ms between samples
+const unsigned long faultTime = 1000;	// ms into the run the fault is injected
+
+/*
+	Runs the simulation with the given fault until the monitor 
+	trips or 3 seconds pass.
+		1 = over pressure
+		2 = over temperature
+		3 = pressure spike
+		4 = flame out
+		5 = pressure sensor failed (reads not a number)
+*/
+void runFault (int fault)
+{
+	unsigned long worstMicros = 0;
+	safety.reset();
+	safety.arm (GROUP_LIMITS);
+	for (unsigned long t = 0; t < 3000; t += tick)
+	{
+		// first order pressure rise to 150 psi
+		chamberPSI = 150.0 * (1.0 - exp(-(float) t / 200.0));
+		chamberTemp = 300;
+		if (t >= 500)
+			safety.arm (GROUP_LIMITS | GROUP_NOGO);
+		if (t >= faultTime)
+		{
+			if (fault == 1) 
+				chamberPSI += (t - faultTime) * 0.5;
+			else if (fault == 2)
+				chamberTemp = 450;
+			else if (fault == 3)
+				chamberPSI += (t - faultTime < 30) ? (t - faultTime) * 5.0 : 150;
+			else if (fault == 4)
+				chamberPSI = 14.7;
+			else if (fault == 5)
+				chamberPSI = NAN;
+		}
+		unsigned long start = micros();
+		int rule = safety.check (t);
+		unsigned long cost = micros() - start;
+		if (cost > worstMicros)
+			worstMicros = cost;
+		if (rule != SAFETY_OK)
+		{
+			safety.printTrip (Serial);
+			Serial.print (F("Trip latency from fault (ms): "));
+			Serial.print (t - faultTime);
+			Serial.print (F(", worst check() time (us): "));
+			Serial.println (worstMicros);
+			return;
+		}
+	}
+	Serial.println (F("No trip!"));
+}
+
+void setup ()
+{
+	Serial.begin(57600);
+}
+
+void loop ()
+{
+	for (int fault = 1; fault <= 5; fault++)
+		runFault (fault);
+	Serial.println (F("Done!\n"));
+	delay (10000);
+}
@@ -0,0 +1,272 @@
+/*
+ Title: SensorFilter.cpp
+  Description: A small bank of digital filters for raw analog
+	readings (0 - 1023). Each filter takes one sample per call,
+	uses a fixed amount of memory and has a fixed cost per 
+	sample:
+		MedianFilter
+			moving median of the last 3 or 5 samples. Removes 
+			single sample spikes without smearing a step.
+		BiquadFilter
+			2nd order Butterworth low-pass in fixed point (Q14
+			coefficients, 4 fractional bits of state, error 
+			feedback). The coefficients are computed once from
+			the cutoff and sample rate and rounded so the DC 
+			gain is exactly 1.
+		DecimatingFIR
+			FIR filter with caller supplied Q15 taps that only 
+			computes an output every 'decimation' samples (eg.
+			to log a channel slower than it is read).
+		SensorFilter
+			the per channel chain used by EngineController: an
+			optional median followed by an optional low-pass.
+	All filters start from the first sample they are given so
+	there is no startup transient.
+	
+	The frequency response, spike rejection and cost per sample
+	can be checked on a PC with Tools/FilterBench.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+
+#include "Arduino.h"
+#include "SensorFilter.h"
+
+/*
+	Moving median of the last 'window' samples (3 or 5). A window
+	of 1 passes samples through.
+*/
+MedianFilter::MedianFilter (byte window)
+{
+	if (window > FILTER_MAX_MEDIAN)
+		window = FILTER_MAX_MEDIAN;
+	if (window < 1)
+		window = 1;
+	_window = window;
+	reset ();
+}
+
+/*
+	Forgets the history. The next sample fills the window.
+*/
+void MedianFilter::reset ()
+{
+	_next = 0;
+	_count = 0;
+}
+
+/*
+	Adds a sample and returns the median of the window. The
+	window is copied and insertion sorted, which for 5 samples
+	is at most 10 compares.
+*/
+int MedianFilter::filter (int raw)
+{
+	if (_count == 0)
+	{
+		for (byte i = 0; i < _window; i++)
+			_history[i] = raw;
+		_count = _window;
+	}
+	_history[_next] = raw;
+	_next++;
+	if (_next >= _window)
+		_next = 0;
+	
+	int sorted[FILTER_MAX_MEDIAN];
+	for (byte i = 0; i < _window; i++)
+	{
+		int v = _history[i];
+		byte j = i;
+		while (j > 0 && sorted[j - 1] > v)
+		{
+			sorted[j] = sorted[j - 1];
+			j--;
+		}
+		sorted[j] = v;
+	}
+	return sorted[_window / 2];
+}
+
+/*
+	2nd order Butterworth low-pass (bilinear transform). The
+	cutoff should be between sampleHz / 100 and sampleHz / 4;
+	below that the Q14 coefficients get too coarse.
+*/
+BiquadFilter::BiquadFilter (float cutoffHz, float sampleHz)
+{
+	float k = tan (M_PI * cutoffHz / sampleHz);
+	float norm = 1.0 / (1.0 + M_SQRT2 * k + k * k);
+	float scale = (float) (1L << FILTER_COEF_SHIFT);
+	long a1 = lround (2.0 * (k * k - 1.0) * norm * scale);
+	long a2 = lround ((1.0 - M_SQRT2 * k + k * k) * norm * scale);
+	
+	// b0 + b1 + b2 = 1 + a1 + a2 so the DC gain is exactly 1
+	long sum = (1L << FILTER_COEF_SHIFT) + a1 + a2;
+	_a1 = a1;
+	_a2 = a2;
+	_b0 = (sum + 2) / 4;
+	_b1 = sum - 2 * _b0;
+	reset ();
+}
+
+/*
+	Forgets the state. The filter restarts from the next sample.
+*/
+void BiquadFilter::reset ()
+{
+	_primed = false;
+}
+
+/*
+	Adds a sample and returns the filtered value
+*/
+int BiquadFilter::filter (int raw)
+{
+	// the state fits in an int (16 bits on AVR): 0 - 1023 with 4
+	// fractional bits is at most 16368 plus the overshoot
+	int x = raw << FILTER_STATE_SHIFT;
+	if (_primed == false)
+	{
+		_x1 = _x2 = _y1 = _y2 = x;
+		_error = 0;
+		_primed = true;
+	}
+	// the bits dropped by the shift are carried into the next 
+	// sample (error feedback) so rounding can't leave a dead band
+	// around the input at low cutoffs
+	long acc = (long) _b0 * ((long) x + _x2) + (long) _b1 * _x1
+			 - (long) _a1 * _y1 - (long) _a2 * _y2 + _error;
+	long y = acc >> FILTER_COEF_SHIFT;
+	_error = acc - (y << FILTER_COEF_SHIFT);
+	if (y > 32767)
+		y = 32767;
+	else if (y < -32768)
+		y = -32768;
+	_x2 = _x1;
+	_x1 = x;
+	_y2 = _y1;
+	_y1 = y;
+	return (int) ((y + (1 << (FILTER_STATE_SHIFT - 1))) >> FILTER_STATE_SHIFT);
+}
+
+/*
+	Gain at 'hz' of the filter as built (ie. with the rounded
+	coefficients). Used to check the response, not per sample.
+*/
+float BiquadFilter::getGain (float hz, float sampleHz)
+{
+	float w = 2.0 * M_PI * hz / sampleHz;
+	float c1 = cos (w), s1 = sin (w), c2 = cos (2.0 * w), s2 = sin (2.0 * w);
+	float nRe = _b0 + _b1 * c1 + _b0 * c2;
+	float nIm = -(_b1 * s1 + _b0 * s2);
+	float dRe = (1L << FILTER_COEF_SHIFT) + _a1 * c1 + _a2 * c2;
+	float dIm = -(_a1 * s1 + _a2 * s2);
+	return sqrt ((nRe * nRe + nIm * nIm) / (dRe * dRe + dIm * dIm));
+}
+
+/*
+	FIR filter with 'numTaps' Q15 taps (sum to 32768 for unity DC
+	gain) that produces one output every 'decimation' samples.
+	The taps are not copied so they must stay in scope.
+*/
+DecimatingFIR::DecimatingFIR (const int *taps, byte numTaps, byte decimation)
+{
+	if (numTaps > FILTER_MAX_TAPS)
+		numTaps = FILTER_MAX_TAPS;
+	if (decimation < 1)
+		decimation = 1;
+	_taps = taps;
+	_numTaps = numTaps;
+	_decimation = decimation;
+	reset ();
+}
+
+/*
+	Forgets the history. The next sample fills it.
+*/
+void DecimatingFIR::reset ()
+{
+	_next = 0;
+	_phase = 0;
+	_primed = false;
+	_output = 0;
+}
+
+/*
+	Adds a sample. Returns true when a new output is ready, in 
+	which case the taps were applied to the history; otherwise
+	the sample is only stored.
+*/
+boolean DecimatingFIR::add (int raw)
+{
+	if (_primed == false)
+	{
+		for (byte i = 0; i < _numTaps; i++)
+			_history[i] = raw;
+		_primed = true;
+	}
+	_history[_next] = raw;
+	_next++;
+	if (_next >= _numTaps)
+		_next = 0;
+	
+	_phase++;
+	if (_phase < _decimation)
+		return false;
+	_phase = 0;
+	
+	// newest sample first
+	long acc = 0;
+	byte h = _next;
+	for (byte i = 0; i < _numTaps; i++)
+	{
+		h = (h == 0) ? _numTaps - 1 : h - 1;
+		acc += (long) _taps[i] * _history[h];
+	}
+	_output = (int) ((acc + (1L << 14)) >> 15);
+	return true;
+}
+
+/*
+	The most recent output of add()
+*/
+int DecimatingFIR::getOutput ()
+{
+	return _output;
+}
+
+/*
+	A median (medianWindow 3 or 5, 0 or 1 = off) followed by a
+	low-pass (cutoffHz <= 0 = off) for a channel read at sampleHz
+*/
+SensorFilter::SensorFilter (byte medianWindow, float cutoffHz, float sampleHz)
+	: _median (medianWindow), _lowPass (cutoffHz > 0 ? cutoffHz : sampleHz / 4, sampleHz)
+{
+	_useMedian = (medianWindow > 1);
+	_useLowPass = (cutoffHz > 0);
+}
+
+/*
+	Restarts the chain from the next sample, eg. when the sample
+	rate changes or after a long gap.
+*/
+void SensorFilter::reset ()
+{
+	_median.reset ();
+	_lowPass.reset ();
+}
+
+/*
+	Filters one raw reading
+*/
+int SensorFilter::filter (int raw)
+{
+	if (_useMedian == true)
+		raw = _median.filter (raw);
+	if (_useLowPass == true)
+		raw = _lowPass.filter (raw);
+	return raw;
+}
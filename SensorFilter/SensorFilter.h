@@ -0,0 +1,107 @@
+/*
+ Title: SensorFilter.h
+  Description: A small bank of digital filters for raw analog
+	readings (0 - 1023). Each filter takes one sample per call,
+	uses a fixed amount of memory and has a fixed cost per 
+	sample:
+		MedianFilter
+			moving median of the last 3 or 5 samples. Removes 
+			single sample spikes without smearing a step.
+		BiquadFilter
+			2nd order Butterworth low-pass in fixed point (Q14
+			coefficients, 4 fractional bits of state, error 
+			feedback). The coefficients are computed once from
+			the cutoff and sample rate and rounded so the DC 
+			gain is exactly 1.
+		DecimatingFIR
+			FIR filter with caller supplied Q15 taps that only 
+			computes an output every 'decimation' samples (eg.
+			to log a channel slower than it is read).
+		SensorFilter
+			the per channel chain used by EngineController: an
+			optional median followed by an optional low-pass.
+	All filters start from the first sample they are given so
+	there is no startup transient.
+	
+	The frequency response, spike rejection and cost per sample
+	can be checked on a PC with Tools/FilterBench.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+#ifndef SensorFilter_h
+#define SensorFilter_h
+
+#include "Arduino.h"
+
+#define FILTER_MAX_MEDIAN 5			// largest median window
+#define FILTER_MAX_TAPS 16			// largest FIR
+#define FILTER_COEF_SHIFT 14		// biquad coefficients are Q14
+#define FILTER_STATE_SHIFT 4		// biquad state has 4 fractional bits
+
+class MedianFilter
+{
+	public:
+		MedianFilter (byte window);
+		void reset ();
+		int filter (int raw);
+	private:
+		byte _window;
+		byte _next;
+		byte _count;
+		int _history[FILTER_MAX_MEDIAN];
+};
+
+class BiquadFilter
+{
+	public:
+		BiquadFilter (float cutoffHz, float sampleHz);
+		void reset ();
+		int filter (int raw);
+		float getGain (float hz, float sampleHz);
+	private:
+		int _b0;
+		int _b1;
+		int _a1;
+		int _a2;
+		boolean _primed;
+		int _x1;
+		int _x2;
+		int _y1;
+		int _y2;
+		int _error;
+};
+
+class DecimatingFIR
+{
+	public:
+		DecimatingFIR (const int *taps, byte numTaps, byte decimation);
+		void reset ();
+		boolean add (int raw);
+		int getOutput ();
+	private:
+		const int *_taps;
+		byte _numTaps;
+		byte _decimation;
+		byte _next;
+		byte _phase;
+		boolean _primed;
+		int _output;
+		int _history[FILTER_MAX_TAPS];
+};
+
+class SensorFilter
+{
+	public:
+		SensorFilter (byte medianWindow, float cutoffHz, float sampleHz);
+		void reset ();
+		int filter (int raw);
+	private:
+		MedianFilter _median;
+		BiquadFilter _lowPass;
+		boolean _useMedian;
+		boolean _useLowPass;
+};
+
+#endif
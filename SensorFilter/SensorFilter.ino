@@ -0,0 +1,97 @@
+/*
+ Title: SensorFilter (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the SensorFilter library. It first 
+	times each filter on this micro (microseconds per sample,
+	averaged over 1000 samples). It then reads an analog pin 
+	every 25ms (40Hz, about the EngineController logging rate)
+	and prints the raw reading, the median, the low-pass, the
+	median + low-pass chain and, every 4th sample, the 
+	decimated FIR output. Tap a wire against the input to see 
+	the spikes removed by the median.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <SensorFilter.h>
+
+int sensorPin = A0;
+float sampleHz = 40.0;
+unsigned long samplePeriod = 25;		// ms
+
+// 8 tap low-pass for decimating by 4 (Q15, sums to 32768)
+const int firTaps[] = {1024, 2624, 4832, 7904, 7904, 4832, 2624, 1024};
+
+MedianFilter median (5);
+BiquadFilter lowPass (5.0, sampleHz);
+SensorFilter chain (3, 5.0, sampleHz);
+DecimatingFIR fir (firTaps, 8, 4);
+
+void setup ()
+{
+	Serial.begin(57600);
+	benchmark ();
+	Serial.println (F("raw,median,lowPass,chain,fir"));
+}
+
+void loop ()
+{
+	int raw = analogRead(sensorPin);
+	Serial.print (raw);
+	Serial.print (',');
+	Serial.print (median.filter (raw));
+	Serial.print (',');
+	Serial.print (lowPass.filter (raw));
+	Serial.print (',');
+	Serial.print (chain.filter (raw));
+	Serial.print (',');
+	if (fir.add (raw) == true)
+		Serial.print (fir.getOutput ());
+	Serial.println ();
+	delay(samplePeriod);
+}
+
+/*
+	Prints the average cost of each filter per sample
+*/
+void benchmark ()
+{
+	int raw[16];
+	for (byte i = 0; i < 16; i++)
+		raw[i] = analogRead(sensorPin);
+	
+	volatile int out;
+	unsigned long start = micros();
+	for (int i = 0; i < 1000; i++)
+		out = median.filter (raw[i & 15]);
+	printCost (F("median(5)"), micros() - start);
+	
+	start = micros();
+	for (int i = 0; i < 1000; i++)
+		out = lowPass.filter (raw[i & 15]);
+	printCost (F("biquad"), micros() - start);
+	
+	start = micros();
+	for (int i = 0; i < 1000; i++)
+		out = chain.filter (raw[i & 15]);
+	printCost (F("median(3)+biquad"), micros() - start);
+	
+	start = micros();
+	for (int i = 0; i < 1000; i++)
+		out = fir.add (raw[i & 15]);
+	printCost (F("fir(8 taps)/4"), micros() - start);
+	
+	median.reset ();
+	lowPass.reset ();
+	chain.reset ();
+	fir.reset ();
+}
+
+void printCost (const __FlashStringHelper *name, unsigned long micros1000)
+{
+	Serial.print (name);
+	Serial.print (F(": "));
+	Serial.print (micros1000 / 1000.0, 1);
+	Serial.println (F(" us/sample"));
+}
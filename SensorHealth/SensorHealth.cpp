@@ -0,0 +1,139 @@
+/*
+ Title: SensorHealth.cpp
+  Description: This library keeps track of the health of 
+	each sensor channel and condenses it into a status bitmap
+	(one bit per channel, set = don't trust this sample) that 
+	can be sent with every line of telemetry. The following 
+	faults are tracked per channel:
+		HEALTH_OUT_OF_RANGE
+			the raw analog reading is outside the range the 
+			sensor can produce (eg. a 0.5V - 4.5V transducer
+			pinned at a rail because of a broken wire or short)
+		HEALTH_STUCK
+			the raw reading has not changed for 'stuckSamples'
+			samples in a row. Real analog readings always 
+			have a little noise.
+		HEALTH_DEVICE_FAULT
+			the device reported a fault (eg. MAX31855 open or
+			shorted thermocouple, Maestro read time out)
+	Faults clear as soon as a good sample is seen.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+
+#include "Arduino.h"
+#include "SensorHealth.h"
+
+/*
+	stuckSamples is the number of identical raw readings in a row
+	before an analog channel is flagged as stuck (0 = not checked,
+	max 255)
+*/
+SensorHealth::SensorHealth (byte stuckSamples)
+{
+	_stuckSamples = stuckSamples;
+	reset();
+}
+
+/*
+	Clears all faults and history
+*/
+void SensorHealth::reset ()
+{
+	_status = 0;
+	for (byte i = 0; i < HEALTH_MAX_CHANNELS; i++)
+	{
+		_lastRaw[i] = -1;
+		_sameCount[i] = 0;
+		_faults[i] = HEALTH_OK;
+	}
+}
+
+/*
+	Checks a raw analog reading (0 - 1023) against the range the
+	sensor can produce and for a stuck value. Returns the fault 
+	bits for the channel.
+*/
+byte SensorHealth::checkAnalog (byte channel, int raw, int minRaw, int maxRaw)
+{
+	if (channel >= HEALTH_MAX_CHANNELS)
+		return HEALTH_OK;
+	byte faults = HEALTH_OK;
+	if ((raw < minRaw) || (raw > maxRaw))
+		faults |= HEALTH_OUT_OF_RANGE;
+	if (raw == _lastRaw[channel])
+	{
+		if (_sameCount[channel] < 255)
+			_sameCount[channel]++;
+	}
+	else
+		_sameCount[channel] = 0;
+	_lastRaw[channel] = raw;
+	if ((_stuckSamples > 0) && (_sameCount[channel] >= _stuckSamples))
+		faults |= HEALTH_STUCK;
+	setFaults (channel, faults);
+	return faults;
+}
+
+/*
+	Records whether a device reported a fault on this read.
+	Returns the fault bits for the channel.
+*/
+byte SensorHealth::checkDevice (byte channel, boolean fault)
+{
+	if (channel >= HEALTH_MAX_CHANNELS)
+		return HEALTH_OK;
+	byte faults = fault ? HEALTH_DEVICE_FAULT : HEALTH_OK;
+	setFaults (channel, faults);
+	return faults;
+}
+
+void SensorHealth::setFaults (byte channel, byte faults)
+{
+	_faults[channel] = faults;
+	if (faults == HEALTH_OK)
+		_status &= ~(1U << channel);
+	else
+		_status |= (1U << channel);
+}
+
+/*
+	Returns the fault bits of a channel
+*/
+byte SensorHealth::getFaults (byte channel)
+{
+	if (channel >= HEALTH_MAX_CHANNELS)
+		return HEALTH_OK;
+	return _faults[channel];
+}
+
+/*
+	Returns the status bitmap. Bit 'n' is set when channel 'n' has
+	any fault.
+*/
+unsigned int SensorHealth::getStatus ()
+{
+	return _status;
+}
+
+/*
+	Prints each faulty channel and its fault bits eg.
+		Sensor faults (channel:bits): 3:1 6:4
+*/
+void SensorHealth::printStatus (Print &out)
+{
+	out.print (F("Sensor faults (channel:bits):"));
+	for (byte i = 0; i < HEALTH_MAX_CHANNELS; i++)
+	{
+		if (_faults[i] != HEALTH_OK)
+		{
+			out.print ((char) ' ');
+			out.print (i);
+			out.print ((char) ':');
+			out.print (_faults[i]);
+		}
+	}
+	out.println();
+}
@@ -0,0 +1,57 @@
+/*
+ Title: SensorHealth.h
+  Description: This library keeps track of the health of 
+	each sensor channel and condenses it into a status bitmap
+	(one bit per channel, set = don't trust this sample) that 
+	can be sent with every line of telemetry. The following 
+	faults are tracked per channel:
+		HEALTH_OUT_OF_RANGE
+			the raw analog reading is outside the range the 
+			sensor can produce (eg. a 0.5V - 4.5V transducer
+			pinned at a rail because of a broken wire or short)
+		HEALTH_STUCK
+			the raw reading has not changed for 'stuckSamples'
+			samples in a row. Real analog readings always 
+			have a little noise.
+		HEALTH_DEVICE_FAULT
+			the device reported a fault (eg. MAX31855 open or
+			shorted thermocouple, Maestro read time out)
+	Faults clear as soon as a good sample is seen.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+#ifndef SensorHealth_h
+#define SensorHealth_h
+
+#include "Arduino.h"
+
+#define HEALTH_MAX_CHANNELS 16
+
+// Fault bits
+#define HEALTH_OK 0x00
+#define HEALTH_OUT_OF_RANGE 0x01
+#define HEALTH_STUCK 0x02
+#define HEALTH_DEVICE_FAULT 0x04
+
+class SensorHealth
+{
+	public:
+		SensorHealth (byte stuckSamples);
+		void reset ();
+		byte checkAnalog (byte channel, int raw, int minRaw, int maxRaw);
+		byte checkDevice (byte channel, boolean fault);
+		byte getFaults (byte channel);
+		unsigned int getStatus ();
+		void printStatus (Print &out);
+	private:
+		void setFaults (byte channel, byte faults);
+		byte _stuckSamples;
+		unsigned int _status;
+		int _lastRaw[HEALTH_MAX_CHANNELS];
+		byte _sameCount[HEALTH_MAX_CHANNELS];
+		byte _faults[HEALTH_MAX_CHANNELS];
+};
+
+#endif
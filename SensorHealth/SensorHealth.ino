@@ -0,0 +1,34 @@
+/*
+ Title: SensorHealth (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the SensorHealth library. A 0.5V - 4.5V
+	transducer on A0 is checked every 100ms and the reading
+	is printed with the status bitmap. Unplug the transducer 
+	(or tie A0 to ground/5V) to see the channel flagged.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <SensorHealth.h>
+
+int sensorPin = A0;
+SensorHealth health (50);		// stuck after 50 identical readings
+
+void setup ()
+{
+	Serial.begin(57600);
+	Serial.println (F("Signal (0 - 1023),status(hex)"));
+}
+
+void loop ()
+{
+	int raw = analogRead (sensorPin);
+	health.checkAnalog (0, raw, 82, 941);		// 0.4V - 4.6V
+	Serial.print (raw);
+	Serial.print ((char) ',');
+	Serial.println (health.getStatus(), HEX);
+	if (health.getStatus() != 0)
+		health.printStatus (Serial);
+	delay (100);
+}
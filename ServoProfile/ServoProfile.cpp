@@ -0,0 +1,330 @@
+/*
+ Title: ServoProfile.cpp
+  Description: Moves Pololu Maestro servos (PMCtrl) along timed
+	motion profiles, so a valve opening or closing transient is
+	the same from run to run and can be tuned as data instead of
+	by juggling servo speeds. Each channel follows its own table
+	of ProfilePoints (RAM, so the times can be configuration 
+	parameters):
+		timeMs
+			time from start() the point is reached (ms)
+		percent
+			valve opening, 0 (closed) - 100 (opened), mapped
+			onto the servo limits given by setLimits(), or
+			PROFILE_CURRENT for the servo's position when the
+			channel was added (eg. to close a throttled valve
+			from where it is). If that position is not known
+			the next point is used, so the servo goes straight
+			there.
+		shape
+			how the servo gets there from the previous point:
+			PROFILE_STEP		holds, then jumps at timeMs
+			PROFILE_LINEAR		constant speed
+			PROFILE_TRAPEZOID	accelerates over the first 
+								quarter, cruises, decelerates
+								over the last quarter
+			PROFILE_SCURVE		smooth start and stop (3t^2 - 2t^3)
+	A channel is left alone until its first point's time, so a
+	later first point delays that channel (eg. ox lead). The 
+	servo speed limit of each channel is turned off by start()
+	so the Maestro follows the setpoints.
+
+	update() is the timer task and should be called every pass
+	of the run loop. A setpoint is due every period ms on a grid
+	from start() and also at the time of each point, so steps,
+	starts and ends are not moved onto the period grid. It is
+	only sent by the first update() at or after that time, so it
+	is late by up to one pass of the calling loop (one telemetry
+	line, ~25ms, in EngineController) and a period shorter than
+	a pass sends once per pass. Late ticks are not made up (the
+	position is worked out for the time now) and a setpoint is
+	only sent when it changes, as every command costs ~1ms of
+	blocking serial. The segment
+	being followed is precomputed in servo us when the channel
+	reaches it, so a tick is one shape evaluation per channel.
+	Setpoints are not sent from an interrupt because the 
+	SoftwareSerial writes block with interrupts disabled.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+
+#include "Arduino.h"
+#include "ServoProfile.h"
+
+/*
+	servoCtrl is the maestro the channels are on (PMCtrl or a
+	PMCtrlT over another port). closedPos and
+	openedPos are the servo targets (us) of a closed and a fully
+	open valve. Setpoints are sent every periodMs while a profile
+	runs.
+*/
+ServoProfile::ServoProfile (PMCtrlBase &servoCtrl, int deviceID, int closedPos, int openedPos, unsigned int periodMs)
+{
+	_servoCtrl = &servoCtrl;
+	_deviceID = deviceID;
+	setLimits (closedPos, openedPos);
+	setPeriod (periodMs);
+	clear ();
+}
+
+/*
+	Servo targets (us) of 0% and 100%. Used by the next start().
+*/
+void ServoProfile::setLimits (int closedPos, int openedPos)
+{
+	_closedPos = closedPos;
+	_openedPos = openedPos;
+}
+
+/*
+	ms between setpoints. Periods shorter than the maestro's
+	pulse frame (20ms) send setpoints the servo never sees.
+*/
+void ServoProfile::setPeriod (unsigned int periodMs)
+{
+	if (periodMs == 0)
+		periodMs = 1;
+	_periodMs = periodMs;
+}
+
+/*
+	Stops any running profile and removes every channel
+*/
+void ServoProfile::clear ()
+{
+	_channels = 0;
+	_running = false;
+}
+
+/*
+	Adds a servo channel that follows 'count' points. The array
+	is not copied, so it must stay in scope (and unchanged) while
+	the profile runs. currentPos is the servo's position now (us,
+	-1 if unknown) and is only used by PROFILE_CURRENT points.
+	Returns false if the table is full or the points are invalid
+	(times going backwards, percent over 100 or an unknown shape).
+*/
+boolean ServoProfile::addChannel (unsigned char channel, const ProfilePoint *points, byte count, int currentPos)
+{
+	if ((_channels >= PROFILE_MAX_CHANNELS) || (count == 0))
+		return false;
+	for (byte i = 0; i < count; i++)
+	{
+		if (((points[i].percent > 100) && (points[i].percent != PROFILE_CURRENT)) || (points[i].shape > PROFILE_SCURVE))
+			return false;
+		if ((i > 0) && (points[i].timeMs < points[i - 1].timeMs))
+			return false;
+	}
+	_channel[_channels] = channel;
+	_points[_channels] = points;
+	_count[_channels] = count;
+	_point[_channels] = 0;
+	_target[_channels] = -1;
+	_current[_channels] = currentPos;
+	_channels++;
+	return true;
+}
+
+/*
+	Starts every channel's profile at time 'now' (ms, eg. millis())
+	and turns off the servo speed limits. The first setpoints are
+	sent by the next update().
+*/
+void ServoProfile::start (unsigned long now)
+{
+	for (byte i = 0; i < _channels; i++)
+	{
+		_servoCtrl->setServoSpeed (0, _channel[i], _deviceID);
+		_point[i] = 0;
+		_target[i] = -1;
+	}
+	_startTime = now;
+	_nextTick = 0;
+	_running = (_channels > 0);
+}
+
+/*
+	Sends the setpoints that are due at time 'now'. Returns true
+	if any were sent. Does nothing once every channel has reached
+	its last point.
+*/
+boolean ServoProfile::update (unsigned long now)
+{
+	if (_running == false)
+		return false;
+	unsigned long sinceStart = now - _startTime;
+	unsigned int elapsed = (sinceStart > 65535) ? 65535 : sinceStart;
+	if (elapsed < _nextTick)
+		return false;
+
+	boolean sent = false;
+	boolean running = false;
+	unsigned long next = ((unsigned long)(elapsed / _periodMs) + 1) * _periodMs;
+	for (byte i = 0; i < _channels; i++)
+	{
+		int pos = positionAt (i, elapsed);
+		if ((pos >= 0) && (pos != _target[i]))
+		{
+			_servoCtrl->setTarget (pos, _channel[i], _deviceID);
+			_target[i] = pos;
+			sent = true;
+		}
+		if (_point[i] < _count[i])
+		{
+			running = true;
+			if (_points[i][_point[i]].timeMs < next)
+				next = _points[i][_point[i]].timeMs;	// due before the next tick
+		}
+	}
+	_running = running;
+	_nextTick = (next > 65535) ? 65535 : next;
+	return sent;
+}
+
+/*
+	Sends every channel straight to its last point and ends the
+	profile, eg. when the caller no longer needs to wait for it.
+*/
+void ServoProfile::finish ()
+{
+	for (byte i = 0; i < _channels; i++)
+	{
+		int pos = pointPosition (i, _count[i] - 1);
+		if ((pos >= 0) && (pos != _target[i]))
+		{
+			_servoCtrl->setTarget (pos, _channel[i], _deviceID);
+			_target[i] = pos;
+		}
+		_point[i] = _count[i];
+	}
+	_running = false;
+}
+
+/*
+	Ends the profile, leaving the servos at their last setpoints
+*/
+void ServoProfile::stop ()
+{
+	_running = false;
+}
+
+/*
+	Returns true until every channel has reached its last point
+*/
+boolean ServoProfile::isRunning ()
+{
+	return _running;
+}
+
+/*
+	Returns the time (ms from start) of the last point of the
+	longest channel
+*/
+unsigned int ServoProfile::getDuration ()
+{
+	unsigned int duration = 0;
+	for (byte i = 0; i < _channels; i++)
+	{
+		if (_points[i][_count[i] - 1].timeMs > duration)
+			duration = _points[i][_count[i] - 1].timeMs;
+	}
+	return duration;
+}
+
+/*
+	Returns the last setpoint (us) sent to the channel 'index'
+	(order added), or -1 if none has been sent since start()
+*/
+int ServoProfile::getTarget (byte index)
+{
+	if (index >= _channels)
+		return -1;
+	return _target[index];
+}
+
+/*
+	Converts an opening (percent) to a servo target (us)
+*/
+int ServoProfile::toPosition (byte percent)
+{
+	return _closedPos + (long)(_openedPos - _closedPos) * percent / 100;
+}
+
+/*
+	Returns the servo target (us) of point 'point' of channel 
+	'index', or -1 if it and every later point are PROFILE_CURRENT 
+	and the current position is not known
+*/
+int ServoProfile::pointPosition (byte index, byte point)
+{
+	const ProfilePoint *points = _points[index];
+	if ((points[point].percent == PROFILE_CURRENT) && (_current[index] >= 0))
+		return _current[index];
+	while ((point < _count[index]) && (points[point].percent == PROFILE_CURRENT))
+		point++;
+	if (point >= _count[index])
+		return -1;
+	return toPosition (points[point].percent);
+}
+
+/*
+	Precomputes the start and end (us) of the segment that leads
+	to the channel's current point
+*/
+void ServoProfile::beginSegment (byte index)
+{
+	byte point = _point[index];
+	if (point >= _count[index])
+		return;
+	_from[index] = pointPosition (index, point - 1);
+	_to[index] = pointPosition (index, point);
+}
+
+/*
+	Returns the setpoint (us) of channel 'index' at 'elapsed' ms
+	from start, or -1 if the channel has not started yet. Moves
+	the channel on to later segments as their points are passed.
+*/
+int ServoProfile::positionAt (byte index, unsigned int elapsed)
+{
+	const ProfilePoint *points = _points[index];
+	byte count = _count[index];
+	while ((_point[index] < count) && (elapsed >= points[_point[index]].timeMs))
+	{
+		_point[index]++;
+		beginSegment (index);
+	}
+	byte point = _point[index];
+	if (point == 0)
+		return -1;
+	if (point >= count)
+		return pointPosition (index, count - 1);
+
+	// elapsed is inside the segment, so its length is never 0
+	unsigned int t0 = points[point - 1].timeMs;
+	float f = (float)(elapsed - t0) / (points[point].timeMs - t0);
+	float s;
+	switch (points[point].shape)
+	{
+		case PROFILE_LINEAR:
+			s = f;
+			break;
+		case PROFILE_TRAPEZOID:		// 1/4 accelerating, 1/2 at 4/3 the mean speed, 1/4 decelerating
+			if (f < 0.25)
+				s = (8.0 / 3.0) * f * f;
+			else if (f < 0.75)
+				s = (4.0 / 3.0) * (f - 0.125);
+			else
+				s = 1.0 - (8.0 / 3.0) * (1.0 - f) * (1.0 - f);
+			break;
+		case PROFILE_SCURVE:
+			s = f * f * (3.0 - 2.0 * f);
+			break;
+		default:					// PROFILE_STEP
+			s = 0;
+			break;
+	}
+	return _from[index] + (int)((_to[index] - _from[index]) * s + ((_to[index] >= _from[index]) ? 0.5 : -0.5));
+}
@@ -0,0 +1,118 @@
+/*
+ Title: ServoProfile.h
+  Description: Moves Pololu Maestro servos (PMCtrl) along timed
+	motion profiles, so a valve opening or closing transient is
+	the same from run to run and can be tuned as data instead of
+	by juggling servo speeds. Each channel follows its own table
+	of ProfilePoints (RAM, so the times can be configuration 
+	parameters):
+		timeMs
+			time from start() the point is reached (ms)
+		percent
+			valve opening, 0 (closed) - 100 (opened), mapped
+			onto the servo limits given by setLimits(), or
+			PROFILE_CURRENT for the servo's position when the
+			channel was added (eg. to close a throttled valve
+			from where it is). If that position is not known
+			the next point is used, so the servo goes straight
+			there.
+		shape
+			how the servo gets there from the previous point:
+			PROFILE_STEP		holds, then jumps at timeMs
+			PROFILE_LINEAR		constant speed
+			PROFILE_TRAPEZOID	accelerates over the first 
+								quarter, cruises, decelerates
+								over the last quarter
+			PROFILE_SCURVE		smooth start and stop (3t^2 - 2t^3)
+	A channel is left alone until its first point's time, so a
+	later first point delays that channel (eg. ox lead). The 
+	servo speed limit of each channel is turned off by start()
+	so the Maestro follows the setpoints.
+
+	update() is the timer task and should be called every pass
+	of the run loop. A setpoint is due every period ms on a grid
+	from start() and also at the time of each point, so steps,
+	starts and ends are not moved onto the period grid. It is
+	only sent by the first update() at or after that time, so it
+	is late by up to one pass of the calling loop (one telemetry
+	line, ~25ms, in EngineController) and a period shorter than
+	a pass sends once per pass. Late ticks are not made up (the
+	position is worked out for the time now) and a setpoint is
+	only sent when it changes, as every command costs ~1ms of
+	blocking serial. The segment
+	being followed is precomputed in servo us when the channel
+	reaches it, so a tick is one shape evaluation per channel.
+	Setpoints are not sent from an interrupt because the 
+	SoftwareSerial writes block with interrupts disabled.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+#ifndef ServoProfile_h
+#define ServoProfile_h
+
+#include "Arduino.h"
+#include "PMCtrl.h"
+
+#define PROFILE_MAX_CHANNELS 2		// fuel and ox valve
+#define PROFILE_PERIOD 20			// default ms between setpoints (one Maestro pulse frame)
+
+// Segment shapes
+#define PROFILE_STEP 0
+#define PROFILE_LINEAR 1
+#define PROFILE_TRAPEZOID 2
+#define PROFILE_SCURVE 3
+
+#define PROFILE_CURRENT 255			// percent: the position given to addChannel()
+
+// number of points in a ProfilePoint array
+#define PROFILE_POINTS(points) (sizeof(points) / sizeof(points[0]))
+
+typedef struct
+{
+	unsigned int timeMs;	// time from start() the point is reached
+	byte percent;			// opening, 0 (closed) - 100 (opened) or PROFILE_CURRENT
+	byte shape;				// PROFILE_STEP, PROFILE_LINEAR, PROFILE_TRAPEZOID or PROFILE_SCURVE
+} ProfilePoint;
+
+class ServoProfile
+{
+	public:
+		ServoProfile (PMCtrlBase &servoCtrl, int deviceID, int closedPos, int openedPos, unsigned int periodMs);
+		void setLimits (int closedPos, int openedPos);
+		void setPeriod (unsigned int periodMs);
+		void clear ();
+		boolean addChannel (unsigned char channel, const ProfilePoint *points, byte count, int currentPos);
+		void start (unsigned long now);
+		boolean update (unsigned long now);
+		void finish ();
+		void stop ();
+		boolean isRunning ();
+		unsigned int getDuration ();
+		int getTarget (byte index);
+	private:
+		int toPosition (byte percent);
+		int pointPosition (byte index, byte point);
+		void beginSegment (byte index);
+		int positionAt (byte index, unsigned int elapsed);
+		PMCtrlBase *_servoCtrl;
+		int _deviceID;
+		int _closedPos;
+		int _openedPos;
+		unsigned int _periodMs;
+		byte _channels;
+		unsigned char _channel[PROFILE_MAX_CHANNELS];
+		const ProfilePoint *_points[PROFILE_MAX_CHANNELS];
+		byte _count[PROFILE_MAX_CHANNELS];
+		byte _point[PROFILE_MAX_CHANNELS];		// point being moved towards (_count = done)
+		int _from[PROFILE_MAX_CHANNELS];		// current segment in servo us
+		int _to[PROFILE_MAX_CHANNELS];
+		int _target[PROFILE_MAX_CHANNELS];		// last setpoint sent (-1 = none)
+		int _current[PROFILE_MAX_CHANNELS];		// position when added (-1 = unknown)
+		boolean _running;
+		unsigned long _startTime;
+		unsigned int _nextTick;
+};
+
+#endif
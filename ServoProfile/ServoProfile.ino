@@ -0,0 +1,71 @@
+/*
+ Title: ServoProfile (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the ServoProfile library. Two servos
+	on a Pololu Maestro (channels 0 and 1) are opened and closed
+	every 4 seconds:
+		opening
+			channel 1 leads: it opens over 200ms with a 
+			trapezoid profile. Channel 0 waits 100ms, then
+			steps to 20% and ramps (S curve) to fully open
+			by 1000ms
+		closing
+			channel 0 closes over 150ms (linear) while channel
+			1 holds for 300ms and then closes over 500ms
+	Every setpoint sent is printed with its time (ms from the
+	start of the profile).
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <SoftwareSerial.h>
+#include <PMCtrl.h>
+#include <ServoProfile.h>
+
+ProfilePoint openFuel[] = { { 100, 0, PROFILE_STEP }, { 100, 20, PROFILE_STEP }, { 1000, 100, PROFILE_SCURVE } };
+ProfilePoint openOx[] = { { 0, 0, PROFILE_STEP }, { 200, 100, PROFILE_TRAPEZOID } };
+ProfilePoint closeFuel[] = { { 0, 100, PROFILE_STEP }, { 150, 0, PROFILE_LINEAR } };
+ProfilePoint closeOx[] = { { 0, 100, PROFILE_STEP }, { 300, 100, PROFILE_STEP }, { 800, 0, PROFILE_LINEAR } };
+
+PMCtrl servoCtrl (11, 3, 57600);                                 // RX, TX, Baud
+ServoProfile profile (servoCtrl, 12, 800, 1600, PROFILE_PERIOD);  // device 12, closed/opened (us)
+boolean opening = false;
+unsigned long lastStart;
+
+void setup ()
+{
+	Serial.begin(57600);
+	lastStart = millis ();
+}
+
+void loop ()
+{
+	if ((profile.isRunning () == false) && (millis () - lastStart >= 4000))
+	{
+		opening = !opening;
+		profile.clear ();
+		if (opening == true)
+		{
+			profile.addChannel (0, openFuel, PROFILE_POINTS(openFuel), -1);
+			profile.addChannel (1, openOx, PROFILE_POINTS(openOx), -1);
+			Serial.println (F("Opening"));
+		}
+		else
+		{
+			profile.addChannel (0, closeFuel, PROFILE_POINTS(closeFuel), -1);
+			profile.addChannel (1, closeOx, PROFILE_POINTS(closeOx), -1);
+			Serial.println (F("Closing"));
+		}
+		lastStart = millis ();
+		profile.start (lastStart);
+	}
+	if (profile.update (millis ()) == true)
+	{
+		Serial.print (millis () - lastStart);
+		Serial.print (',');
+		Serial.print (profile.getTarget (0));
+		Serial.print (',');
+		Serial.println (profile.getTarget (1));
+	}
+}
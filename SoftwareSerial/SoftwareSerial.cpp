@@ -42,6 +42,7 @@ http://arduiniana.org.
 #include <avr/pgmspace.h>
 #include <Arduino.h>
 #include <SoftwareSerial.h>
+#include <BufferArena.h>
 //
 // Lookup table
 //
@@ -133,9 +134,13 @@ const int XMIT_START_ADJUSTMENT = 6;
 // Statics
 //
 SoftwareSerial *SoftwareSerial::active_object = 0;
-char SoftwareSerial::_receive_buffer[_SS_MAX_RX_BUFF]; 
 volatile uint8_t SoftwareSerial::_receive_buffer_tail = 0;
 volatile uint8_t SoftwareSerial::_receive_buffer_head = 0;
+#if _SS_TIMER_RX
+volatile uint8_t SoftwareSerial::_rx_bit = 0;
+uint8_t SoftwareSerial::_rx_data = 0;
+uint32_t SoftwareSerial::_rx_next = 0;
+#endif
 
 //
 // Debugging
@@ -162,6 +167,7 @@ inline void DebugPulse(uint8_t pin, uint8_t count)
 
 /* static */ 
 inline void SoftwareSerial::tunedDelay(uint16_t delay) { 
+#if defined(__AVR__) // host builds (Tools/SoftSerialSim) don't time anything
   uint8_t tmp=0;
 
   asm volatile("sbiw    %0, 0x01 \n\t"
@@ -172,6 +178,7 @@ inline void SoftwareSerial::tunedDelay(uint16_t delay) {
     : "+r" (delay), "+a" (tmp)
     : "0" (delay)
     );
+#endif
 }
 
 // This function sets the current object as the "listening"
@@ -183,6 +190,13 @@ bool SoftwareSerial::listen()
     _buffer_overflow = false;
     uint8_t oldSREG = SREG;
     cli();
+#if _SS_TIMER_RX
+    // drop a byte the old object was part way through
+    if (_rx_bit && active_object)
+      *active_object->_pcint_maskreg |= active_object->_pcint_maskvalue;
+    TIMSK1 &= ~_BV(OCIE1A);
+    _rx_bit = 0;
+#endif
     _receive_buffer_head = _receive_buffer_tail = 0;
     active_object = this;
     SREG = oldSREG;
@@ -197,6 +211,27 @@ bool SoftwareSerial::listen()
 //
 void SoftwareSerial::recv()
 {
+#if _SS_TIMER_RX
+  // On a start bit, work out when it began and let Timer1 compare
+  // interrupts sample the middle of each following bit (recv_bit).
+  // The pin's change interrupt is off until the stop bit, so the
+  // edges within the byte cost nothing.
+  uint16_t now = TCNT1;
+  if (_rx_bit == 0 && (_inverse_logic ? rx_pin_read() : !rx_pin_read()))
+  {
+    *_pcint_maskreg &= ~_pcint_maskvalue;
+    // less this ISR's and the compare ISR's delay before reading
+    now -= 2 * _SS_RX_ISR_CYCLES / 8;
+    // first sample mid way through bit 0, less a 16th of a bit as
+    // other interrupts can only make the ISRs late
+    _rx_next = ((uint32_t)now << 4) + _rx_bit_ticks + (_rx_bit_ticks >> 1) - (_rx_bit_ticks >> 4);
+    OCR1A = _rx_next >> 4;
+    TIFR1 = _BV(OCF1A); // clear a match from before
+    TIMSK1 |= _BV(OCIE1A);
+    _rx_data = 0;
+    _rx_bit = 1;
+  }
+#else
 
 #if GCC_VERSION < 40302
 // Work-around for avr-gcc 4.3.0 OSX version bug
@@ -247,7 +282,7 @@ void SoftwareSerial::recv()
     if ((_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF != _receive_buffer_head) 
     {
       // save new data in buffer: tail points to where byte goes
-      _receive_buffer[_receive_buffer_tail] = d; // save new byte
+      arena.serialRx[_receive_buffer_tail] = d; // save new byte
       _receive_buffer_tail = (_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF;
     } 
     else 
@@ -273,8 +308,50 @@ void SoftwareSerial::recv()
     "pop r18 \n\t"
     ::);
 #endif
+#endif // _SS_TIMER_RX
 }
 
+#if _SS_TIMER_RX
+//
+// The Timer1 compare interrupt: samples one bit in the middle and
+// sets the timer for the next. At the stop bit the byte is saved
+// (dropped if the stop bit is missing) and the pin's change interrupt
+// is turned back on for the next start bit.
+//
+void SoftwareSerial::recv_bit()
+{
+  uint8_t level = rx_pin_read();
+  if (_inverse_logic)
+    level = !level;
+
+  if (_rx_bit <= 8)
+  {
+    _rx_data >>= 1; // LSB first
+    if (level)
+      _rx_data |= 0x80;
+    _rx_bit++;
+    _rx_next += _rx_bit_ticks;
+    OCR1A = _rx_next >> 4;
+    return;
+  }
+
+  TIMSK1 &= ~_BV(OCIE1A);
+  _rx_bit = 0;
+  *_pcint_maskreg |= _pcint_maskvalue;
+  if (!level) // framing error
+    return;
+
+  // if buffer full, set the overflow flag and return
+  if ((_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF != _receive_buffer_head) 
+  {
+    arena.serialRx[_receive_buffer_tail] = _rx_data;
+    _receive_buffer_tail = (_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF;
+  } 
+  else 
+    _buffer_overflow = true;
+}
+#endif
+
 void SoftwareSerial::tx_pin_write(uint8_t pin_state)
 {
   if (pin_state == LOW)
@@ -301,6 +378,22 @@ inline void SoftwareSerial::handle_interrupt()
   }
 }
 
+#if _SS_TIMER_RX
+/* static */
+inline void SoftwareSerial::handle_timer()
+{
+  if (active_object)
+  {
+    active_object->recv_bit();
+  }
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+  SoftwareSerial::handle_timer();
+}
+#endif
+
 #if defined(PCINT0_vect)
 ISR(PCINT0_vect)
 {
@@ -368,6 +461,10 @@ void SoftwareSerial::setRX(uint8_t rx)
     digitalWrite(rx, HIGH);  // pullup for normal logic!
   _receivePin = rx;
   _receiveBitMask = digitalPinToBitMask(rx);
+#if _SS_TIMER_RX
+  _pcint_maskreg = digitalPinToPCMSK(rx);
+  _pcint_maskvalue = _BV(digitalPinToPCMSKbit(rx));
+#endif
   uint8_t port = digitalPinToPort(rx);
   _receivePortRegister = portInputRegister(port);
 }
@@ -396,6 +493,12 @@ void SoftwareSerial::begin(long speed)
   // Set up RX interrupts, but only if we have a valid RX baud rate
   if (_rx_delay_stopbit)
   {
+#if _SS_TIMER_RX
+    // Timer1 free running at clk/8 gives the bit times
+    _rx_bit_ticks = (F_CPU * 2 + speed / 2) / speed;
+    TCCR1A = 0;
+    TCCR1B = _BV(CS11);
+#endif
     if (digitalPinToPCICR(_receivePin))
     {
       *digitalPinToPCICR(_receivePin) |= _BV(digitalPinToPCICRbit(_receivePin));
@@ -414,6 +517,13 @@ void SoftwareSerial::begin(long speed)
 
 void SoftwareSerial::end()
 {
+#if _SS_TIMER_RX
+  if (isListening())
+  {
+    TIMSK1 &= ~_BV(OCIE1A);
+    _rx_bit = 0;
+  }
+#endif
   if (digitalPinToPCMSK(_receivePin))
     *digitalPinToPCMSK(_receivePin) &= ~_BV(digitalPinToPCMSKbit(_receivePin));
 }
@@ -430,7 +540,7 @@ int SoftwareSerial::read()
     return -1;
 
   // Read from "head"
-  uint8_t d = _receive_buffer[_receive_buffer_head]; // grab next byte
+  uint8_t d = arena.serialRx[_receive_buffer_head]; // grab next byte
   _receive_buffer_head = (_receive_buffer_head + 1) % _SS_MAX_RX_BUFF;
   return d;
 }
@@ -514,5 +624,5 @@ int SoftwareSerial::peek()
     return -1;
 
   // Read from "head"
-  return _receive_buffer[_receive_buffer_head];
+  return arena.serialRx[_receive_buffer_head];
 }
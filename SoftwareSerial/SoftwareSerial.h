@@ -34,12 +34,24 @@ http://arduiniana.org.
 
 #include <inttypes.h>
 #include <Stream.h>
+#include <ArenaConfig.h>
 
 /******************************************************************************
 * Definitions
 ******************************************************************************/
 
-#define _SS_MAX_RX_BUFF 64 // RX buffer size
+#define _SS_MAX_RX_BUFF ARENA_SERIAL_RX // RX buffer size (arena.serialRx, see BufferArena)
+
+// When set, bits are received by Timer1 compare interrupts (a few us
+// each) instead of busy waiting in the pin change interrupt for the
+// whole byte. Timer1 is taken over (normal mode, clk/8), so analogWrite
+// on its pins and the Servo library can't be used with it.
+#ifndef _SS_TIMER_RX
+#define _SS_TIMER_RX 1
+#endif
+// Cycles from an edge or compare match to the ISR reading the timer
+// or the pin (response, prologue and call)
+#define _SS_RX_ISR_CYCLES 48
 #ifndef GCC_VERSION
 #define GCC_VERSION (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__)
 #endif
@@ -62,14 +74,27 @@ private:
   uint16_t _buffer_overflow:1;
   uint16_t _inverse_logic:1;
 
+#if _SS_TIMER_RX
+  uint32_t _rx_bit_ticks; // bit time in 1/16 Timer1 ticks
+  volatile uint8_t *_pcint_maskreg;
+  uint8_t _pcint_maskvalue;
+#endif
+
   // static data
-  static char _receive_buffer[_SS_MAX_RX_BUFF]; 
   static volatile uint8_t _receive_buffer_tail;
   static volatile uint8_t _receive_buffer_head;
   static SoftwareSerial *active_object;
+#if _SS_TIMER_RX
+  static volatile uint8_t _rx_bit; // next bit to sample (1-8 data, 9 stop), 0 = idle
+  static uint8_t _rx_data;
+  static uint32_t _rx_next; // time of the next sample, 1/16 Timer1 ticks
+#endif
 
   // private methods
   void recv();
+#if _SS_TIMER_RX
+  void recv_bit();
+#endif
   uint8_t rx_pin_read();
   void tx_pin_write(uint8_t pin_state);
   void setTX(uint8_t transmitPin);
@@ -98,6 +123,9 @@ public:
 
   // public only for easy access by interrupt handlers
   static inline void handle_interrupt();
+#if _SS_TIMER_RX
+  static inline void handle_timer();
+#endif
 };
 
 // Arduino 0012 workaround
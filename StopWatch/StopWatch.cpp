@@ -22,6 +22,8 @@
 #include "Arduino.h"
 #include "StopWatch.h"
 
+unsigned long (*StopWatch::_clock)() = millis;
+
 /*
 	Empty Constructor
 */
@@ -29,12 +31,21 @@ StopWatch::StopWatch ()
 {
 }
 
+/*
+	Reads the time of every StopWatch through 'clock' instead of
+	millis() (eg. one that records it so a session can be replayed)
+*/
+void StopWatch::setClock (unsigned long (*clock)())
+{
+  _clock = clock;
+}
+
 /*
 	sets a timer to run for 'x' milliseconds
 */
 void StopWatch::startTimer (unsigned long millisToTime)
 {
-  _startTime = millis();
+  _startTime = _clock();
   _stopTime = _startTime + millisToTime;
 }
 
@@ -44,7 +55,7 @@ void StopWatch::startTimer (unsigned long millisToTime)
 */
 boolean StopWatch::timerStatus ()
 {
-  if ( (millis() >= _startTime) && (millis() <= _stopTime) )
+  if ( (_clock() >= _startTime) && (_clock() <= _stopTime) )
     return true;
   else
     return false;
@@ -55,7 +66,7 @@ boolean StopWatch::timerStatus ()
 */
 unsigned long StopWatch::timeElapsed ()
 {
-  return millis() - _startTime;
+  return _clock() - _startTime;
 }
 
 /*
@@ -63,11 +74,11 @@ unsigned long StopWatch::timeElapsed ()
 */
 void StopWatch::millisToSleep (unsigned long sleepTime)
 {
-  unsigned long wakeupTime = millis() + sleepTime;
+  unsigned long wakeupTime = _clock() + sleepTime;
   
   while(true)
   {
-    if (millis() >= wakeupTime)
+    if (_clock() >= wakeupTime)
       break;
   }
 }
\ No newline at end of file
@@ -13,6 +13,9 @@
 		    1,193.05 hours 
 		       49.71 days
 
+	The time is read with millis() unless another clock is 
+	given to setClock().
+
 	Function descriptions can be found in the .cpp file
 	of the same name.
 */
@@ -31,7 +34,9 @@ class StopWatch
 		boolean timerStatus ();
 		unsigned long timeElapsed ();
 		void millisToSleep (unsigned long sleepTime);
+		static void setClock (unsigned long (*clock)());
 	private:
+		static unsigned long (*_clock)();
 		unsigned long _startTime;
 		unsigned long _stopTime;
 };
@@ -0,0 +1,127 @@
+/*
+ Title: SupplyMonitor.cpp
+  Description: This library measures the micro's supply 
+	voltage (Vcc), which is also the ADC reference and the 
+	supply of the ratiometric sensors, by reading the internal
+	1.1V bandgap against it:
+		Vcc = bandgap * 1023 / reading
+	A measurement takes about 0.3ms so update() only takes one
+	every 'interval' calls and the result is smoothed with a
+	simple low pass filter. Called once per sensor read this 
+	costs a counter increment on all but 1 in 'interval' loops.
+	
+	The bandgap is only accurate to +/-10% from part to part.
+	For best results measure Vcc with a good meter once and 
+	call setBandgap(1.1 * meterVcc / getVcc()).
+	
+	The bandgap readings can be passed through a hook 
+	(setInputHook()) as they are read.
+	
+	Supported: ATmega328P/168 (Uno), ATmega32U4, ATmega1280/2560
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+
+#include "Arduino.h"
+#include "SupplyMonitor.h"
+
+int (*SupplyMonitor::_inputHook)(int raw) = NULL;
+
+/*
+	interval:	calls to update() between measurements (min 1)
+	bandgap:	the bandgap voltage of this part (nominal 1.1V)
+*/
+SupplyMonitor::SupplyMonitor (unsigned int interval, float bandgap)
+{
+	_interval = (interval == 0) ? 1 : interval;
+	_count = 0;
+	_bandgap = bandgap;
+	_vcc = 5.0;
+	_measured = false;
+}
+
+void SupplyMonitor::setBandgap (float bandgap)
+{
+	_bandgap = bandgap;
+	_measured = false;
+}
+
+/*
+	Passes every bandgap reading through 'hook' before it is used,
+	eg. to record it (NULL = none)
+*/
+void SupplyMonitor::setInputHook (int (*hook)(int raw))
+{
+	_inputHook = hook;
+}
+
+/*
+	Reads the bandgap against AVcc. The first conversion after 
+	switching the multiplexer to the bandgap is thrown away while
+	it settles. analogRead() sets the multiplexer itself so 
+	nothing needs to be restored afterwards.
+*/
+int SupplyMonitor::readBandgap ()
+{
+#if defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+	ADMUX = _BV(REFS0) | _BV(MUX4) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+	ADCSRB &= ~_BV(MUX5);
+#else
+	ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+#endif
+	delayMicroseconds(100);
+	int reading = 0;
+	for (byte i = 0; i < 2; i++)
+	{
+		ADCSRA |= _BV(ADSC);
+		while (ADCSRA & _BV(ADSC));
+		reading = ADCL;
+		reading |= ADCH << 8;
+	}
+	if (_inputHook != NULL)
+		reading = _inputHook (reading);
+	return reading;
+}
+
+/*
+	Takes a measurement now and returns the filtered Vcc
+*/
+float SupplyMonitor::measure ()
+{
+	int reading = readBandgap();
+	if (reading <= 0)
+		return _vcc;
+	float vcc = (_bandgap * 1023.0) / reading;
+	if (_measured == false)
+	{
+		_vcc = vcc;
+		_measured = true;
+	}
+	else
+		_vcc += (vcc - _vcc) * 0.25;
+	return _vcc;
+}
+
+/*
+	Call once per loop. Takes a measurement every 'interval' calls
+	(and on the first call). Returns true when a new value is 
+	available.
+*/
+boolean SupplyMonitor::update ()
+{
+	if ((_measured == true) && (++_count < _interval))
+		return false;
+	_count = 0;
+	measure();
+	return true;
+}
+
+/*
+	Returns the last filtered Vcc (5.0 until the first measurement)
+*/
+float SupplyMonitor::getVcc ()
+{
+	return _vcc;
+}
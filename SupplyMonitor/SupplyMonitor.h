@@ -0,0 +1,50 @@
+/*
+ Title: SupplyMonitor.h
+  Description: This library measures the micro's supply 
+	voltage (Vcc), which is also the ADC reference and the 
+	supply of the ratiometric sensors, by reading the internal
+	1.1V bandgap against it:
+		Vcc = bandgap * 1023 / reading
+	A measurement takes about 0.3ms so update() only takes one
+	every 'interval' calls and the result is smoothed with a
+	simple low pass filter. Called once per sensor read this 
+	costs a counter increment on all but 1 in 'interval' loops.
+	
+	The bandgap is only accurate to +/-10% from part to part.
+	For best results measure Vcc with a good meter once and 
+	call setBandgap(1.1 * meterVcc / getVcc()).
+	
+	The bandgap readings can be passed through a hook 
+	(setInputHook()) as they are read.
+	
+	Supported: ATmega328P/168 (Uno), ATmega32U4, ATmega1280/2560
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+#ifndef SupplyMonitor_h
+#define SupplyMonitor_h
+
+#include "Arduino.h"
+
+class SupplyMonitor
+{
+	public:
+		SupplyMonitor (unsigned int interval, float bandgap = 1.1);
+		void setBandgap (float bandgap);
+		float measure ();
+		boolean update ();
+		float getVcc ();
+		static void setInputHook (int (*hook)(int raw));
+	private:
+		static int (*_inputHook)(int raw);
+		int readBandgap ();
+		unsigned int _interval;
+		unsigned int _count;
+		float _bandgap;
+		float _vcc;
+		boolean _measured;
+};
+
+#endif
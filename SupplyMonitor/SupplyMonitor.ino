@@ -0,0 +1,66 @@
+/*
+ Title: SupplyMonitor (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the SupplyMonitor library. It first 
+	simulates the supply sagging from 5.0V to 4.5V and prints 
+	what an SSI (regulated, non-ratiometric) transducer at 
+	500psi and an MSI ratiometric transducer at 500psi read 
+	with and without the measured supply fed in. Then the live
+	Vcc is printed every second.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <EEPROM.h>
+#include <ConfigStore.h>
+#include <TransducerCal.h>
+#include <SupplyMonitor.h>
+
+SupplyMonitor supply (64);
+TransducerCal ssi (TRANSDUCER_SSI);
+TransducerCal msi (TRANSDUCER_MSI);
+
+void setup ()
+{
+	Serial.begin(57600);
+	Serial.println (F("Vcc,SSI(psi),SSI corrected(psi),MSI(psi),MSI corrected(psi)"));
+	float ssiVolts = (500.0 + 108.69) / 246.375;		// regulated output at 500psi
+	float msiVolts = ((500.0 - 14.69) * 0.004) + 0.5;	// output at 500psi with a 5V supply
+	for (float vcc = 5.0; vcc > 4.49; vcc -= 0.1)
+	{
+		// the ADC measures against Vcc, and the MSI output scales with it
+		int ssiRaw = (ssiVolts * 1023.0 / vcc) + 0.5;
+		int msiRaw = ((msiVolts * vcc / 5.0) * 1023.0 / vcc) + 0.5;
+		ssi.setReferenceVoltage (5.0);
+		ssi.setSupplyVoltage (5.0);
+		msi.setReferenceVoltage (5.0);
+		msi.setSupplyVoltage (5.0);
+		Serial.print (vcc);
+		Serial.print ((char) ',');
+		Serial.print (ssi.getPSI (ssiRaw));
+		Serial.print ((char) ',');
+		ssi.setReferenceVoltage (vcc);
+		ssi.setSupplyVoltage (vcc);
+		Serial.print (ssi.getPSI (ssiRaw));
+		Serial.print ((char) ',');
+		Serial.print (msi.getPSI (msiRaw));
+		Serial.print ((char) ',');
+		msi.setReferenceVoltage (vcc);
+		msi.setSupplyVoltage (vcc);
+		Serial.println (msi.getPSI (msiRaw));
+	}
+	Serial.println (F("Live Vcc"));
+}
+
+void loop ()
+{
+	unsigned long start = micros();
+	supply.measure();
+	unsigned long cost = micros() - start;
+	Serial.print (supply.getVcc(), 3);
+	Serial.print (F("V ("));
+	Serial.print (cost);
+	Serial.println (F("us)"));
+	delay (1000);
+}
@@ -1,4 +1,5 @@
 #include <ThermoTemp.h>
+#include <TypeK.h>
 #include <stdio.h> //For dtostrf function http://www.nongnu.org/avr-libc/user-manual/group__avr__stdlib.html#ga060c998e77fb5fc0d3168b3ce8771d42
 
 ThermoTemp thermoTemp;
@@ -6,20 +6,32 @@
     values as an array:
 		[0] raw interval
 		[1] voltage (in milivolts)
-		[2] temperature in Celsius
+		[2] temperature in Celsius (NIST type K linearised)
 		[3] temperature in Kelvin
 		[4] temperature in Fahrenheit
 		[5] temperature in Rankine
 	Additionally this library has some handy methods 
 	to calculate Kelvin, Fahrenheit, and Rankine given
 	a Celsius measurement.
+	getCelsius is the AD595's nominal 10mV/C. getCelsiusNIST
+	removes the AD595's gain (247.3) and offset (11uV) to get
+	back to the compensated thermocouple voltage and converts 
+	that with the NIST type K reference function (see the TypeK
+	library). The AD595 is only trimmed to 10mV/C around 25C so
+	this is several degrees better at engine temperatures.
     Note that this library will not setup any pins. It
 	is expected that these will be defined by the calling 
 	program.
+	Change Log:
+		GNS 2012-05-05: initial version
 */
 
 #include "Arduino.h"
 #include "ThermoTemp.h"
+#include <TypeK.h>
+
+#define AD595_GAIN 247.3
+#define AD595_OFFSET_MV 0.011
 
 //Empty Constructor
 ThermoTemp::ThermoTemp()
@@ -35,7 +47,7 @@ void ThermoTemp::getTemps (int analogSignalF, float tempsF[])
 {
   tempsF[0] = analogSignalF;
   tempsF[1] = getVoltage (tempsF[0]);  
-  tempsF[2] = getCelsius (tempsF[1]);
+  tempsF[2] = getCelsiusNIST (tempsF[1]);
   tempsF[3] = getKelvin (tempsF[2]);
   tempsF[4] = getFahrenheit (tempsF[2]);
   tempsF[5] = getRankine (tempsF[2]);
@@ -53,6 +65,16 @@ float ThermoTemp::getCelsius (float voltage)
   return celsius;
 }
 
+/*
+	AD595 output = (type K voltage + 11uV) * 247.3 
+	(see the AD595 datasheet). Returns NAN outside -200C to 1372C.
+*/
+float ThermoTemp::getCelsiusNIST (float voltage)
+{
+  float millivolts = (voltage * 1000.0 / AD595_GAIN) - AD595_OFFSET_MV;
+  return TypeK::getCelsius (millivolts);
+}
+
 float ThermoTemp::getKelvin (float celsius)
 {
   float kelvin = (celsius + 273.15);
@@ -6,16 +6,24 @@
     values as an array:
 		[0] raw interval
 		[1] voltage (in volts)
-		[2] temperature in Celsius
+		[2] temperature in Celsius (NIST type K linearised)
 		[3] temperature in Kelvin
 		[4] temperature in Fahrenheit
 		[5] temperature in Rankine
 	Additionally this library has some handy methods 
 	to calculate Kelvin, Fahrenheit, and Rankine given
 	a Celsius measurement.
+	getCelsius is the AD595's nominal 10mV/C. getCelsiusNIST
+	removes the AD595's gain (247.3) and offset (11uV) to get
+	back to the compensated thermocouple voltage and converts 
+	that with the NIST type K reference function (see the TypeK
+	library). The AD595 is only trimmed to 10mV/C around 25C so
+	this is several degrees better at engine temperatures.
     Note that this library will not setup any pins. It
 	is expected that these will be defined by the calling 
 	program.
+	Change Log:
+		GNS 2012-05-05: initial version
 */
 #ifndef ThermoTemp_h
 #define ThermoTemp_h
@@ -29,6 +37,7 @@ class ThermoTemp
 	void getTemps (int analogSignalF, float tempsF[]);
     float getVoltage (float analogSignal);
     float getCelsius (float voltage);
+    float getCelsiusNIST (float voltage);
 	float getKelvin (float clesius);
 	float getFahrenheit (float celsius);
 	float getRankine (float celsius); 
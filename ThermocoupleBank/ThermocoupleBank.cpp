@@ -0,0 +1,254 @@
+/*
+ Title: ThermocoupleBank.cpp
+  Description: Reads up to THERMO_BANK_MAX MAX31855 
+	thermocouple amplifiers that share the clock and data 
+	lines (one chip select each) and keeps the latest reading
+	of each in an array.
+	
+	A MAX31855 only converts every ~100ms so reading it more 
+	often returns the same data. update() therefore reads every
+	device back to back once per period (default 100ms) and 
+	does nothing in between, so the thermocouples don't slow 
+	down a loop that samples pressures much faster. The port
+	registers and bit masks of the pins are looked up once and
+	the bus is driven directly rather than with digitalWrite, 
+	so a device takes tens of us instead of several hundred
+	with digitalWrite and 1us delays. Each reading is
+	cold junction compensated and linearised with the TypeK 
+	library as part of the burst.
+	
+	The time is read with millis() and micros() unless other
+	clocks are given to setClock(), and the raw device words 
+	can be passed through a hook (setInputHook()) as they are
+	read.
+	
+	begin() sets the pin modes, so call it from setup() after 
+	adding the devices.
+*/
+
+#include "Arduino.h"
+#include <TypeK.h>
+#include "ThermocoupleBank.h"
+
+unsigned long (*ThermocoupleBank::_millisClock)() = millis;
+unsigned long (*ThermocoupleBank::_microsClock)() = micros;
+uint32_t (*ThermocoupleBank::_inputHook)(uint32_t raw) = NULL;
+
+/*
+	Shared clock (SCK) and data (SO) pins
+*/
+ThermocoupleBank::ThermocoupleBank (uint8_t sclk, uint8_t miso)
+{
+	_sclkPin = sclk;
+	_misoPin = miso;
+	_sclkPort = portOutputRegister(digitalPinToPort(sclk));
+	_sclkMask = digitalPinToBitMask(sclk);
+	_misoPort = portInputRegister(digitalPinToPort(miso));
+	_misoMask = digitalPinToBitMask(miso);
+	_count = 0;
+	_period = THERMO_BANK_PERIOD;
+	_lastBurst = 0;
+	_read = false;
+	_burstMicros = 0;
+}
+
+/*
+	Reads the time of every bank through these clocks instead of
+	millis() and micros() (eg. ones that record it so a session 
+	can be replayed)
+*/
+void ThermocoupleBank::setClock (unsigned long (*millisClock)(), unsigned long (*microsClock)())
+{
+	_millisClock = millisClock;
+	_microsClock = microsClock;
+}
+
+/*
+	Passes every raw 32 bit word read from a device through 'hook'
+	before it is converted, eg. to record it (NULL = none)
+*/
+void ThermocoupleBank::setInputHook (uint32_t (*hook)(uint32_t raw))
+{
+	_inputHook = hook;
+}
+
+/*
+	Adds a device by its chip select pin. Returns its number 
+	(the index used by the getters) or -1 if the bank is full.
+*/
+int ThermocoupleBank::addDevice (uint8_t cs)
+{
+	if (_count >= THERMO_BANK_MAX)
+		return -1;
+	_csPin[_count] = cs;
+	_csPort[_count] = portOutputRegister(digitalPinToPort(cs));
+	_csMask[_count] = digitalPinToBitMask(cs);
+	_celsius[_count] = NAN;
+	_internal[_count] = 0;
+	_fault[_count] = 0;
+	return _count++;
+}
+
+/*
+	Sets the pin modes and deselects every device
+*/
+void ThermocoupleBank::begin ()
+{
+	for (byte i = 0; i < _count; i++)
+	{
+		pinMode(_csPin[i], OUTPUT);
+		digitalWrite(_csPin[i], HIGH);
+	}
+	pinMode(_sclkPin, OUTPUT);
+	digitalWrite(_sclkPin, LOW);
+	pinMode(_misoPin, INPUT);
+}
+
+/*
+	Sets the time between bursts (ms). Anything shorter than the
+	conversion time just re-reads the same data.
+*/
+void ThermocoupleBank::setPeriod (unsigned int periodMillis)
+{
+	_period = periodMillis;
+}
+
+/*
+	Reads every device if the period has passed since the last
+	burst (or nothing has been read yet). Returns true if it did.
+*/
+boolean ThermocoupleBank::update ()
+{
+	if (_read == true && _millisClock() - _lastBurst < _period)
+		return false;
+	readAll ();
+	return true;
+}
+
+/*
+	Reads and converts every device now
+*/
+void ThermocoupleBank::readAll ()
+{
+	unsigned long start = _microsClock();
+	for (byte i = 0; i < _count; i++)
+	{
+		uint32_t v = readDevice (i);
+		if (_inputHook != NULL)
+			v = _inputHook (v);
+		
+		// cold junction: bits 4 - 15, LSB = 0.0625 degrees
+		int16_t internal = (v >> 4) & 0xFFF;
+		if (internal & 0x800)
+			internal |= 0xF000;
+		_internal[i] = internal;
+		
+		_fault[i] = v & 0x7;
+		if (_fault[i] != 0)
+		{
+			_celsius[i] = NAN;
+			continue;
+		}
+		
+		// thermocouple: bits 18 - 31, LSB = 0.25 degrees
+		int16_t temp = (v >> 18) & 0x3FFF;
+		if (temp & 0x2000)
+			temp |= 0xC000;
+		_celsius[i] = TypeK::compensate (temp * 0.25, internal * 0.0625);
+	}
+	_lastBurst = _millisClock();
+	_read = true;
+	_burstMicros = _microsClock() - start;
+}
+
+/*
+	Clocks 32 bits out of one device. The read-modify-writes of
+	the port registers are made with interrupts off (as 
+	digitalWrite does) since other pins on the same port may be
+	written from an interrupt.
+*/
+uint32_t ThermocoupleBank::readDevice (byte device)
+{
+	volatile uint8_t *csPort = _csPort[device];
+	uint8_t csMask = _csMask[device];
+	uint32_t d = 0;
+	uint8_t oldSREG;
+	
+	oldSREG = SREG;
+	cli();
+	*_sclkPort &= ~_sclkMask;
+	*csPort &= ~csMask;
+	SREG = oldSREG;
+	delayMicroseconds(1);		// CS to first bit (100ns min)
+	
+	for (byte i = 0; i < 32; i++)
+	{
+		oldSREG = SREG;
+		cli();
+		*_sclkPort &= ~_sclkMask;
+		SREG = oldSREG;
+		d <<= 1;
+		if (*_misoPort & _misoMask)
+			d |= 1;
+		oldSREG = SREG;
+		cli();
+		*_sclkPort |= _sclkMask;
+		SREG = oldSREG;
+	}
+	
+	oldSREG = SREG;
+	cli();
+	*_sclkPort &= ~_sclkMask;
+	*csPort |= csMask;
+	SREG = oldSREG;
+	return d;
+}
+
+/*
+	Number of devices added
+*/
+byte ThermocoupleBank::getCount ()
+{
+	return _count;
+}
+
+/*
+	Linearised temperature (C) from the last burst, NAN if the 
+	device reported a fault or hasn't been read
+*/
+float ThermocoupleBank::getCelsius (byte device)
+{
+	return _celsius[device];
+}
+
+/*
+	Cold junction (chip) temperature (C) from the last burst
+*/
+float ThermocoupleBank::getInternal (byte device)
+{
+	return _internal[device] * 0.0625;
+}
+
+/*
+	Fault bits from the last burst (0 = OK)
+*/
+byte ThermocoupleBank::getFault (byte device)
+{
+	return _fault[device];
+}
+
+/*
+	The temperatures (C) of every device, indexed by device number
+*/
+const float *ThermocoupleBank::getReadings ()
+{
+	return _celsius;
+}
+
+/*
+	Time (us) the last burst took, including the conversions
+*/
+unsigned int ThermocoupleBank::getBurstMicros ()
+{
+	return _burstMicros;
+}
@@ -0,0 +1,82 @@
+/*
+ Title: ThermocoupleBank.h
+  Description: Reads up to THERMO_BANK_MAX MAX31855 
+	thermocouple amplifiers that share the clock and data 
+	lines (one chip select each) and keeps the latest reading
+	of each in an array.
+	
+	A MAX31855 only converts every ~100ms so reading it more 
+	often returns the same data. update() therefore reads every
+	device back to back once per period (default 100ms) and 
+	does nothing in between, so the thermocouples don't slow 
+	down a loop that samples pressures much faster. The port
+	registers and bit masks of the pins are looked up once and
+	the bus is driven directly rather than with digitalWrite, 
+	so a device takes tens of us instead of several hundred
+	with digitalWrite and 1us delays. Each reading is
+	cold junction compensated and linearised with the TypeK 
+	library as part of the burst.
+	
+	The time is read with millis() and micros() unless other
+	clocks are given to setClock(), and the raw device words 
+	can be passed through a hook (setInputHook()) as they are
+	read.
+	
+	begin() sets the pin modes, so call it from setup() after 
+	adding the devices.
+*/
+#ifndef ThermocoupleBank_h
+#define ThermocoupleBank_h
+
+#include "Arduino.h"
+
+#define THERMO_BANK_MAX 4			// igniter, engine, fuel and ox line
+#define THERMO_BANK_PERIOD 100		// ms, MAX31855 conversion time
+
+// Fault bits (as reported by the MAX31855)
+#define THERMO_OPEN 0x01
+#define THERMO_SHORT_GND 0x02
+#define THERMO_SHORT_VCC 0x04
+
+class ThermocoupleBank
+{
+	public:
+		ThermocoupleBank (uint8_t sclk, uint8_t miso);
+		int addDevice (uint8_t cs);
+		void begin ();
+		void setPeriod (unsigned int periodMillis);
+		boolean update ();
+		void readAll ();
+		byte getCount ();
+		float getCelsius (byte device);
+		float getInternal (byte device);
+		byte getFault (byte device);
+		const float *getReadings ();
+		unsigned int getBurstMicros ();
+		static void setClock (unsigned long (*millisClock)(), unsigned long (*microsClock)());
+		static void setInputHook (uint32_t (*hook)(uint32_t raw));
+	private:
+		static unsigned long (*_millisClock)();
+		static unsigned long (*_microsClock)();
+		static uint32_t (*_inputHook)(uint32_t raw);
+		uint32_t readDevice (byte device);
+		uint8_t _sclkPin;
+		uint8_t _misoPin;
+		volatile uint8_t *_sclkPort;
+		uint8_t _sclkMask;
+		volatile uint8_t *_misoPort;
+		uint8_t _misoMask;
+		byte _count;
+		uint8_t _csPin[THERMO_BANK_MAX];
+		volatile uint8_t *_csPort[THERMO_BANK_MAX];
+		uint8_t _csMask[THERMO_BANK_MAX];
+		float _celsius[THERMO_BANK_MAX];
+		int16_t _internal[THERMO_BANK_MAX];
+		byte _fault[THERMO_BANK_MAX];
+		unsigned int _period;
+		unsigned long _lastBurst;
+		boolean _read;
+		unsigned int _burstMicros;
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ Title: ThermocoupleBank (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the ThermocoupleBank library. Four 
+	MAX31855 breakouts share the clock and data lines and each 
+	has its own chip select. The bank is updated every pass of
+	a fast loop (as a pressure sampling loop would) and the 
+	temperatures, cold junction temperatures and faults are 
+	printed every second along with the time the last burst 
+	took and how many loops ran.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <TypeK.h>
+#include <ThermocoupleBank.h>
+
+int thermoDO = 7;
+int thermoCLK = 4;
+int thermoCS[] = {6, 5, 3, 2};		// injector, chamber, throat, regen jacket
+
+ThermocoupleBank thermos (thermoCLK, thermoDO);
+unsigned long lastPrint = 0;
+unsigned long loops = 0;
+
+void setup ()
+{
+	Serial.begin(57600);
+	for (byte i = 0; i < sizeof(thermoCS) / sizeof(thermoCS[0]); i++)
+		thermos.addDevice (thermoCS[i]);
+	thermos.begin ();
+}
+
+void loop ()
+{
+	thermos.update ();
+	loops++;
+	if (millis() - lastPrint < 1000)
+		return;
+	lastPrint = millis();
+	
+	const float *temps = thermos.getReadings ();
+	for (byte i = 0; i < thermos.getCount (); i++)
+	{
+		Serial.print (temps[i], 2);
+		Serial.print (F("C ("));
+		Serial.print (thermos.getInternal (i), 2);
+		Serial.print (F("C"));
+		if (thermos.getFault (i) != 0)
+		{
+			Serial.print (F(" fault "));
+			Serial.print (thermos.getFault (i), HEX);
+		}
+		Serial.print (F("), "));
+	}
+	Serial.print (F("burst "));
+	Serial.print (thermos.getBurstMicros ());
+	Serial.print (F("us, loops/s "));
+	Serial.println (loops);
+	loops = 0;
+}
@@ -0,0 +1,251 @@
+/*
+ Title: ThrottleControl.cpp
+  Description: Closed loop throttling of the two main valve
+	servos. Two PI loops run at a fixed period:
+		pressure
+			sets the throttle (the opening of the more open 
+			valve, 0 - 1) from the chamber pressure error
+		mixture ratio
+			sets the ratio of the ox valve opening to the fuel
+			valve opening from the O/F error, using the measured
+			fuel and ox flows
+	and the servo targets are:
+		fuel = closed + throttle * min(1, 1 / ratio) * (opened - closed)
+		ox   = closed + throttle * min(1, ratio) * (opened - closed)
+	Both loops work on relative errors and make relative changes
+	(eg. a 10% pressure error changes the throttle by kp * 10% of
+	itself) so the same gains hold at any target and over the
+	whole valve travel, even though the flow through a valve 
+	changes much faster near closed than near open. A loop with
+	a target of 0 is off and holds its output (eg. pressure 
+	only, or a fixed throttle with mixture ratio control). The
+	throttle may only change by a set step per tick so the 
+	valves are never slammed, and an integrator stops while its
+	output is limited (anti windup). A NAN reading (sensor 
+	fault) holds that loop.
+
+	Call start() with the current valve opening so the loops
+	take over without a bump, then update() every pass of the
+	run loop. It returns true when new servo targets are ready.
+	stop() ends the loops (eg. on a shutdown) and update() does
+	nothing until the next start().
+	The library has no timebase of its own: a tick runs on the 
+	first update() at or after it is due, so it is late by up
+	to one pass of the calling loop, and a period shorter than
+	a pass runs once per pass. Use a period of at least two
+	passes (the average period is kept as long as a tick is 
+	less than a period late).
+
+	Tools/ThrottleSim runs the controller against a model of
+	the feed system, valves, chamber and sensors and reports
+	settling time and stability.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+
+#include "Arduino.h"
+#include "ThrottleControl.h"
+
+/*
+	Limits x to lo - hi
+*/
+static float clampFloat (float x, float lo, float hi)
+{
+	if (x < lo)
+		return lo;
+	if (x > hi)
+		return hi;
+	return x;
+}
+
+/*
+	closedPos and openedPos are the servo targets (us) of a closed
+	and a fully open valve. The loops run every periodMs once
+	started. The default gains suit the model in Tools/ThrottleSim;
+	re-tune them there for a different feed system.
+*/
+ThrottleControl::ThrottleControl (int closedPos, int openedPos, unsigned int periodMs)
+{
+	setLimits (closedPos, openedPos);
+	setPeriod (periodMs);
+	setPressureGains (THROTTLE_PRESSURE_KP, THROTTLE_PRESSURE_KI);
+	setMixtureGains (THROTTLE_MIXTURE_KP, THROTTLE_MIXTURE_KI);
+	setMaxStep (0.05);
+	setTarget (0, 0);
+	start (0, 1, 1);
+	stop ();
+}
+
+/*
+	Servo targets (us) of a closed and a fully open valve
+*/
+void ThrottleControl::setLimits (int closedPos, int openedPos)
+{
+	_closedPos = closedPos;
+	_openedPos = openedPos;
+}
+
+/*
+	Time between control ticks (ms). The loop gains are per
+	second so they don't need to change with the period.
+*/
+void ThrottleControl::setPeriod (unsigned int periodMs)
+{
+	_periodMs = periodMs;
+}
+
+/*
+	Relative throttle change per unit of relative pressure error
+	(kp) and per unit of relative error per second (ki)
+*/
+void ThrottleControl::setPressureGains (float kp, float ki)
+{
+	_pressureKp = kp;
+	_pressureKi = ki;
+}
+
+/*
+	Relative change of the ox to fuel opening ratio per unit of
+	relative O/F error (kp) and per unit of relative error per 
+	second (ki)
+*/
+void ThrottleControl::setMixtureGains (float kp, float ki)
+{
+	_mixtureKp = kp;
+	_mixtureKi = ki;
+}
+
+/*
+	Largest throttle change per tick (default 0.05, ie. 5% of the
+	valve travel)
+*/
+void ThrottleControl::setMaxStep (float maxStep)
+{
+	_maxStep = maxStep;
+}
+
+/*
+	Chamber pressure (psi) and mixture ratio (O/F) to hold. 0 
+	turns that loop off.
+*/
+void ThrottleControl::setTarget (float chamberPSI, float mixtureRatio)
+{
+	_targetPSI = chamberPSI;
+	_targetMR = mixtureRatio;
+}
+
+/*
+	Starts the loops from the given throttle (0 - 1) and ox to fuel
+	opening ratio (see top of file) so the first tick does not 
+	bump the valves. The first tick is a period after 'now' (ms).
+*/
+void ThrottleControl::start (unsigned long now, float throttle, float ratio)
+{
+	_lastTick = now;
+	_throttle = clampFloat (throttle, THROTTLE_MIN, 1);
+	_throttleI = _throttle;
+	_ratio = clampFloat (ratio, 1 / THROTTLE_MAX_RATIO, THROTTLE_MAX_RATIO);
+	_ratioI = _ratio;
+	_running = true;
+}
+
+/*
+	Runs a control tick if one is due at 'now' (ms). Returns true
+	when it did, ie. there are new servo targets. A tick that is
+	late by more than a period is not made up. Returns false while
+	stopped.
+*/
+boolean ThrottleControl::update (unsigned long now, float chamberPSI, float fuelFlow, float oxFlow)
+{
+	if ((_running == false) || (now - _lastTick < _periodMs))
+		return false;
+	if (now - _lastTick < 2UL * _periodMs)
+		_lastTick += _periodMs;
+	else
+		_lastTick = now;
+	float dt = _periodMs / 1000.0;
+	
+	if ((_targetPSI > 0) && (isnan (chamberPSI) == false))
+	{
+		float error = (_targetPSI - chamberPSI) / _targetPSI;
+		float u = _throttleI * (1 + _pressureKp * error);
+		float limited = clampFloat (u, _throttle - _maxStep, _throttle + _maxStep);
+		limited = clampFloat (limited, THROTTLE_MIN, 1);
+		// don't integrate further into a limit
+		if (!((u > limited && error > 0) || (u < limited && error < 0)))
+			_throttleI = clampFloat (_throttleI * (1 + _pressureKi * error * dt), THROTTLE_MIN, 1);
+		_throttle = limited;
+	}
+	
+	float mixtureRatio = (fuelFlow > 0) ? oxFlow / fuelFlow : NAN;
+	if ((_targetMR > 0) && (isnan (mixtureRatio) == false))
+	{
+		float error = (_targetMR - mixtureRatio) / _targetMR;
+		float r = _ratioI * (1 + _mixtureKp * error);
+		float limited = clampFloat (r, 1 / THROTTLE_MAX_RATIO, THROTTLE_MAX_RATIO);
+		if (!((r > limited && error > 0) || (r < limited && error < 0)))
+			_ratioI = clampFloat (_ratioI * (1 + _mixtureKi * error * dt), 1 / THROTTLE_MAX_RATIO, THROTTLE_MAX_RATIO);
+		_ratio = limited;
+	}
+	return true;
+}
+
+/*
+	Stops the loops. The servo targets are left where they were; it
+	is up to the caller to close the valves.
+*/
+void ThrottleControl::stop ()
+{
+	_running = false;
+}
+
+/*
+	Returns true between start() and stop()
+*/
+boolean ThrottleControl::isRunning ()
+{
+	return _running;
+}
+
+/*
+	Servo target (us) of a valve opened by 'opening' (0 - 1)
+*/
+int ThrottleControl::toPosition (float opening)
+{
+	opening = clampFloat (opening, 0, 1);
+	return (int) floor (_closedPos + opening * (_openedPos - _closedPos) + 0.5);
+}
+
+/*
+	Fuel valve servo target (us)
+*/
+int ThrottleControl::getFuelTarget ()
+{
+	return toPosition ((_ratio > 1) ? _throttle / _ratio : _throttle);
+}
+
+/*
+	Ox valve servo target (us)
+*/
+int ThrottleControl::getOxTarget ()
+{
+	return toPosition ((_ratio < 1) ? _throttle * _ratio : _throttle);
+}
+
+/*
+	Current throttle (0 - 1)
+*/
+float ThrottleControl::getThrottle ()
+{
+	return _throttle;
+}
+
+/*
+	Current ox to fuel valve opening ratio
+*/
+float ThrottleControl::getRatio ()
+{
+	return _ratio;
+}
@@ -0,0 +1,99 @@
+/*
+ Title: ThrottleControl.h
+  Description: Closed loop throttling of the two main valve
+	servos. Two PI loops run at a fixed period:
+		pressure
+			sets the throttle (the opening of the more open 
+			valve, 0 - 1) from the chamber pressure error
+		mixture ratio
+			sets the ratio of the ox valve opening to the fuel
+			valve opening from the O/F error, using the measured
+			fuel and ox flows
+	and the servo targets are:
+		fuel = closed + throttle * min(1, 1 / ratio) * (opened - closed)
+		ox   = closed + throttle * min(1, ratio) * (opened - closed)
+	Both loops work on relative errors and make relative changes
+	(eg. a 10% pressure error changes the throttle by kp * 10% of
+	itself) so the same gains hold at any target and over the
+	whole valve travel, even though the flow through a valve 
+	changes much faster near closed than near open. A loop with
+	a target of 0 is off and holds its output (eg. pressure 
+	only, or a fixed throttle with mixture ratio control). The
+	throttle may only change by a set step per tick so the 
+	valves are never slammed, and an integrator stops while its
+	output is limited (anti windup). A NAN reading (sensor 
+	fault) holds that loop.
+
+	Call start() with the current valve opening so the loops
+	take over without a bump, then update() every pass of the
+	run loop. It returns true when new servo targets are ready.
+	stop() ends the loops (eg. on a shutdown) and update() does
+	nothing until the next start().
+	The library has no timebase of its own: a tick runs on the 
+	first update() at or after it is due, so it is late by up
+	to one pass of the calling loop, and a period shorter than
+	a pass runs once per pass. Use a period of at least two
+	passes (the average period is kept as long as a tick is 
+	less than a period late).
+
+	Tools/ThrottleSim runs the controller against a model of
+	the feed system, valves, chamber and sensors and reports
+	settling time and stability.
+
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling
+	program.
+*/
+#ifndef ThrottleControl_h
+#define ThrottleControl_h
+
+#include "Arduino.h"
+
+#define THROTTLE_MAX_RATIO 2.0		// largest ox to fuel valve opening ratio (smallest is 1 / this)
+#define THROTTLE_MIN 0.05			// smallest throttle the pressure loop will set
+
+// Default gains (tuned with Tools/ThrottleSim)
+#define THROTTLE_PRESSURE_KP 0.2
+#define THROTTLE_PRESSURE_KI 2.0
+#define THROTTLE_MIXTURE_KP 0.2
+#define THROTTLE_MIXTURE_KI 2.0
+
+class ThrottleControl
+{
+	public:
+		ThrottleControl (int closedPos, int openedPos, unsigned int periodMs);
+		void setLimits (int closedPos, int openedPos);
+		void setPeriod (unsigned int periodMs);
+		void setPressureGains (float kp, float ki);
+		void setMixtureGains (float kp, float ki);
+		void setMaxStep (float maxStep);
+		void setTarget (float chamberPSI, float mixtureRatio);
+		void start (unsigned long now, float throttle, float ratio);
+		boolean update (unsigned long now, float chamberPSI, float fuelFlow, float oxFlow);
+		void stop ();
+		boolean isRunning ();
+		int getFuelTarget ();
+		int getOxTarget ();
+		float getThrottle ();
+		float getRatio ();
+	private:
+		int toPosition (float opening);
+		int _closedPos;
+		int _openedPos;
+		unsigned int _periodMs;
+		float _pressureKp;
+		float _pressureKi;
+		float _mixtureKp;
+		float _mixtureKi;
+		float _maxStep;
+		float _targetPSI;
+		float _targetMR;
+		unsigned long _lastTick;
+		float _throttle;
+		float _throttleI;
+		float _ratio;
+		float _ratioI;
+		boolean _running;
+};
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ Title: ThrottleControl (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the ThrottleControl library. A
+	potentiometer on A0 stands in for the chamber pressure
+	transducer (0 - 5V = 0 - 300psi). The pressure loop holds
+	150psi (mixture ratio control is off) and the throttle and
+	servo targets are printed every control tick (50ms). Turn
+	the pot to see the throttle wind towards closed when the
+	"pressure" is high and towards open when it is low.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <ThrottleControl.h>
+
+ThrottleControl throttle (800, 1600, 50);	// closed (us), opened (us), period (ms)
+
+void setup ()
+{
+	Serial.begin(57600);
+	throttle.setTarget (150, 0);			// 150psi, no mixture ratio control
+	throttle.start (millis (), 1.0, 1.0);	// from fully open
+	Serial.println (F("psi,throttle,fuel(us),ox(us)"));
+}
+
+void loop ()
+{
+	float psi = analogRead (A0) * 300.0 / 1023.0;
+	if (throttle.update (millis (), psi, NAN, NAN) == true)
+	{
+		Serial.print (psi);
+		Serial.print (',');
+		Serial.print (throttle.getThrottle (), 3);
+		Serial.print (',');
+		Serial.print (throttle.getFuelTarget ());
+		Serial.print (',');
+		Serial.println (throttle.getOxTarget ());
+	}
+}
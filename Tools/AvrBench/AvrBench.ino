@@ -0,0 +1,213 @@
+/*
+ Title: AvrBench
+  Description: Microbenchmarks of the libraries on the ATmega328P
+	(Uno), to be run in simavr (cycle accurate) or on a board. Each
+	benchmark calls a function 'n' times between two reads of a 32
+	bit cycle counter (Timer1 at clk/1 plus its overflow interrupt)
+	and takes off the cost of the empty loop. Timer0 (millis) is
+	stopped and the serial output has drained while measuring, so
+	nothing else runs. Inputs are read from volatiles so nothing is
+	worked out when compiling. The output is one CSV line each:
+		bench,<name>,<cycles per call>,<calls>
+		mem,flash,<bytes>		program + .data initial values
+		mem,static,<bytes>		.data + .bss
+		mem,free,<bytes>		stack pointer to the heap at setup
+		done
+	Tools/AvrBenchReport turns this (and avr-nm's symbol sizes per
+	library) into a report and compares it with a baseline.
+
+	Build and run (from this directory, with arduino-cli and simavr):
+		arduino-cli compile --fqbn arduino:avr:uno --libraries ../.. --output-dir build .
+		simavr -m atmega328p -f 16000000 build/AvrBench.ino.elf > bench.txt
+		avr-nm -C -S -l --size-sort build/AvrBench.ino.elf > symbols.txt
+	simavr prints the UART output and quits when the sketch sleeps
+	with interrupts off at the end. On a board, read the serial
+	port at 115200 instead.
+
+*/
+
+#include <avr/sleep.h>
+#include <EngineMath.h>
+#include <Transducer.h>
+#include <LoadCell.h>
+#include <ThermoTemp.h>
+#include <TypeK.h>
+#include <Adafruit_MAX31855.h>
+#include <SoftwareSerial.h>
+#include <InputTrace.h>
+#include <PMCtrl.h>
+#include <SensorFilter.h>
+#include <Propellant.h>
+
+/*
+	Port for PMCtrlT that only keeps the last byte, so the cost is
+	encoding the packet and not the serial line
+*/
+class NullPort
+{
+	public:
+		size_t write (uint8_t b) { last = b; return 1; }
+		int available () { return 0; }
+		int read () { return -1; }
+		volatile uint8_t last;
+};
+
+// Linker symbols (avr-libc)
+extern char __data_start, __bss_end, __heap_start, __data_load_end;
+
+EngineMath em;
+Transducer transducer;
+LoadCell loadCell (5.0, 0.5, 4.5, 1000.0);
+ThermoTemp thermoTemp;
+Adafruit_MAX31855 thermocouple (5, 4, 6);	// CLK, CS, DO (nothing attached: reads 0)
+SoftwareSerial softSerial (11, 12);			// RX, TX
+NullPort nullPort;
+PMCtrlT<NullPort> nullCtrl (nullPort);
+BiquadFilter biquad (5.0, 40.0);
+MedianFilter median (5);
+
+volatile int rawIn = 512;
+volatile float psiIn = 350.0;
+volatile float voltsIn = 2.0;
+volatile float mvIn = 12.5;
+volatile float aExitIn = 0.0005;
+volatile float sinkF;
+volatile int sinkI;
+float temps[4];
+float pressures[5];
+
+static volatile uint16_t overflows = 0;
+static uint32_t overhead = 0;			// cycles of the empty loop per call
+
+ISR(TIMER1_OVF_vect)
+{
+	overflows++;
+}
+
+/*
+	Cycles since Timer1 was started (32 bit)
+*/
+static uint32_t cycles ()
+{
+	uint8_t oldSREG = SREG;
+	cli ();
+	uint16_t low = TCNT1;
+	uint16_t high = overflows;
+	if ((TIFR1 & _BV(TOV1)) && (low < 0x8000))	// overflowed since cli
+		high++;
+	SREG = oldSREG;
+	return ((uint32_t) high << 16) | low;
+}
+
+/*
+	Stops everything else that would interrupt a benchmark and
+	starts Timer1 counting cycles. Called after the serial output
+	has drained.
+*/
+static void startCounting ()
+{
+	Serial.flush ();
+	TIMSK0 &= ~_BV(TOIE0);
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10);
+	TCNT1 = 0;
+	overflows = 0;
+	TIFR1 = _BV(TOV1);
+	TIMSK1 = _BV(TOIE1);
+}
+
+static void stopCounting ()
+{
+	TIMSK1 = 0;
+	TIMSK0 |= _BV(TOIE0);
+}
+
+/*
+	Prints the cycles per call of a benchmark that took 'total'
+	cycles for 'calls' calls
+*/
+static void report (const __FlashStringHelper *name, uint32_t total, uint16_t calls)
+{
+	stopCounting ();
+	uint32_t perCall = total / calls;
+	perCall = (perCall > overhead) ? perCall - overhead : 0;
+	Serial.print (F("bench,"));
+	Serial.print (name);
+	Serial.print (',');
+	Serial.print (perCall);
+	Serial.print (',');
+	Serial.println (calls);
+}
+
+#define BENCH(name, calls, code) \
+	{ \
+		startCounting (); \
+		uint32_t start = cycles (); \
+		for (uint16_t i = 0; i < (calls); i++) \
+		{ \
+			code; \
+		} \
+		report (F(name), cycles () - start, (calls)); \
+	}
+
+void setup ()
+{
+	Serial.begin (115200);
+	uint16_t freeRam = SP - (uint16_t) &__heap_start;
+	softSerial.begin (57600);		// before startCounting takes Timer1 back
+
+	// empty loop first, taken off the rest
+	startCounting ();
+	uint32_t start = cycles ();
+	for (uint16_t i = 0; i < 1000; i++)
+		asm volatile ("");
+	overhead = (cycles () - start) / 1000;
+	stopCounting ();
+	Serial.print (F("bench,empty loop,"));
+	Serial.print (overhead);
+	Serial.println (F(",1000"));
+
+	BENCH ("EngineMath::GasMassFlow", 100, sinkF = em.GasMassFlow (0.65, 9.80665, 1.4, 1.0, 293.0, 32.0, psiIn, 14.7, 0.00002));
+	BENCH ("EngineMath::LiquidMassFlow", 100, sinkF = em.LiquidMassFlow (0.61, 789.0, psiIn, 14.7, 0.00001));
+	BENCH ("EngineMath::thrustCalc", 100, sinkF = em.thrustCalc (1.2, psiIn, 14.7, 14.7, 0.0005, 0.0001));
+	BENCH ("EngineMath::nozzleThrust", 100, sinkF = em.nozzleThrust (1.2, psiIn, 14.7, 0.0005, 0.0001));
+	BENCH ("EngineMath::exitPressureRatio (solve)", 20, sinkF = em.exitPressureRatio (1.2, aExitIn + (i & 1) * 0.0001, 0.0001));
+	BENCH ("Transducer::getVoltage", 100, sinkF = transducer.getVoltage (rawIn));
+	BENCH ("Transducer::getPSI", 100, sinkF = transducer.getPSI (voltsIn));
+	BENCH ("Transducer::getPressures", 100, transducer.getPressures (rawIn, pressures));
+	BENCH ("LoadCell::getForce", 100, sinkF = loadCell.getForce (rawIn));
+	BENCH ("ThermoTemp::getCelsius", 100, sinkF = thermoTemp.getCelsius (voltsIn));
+	BENCH ("ThermoTemp::getCelsiusNIST", 100, sinkF = thermoTemp.getCelsiusNIST (voltsIn));
+	BENCH ("ThermoTemp::getTemps", 100, thermoTemp.getTemps (rawIn, temps));
+	BENCH ("TypeK::getCelsius", 100, sinkF = TypeK::getCelsius (mvIn));
+	BENCH ("Adafruit_MAX31855::spiread32 (readError)", 20, sinkI = thermocouple.readError ());
+	BENCH ("Adafruit_MAX31855::readCelsius", 20, sinkF = thermocouple.readCelsius ());
+	BENCH ("PMCtrlT::setTarget (packet encode)", 100, nullCtrl.setTarget (1500 + (i & 255), 0, 12));
+	BENCH ("PMCtrlT::getPosition (no reply)", 100, sinkI = nullCtrl.getPosition (0, 12));
+	BENCH ("SoftwareSerial::write (57600)", 20, softSerial.write ((uint8_t) i));
+	softSerial.begin (9600);
+	BENCH ("SoftwareSerial::write (9600)", 10, softSerial.write ((uint8_t) i));
+	BENCH ("BiquadFilter::filter", 100, sinkI = biquad.filter (rawIn));
+	BENCH ("MedianFilter::filter", 100, sinkI = median.filter (rawIn + (i & 15)));
+	BENCH ("Propellant::getGasZ", 100, sinkF = Propellant::getGasZ (PROP_O2, 250.0, psiIn));
+	BENCH ("Propellant::getLiquidDensity", 100, sinkF = Propellant::getLiquidDensity (PROP_ETHANOL, 290.0));
+
+	Serial.print (F("mem,flash,"));
+	Serial.println ((uint16_t) &__data_load_end);
+	Serial.print (F("mem,static,"));
+	Serial.println ((uint16_t) &__bss_end - (uint16_t) &__data_start);
+	Serial.print (F("mem,free,"));
+	Serial.println (freeRam);
+	Serial.println (F("done"));
+	Serial.flush ();
+
+	// simavr stops here
+	cli ();
+	set_sleep_mode (SLEEP_MODE_PWR_DOWN);
+	sleep_enable ();
+	sleep_cpu ();
+}
+
+void loop ()
+{
+}
@@ -0,0 +1,249 @@
+/*
+ Title: AvrBenchReport.cpp
+  Description: Host tool that turns the output of the AvrBench
+	sketch (Tools/AvrBench, run in simavr or on a board) and the
+	symbol sizes of its ELF into one CSV report:
+		cycles,<benchmark>,<cycles per call>
+		flash,<library>,<bytes>		code and PROGMEM tables
+		ram,<library>,<bytes>		.data and .bss
+		mem,<flash|static|free>,<bytes>
+	Symbols are put under the folder of the source file they came
+	from (avr-nm -l), so each library's flash and RAM is seen
+	separately. With a baseline (an earlier report) every number
+	is compared with it and anything worse by more than the
+	tolerance (more cycles, flash or RAM, or less free RAM) FAILs,
+	so a change that slows a library down shows up. simavr is cycle
+	accurate, so the cycles of the same code do not change between
+	runs.
+	The report goes to stdout; checks print PASS or FAIL to stderr
+	and the exit status is the number of failures.
+
+	Build (from this directory):
+		g++ -O2 AvrBenchReport.cpp -o AvrBenchReport
+	Usage:
+		AvrBenchReport bench.txt [symbols.txt] [-baseline old.csv] [-tolerance percent]
+			bench.txt	AvrBench output (other lines are ignored)
+			symbols.txt	avr-nm -C -S -l --size-sort AvrBench.ino.elf
+			percent		allowed increase, default 1
+		eg. AvrBenchReport bench.txt symbols.txt > report.csv
+			AvrBenchReport bench.txt symbols.txt -baseline report.csv
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void result (const char *check, bool pass)
+{
+	fprintf (stderr, "%-60s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+struct Row
+{
+	std::string kind;
+	std::string name;
+	long value;
+};
+
+/*
+	Reads the bench and mem lines of the AvrBench output. The
+	simulator may put its own text around them, so each line is
+	searched for the prefix. Returns false if "done" never came.
+*/
+static bool readBench (const char *path, std::vector<Row> &rows)
+{
+	FILE *f = fopen (path, "r");
+	if (f == NULL)
+	{
+		perror (path);
+		exit (1);
+	}
+	char line[256];
+	bool done = false;
+	while (fgets (line, sizeof (line), f))
+	{
+		char *p;
+		if ((p = strstr (line, "bench,")) != NULL)
+		{
+			char *name = p + 6;
+			char *comma = strchr (name, ',');
+			if (comma == NULL)
+				continue;
+			*comma = 0;
+			if (strcmp (name, "empty loop") != 0)
+				rows.push_back ((Row) { "cycles", name, atol (comma + 1) });
+		}
+		else if ((p = strstr (line, "mem,")) != NULL)
+		{
+			char *name = p + 4;
+			char *comma = strchr (name, ',');
+			if (comma == NULL)
+				continue;
+			*comma = 0;
+			rows.push_back ((Row) { "mem", name, atol (comma + 1) });
+		}
+		else if (strstr (line, "done") != NULL)
+			done = true;
+	}
+	fclose (f);
+	return done;
+}
+
+/*
+	Library a symbol belongs to: the folder of its source file, or
+	the class for a symbol without one
+*/
+static std::string library (const char *name, const char *file)
+{
+	if ((file != NULL) && (*file != 0))
+	{
+		std::string path (file);
+		path = path.substr (0, path.rfind (':'));		// drop the line number
+		size_t slash = path.rfind ('/');
+		if (slash != std::string::npos)
+		{
+			std::string dir = path.substr (0, slash);
+			size_t up = dir.rfind ('/');
+			dir = (up == std::string::npos) ? dir : dir.substr (up + 1);
+			return (dir == "arduino") ? "core" : dir;
+		}
+	}
+	std::string symbol (name);
+	if (symbol.compare (0, 11, "vtable for ") == 0)
+		symbol = symbol.substr (11);
+	size_t scope = symbol.find ("::");
+	if (scope == std::string::npos)
+		return "other";
+	symbol = symbol.substr (0, scope);
+	return symbol.substr (0, symbol.find ('<'));		// PMCtrlT<Port> is PMCtrlT
+}
+
+/*
+	Adds up the flash and RAM of each library from avr-nm output
+	(address size type name [tab file:line])
+*/
+static void readSymbols (const char *path, std::vector<Row> &rows)
+{
+	FILE *f = fopen (path, "r");
+	if (f == NULL)
+	{
+		perror (path);
+		exit (1);
+	}
+	std::map<std::string, long> flash, ram;
+	char line[1024];
+	while (fgets (line, sizeof (line), f))
+	{
+		line[strcspn (line, "\r\n")] = 0;
+		char *file = strchr (line, '\t');
+		if (file != NULL)
+			*file++ = 0;
+		unsigned long address, size;
+		char type;
+		int used;
+		if (sscanf (line, "%lx %lx %c %n", &address, &size, &type, &used) < 3)
+			continue;
+		std::string lib = library (line + used, file);
+		switch (type)
+		{
+			case 't': case 'T': case 'W': case 'w':
+				flash[lib] += size;
+				break;
+			case 'd': case 'D': case 'r': case 'R':		// initial values are in flash
+				flash[lib] += size;
+				ram[lib] += size;
+				break;
+			case 'b': case 'B': case 'v': case 'V':
+				ram[lib] += size;
+				break;
+		}
+	}
+	fclose (f);
+	for (std::map<std::string, long>::iterator i = flash.begin (); i != flash.end (); ++i)
+		rows.push_back ((Row) { "flash", i->first, i->second });
+	for (std::map<std::string, long>::iterator i = ram.begin (); i != ram.end (); ++i)
+		rows.push_back ((Row) { "ram", i->first, i->second });
+}
+
+/*
+	Reads a report written by this tool
+*/
+static std::map<std::string, long> readReport (const char *path)
+{
+	std::map<std::string, long> values;
+	FILE *f = fopen (path, "r");
+	if (f == NULL)
+	{
+		perror (path);
+		exit (1);
+	}
+	char line[256];
+	while (fgets (line, sizeof (line), f))
+	{
+		char *comma = strrchr (line, ',');
+		if (comma == NULL)
+			continue;
+		*comma = 0;
+		values[line] = atol (comma + 1);
+	}
+	fclose (f);
+	return values;
+}
+
+int main (int argc, char *argv[])
+{
+	const char *benchPath = NULL;
+	const char *symbolPath = NULL;
+	const char *baselinePath = NULL;
+	double tolerance = 1.0;
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp (argv[i], "-baseline") == 0) && (i + 1 < argc))
+			baselinePath = argv[++i];
+		else if ((strcmp (argv[i], "-tolerance") == 0) && (i + 1 < argc))
+			tolerance = atof (argv[++i]);
+		else if (benchPath == NULL)
+			benchPath = argv[i];
+		else
+			symbolPath = argv[i];
+	}
+	if (benchPath == NULL)
+	{
+		fprintf (stderr, "usage: AvrBenchReport bench.txt [symbols.txt] [-baseline old.csv] [-tolerance percent]\n");
+		return 1;
+	}
+
+	std::vector<Row> rows;
+	result ("benchmark ran to the end", readBench (benchPath, rows));
+	if (symbolPath != NULL)
+		readSymbols (symbolPath, rows);
+	for (size_t i = 0; i < rows.size (); i++)
+		printf ("%s,%s,%ld\n", rows[i].kind.c_str (), rows[i].name.c_str (), rows[i].value);
+
+	if (baselinePath != NULL)
+	{
+		std::map<std::string, long> baseline = readReport (baselinePath);
+		for (size_t i = 0; i < rows.size (); i++)
+		{
+			std::string key = rows[i].kind + "," + rows[i].name;
+			std::map<std::string, long>::iterator old = baseline.find (key);
+			if (old == baseline.end ())
+				continue;
+			// less is better, except for free RAM
+			bool lessIsBetter = (key != "mem,free");
+			double change = (old->second == 0) ? 0 : 100.0 * (rows[i].value - old->second) / old->second;
+			char check[128];
+			snprintf (check, sizeof (check), "%s: %ld -> %ld (%+.1f%%)", key.c_str (), old->second, rows[i].value, change);
+			result (check, lessIsBetter ? (change <= tolerance) : (change >= -tolerance));
+		}
+	}
+	fprintf (stderr, "%d failure(s)\n", failures);
+	return failures;
+}
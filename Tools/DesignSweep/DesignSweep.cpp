@@ -0,0 +1,515 @@
+/*
+ Title: DesignSweep.cpp
+  Description: Host tool for choosing orifice diameters, tank
+	pressures and nozzle areas on a PC instead of at the test
+	stand. Every combination on a grid of
+		ld, gd			fuel and ox orifice diameters (in)
+		fuelTankPSI,
+		oxTankPSI		feed pressures at the orifices (psi)
+		lcd, gcd		discharge coefficients
+		aThroatE,
+		aExitE			nozzle throat and exit areas (m^2)
+	(names as in EngineController) is solved for the chamber
+	pressure at which the propellant flowing in through the
+	orifices (EngineMath LiquidMassFlow and GasMassFlow, as
+	EngineController calculates them) equals the flow out of the
+	throat at a C* that falls off either side of the best O/F
+	(the Tools/ThrottleSim chamber model). The thrust then comes
+	from nozzleThrust. Designs are kept when:
+		- the chamber pressure is above ambient
+		- the pressure drop across each orifice is at least a
+		  set fraction of the chamber pressure (injector
+		  stiffness, so chamber pressure changes can't couple
+		  back into the feed)
+		- O/F is within a set range
+	and the Pareto optimal ones (no other design has at least
+	as much thrust and Isp at no more tank pressure, and more of
+	one of them) are printed.
+
+	The grid is shared out by a work stealing thread pool: each
+	thread splits its range in halves down to a small block,
+	works through its own blocks newest first and, when it runs
+	out, takes the oldest (largest) block from another thread.
+	Each thread keeps its own Pareto set; the sets are merged at
+	the end. -bench runs the same sweep on 1, 2, 4 ... threads
+	and prints the grid points per second and the speed up.
+
+	Build (from this directory):
+		g++ -O2 -pthread -I../HostShim -I../../EngineMath DesignSweep.cpp ../../EngineMath/EngineMath.cpp -o DesignSweep
+	Usage:
+		DesignSweep [options]
+			-g name=min:max:steps	sweeps a variable (steps = 1
+									fixes it at min), eg.
+									-g ld=0.02:0.12:41
+			-stiff fraction			smallest orifice pressure drop
+									/ chamber pressure (default 0.2)
+			-mr min:max				O/F range (default 1.0:2.0)
+			-j threads				default all cores
+			-csv file				writes every design that passes
+			-bench					threads scaling benchmark
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "Arduino.h"
+#include "EngineMath.h"
+
+#define PSI2PA 6894.75729
+#define AMBIENT_PSI 14.696
+#define G0 9.80665
+#define LBF2N 4.44822
+#define SOLVER_STEPS 24			// bisection steps on chamber pressure (< 0.0001 of the range)
+#define BLOCK_SIZE 64			// grid points a thread works through without splitting
+
+typedef struct
+{
+	const char *name;
+	double min;
+	double max;
+	int steps;
+	const char *note;
+} SweepVariable;
+
+enum { V_LD, V_GD, V_FUEL_TANK, V_OX_TANK, V_LCD, V_GCD, V_THROAT, V_EXIT, V_COUNT };
+
+static SweepVariable sweep[V_COUNT] =
+{
+	// name			min			max			steps	note
+	{ "ld",			0.02,		0.12,		41,		"fuel orifice diameter (in)" },
+	{ "gd",			0.10,		0.45,		36,		"ox orifice diameter (in)" },
+	{ "fuelTankPSI",200,		600,		17,		"fuel feed pressure (psi)" },
+	{ "oxTankPSI",	200,		600,		17,		"ox feed pressure (psi)" },
+	{ "lcd",		0.7,		0.7,		1,		"fuel Cd" },
+	{ "gcd",		0.32,		0.32,		1,		"ox Cd" },
+	{ "aThroatE",	0.00017,	0.00017,	1,		"throat area (m^2)" },
+	{ "aExitE",		0.00038,	0.00038,	1,		"exit area (m^2)" }
+};
+
+// Fixed properties (EngineController defaults, Tools/ThrottleSim chamber)
+static const double lden = 800;
+static const double gk = 1.40;
+static const double gz = 0.98;
+static const double gtemp = 277.0;
+static const double gm = 32;
+static const double kE = 1.22;
+static const double cStarMax = 1500;
+static const double bestMR = 1.4;
+
+// Limits
+static double minStiffness = 0.2;
+static double minMR = 1.0;
+static double maxMR = 2.0;
+
+typedef struct
+{
+	float x[V_COUNT];
+	float pc;			// chamber psi
+	float mr;			// O/F
+	float flow;			// kg/sec
+	float thrust;		// lbf
+	float isp;			// sec
+	float fuelStiffness;
+	float oxStiffness;
+} Design;
+
+/*
+	Orifice area (m^2) of a diameter in inches (as EngineController)
+*/
+static double orificeArea (double d)
+{
+	return M_PI * pow (d / 2, 2) * 0.00064516;
+}
+
+static double sweepValue (int v, int i)
+{
+	if (sweep[v].steps <= 1)
+		return sweep[v].min;
+	return sweep[v].min + (sweep[v].max - sweep[v].min) * i / (sweep[v].steps - 1);
+}
+
+static size_t gridPoints ()
+{
+	size_t n = 1;
+	for (int v = 0; v < V_COUNT; v++)
+		n *= sweep[v].steps;
+	return n;
+}
+
+/*
+	Propellant in minus propellant out of the throat at chamber
+	pressure 'pc'
+*/
+static double flowBalance (EngineMath &em, const Design &d, double la, double ga, double pc,
+						   double *fuelFlow, double *oxFlow)
+{
+	*fuelFlow = em.LiquidMassFlow (d.x[V_LCD], lden, d.x[V_FUEL_TANK], pc, la);
+	*oxFlow = em.GasMassFlow (d.x[V_GCD], G0, gk, gz, gtemp, gm, d.x[V_OX_TANK], pc, ga);
+	double mr = *oxFlow / *fuelFlow;
+	double cStar = cStarMax * fmax (0.5, 1.0 - 0.1 * pow (mr - bestMR, 2));
+	double out = pc * PSI2PA * d.x[V_THROAT] / cStar;
+	return *fuelFlow + *oxFlow - out;
+}
+
+/*
+	Solves one grid point. Returns false if it fails a limit.
+*/
+static boolean solve (size_t index, Design &d)
+{
+	static thread_local EngineMath em;	// keeps the nozzle solution while the geometry repeats
+	for (int v = 0; v < V_COUNT; v++)
+	{
+		d.x[v] = sweepValue (v, index % sweep[v].steps);
+		index /= sweep[v].steps;
+	}
+	double la = orificeArea (d.x[V_LD]);
+	double ga = orificeArea (d.x[V_GD]);
+	double fuelFlow, oxFlow;
+	double lo = AMBIENT_PSI;
+	double hi = fmin (d.x[V_FUEL_TANK], d.x[V_OX_TANK]);
+	if ((hi <= lo) || (flowBalance (em, d, la, ga, lo, &fuelFlow, &oxFlow) <= 0))
+		return false;
+	for (int i = 0; i < SOLVER_STEPS; i++)
+	{
+		double mid = 0.5 * (lo + hi);
+		if (flowBalance (em, d, la, ga, mid, &fuelFlow, &oxFlow) > 0)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	double pc = 0.5 * (lo + hi);
+	flowBalance (em, d, la, ga, pc, &fuelFlow, &oxFlow);
+	d.pc = pc;
+	d.mr = oxFlow / fuelFlow;
+	d.flow = fuelFlow + oxFlow;
+	d.fuelStiffness = (d.x[V_FUEL_TANK] - pc) / pc;
+	d.oxStiffness = (d.x[V_OX_TANK] - pc) / pc;
+	if ((d.fuelStiffness < minStiffness) || (d.oxStiffness < minStiffness) || (d.mr < minMR) || (d.mr > maxMR))
+		return false;
+	d.thrust = em.nozzleThrust (kE, pc, AMBIENT_PSI, d.x[V_EXIT], d.x[V_THROAT]);
+	d.isp = d.thrust * LBF2N / (d.flow * G0);
+	return (d.thrust > 0);
+}
+
+static double tankPSI (const Design &d)
+{
+	return fmax (d.x[V_FUEL_TANK], d.x[V_OX_TANK]);
+}
+
+/*
+	True if 'a' is at least as good as 'b' in thrust, Isp and tank
+	pressure and better in one of them
+*/
+static boolean dominates (const Design &a, const Design &b)
+{
+	if ((a.thrust < b.thrust) || (a.isp < b.isp) || (tankPSI (a) > tankPSI (b)))
+		return false;
+	return (a.thrust > b.thrust) || (a.isp > b.isp) || (tankPSI (a) < tankPSI (b));
+}
+
+/*
+	Adds a design to a Pareto set, dropping any it dominates
+*/
+static void addToFront (std::vector<Design> &front, const Design &d)
+{
+	for (size_t i = 0; i < front.size (); i++)
+		if (dominates (front[i], d))
+			return;
+	size_t kept = 0;
+	for (size_t i = 0; i < front.size (); i++)
+		if (dominates (d, front[i]) == false)
+			front[kept++] = front[i];
+	front.resize (kept);
+	front.push_back (d);
+}
+
+/*
+	Work stealing pool. run() calls work (first, count, thread)
+	over [0, total) in blocks of at most BLOCK_SIZE.
+*/
+class StealingPool
+{
+	public:
+		StealingPool (int threads) : _threads (threads), _queues (threads) {}
+		template <class Work> void run (size_t total, Work work);
+		unsigned long getSteals () { return _steals; }
+	private:
+		struct Range { size_t first; size_t end; };
+		struct Queue { std::mutex lock; std::deque<Range> ranges; };
+		boolean take (int t, Range &r);
+		int _threads;
+		std::vector<Queue> _queues;
+		std::atomic<size_t> _done;
+		std::atomic<unsigned long> _steals;
+};
+
+/*
+	Takes the newest range of thread t's own queue, or else the
+	oldest range of another thread's queue
+*/
+boolean StealingPool::take (int t, Range &r)
+{
+	{
+		std::lock_guard<std::mutex> guard (_queues[t].lock);
+		if (_queues[t].ranges.empty () == false)
+		{
+			r = _queues[t].ranges.back ();
+			_queues[t].ranges.pop_back ();
+			return true;
+		}
+	}
+	for (int i = 1; i < _threads; i++)
+	{
+		Queue &victim = _queues[(t + i) % _threads];
+		std::lock_guard<std::mutex> guard (victim.lock);
+		if (victim.ranges.empty () == false)
+		{
+			r = victim.ranges.front ();
+			victim.ranges.pop_front ();
+			_steals++;
+			return true;
+		}
+	}
+	return false;
+}
+
+template <class Work> void StealingPool::run (size_t total, Work work)
+{
+	_done = 0;
+	_steals = 0;
+	for (int t = 0; t < _threads; t++)
+	{
+		Range r = { total * t / _threads, total * (t + 1) / _threads };
+		if (r.end > r.first)
+			_queues[t].ranges.push_back (r);
+	}
+	std::vector<std::thread> pool;
+	for (int t = 0; t < _threads; t++)
+	{
+		pool.push_back (std::thread ([this, t, total, &work] ()
+		{
+			Range r;
+			while (_done < total)
+			{
+				if (take (t, r) == false)
+				{
+					std::this_thread::yield ();
+					continue;
+				}
+				// keep the first block, leave the rest where others can take it
+				while (r.end - r.first > BLOCK_SIZE)
+				{
+					size_t mid = r.first + (r.end - r.first) / 2;
+					Range upper = { mid, r.end };
+					{
+						std::lock_guard<std::mutex> guard (_queues[t].lock);
+						_queues[t].ranges.push_back (upper);
+					}
+					r.end = mid;
+				}
+				work (r.first, r.end - r.first, t);
+				_done += r.end - r.first;
+			}
+		}));
+	}
+	for (size_t t = 0; t < pool.size (); t++)
+		pool[t].join ();
+}
+
+/*
+	Sweeps the grid. Returns the Pareto set and fills in the number
+	of designs that passed the limits.
+*/
+static std::vector<Design> runSweep (int threads, size_t *passed, std::vector<Design> *all, unsigned long *steals)
+{
+	size_t total = gridPoints ();
+	std::vector<std::vector<Design> > fronts (threads);
+	std::vector<std::vector<Design> > kept (threads);
+	std::vector<size_t> counts (threads, 0);
+	StealingPool pool (threads);
+	pool.run (total, [&] (size_t first, size_t count, int t)
+	{
+		Design d;
+		for (size_t i = first; i < first + count; i++)
+		{
+			if (solve (i, d) == false)
+				continue;
+			counts[t]++;
+			addToFront (fronts[t], d);
+			if (all != NULL)
+				kept[t].push_back (d);
+		}
+	});
+	*passed = 0;
+	for (int t = 0; t < threads; t++)
+	{
+		*passed += counts[t];
+		if (t > 0)
+			for (size_t i = 0; i < fronts[t].size (); i++)
+				addToFront (fronts[0], fronts[t][i]);
+		if (all != NULL)
+			all->insert (all->end (), kept[t].begin (), kept[t].end ());
+	}
+	if (steals != NULL)
+		*steals = pool.getSteals ();
+	return fronts[0];
+}
+
+static boolean byTankThenThrust (const Design &a, const Design &b)
+{
+	if (tankPSI (a) != tankPSI (b))
+		return tankPSI (a) < tankPSI (b);
+	return a.thrust < b.thrust;
+}
+
+static void printDesign (FILE *out, const Design &d, const char *sep)
+{
+	fprintf (out, "%.4f%s%.4f%s%.0f%s%.0f%s%.3f%s%.3f%s%.3g%s%.3g%s%.1f%s%.3f%s%.1f%s%.1f%s%.4f%s%.2f%s%.2f\n",
+		d.x[V_LD], sep, d.x[V_GD], sep, d.x[V_FUEL_TANK], sep, d.x[V_OX_TANK], sep, d.x[V_LCD], sep, d.x[V_GCD], sep,
+		d.x[V_THROAT], sep, d.x[V_EXIT], sep, d.pc, sep, d.mr, sep, d.thrust, sep, d.isp, sep, d.flow, sep,
+		d.fuelStiffness, sep, d.oxStiffness);
+}
+
+static const char *columns[] = { "ld", "gd", "fuelTankPSI", "oxTankPSI", "lcd", "gcd", "aThroatE", "aExitE",
+	"enginePSI", "O/F", "thrust(lbf)", "Isp(sec)", "flow(kg/sec)", "fuelStiff", "oxStiff" };
+
+/*
+	Applies a -g name=min:max:steps option
+*/
+static boolean setSweep (const char *option)
+{
+	const char *eq = strchr (option, '=');
+	if (eq == NULL)
+		return false;
+	for (int v = 0; v < V_COUNT; v++)
+	{
+		if ((strlen (sweep[v].name) != (size_t) (eq - option)) || (strncmp (sweep[v].name, option, eq - option) != 0))
+			continue;
+		double lo, hi;
+		int steps;
+		if ((sscanf (eq + 1, "%lf:%lf:%d", &lo, &hi, &steps) != 3) || (steps < 1))
+			return false;
+		sweep[v].min = lo;
+		sweep[v].max = hi;
+		sweep[v].steps = steps;
+		return true;
+	}
+	return false;
+}
+
+/*
+	Grid points per second on 1, 2, 4 ... 'maxThreads' threads
+*/
+static void benchmark (int maxThreads)
+{
+	size_t total = gridPoints ();
+	printf ("Threads  Points/sec  Speed up  Efficiency  Steals\n");
+	double base = 0;
+	for (int threads = 1; ; threads = (threads * 2 > maxThreads && threads < maxThreads) ? maxThreads : threads * 2)
+	{
+		size_t passed;
+		unsigned long steals;
+		auto start = std::chrono::steady_clock::now ();
+		runSweep (threads, &passed, NULL, &steals);
+		double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+		double rate = total / seconds;
+		if (threads == 1)
+			base = rate;
+		printf ("%7d  %10.0f  %8.2f  %9.0f%%  %6lu\n", threads, rate, rate / base, 100 * rate / base / threads, steals);
+		if (threads >= maxThreads)
+			break;
+	}
+}
+
+int main (int argc, char **argv)
+{
+	int threads = std::thread::hardware_concurrency ();
+	const char *csvName = NULL;
+	boolean bench = false;
+	for (int i = 1; i < argc; i++)
+	{
+		boolean hasValue = (i + 1 < argc);
+		if ((strcmp (argv[i], "-g") == 0) && hasValue)
+		{
+			if (setSweep (argv[++i]) == false)
+			{
+				fprintf (stderr, "bad sweep: %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if ((strcmp (argv[i], "-stiff") == 0) && hasValue)
+			minStiffness = atof (argv[++i]);
+		else if ((strcmp (argv[i], "-mr") == 0) && hasValue)
+		{
+			if (sscanf (argv[++i], "%lf:%lf", &minMR, &maxMR) != 2)
+			{
+				fprintf (stderr, "bad O/F range: %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if ((strcmp (argv[i], "-j") == 0) && hasValue)
+			threads = atoi (argv[++i]);
+		else if ((strcmp (argv[i], "-csv") == 0) && hasValue)
+			csvName = argv[++i];
+		else if (strcmp (argv[i], "-bench") == 0)
+			bench = true;
+		else
+		{
+			fprintf (stderr, "unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (threads < 1)
+		threads = 1;
+
+	printf ("Grid:\n");
+	for (int v = 0; v < V_COUNT; v++)
+		printf ("  %-12s %10.5g to %-10.5g %4d steps  %s\n", sweep[v].name, sweep[v].min, sweep[v].max, sweep[v].steps, sweep[v].note);
+	printf ("%lu points. Limits: stiffness >= %.2f, O/F %.2f to %.2f\n\n", (unsigned long) gridPoints (),
+		minStiffness, minMR, maxMR);
+	if (bench)
+	{
+		benchmark (threads);
+		return 0;
+	}
+
+	size_t passed;
+	unsigned long steals;
+	std::vector<Design> all;
+	auto start = std::chrono::steady_clock::now ();
+	std::vector<Design> front = runSweep (threads, &passed, (csvName != NULL) ? &all : NULL, &steals);
+	double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+	std::sort (front.begin (), front.end (), byTankThenThrust);
+
+	printf ("%lu designs pass, %lu are Pareto optimal (thrust, Isp, tank pressure)\n", (unsigned long) passed,
+		(unsigned long) front.size ());
+	printf ("%.2f sec on %d threads (%.0f points/sec, %lu steals)\n\n", seconds, threads, gridPoints () / seconds, steals);
+	for (size_t c = 0; c < sizeof (columns) / sizeof (columns[0]); c++)
+		printf ("%s%s", columns[c], (c + 1 < sizeof (columns) / sizeof (columns[0])) ? " " : "\n");
+	for (size_t i = 0; i < front.size (); i++)
+		printDesign (stdout, front[i], " ");
+
+	if (csvName != NULL)
+	{
+		FILE *csv = fopen (csvName, "w");
+		if (csv == NULL)
+		{
+			fprintf (stderr, "can't write %s\n", csvName);
+			return 1;
+		}
+		for (size_t c = 0; c < sizeof (columns) / sizeof (columns[0]); c++)
+			fprintf (csv, "%s%s", columns[c], (c + 1 < sizeof (columns) / sizeof (columns[0])) ? "," : "\n");
+		for (size_t i = 0; i < all.size (); i++)
+			printDesign (csv, all[i], ",");
+		fclose (csv);
+	}
+	return 0;
+}
@@ -0,0 +1,622 @@
+/*
+ Title: FailSafeSim.cpp
+  Description: Host tool that checks how long EngineController
+	takes to make the engine safe when the operator link is lost
+	or the code hangs. The sketch and its libraries are compiled
+	for the PC (as in Tools/TraceReplay) and run against a model:
+	a virtual clock advanced by what each call costs on the AVR,
+	a ground station that types the operator input and sends the
+	keep alive every heartbeatPeriod, steady sensor readings that
+	pass the redlines, a Maestro that reports the last target as
+	the position and a simulated watchdog. The watchdog counts
+	from the last wdt_reset() in the mode FailSafe::begin() wrote
+	to WDTCSR: the first timeout runs the watchdog interrupt (and
+	clears WDIE as the hardware does), the next one resets the
+	micro, after which setup() is run again.
+
+	The FailSafe checks run first: the link is lost exactly
+	heartbeatPeriod * heartbeatMissedMax after the last beat, a
+	kicked watchdog never fires and one that isn't interrupts at
+	the timeout and resets at twice it.
+	Then the firing sequence (menu option 5) is run with no
+	fault, with the longest accepted lead times, and with the
+	keep alives stopped, the loop stalled or the loop held up
+	(for longer than the watchdog interrupt but less than the
+	reset) in each phase of the start: countdown, igniter lead,
+	ox lead, igniter startup, main valve opening and firing. The time to safe is from the
+	last keep alive (link loss) or the start of the stall to the
+	moment the igniter and both solenoids are off and both
+	servos have been sent the close command. It must be within
+	heartbeatPeriod * heartbeatMissedMax plus one pass of the
+	loop for a lost link and within the watchdog timeout (the
+	nominal 128kHz oscillator, eg. 256ms for WDTO_250MS) plus the
+	time to send the two servo commands for a stall or a hold
+	up, nothing may open again afterwards, a stall must end in
+	a reset that setup() reports and a run that was held up must
+	be aborted when the loop comes back. A run with no fault
+	must not see the watchdog at all.
+	Each check prints PASS or FAIL and the exit status is the
+	number of failures.
+
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../BufferArena -I../../InputTrace -I../../EventJournal -I../../EngineMath -I../../Transducer -I../../ThermocoupleBank -I../../ChannelTable -I../../StopWatch -I../../SoftwareSerial -I../../PMCtrl -I../../ServoProfile -I../../LoadCell -I../../ImpulseCalc -I../../SafetyMonitor -I../../FastStop -I../../FailSafe -I../../SensorHealth -I../../SupplyMonitor -I../../SensorFilter -I../../TypeK -I../../ConfigStore -I../../ThrottleControl -I../../Propellant -x c++ -include Arduino.h ../../EngineController/EngineController.ino -x none FailSafeSim.cpp ../HostShim/HostArduino.cpp ../../BufferArena/BufferArena.cpp ../../InputTrace/InputTrace.cpp ../../EventJournal/EventJournal.cpp ../../EngineMath/EngineMath.cpp ../../Transducer/Transducer.cpp ../../Transducer/TransducerCal.cpp ../../ThermocoupleBank/ThermocoupleBank.cpp ../../ChannelTable/ChannelTable.cpp ../../StopWatch/StopWatch.cpp ../../PMCtrl/PMCtrl.cpp ../../ServoProfile/ServoProfile.cpp ../../LoadCell/LoadCell.cpp ../../ImpulseCalc/ImpulseCalc.cpp ../../SafetyMonitor/SafetyMonitor.cpp ../../FastStop/FastStop.cpp ../../FailSafe/FailSafe.cpp ../../SensorHealth/SensorHealth.cpp ../../SupplyMonitor/SupplyMonitor.cpp ../../SensorFilter/SensorFilter.cpp ../../TypeK/TypeK.cpp ../../ConfigStore/ConfigStore.cpp ../../ThrottleControl/ThrottleControl.cpp ../../Propellant/Propellant.cpp -o FailSafeSim
+	Usage:
+		FailSafeSim [-v]
+			-v prints the sketch output of every run
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "Arduino.h"
+#include "SoftwareSerial.h"
+#include "FailSafe.h"
+#include "ConfigStore.h"
+
+// EngineController.ino
+void setup ();
+void loop ();
+extern FailSafe failSafe;
+extern ConfigStore config;
+extern byte keepAliveChar;
+extern unsigned int heartbeatPeriod;
+extern byte heartbeatMissedMax;
+extern byte watchdogTimeout;
+extern unsigned int igniterLeadTime;
+extern unsigned int oxLeadTime;
+extern int igniterPin;
+extern int solenoidFuelValve;
+extern int solenoidOxValve;
+extern int servoClosed;
+extern unsigned char fuelChannel;
+extern unsigned char oxChannel;
+
+extern "C" void WDT_vect (void);
+
+#define LEAD_TIME_MAX 1000		// longest lead time configParams accepts (ms)
+#define LOOP_ALLOWANCE 50		// longest pass of a firing loop (ms), one CSV line and the reads
+#define CLOSE_SERVOS_MICROS 2500	// both servo close commands (12 bytes at 57600 baud) from the interrupt
+#define RUN_TIME "3000"			// ms the engine is fired for
+
+static int failures = 0;
+static boolean echo = false;
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-64s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+struct WatchdogReset {};		// thrown when the simulated watchdog resets the micro
+struct RunEnd {};				// thrown when a run is over
+
+enum Fault { FAULT_NONE, FAULT_LINK, FAULT_STALL, FAULT_HOLD };
+enum Phase { PHASE_COUNTDOWN, PHASE_IGNITER_LEAD, PHASE_OX_LEAD, PHASE_STARTUP, PHASE_MAIN_VALVES, PHASE_FIRING, PHASES };
+static const char *phaseNames[] = { "countdown", "igniter lead", "ox lead", "igniter startup", "main valves opening", "firing" };
+// when each fault is injected (ms after the phase starts), inside the phase with the default timing
+static const unsigned int phaseDelay[] = { 2000, 200, 30, 500, 100, 500 };
+
+/*
+	Model state. Times are virtual micros, 0 = not yet.
+*/
+static unsigned long long virtualMicros = 0;
+static unsigned long long wdtKicked = 0;
+static boolean inWatchdog = false;
+static unsigned int wdtInterrupts = 0;
+static unsigned long long wdtInterruptAt = 0;
+
+static Fault fault = FAULT_NONE;
+static Phase faultPhase = PHASE_COUNTDOWN;
+static unsigned long long phaseStart[PHASES];
+static unsigned long long faultAt = 0;		// fault injected
+static unsigned long long stallAt = 0;		// loop stopped
+static unsigned long long lastBeat = 0;		// last keep alive read by the sketch
+static unsigned long long linkLostAt = 0;	// "Link lost" printed
+static unsigned long long safeAt = 0;
+static boolean reopened = false;
+static unsigned long long igniterOffAt = 0;
+
+static const char *operatorInput = "";
+static unsigned long long nextKeyMicros = 0;
+static unsigned long long nextBeatMicros = 0;
+static unsigned long long endMicros = 0;
+static std::string output;
+static std::string outputLine;
+static unsigned long noise = 1;
+
+/*
+	Maestro stand-in: set target (0x04) is remembered and get
+	position (0x10) answers with the last target
+*/
+static byte maestroCommand[6];
+static byte maestroLength = 0;
+static unsigned int maestroTargets[24];
+static byte maestroReply[2];
+static byte maestroReplyLength = 0;
+
+SoftwareSerial::SoftwareSerial (uint8_t receivePin, uint8_t transmitPin, bool inverse_logic) {}
+SoftwareSerial::~SoftwareSerial () {}
+void SoftwareSerial::begin (long speed) {}
+bool SoftwareSerial::listen () { return true; }
+void SoftwareSerial::end () {}
+void SoftwareSerial::flush () {}
+
+size_t SoftwareSerial::write (uint8_t b)
+{
+	virtualMicros += 174;		// one byte at 57600 baud
+	if ((b == 0xAA) || (maestroLength >= sizeof (maestroCommand)))
+		maestroLength = 0;
+	maestroCommand[maestroLength++] = b;
+	byte channel = maestroCommand[3] % 24;
+	if ((maestroLength == 6) && (maestroCommand[2] == 0x04))
+		maestroTargets[channel] = maestroCommand[4] | (maestroCommand[5] << 7);
+	else if ((maestroLength == 4) && (maestroCommand[2] == 0x10))
+	{
+		maestroReply[0] = maestroTargets[channel] & 0xFF;
+		maestroReply[1] = maestroTargets[channel] >> 8;
+		maestroReplyLength = 2;
+	}
+	else if ((maestroLength == 3) && (maestroCommand[2] == 0x21))
+	{
+		maestroReply[0] = 0;
+		maestroReply[1] = 0;
+		maestroReplyLength = 2;
+	}
+	return 1;
+}
+
+int SoftwareSerial::available ()
+{
+	return maestroReplyLength;
+}
+
+int SoftwareSerial::peek ()
+{
+	return (maestroReplyLength > 0) ? maestroReply[2 - maestroReplyLength] : -1;
+}
+
+int SoftwareSerial::read ()
+{
+	int b = peek ();
+	if (maestroReplyLength > 0)
+		maestroReplyLength--;
+	return b;
+}
+
+/*
+	Watchdog timeout of the prescaler in WDTCSR: 2048 cycles of the
+	128kHz oscillator doubled per step
+*/
+static unsigned long long watchdogMicros (byte prescale)
+{
+	return 16000ULL << prescale;
+}
+
+static unsigned long long watchdogMicros ()
+{
+	return watchdogMicros ((WDTCSR & 0x07) | ((WDTCSR & _BV(WDP3)) ? 0x08 : 0));
+}
+
+static void simWdtReset ()
+{
+	wdtKicked = virtualMicros;
+}
+
+/*
+	Runs the watchdog interrupt or resets the micro once the
+	timeout has passed since the last wdt_reset()
+*/
+static void checkWatchdog ()
+{
+	if (((WDTCSR & (_BV(WDE) | _BV(WDIE))) == 0) || (inWatchdog == true))
+		return;
+	if (virtualMicros - wdtKicked < watchdogMicros ())
+		return;
+	wdtKicked = virtualMicros;
+	if ((WDTCSR & _BV(WDIE)) != 0)
+	{
+		WDTCSR &= ~_BV(WDIE);		// cleared by the hardware as the interrupt runs
+		wdtInterrupts++;
+		if (wdtInterruptAt == 0)
+			wdtInterruptAt = virtualMicros;
+		inWatchdog = true;
+		WDT_vect ();
+		inWatchdog = false;
+	}
+	else
+		throw WatchdogReset ();
+}
+
+static boolean isHigh (int pin)
+{
+	return (*portOutputRegister (digitalPinToPort (pin)) & digitalPinToBitMask (pin)) != 0;
+}
+
+static boolean isServoClosed (unsigned char channel)
+{
+	return maestroTargets[channel] == (unsigned int) servoClosed * 4;
+}
+
+/*
+	Follows the firing sequence from the pins and servo targets,
+	injects the fault and times the shutdown
+*/
+static void watchPins ()
+{
+	boolean igniter = isHigh (igniterPin);
+	boolean ox = isHigh (solenoidOxValve);
+	boolean fuel = isHigh (solenoidFuelValve);
+	if ((phaseStart[PHASE_IGNITER_LEAD] == 0) && igniter)
+		phaseStart[PHASE_IGNITER_LEAD] = virtualMicros;
+	if ((phaseStart[PHASE_OX_LEAD] == 0) && ox)
+		phaseStart[PHASE_OX_LEAD] = virtualMicros;
+	if ((phaseStart[PHASE_STARTUP] == 0) && fuel)
+		phaseStart[PHASE_STARTUP] = virtualMicros;
+	if ((phaseStart[PHASE_MAIN_VALVES] == 0) && (phaseStart[PHASE_STARTUP] != 0) && !isServoClosed (fuelChannel))
+		phaseStart[PHASE_MAIN_VALVES] = virtualMicros;
+	if ((phaseStart[PHASE_FIRING] == 0) && (phaseStart[PHASE_MAIN_VALVES] != 0) && igniter && !fuel && !ox)
+		phaseStart[PHASE_FIRING] = virtualMicros;
+	if ((igniterOffAt == 0) && (phaseStart[PHASE_IGNITER_LEAD] != 0) && !igniter)
+		igniterOffAt = virtualMicros;
+
+	if ((fault != FAULT_NONE) && (faultAt == 0) && (phaseStart[faultPhase] != 0) &&
+		(virtualMicros >= phaseStart[faultPhase] + phaseDelay[faultPhase] * 1000ULL))
+		faultAt = virtualMicros;
+
+	boolean closed = !igniter && !ox && !fuel && isServoClosed (fuelChannel) && isServoClosed (oxChannel);
+	boolean tripped = (linkLostAt != 0) || (wdtInterruptAt != 0);
+	if ((faultAt != 0) && (safeAt == 0) && tripped && closed)
+		safeAt = virtualMicros;
+	if ((safeAt != 0) && !closed)
+		reopened = true;
+}
+
+static unsigned long simMicros ()
+{
+	virtualMicros += 4;
+	checkWatchdog ();
+	watchPins ();
+	return (unsigned long) virtualMicros;
+}
+
+static void simDelay (unsigned long us)
+{
+	unsigned long long end = virtualMicros + us;
+	while (virtualMicros < end)
+		simMicros ();
+}
+
+/*
+	Pressures near 100psi on the igniter and engine (inside the
+	redlines and above the no-go limits), 300psi on the feeds, a
+	count of noise so no channel looks stuck
+*/
+static int simAnalogRead (uint8_t pin)
+{
+	virtualMicros += 112;		// one conversion
+	noise = noise * 1103515245UL + 12345;
+	int level = ((pin == A0) || (pin == A1)) ? 348 : 184;
+	return level + (int) ((noise >> 16) % 3) - 1;
+}
+
+/*
+	Ground station: the operator input one key per 50ms and a keep
+	alive every heartbeatPeriod until the link is cut. A stall
+	or a hold up starts here, as the loop is always polling the
+	link. A hold up lasts one and a half watchdog timeouts.
+*/
+static int simSerialRead ()
+{
+	simMicros ();
+	if ((fault == FAULT_STALL) && (faultAt != 0))
+	{
+		stallAt = virtualMicros;
+		for (;;)
+			simMicros ();
+	}
+	if ((fault == FAULT_HOLD) && (faultAt != 0) && (stallAt == 0))
+	{
+		stallAt = virtualMicros;
+		while (virtualMicros - stallAt < watchdogMicros (watchdogTimeout) * 3 / 2)
+			simMicros ();
+	}
+	if (virtualMicros >= endMicros)
+		throw RunEnd ();
+	if ((*operatorInput != '\0') && (virtualMicros >= nextKeyMicros))
+	{
+		nextKeyMicros = virtualMicros + 50000;
+		return *operatorInput++;
+	}
+	if ((virtualMicros >= nextBeatMicros) && !((fault == FAULT_LINK) && (faultAt != 0)))
+	{
+		nextBeatMicros = virtualMicros + heartbeatPeriod * 1000ULL;
+		lastBeat = virtualMicros;
+		return keepAliveChar;
+	}
+	return -1;
+}
+
+/*
+	Output. "Starting Engine in" and "Link lost" are watched for as
+	they are printed (the countdown line only ends after it).
+*/
+static boolean endsWith (const std::string &text, const char *tail)
+{
+	size_t length = strlen (tail);
+	return (text.size () >= length) && (text.compare (text.size () - length, length, tail) == 0);
+}
+
+static void simSerialWrite (uint8_t c)
+{
+	virtualMicros += 174;		// one character at 57600 baud
+	output += (char) c;
+	if (echo)
+		putchar (c);
+	if (c == '\n')
+		outputLine.clear ();
+	else
+		outputLine += (char) c;
+	if ((phaseStart[PHASE_COUNTDOWN] == 0) && endsWith (outputLine, "Starting Engine in"))
+		phaseStart[PHASE_COUNTDOWN] = virtualMicros;
+	if ((linkLostAt == 0) && endsWith (outputLine, "Link lost"))
+		linkLostAt = virtualMicros;
+}
+
+/*
+	Powers up the model and the micro
+*/
+static void powerUp (boolean watchdogReset)
+{
+	PORTB = PORTC = PORTD = 0;
+	if (watchdogReset)
+	{
+		MCUSR = _BV(WDRF);
+		WDTCSR = _BV(WDE);				// left running, shortest timeout
+	}
+	else
+	{
+		MCUSR = 0;
+		WDTCSR = 0;
+	}
+	wdtKicked = virtualMicros;
+	maestroTargets[fuelChannel] = servoClosed * 4;
+	maestroTargets[oxChannel] = servoClosed * 4;
+}
+
+/*
+	Runs the sketch until the run is over or the watchdog resets
+	it. Returns true on a reset.
+*/
+static boolean run (const char *input, double seconds)
+{
+	operatorInput = input;
+	nextKeyMicros = virtualMicros + 1000000;
+	nextBeatMicros = virtualMicros;
+	endMicros = virtualMicros + (unsigned long long) (seconds * 1e6);
+	output.clear ();
+	outputLine.clear ();
+	memset (phaseStart, 0, sizeof (phaseStart));
+	faultAt = stallAt = lastBeat = linkLostAt = safeAt = igniterOffAt = 0;
+	wdtInterrupts = 0;
+	wdtInterruptAt = 0;
+	reopened = false;
+	powerUp (false);
+	try
+	{
+		setup ();
+		for (;;)
+			loop ();
+	}
+	catch (RunEnd &)
+	{
+		return false;
+	}
+	catch (WatchdogReset &)
+	{
+	}
+	// the micro restarts. setup() must turn the watchdog off before
+	// it resets again and report why it restarted.
+	output.clear ();
+	powerUp (true);
+	endMicros = virtualMicros + 100000;
+	try
+	{
+		setup ();
+	}
+	catch (WatchdogReset &)
+	{
+		output = "(reset again)";
+	}
+	return true;
+}
+
+/*
+	FailSafe on its own
+*/
+static void testFailSafe ()
+{
+	char check[128];
+	unsigned long long beatMicros = heartbeatPeriod * 1000ULL * heartbeatMissedMax;
+	unsigned long long timeout = watchdogMicros (watchdogTimeout);
+	powerUp (false);
+	endMicros = ~0ULL;
+	setup ();				// the pins the watchdog interrupt closes
+
+	failSafe.begin (watchdogTimeout);
+	failSafe.isKeepAlive (keepAliveChar);
+	unsigned long long beat = virtualMicros;
+	while (virtualMicros - beat < beatMicros - 1000)
+	{
+		simMicros ();
+		failSafe.kick ();
+	}
+	boolean early = failSafe.isLinkLost ();
+	while (virtualMicros - beat < beatMicros)
+	{
+		simMicros ();
+		failSafe.kick ();
+	}
+	snprintf (check, sizeof (check), "link lost %llums after the last beat, not before", beatMicros / 1000);
+	result (check, (early == false) && (failSafe.isLinkLost () == true));
+	failSafe.isKeepAlive (keepAliveChar);
+	result ("a beat restores the link", failSafe.isLinkLost () == false);
+
+	wdtInterrupts = 0;
+	wdtInterruptAt = 0;
+	unsigned long long start = virtualMicros;
+	unsigned long long nextKick = start;
+	while (virtualMicros - start < 4 * timeout)
+	{
+		simMicros ();
+		if (virtualMicros >= nextKick)
+		{
+			failSafe.kick ();
+			nextKick += 200000;
+		}
+	}
+	snprintf (check, sizeof (check), "kicked every 200ms the watchdog (%llums) never fires", timeout / 1000);
+	result (check, wdtInterrupts == 0);
+
+	PORTB = 0xFF;
+	start = virtualMicros;
+	failSafe.kick ();
+	unsigned long long resetAt = 0;
+	try
+	{
+		for (;;)
+			simMicros ();
+	}
+	catch (WatchdogReset &)
+	{
+		resetAt = virtualMicros;
+	}
+	snprintf (check, sizeof (check), "stalled: interrupt at %.1fms, valves closed, reset at %.1fms",
+		(wdtInterruptAt - start) / 1000.0, (resetAt - start) / 1000.0);
+	result (check, (wdtInterrupts == 1) && (wdtInterruptAt - start <= timeout) && (resetAt - start <= 2 * timeout) &&
+		!isHigh (igniterPin) && !isHigh (solenoidOxValve) && !isHigh (solenoidFuelValve));
+	powerUp (true);
+	result ("bootCheck reports the watchdog reset and stops it", (FailSafe::bootCheck () == true) && (WDTCSR == 0));
+
+	failSafe.begin (watchdogTimeout);
+	failSafe.end ();
+	wdtInterrupts = 0;
+	start = virtualMicros;
+	while (virtualMicros - start < 4 * timeout)
+		simMicros ();
+	result ("end() stops the watchdog", wdtInterrupts == 0);
+}
+
+/*
+	The firing sequence with no fault
+*/
+static void testFiring (const char *name)
+{
+	char check[128];
+	fault = FAULT_NONE;
+	boolean reset = run ("5/" RUN_TIME "/", 14);
+	unsigned long long igniterLead = phaseStart[PHASE_OX_LEAD] - phaseStart[PHASE_IGNITER_LEAD];
+	unsigned long long oxLead = phaseStart[PHASE_STARTUP] - phaseStart[PHASE_OX_LEAD];
+	snprintf (check, sizeof (check), "%s: no watchdog interrupt or reset", name);
+	result (check, (wdtInterrupts == 0) && (reset == false));
+	snprintf (check, sizeof (check), "%s: leads %.1f/%.1fms (%u/%u)", name, igniterLead / 1000.0, oxLead / 1000.0,
+		igniterLeadTime, oxLeadTime);
+	result (check, (phaseStart[PHASE_STARTUP] != 0) && (igniterLead >= igniterLeadTime * 1000ULL) &&
+		(igniterLead < igniterLeadTime * 1000ULL + LOOP_ALLOWANCE * 1000) &&
+		(oxLead >= oxLeadTime * 1000ULL) && (oxLead < oxLeadTime * 1000ULL + LOOP_ALLOWANCE * 1000));
+	snprintf (check, sizeof (check), "%s: igniter on through the start, run completes", name);
+	result (check, (phaseStart[PHASE_FIRING] != 0) && (igniterOffAt > phaseStart[PHASE_FIRING]) &&
+		(output.find ("Run Complete") != std::string::npos));
+}
+
+/*
+	The firing sequence with a fault in one phase
+*/
+static void testFault (Fault kind, Phase phase)
+{
+	char check[160];
+	fault = kind;
+	faultPhase = phase;
+	boolean reset = run ("5/" RUN_TIME "/", 14);
+	const char *what = (kind == FAULT_LINK) ? "link lost" : (kind == FAULT_STALL) ? "stalled" : "held up";
+	if (faultAt == 0)
+	{
+		snprintf (check, sizeof (check), "%s in %s: fault injected", what, phaseNames[phase]);
+		result (check, false);
+		return;
+	}
+	if (kind == FAULT_LINK)
+	{
+		unsigned long long limit = heartbeatPeriod * 1000ULL * heartbeatMissedMax + LOOP_ALLOWANCE * 1000;
+		unsigned long long toSafe = safeAt - lastBeat;
+		snprintf (check, sizeof (check), "%s in %s: safe %.1fms after the last beat (%llu)", what, phaseNames[phase],
+			toSafe / 1000.0, limit / 1000);
+		result (check, (safeAt != 0) && (toSafe <= limit) && (reset == false));
+	}
+	else if (kind == FAULT_HOLD)
+	{
+		unsigned long long limit = watchdogMicros (watchdogTimeout) + CLOSE_SERVOS_MICROS;
+		unsigned long long toSafe = safeAt - stallAt;
+		snprintf (check, sizeof (check), "%s in %s: safe %.1fms after the hold up (%.1f)", what, phaseNames[phase],
+			toSafe / 1000.0, limit / 1000.0);
+		result (check, (stallAt != 0) && (safeAt != 0) && (toSafe <= limit));
+		snprintf (check, sizeof (check), "%s in %s: run aborted, no reset", what, phaseNames[phase]);
+		result (check, (reset == false) && (output.find ("Watchdog tripped. Aborting") != std::string::npos) &&
+			(output.find ("Run Complete") == std::string::npos));
+	}
+	else
+	{
+		unsigned long long limit = watchdogMicros (watchdogTimeout) + CLOSE_SERVOS_MICROS;
+		unsigned long long toSafe = safeAt - stallAt;
+		snprintf (check, sizeof (check), "%s in %s: safe %.1fms after the stall (%.1f)", what, phaseNames[phase],
+			toSafe / 1000.0, limit / 1000.0);
+		result (check, (stallAt != 0) && (safeAt != 0) && (toSafe <= limit));
+		snprintf (check, sizeof (check), "%s in %s: reset, reported at boot", what, phaseNames[phase]);
+		result (check, reset && (output.find ("Reset by watchdog") != std::string::npos));
+	}
+	snprintf (check, sizeof (check), "%s in %s: nothing opens again", what, phaseNames[phase]);
+	result (check, reopened == false);
+}
+
+int main (int argc, char *argv[])
+{
+	if ((argc == 2) && (strcmp (argv[1], "-v") == 0))
+		echo = true;
+	else if (argc != 1)
+	{
+		fprintf (stderr, "Usage: FailSafeSim [-v]\n");
+		return 1;
+	}
+	hostMicros = simMicros;
+	hostDelay = simDelay;
+	hostAnalogRead = simAnalogRead;
+	hostSerialRead = simSerialRead;
+	hostSerialWrite = simSerialWrite;
+	hostWdtReset = simWdtReset;
+
+	testFailSafe ();
+	testFiring ("firing");
+	for (byte phase = PHASE_COUNTDOWN; phase < PHASES; phase++)
+		testFault (FAULT_LINK, (Phase) phase);
+	for (byte phase = PHASE_COUNTDOWN; phase < PHASES; phase++)
+		testFault (FAULT_STALL, (Phase) phase);
+	for (byte phase = PHASE_COUNTDOWN; phase < PHASES; phase++)
+		testFault (FAULT_HOLD, (Phase) phase);
+
+	unsigned int defaultIgniterLead = igniterLeadTime;
+	unsigned int defaultOxLead = oxLeadTime;
+	int igniterRow = config.find ("igniterLeadTime");
+	int oxRow = config.find ("oxLeadTime");
+	char check[128];
+	snprintf (check, sizeof (check), "lead times over %dms are refused", LEAD_TIME_MAX);
+	result (check, (igniterRow >= 0) && (oxRow >= 0) && (config.set (igniterRow, LEAD_TIME_MAX + 1) == false) &&
+		(config.set (oxRow, LEAD_TIME_MAX + 1) == false));
+	if ((igniterRow >= 0) && (oxRow >= 0) && config.set (igniterRow, LEAD_TIME_MAX) && config.set (oxRow, LEAD_TIME_MAX))
+		testFiring ("longest leads");
+	igniterLeadTime = defaultIgniterLead;
+	oxLeadTime = defaultOxLead;
+
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
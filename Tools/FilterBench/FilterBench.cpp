@@ -0,0 +1,208 @@
+/*
+ Title: FilterBench.cpp
+  Description: Host tool that checks the SensorFilter library
+	using the same code that runs on the Arduino:
+		(1) frequency response - a sine at each test frequency
+			is run through the fixed point BiquadFilter and the
+			measured gain is compared with the ideal Butterworth
+			response (bilinear transform)
+		(2) spike rejection - single and double sample spikes 
+			on a step are run through the MedianFilter
+		(3) DecimatingFIR - DC gain and output rate
+		(4) cost per sample of each filter on this PC (for the 
+			cost on the micro run the SensorFilter demo sketch)
+	Each check prints PASS or FAIL and the exit status is the
+	number of failures.
+	
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../SensorFilter FilterBench.cpp ../../SensorFilter/SensorFilter.cpp -o FilterBench
+	Usage:
+		FilterBench [cutoffHz] [sampleHz]
+			defaults are 5Hz and 40Hz (EngineController settings)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "Arduino.h"
+#include "SensorFilter.h"
+
+static int failures = 0;
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-48s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+/*
+	Gain of the ideal Butterworth low-pass after the bilinear
+	transform (the frequency axis is pre-warped by tan)
+*/
+static double idealGain (double hz, double cutoffHz, double sampleHz)
+{
+	double r = tan (M_PI * hz / sampleHz) / tan (M_PI * cutoffHz / sampleHz);
+	return 1.0 / sqrt (1.0 + r * r * r * r);
+}
+
+/*
+	Runs a 300 count sine around mid scale through a new filter.
+	Once settled, the output amplitude over a whole number of 
+	cycles is found by correlating with sin and cos (the samples
+	rarely land on the peaks) and divided by the input amplitude.
+*/
+static double measuredGain (double hz, double cutoffHz, double sampleHz)
+{
+	BiquadFilter f (cutoffHz, sampleHz);
+	const double amplitude = 300.0;
+	int settle = (int) (20.0 * sampleHz / cutoffHz) + 200;
+	int measure = (int) lround (50.0 * sampleHz / hz);
+	double sumSin = 0, sumCos = 0;
+	for (int n = 0; n < settle + measure; n++)
+	{
+		double phase = 2.0 * M_PI * hz * n / sampleHz;
+		int raw = (int) lround (512.0 + amplitude * sin (phase));
+		int y = f.filter (raw);
+		if (n >= settle)
+		{
+			sumSin += (y - 512) * sin (phase);
+			sumCos += (y - 512) * cos (phase);
+		}
+	}
+	return 2.0 * sqrt (sumSin * sumSin + sumCos * sumCos) / measure / amplitude;
+}
+
+static void frequencyResponse (double cutoffHz, double sampleHz)
+{
+	BiquadFilter f (cutoffHz, sampleHz);
+	printf ("Biquad low-pass, cutoff %.2fHz, sample rate %.2fHz\n", cutoffHz, sampleHz);
+	printf ("%10s %10s %10s %10s\n", "Hz", "ideal", "design", "measured");
+	bool pass = true;
+	double fractions[] = {0.0, 0.25, 0.5, 0.75, 1.0, 1.5, 2.0, 3.0};
+	for (unsigned i = 0; i < sizeof (fractions) / sizeof (fractions[0]); i++)
+	{
+		double hz = fractions[i] * cutoffHz;
+		if (hz >= sampleHz / 2)
+			break;
+		double ideal = idealGain (hz, cutoffHz, sampleHz);
+		double design = f.getGain (hz, sampleHz);
+		double measured = (hz == 0) ? 1.0 : measuredGain (hz, cutoffHz, sampleHz);
+		printf ("%10.2f %10.4f %10.4f %10.4f\n", hz, ideal, design, measured);
+		// allow for coefficient rounding and +/-1 count of output rounding
+		if (fabs (design - ideal) > 0.02 || fabs (measured - design) > 0.02 + 1.0 / 300.0)
+			pass = false;
+	}
+	result ("biquad matches Butterworth response", pass);
+	
+	// a full scale step must follow the floating point filter and
+	// settle on the input exactly (DC gain of 1)
+	double k = tan (M_PI * cutoffHz / sampleHz);
+	double norm = 1.0 / (1.0 + M_SQRT2 * k + k * k);
+	double b0 = k * k * norm, a1 = 2.0 * (k * k - 1.0) * norm;
+	double a2 = (1.0 - M_SQRT2 * k + k * k) * norm;
+	double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+	BiquadFilter step (cutoffHz, sampleHz);
+	step.filter (0);
+	int y = 0, peak = 0;
+	double worst = 0, refPeak = 0;
+	for (int n = 0; n < (int) (50.0 * sampleHz / cutoffHz); n++)
+	{
+		double ref = b0 * (1023 + 2 * x1 + x2) - a1 * y1 - a2 * y2;
+		x2 = x1; x1 = 1023; y2 = y1; y1 = ref;
+		y = step.filter (1023);
+		if (y > peak) peak = y;
+		if (ref > refPeak) refPeak = ref;
+		if (fabs (y - ref) > worst) worst = fabs (y - ref);
+	}
+	printf ("step 0 -> 1023: final %d, peak %d (floating point %.1f), worst error %.2f counts\n", 
+		y, peak, refPeak, worst);
+	result ("biquad unity DC gain", y == 1023);
+	result ("biquad step within 3 counts of floating point", worst <= 3.0);
+}
+
+static void spikeRejection ()
+{
+	int input[] = {100, 100, 100, 900, 100, 100, 0, 0, 100, 100, 500, 500, 500, 500, 500, 500};
+	int n = sizeof (input) / sizeof (input[0]);
+	MedianFilter m3 (3), m5 (5);
+	bool pass = true;
+	printf ("%6s %6s %6s\n", "raw", "med3", "med5");
+	for (int i = 0; i < n; i++)
+	{
+		int y3 = m3.filter (input[i]);
+		int y5 = m5.filter (input[i]);
+		printf ("%6d %6d %6d\n", input[i], y3, y5);
+		if (i < 10 && y5 != 100)
+			pass = false;
+		if (i == 3 && y3 != 100)
+			pass = false;
+	}
+	result ("median(5) removes 1 and 2 sample spikes", pass);
+	result ("median(3) removes 1 sample spikes", pass);
+	result ("median(5) passes a step", m5.filter (500) == 500);
+}
+
+static void decimation ()
+{
+	const int taps[] = {1024, 2624, 4832, 7904, 7904, 4832, 2624, 1024};
+	DecimatingFIR fir (taps, 8, 4);
+	int outputs = 0, last = 0;
+	for (int i = 0; i < 400; i++)
+	{
+		if (fir.add (700) == true)
+		{
+			outputs++;
+			last = fir.getOutput ();
+		}
+	}
+	printf ("FIR: %d outputs from 400 samples, DC output %d\n", outputs, last);
+	result ("fir decimates by 4", outputs == 100);
+	result ("fir unity DC gain", last == 700);
+}
+
+/*
+	Nanoseconds per sample of filter 'f' over a noisy input
+*/
+template <typename F> static double cost (F &f)
+{
+	const int samples = 10000000;
+	volatile int sink = 0;
+	clock_t start = clock ();
+	for (int i = 0; i < samples; i++)
+		sink = f (512 + (i * 37 & 63));
+	(void) sink;
+	return 1e9 * (clock () - start) / CLOCKS_PER_SEC / samples;
+}
+
+static void benchmark (double cutoffHz, double sampleHz)
+{
+	MedianFilter m (5);
+	BiquadFilter b (cutoffHz, sampleHz);
+	SensorFilter s (3, cutoffHz, sampleHz);
+	const int taps[] = {1024, 2624, 4832, 7904, 7904, 4832, 2624, 1024};
+	DecimatingFIR d (taps, 8, 4);
+	auto med = [&] (int x) { return m.filter (x); };
+	auto bq = [&] (int x) { return b.filter (x); };
+	auto chain = [&] (int x) { return s.filter (x); };
+	auto fir = [&] (int x) { return (int) d.add (x); };
+	printf ("cost per sample on this PC (ns): median(5) %.1f, biquad %.1f, median(3)+biquad %.1f, fir(8)/4 %.1f\n",
+		cost (med), cost (bq), cost (chain), cost (fir));
+}
+
+int main (int argc, char *argv[])
+{
+	double cutoffHz = (argc > 1) ? atof (argv[1]) : 5.0;
+	double sampleHz = (argc > 2) ? atof (argv[2]) : 40.0;
+	
+	frequencyResponse (cutoffHz, sampleHz);
+	printf ("\n");
+	spikeRejection ();
+	printf ("\n");
+	decimation ();
+	printf ("\n");
+	benchmark (cutoffHz, sampleHz);
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
@@ -0,0 +1,601 @@
+/*
+ Title: FlowUncertainty.cpp
+  Description: Host tool that puts error bars on the flows and
+	calculated thrust of a recorded burn. The discharge
+	coefficients, gas properties, orifice and nozzle sizes and
+	the transducer readings EngineController uses are not known
+	exactly, so the fuelFlow, oxFlow, engineFlow and
+	engineForceCalc columns of the log are only as good as those
+	guesses. This tool recalculates them from the logged
+	pressures with EngineMath (the same code that runs on the
+	Arduino) for thousands of draws of the uncertain inputs
+	(Monte Carlo) and reports:
+		(1) the burn totals (propellant masses, O/F, calculated
+			impulse, Isp and C*, integrated with ImpulseCalc as
+			burnSummary does) with their confidence interval
+		(2) optionally the confidence band of each flow and
+			thrust column at every sample (-csv), for plotting
+	Each draw picks one value of every input and holds it for
+	the whole burn, as an error in a Cd or a transducer offset
+	would be. The transducer error is taken as an offset within
+	the +/-2% of full scale (1000 psi) accuracy of the SSI and
+	MSI transducers. Random noise from sample to sample is
+	already in the log and is not added again.
+
+	Every draw has its own random stream (seeded from the seed
+	and the draw number), so the results are the same for any
+	number of threads. The work is split into small blocks that
+	threads take as they finish the last one, once over the
+	samples for the bands and once over the draws for the
+	totals.
+
+	The nominal values are the EngineController defaults. If the
+	log was recorded with other values set them with -p so the
+	nominal recalculation matches the log (the largest
+	difference is printed as a check).
+
+	Build (from this directory):
+		g++ -O2 -pthread -I../HostShim -I../../EngineMath -I../../ImpulseCalc FlowUncertainty.cpp ../../EngineMath/EngineMath.cpp ../../ImpulseCalc/ImpulseCalc.cpp -o FlowUncertainty
+	Usage:
+		FlowUncertainty [options] < burn.csv
+			-n draws		number of draws (default 10000)
+			-j threads		default all cores
+			-s seed			default 1
+			-c percent		confidence interval (default 95)
+			-b burn			burn number in the log (default 1)
+			-csv file		writes the bands at every sample
+			-p name=spec	changes an input:
+								value			fixed
+								n:mean:sd		normal
+								u:min:max		uniform
+							eg. -p gcd=u:0.3:0.5 -p ld=0.025
+							A fixed value or normal mean is also
+							used as the nominal value.
+			-list			lists the inputs and their spread
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "Arduino.h"
+#include "EngineMath.h"
+#include "ImpulseCalc.h"
+
+#define DIST_FIXED 0
+#define DIST_NORMAL 1
+#define DIST_UNIFORM 2
+
+#define BLOCK_SIZE 16		// samples or draws taken by a thread at a time
+
+typedef struct
+{
+	const char *name;
+	float nominal;
+	byte dist;
+	float a;				// sd (normal) or min (uniform)
+	float b;				// max (uniform)
+	const char *note;
+} UncertainInput;
+
+// Inputs in the order of the draw vector. Nominal values are the
+// EngineController defaults.
+enum { IN_LCD, IN_LDEN, IN_LD, IN_GCD, IN_GK, IN_GZ, IN_GTEMP, IN_GM, IN_GD,
+	IN_KE, IN_ATHROAT, IN_AEXIT, IN_P2, IN_P3, IN_FUEL_PSI, IN_OX_PSI, IN_ENGINE_PSI, IN_COUNT };
+
+static UncertainInput inputs[IN_COUNT] =
+{
+	// name			nominal		dist			a			b			note
+	{ "lcd",		0.7,		DIST_UNIFORM,	0.47,		0.75,		"fuel Cd (guesses 0.47 - 0.7)" },
+	{ "lden",		800,		DIST_NORMAL,	8,			0,			"fuel density kg/m^3" },
+	{ "ld",			0.023,		DIST_UNIFORM,	0.022,		0.024,		"fuel orifice diameter in (drill +/-0.001)" },
+	{ "gcd",		0.32,		DIST_UNIFORM,	0.25,		0.40,		"ox Cd" },
+	{ "gk",			1.40,		DIST_FIXED,		0,			0,			"ox specific heat ratio" },
+	{ "gz",			0.98,		DIST_UNIFORM,	0.975,		0.99,		"ox compressibility" },
+	{ "gtemp",		277.0,		DIST_NORMAL,	5,			0,			"ox inlet temperature K" },
+	{ "gm",			32,			DIST_FIXED,		0,			0,			"ox molecular mass" },
+	{ "gd",			0.141,		DIST_UNIFORM,	0.140,		0.142,		"ox orifice diameter in (drill +/-0.001)" },
+	{ "kE",			1.22,		DIST_UNIFORM,	1.18,		1.26,		"engine specific heat ratio" },
+	{ "aThroatE",	0.00017,	DIST_NORMAL,	0.0000017,	0,			"throat area m^2 (1%)" },
+	{ "aExitE",		0.00038,	DIST_NORMAL,	0.0000038,	0,			"exit area m^2 (1%)" },
+	{ "p2PSI",		0,			DIST_FIXED,		0,			0,			"exit pressure psi (0 = from area ratio)" },
+	{ "p3PSI",		14.696,		DIST_FIXED,		0,			0,			"atmospheric pressure psi" },
+	{ "fuelPSI",	0,			DIST_UNIFORM,	-20,		20,			"fuel transducer offset psi (2% FSO)" },
+	{ "oxPSI",		0,			DIST_UNIFORM,	-20,		20,			"ox transducer offset psi (2% FSO)" },
+	{ "enginePSI",	0,			DIST_UNIFORM,	-20,		20,			"engine transducer offset psi (2% FSO)" }
+};
+
+// Recalculated columns
+enum { OUT_FUEL_FLOW, OUT_OX_FLOW, OUT_ENGINE_FLOW, OUT_FORCE_CALC, OUT_COUNT };
+static const char *outputNames[OUT_COUNT] = { "fuelFlow(kg/sec)", "oxFlow(kg/sec)", "engineFlow(kg/sec)", "engineForceCalc(lbf)" };
+
+// Burn totals
+enum { TOT_FUEL_MASS, TOT_OX_MASS, TOT_MIXTURE, TOT_IMPULSE_CALC, TOT_ISP_CALC, TOT_CSTAR, TOT_COUNT };
+static const char *totalNames[TOT_COUNT] = { "Fuel Mass (kg)", "Ox Mass (kg)", "O/F", "Calc. Impulse (N-sec)", "Calc. Isp (sec)", "C* (m/sec)" };
+
+typedef struct
+{
+	unsigned long millis;
+	float fuelPSI;
+	float oxPSI;
+	float enginePSI;
+	float forceSensor;
+	float logged[OUT_COUNT];
+} Sample;
+
+static std::vector<Sample> samples;
+
+/*
+	Random stream of one draw (splitmix64)
+*/
+class DrawRandom
+{
+	public:
+		DrawRandom (uint64_t seed, uint64_t draw) { _state = seed * 0x9E3779B97F4A7C15ULL + draw; next (); }
+		uint64_t next ()
+		{
+			uint64_t z = (_state += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		}
+		double uniform () { return (next () >> 11) * (1.0 / 9007199254740992.0); }
+		double normal ()
+		{
+			double u = uniform ();
+			double v = uniform ();
+			return sqrt (-2.0 * log (1.0 - u)) * cos (2.0 * M_PI * v);
+		}
+	private:
+		uint64_t _state;
+};
+
+/*
+	Picks a value of every input for one draw
+*/
+static void drawInputs (uint64_t seed, uint64_t draw, float *values)
+{
+	DrawRandom random (seed, draw);
+	for (int i = 0; i < IN_COUNT; i++)
+	{
+		const UncertainInput &in = inputs[i];
+		if (in.dist == DIST_NORMAL)
+			values[i] = in.nominal + in.a * random.normal ();
+		else if (in.dist == DIST_UNIFORM)
+			values[i] = in.a + (in.b - in.a) * random.uniform ();
+		else
+			values[i] = in.nominal;
+	}
+}
+
+static void nominalInputs (float *values)
+{
+	for (int i = 0; i < IN_COUNT; i++)
+		values[i] = inputs[i].nominal;
+}
+
+/*
+	Orifice area (m^2) from a diameter in inches, as EngineController
+*/
+static float orificeArea (float diameter)
+{
+	return 3.141592654 * pow (diameter / 2, 2) * 0.00064516;
+}
+
+/*
+	Recalculates the flow and thrust columns of one sample, as
+	EngineController's calcFuelFlow etc.
+*/
+static void calcOutputs (const Sample &s, const float *in, float *out)
+{
+	static thread_local EngineMath em;	// keeps the nozzle solution while the geometry repeats
+	float fuelPSI = s.fuelPSI + in[IN_FUEL_PSI];
+	float oxPSI = s.oxPSI + in[IN_OX_PSI];
+	float enginePSI = s.enginePSI + in[IN_ENGINE_PSI];
+	out[OUT_FUEL_FLOW] = em.LiquidMassFlow (in[IN_LCD], in[IN_LDEN], fuelPSI, enginePSI, orificeArea (in[IN_LD]));
+	out[OUT_OX_FLOW] = em.GasMassFlow (in[IN_GCD], 9.80665, in[IN_GK], in[IN_GZ], in[IN_GTEMP], in[IN_GM],
+		oxPSI, enginePSI, orificeArea (in[IN_GD]));
+	out[OUT_ENGINE_FLOW] = out[OUT_OX_FLOW] + out[OUT_FUEL_FLOW];
+	if (in[IN_P2] > 0)
+		out[OUT_FORCE_CALC] = em.thrustCalc (in[IN_KE], enginePSI, in[IN_P2], in[IN_P3], in[IN_AEXIT], in[IN_ATHROAT]);
+	else
+		out[OUT_FORCE_CALC] = em.nozzleThrust (in[IN_KE], enginePSI, in[IN_P3], in[IN_AEXIT], in[IN_ATHROAT]);
+}
+
+/*
+	Integrates the burn for one set of inputs with ImpulseCalc
+*/
+static void calcTotals (const float *in, ImpulseCalc &burn, double *totals)
+{
+	float out[OUT_COUNT];
+	burn.setThroatArea (in[IN_ATHROAT]);
+	burn.reset ();
+	for (size_t i = 0; i < samples.size (); i++)
+	{
+		const Sample &s = samples[i];
+		calcOutputs (s, in, out);
+		burn.addSample (s.millis, s.forceSensor, out[OUT_FORCE_CALC], out[OUT_FUEL_FLOW], out[OUT_OX_FLOW],
+			s.enginePSI + in[IN_ENGINE_PSI]);
+	}
+	totals[TOT_FUEL_MASS] = burn.getFuelMass ();
+	totals[TOT_OX_MASS] = burn.getOxMass ();
+	totals[TOT_MIXTURE] = burn.getMixtureRatio ();
+	totals[TOT_IMPULSE_CALC] = burn.getImpulseCalc ();
+	totals[TOT_ISP_CALC] = burn.getIspCalc ();
+	totals[TOT_CSTAR] = burn.getCStar ();
+}
+
+/*
+	Runs work (first, count) on 'threads' threads in blocks of
+	BLOCK_SIZE, handing out the next block to whichever thread is
+	free
+*/
+template <class Work> static void parallelFor (size_t count, int threads, Work work)
+{
+	std::atomic<size_t> next (0);
+	std::vector<std::thread> pool;
+	for (int t = 0; t < threads; t++)
+	{
+		pool.push_back (std::thread ([&] ()
+		{
+			for (;;)
+			{
+				size_t first = next.fetch_add (BLOCK_SIZE);
+				if (first >= count)
+					break;
+				work (first, std::min ((size_t) BLOCK_SIZE, count - first));
+			}
+		}));
+	}
+	for (size_t t = 0; t < pool.size (); t++)
+		pool[t].join ();
+}
+
+/*
+	Returns the value at fraction 'p' (0 - 1) of the sorted values,
+	interpolating between neighbours. 'values' is reordered.
+*/
+static float percentile (std::vector<float> &values, double p)
+{
+	if (values.empty ())
+		return NAN;
+	double pos = p * (values.size () - 1);
+	size_t lo = (size_t) pos;
+	std::nth_element (values.begin (), values.begin () + lo, values.end ());
+	float a = values[lo];
+	if (lo + 1 >= values.size ())
+		return a;
+	float b = *std::min_element (values.begin () + lo + 1, values.end ());
+	return a + (b - a) * (pos - lo);
+}
+
+/*
+	Splits a CSV line into its fields
+*/
+static std::vector<std::string> splitCSV (const char *line)
+{
+	std::vector<std::string> fields;
+	std::string field;
+	for (const char *p = line; *p && *p != '\n' && *p != '\r'; p++)
+	{
+		if (*p == ',')
+		{
+			fields.push_back (field);
+			field.clear();
+		}
+		else
+			field += *p;
+	}
+	fields.push_back (field);
+	return fields;
+}
+
+/*
+	Returns the index of the column whose name starts with 'name'
+*/
+static int findColumn (const std::vector<std::string> &header, const char *name)
+{
+	for (size_t i = 0; i < header.size(); i++)
+		if (header[i].compare (0, strlen (name), name) == 0)
+			return (int) i;
+	return -1;
+}
+
+/*
+	Reads burn number 'burnNo' of the log on stdin
+*/
+static boolean readLog (int burnNo)
+{
+	static const char *names[] = { "Millis", "fuelPSI", "oxPSI", "enginePSI", "engineForceSensor",
+		"fuelFlow", "oxFlow", "engineFlow", "engineForceCalc" };
+	const int columns = sizeof (names) / sizeof (names[0]);
+	int col[columns];
+	char line[1024];
+	int burn = 0;
+	while (fgets (line, sizeof (line), stdin))
+	{
+		if (strncmp (line, "Millis,", 7) == 0)
+		{
+			if (burn == burnNo)
+				break;
+			burn++;
+			std::vector<std::string> header = splitCSV (line);
+			for (int i = 0; i < columns; i++)
+			{
+				col[i] = findColumn (header, names[i]);
+				if (col[i] < 0)
+				{
+					fprintf (stderr, "missing column %s in header: %s", names[i], line);
+					return false;
+				}
+			}
+			continue;
+		}
+		if (burn != burnNo)
+			continue;
+		std::vector<std::string> f = splitCSV (line);
+		if ((int) f.size() <= *std::max_element (col, col + columns))
+			continue;
+		char *end;
+		Sample s;
+		s.millis = strtoul (f[col[0]].c_str(), &end, 10);
+		if (*end != '\0')
+			continue;
+		s.fuelPSI = atof (f[col[1]].c_str());
+		s.oxPSI = atof (f[col[2]].c_str());
+		s.enginePSI = atof (f[col[3]].c_str());
+		s.forceSensor = atof (f[col[4]].c_str());
+		for (int i = 0; i < OUT_COUNT; i++)
+			s.logged[i] = atof (f[col[5 + i]].c_str());
+		samples.push_back (s);
+	}
+	if (samples.size () < 2)
+	{
+		fprintf (stderr, "burn %d not found or has no samples\n", burnNo);
+		return false;
+	}
+	return true;
+}
+
+/*
+	Applies a -p name=spec option
+*/
+static boolean setInput (const char *option)
+{
+	const char *eq = strchr (option, '=');
+	if (eq == NULL)
+		return false;
+	for (int i = 0; i < IN_COUNT; i++)
+	{
+		UncertainInput &in = inputs[i];
+		if ((strlen (in.name) != (size_t) (eq - option)) || (strncmp (in.name, option, eq - option) != 0))
+			continue;
+		float x, y;
+		if (sscanf (eq + 1, "n:%f:%f", &x, &y) == 2)
+		{
+			in.dist = DIST_NORMAL;
+			in.nominal = x;
+			in.a = y;
+		}
+		else if (sscanf (eq + 1, "u:%f:%f", &x, &y) == 2)
+		{
+			in.dist = DIST_UNIFORM;
+			in.a = x;
+			in.b = y;
+		}
+		else if (sscanf (eq + 1, "%f", &x) == 1)
+		{
+			in.dist = DIST_FIXED;
+			in.nominal = x;
+		}
+		else
+			return false;
+		return true;
+	}
+	return false;
+}
+
+static void listInputs ()
+{
+	printf ("Input       Nominal    Spread\n");
+	for (int i = 0; i < IN_COUNT; i++)
+	{
+		const UncertainInput &in = inputs[i];
+		char spread[64];
+		if (in.dist == DIST_NORMAL)
+			snprintf (spread, sizeof (spread), "normal sd %g", in.a);
+		else if (in.dist == DIST_UNIFORM)
+			snprintf (spread, sizeof (spread), "uniform %g to %g", in.a, in.b);
+		else
+			snprintf (spread, sizeof (spread), "fixed");
+		printf ("%-10s %9g  %-26s %s\n", in.name, in.nominal, spread, in.note);
+	}
+}
+
+int main (int argc, char **argv)
+{
+	long draws = 10000;
+	int threads = std::thread::hardware_concurrency ();
+	uint64_t seed = 1;
+	double confidence = 95;
+	int burnNo = 1;
+	const char *csvName = NULL;
+	boolean list = false;
+	for (int i = 1; i < argc; i++)
+	{
+		boolean hasValue = (i + 1 < argc);
+		if ((strcmp (argv[i], "-n") == 0) && hasValue)
+			draws = atol (argv[++i]);
+		else if ((strcmp (argv[i], "-j") == 0) && hasValue)
+			threads = atoi (argv[++i]);
+		else if ((strcmp (argv[i], "-s") == 0) && hasValue)
+			seed = strtoull (argv[++i], NULL, 10);
+		else if ((strcmp (argv[i], "-c") == 0) && hasValue)
+			confidence = atof (argv[++i]);
+		else if ((strcmp (argv[i], "-b") == 0) && hasValue)
+			burnNo = atoi (argv[++i]);
+		else if ((strcmp (argv[i], "-csv") == 0) && hasValue)
+			csvName = argv[++i];
+		else if ((strcmp (argv[i], "-p") == 0) && hasValue)
+		{
+			if (setInput (argv[++i]) == false)
+			{
+				fprintf (stderr, "bad input setting: %s (see -list for the names)\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp (argv[i], "-list") == 0)
+			list = true;
+		else
+		{
+			fprintf (stderr, "unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (list)
+	{
+		listInputs ();
+		return 0;
+	}
+	if (threads < 1)
+		threads = 1;
+	if ((draws < 2) || (confidence <= 0) || (confidence >= 100))
+	{
+		fprintf (stderr, "need at least 2 draws and a confidence between 0 and 100\n");
+		return 1;
+	}
+	if (readLog (burnNo) == false)
+		return 1;
+	double pLow = (1 - confidence / 100) / 2;
+	double pHigh = 1 - pLow;
+	auto start = std::chrono::steady_clock::now ();
+
+	// the inputs of every draw
+	std::vector<float> drawn (draws * IN_COUNT);
+	parallelFor (draws, threads, [&] (size_t first, size_t count)
+	{
+		for (size_t d = first; d < first + count; d++)
+			drawInputs (seed, d, &drawn[d * IN_COUNT]);
+	});
+
+	// nominal recalculation (check against the log)
+	float nominal[IN_COUNT];
+	nominalInputs (nominal);
+	double worst = 0;
+	int worstOut = 0;
+	for (size_t i = 0; i < samples.size (); i++)
+	{
+		float out[OUT_COUNT];
+		calcOutputs (samples[i], nominal, out);
+		for (int o = 0; o < OUT_COUNT; o++)
+		{
+			if (isnan (out[o]) || isnan (samples[i].logged[o]))
+				continue;
+			double diff = fabs (out[o] - samples[i].logged[o]) / std::max (fabs ((double) samples[i].logged[o]), 1e-6);
+			if (diff > worst)
+			{
+				worst = diff;
+				worstOut = o;
+			}
+		}
+	}
+
+	// (1) bands at every sample
+	std::vector<float> bands;
+	if (csvName != NULL)
+	{
+		bands.resize (samples.size () * OUT_COUNT * 3);
+		parallelFor (samples.size (), threads, [&] (size_t first, size_t count)
+		{
+			std::vector<float> values[OUT_COUNT];
+			float out[OUT_COUNT];
+			for (size_t i = first; i < first + count; i++)
+			{
+				for (int o = 0; o < OUT_COUNT; o++)
+					values[o].clear ();
+				for (long d = 0; d < draws; d++)
+				{
+					calcOutputs (samples[i], &drawn[d * IN_COUNT], out);
+					for (int o = 0; o < OUT_COUNT; o++)
+						if (isnan (out[o]) == false)
+							values[o].push_back (out[o]);
+				}
+				for (int o = 0; o < OUT_COUNT; o++)
+				{
+					float *band = &bands[(i * OUT_COUNT + o) * 3];
+					band[0] = percentile (values[o], pLow);
+					band[1] = percentile (values[o], 0.5);
+					band[2] = percentile (values[o], pHigh);
+				}
+			}
+		});
+	}
+
+	// (2) burn totals of every draw
+	std::vector<double> totals (draws * TOT_COUNT);
+	parallelFor (draws, threads, [&] (size_t first, size_t count)
+	{
+		ImpulseCalc burn (inputs[IN_ATHROAT].nominal);
+		for (size_t d = first; d < first + count; d++)
+			calcTotals (&drawn[d * IN_COUNT], burn, &totals[d * TOT_COUNT]);
+	});
+	double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	ImpulseCalc nominalBurn (inputs[IN_ATHROAT].nominal);
+	double nominalTotals[TOT_COUNT];
+	calcTotals (nominal, nominalBurn, nominalTotals);
+
+	printf ("Burn %d: %lu samples, %.3f sec\n", burnNo, (unsigned long) samples.size (),
+		(samples.back ().millis - samples.front ().millis) / 1000.0);
+	printf ("Nominal recalculation differs from the log by up to %.2f%% (%s)\n", worst * 100, outputNames[worstOut]);
+	printf ("%ld draws on %d threads in %.2f sec\n\n", draws, threads, seconds);
+	printf ("%-22s %12s %12s %12s %12s %8s\n", "", "Nominal", "Median", "Low", "High", "+/-%");
+	for (int t = 0; t < TOT_COUNT; t++)
+	{
+		std::vector<float> values;
+		for (long d = 0; d < draws; d++)
+			if (isfinite (totals[d * TOT_COUNT + t]))
+				values.push_back (totals[d * TOT_COUNT + t]);
+		float lo = percentile (values, pLow);
+		float mid = percentile (values, 0.5);
+		float hi = percentile (values, pHigh);
+		printf ("%-22s %12.5g %12.5g %12.5g %12.5g %8.1f\n", totalNames[t], nominalTotals[t], mid, lo, hi,
+			(mid != 0) ? 50 * (hi - lo) / fabs (mid) : 0.0);
+	}
+	printf ("(Low - High is the %g%% interval)\n", confidence);
+
+	if (csvName != NULL)
+	{
+		FILE *csv = fopen (csvName, "w");
+		if (csv == NULL)
+		{
+			fprintf (stderr, "can't write %s\n", csvName);
+			return 1;
+		}
+		fprintf (csv, "Millis");
+		for (int o = 0; o < OUT_COUNT; o++)
+			fprintf (csv, ",%s,low,median,high", outputNames[o]);
+		fprintf (csv, "\n");
+		for (size_t i = 0; i < samples.size (); i++)
+		{
+			float out[OUT_COUNT];
+			calcOutputs (samples[i], nominal, out);
+			fprintf (csv, "%lu", samples[i].millis);
+			for (int o = 0; o < OUT_COUNT; o++)
+			{
+				const float *band = &bands[(i * OUT_COUNT + o) * 3];
+				fprintf (csv, ",%g,%g,%g,%g", out[o], band[0], band[1], band[2]);
+			}
+			fprintf (csv, "\n");
+		}
+		fclose (csv);
+	}
+	return 0;
+}
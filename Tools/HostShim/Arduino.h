@@ -0,0 +1,240 @@
+/*
+ Title: Arduino.h (Host Shim)
+  Description: A minimal stand-in for the Arduino core so that
+	the hardware independent libraries (eg. EngineMath,
+	ImpulseCalc) can be compiled into the host tools found in
+	the Tools directory. Only what those libraries need is
+	provided here. Do not put this directory on the include
+	path of an Arduino build.
+
+	Tools that run a whole sketch (Tools/TraceReplay) also link
+	HostArduino.cpp, which provides the pin, time, Print, Serial
+	and EEPROM functions declared below. Time, analog inputs and
+	the serial port can be driven by the tool through the host*
+	hooks. Registers are plain variables except ADCSRA, which
+	finishes a conversion as soon as ADSC is set. digitalWrite
+	sets the pin's bit in its PORT register, so pins written
+	either way can be watched. The watchdog is only WDTCSR plus
+	the hostWdtReset hook (avr/wdt.h); a tool that wants it to
+	fire checks the time since the last reset itself
+	(Tools/FailSafeSim). Print formats
+	numbers exactly as the Arduino core does (floats in single
+	precision, as doubles are 32 bits on the AVR) so output can
+	be compared with a log from a board.
+*/
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define ARDUINO 105
+#define F_CPU 16000000L
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// program memory is ordinary memory on a PC
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *) (addr))
+#define pgm_read_word(addr) hostReadWord ((const void *) (addr))
+#define pgm_read_dword(addr) hostReadDword ((const void *) (addr))
+#define pgm_read_float(addr) hostReadFloat ((const void *) (addr))
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define strlen_P strlen
+
+// copied out, as the data may be of another type (eg. a float table
+// read as dwords) or unaligned
+static inline uint16_t hostReadWord (const void *addr) { uint16_t v; memcpy (&v, addr, sizeof (v)); return v; }
+static inline uint32_t hostReadDword (const void *addr) { uint32_t v; memcpy (&v, addr, sizeof (v)); return v; }
+static inline float hostReadFloat (const void *addr) { float v; memcpy (&v, addr, sizeof (v)); return v; }
+
+#define _BV(bit) (1 << (bit))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+
+// ATmega328P register bits used by the libraries
+#define REFS0 6
+#define REFS1 7
+#define MUX0 0
+#define MUX1 1
+#define MUX2 2
+#define MUX3 3
+#define MUX4 4
+#define MUX5 3
+#define ADSC 6
+#define ADEN 7
+#define WDP0 0
+#define WDP1 1
+#define WDP2 2
+#define WDE 3
+#define WDCE 4
+#define WDP3 5
+#define WDIE 6
+#define WDRF 3
+#define PCIE0 0
+#define CS10 0
+#define CS11 1
+#define WGM12 3
+#define OCIE1A 1
+#define OCIE1B 2
+#define ICIE1 5
+#define OCF1A 1
+
+/*
+	ADC control register: a conversion started by setting ADSC
+	has finished by the next read
+*/
+struct HostAdcControl
+{
+	uint8_t value;
+	operator uint8_t () { value &= ~_BV(ADSC); return value; }
+	HostAdcControl &operator= (uint8_t v) { value = v; return *this; }
+	HostAdcControl &operator|= (uint8_t v) { value |= v; return *this; }
+	HostAdcControl &operator&= (uint8_t v) { value &= v; return *this; }
+};
+
+extern volatile uint8_t SREG, MCUSR, WDTCSR, ADMUX, ADCSRB, ADCL, ADCH;
+extern volatile uint8_t PORTB, PORTC, PORTD, PINB, PINC, PIND, DDRB, DDRC, DDRD;
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2, TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t OCR1A, OCR1B, TCNT1, ICR1;
+extern HostAdcControl ADCSRA;
+
+inline void cli () {}
+inline void sei () {}
+#define noInterrupts() cli()
+#define interrupts() sei()
+#define ISR(vector) extern "C" void vector (void)
+// Vectors a host tool can call (the ISRs are compiled under #if defined(X_vect))
+#define PCINT0_vect PCINT0_vect
+#define PCINT1_vect PCINT1_vect
+#define PCINT2_vect PCINT2_vect
+#define TIMER1_COMPA_vect TIMER1_COMPA_vect
+#define WDT_vect WDT_vect
+
+// Pins 0-7 are port D (4), 8-13 port B (2) and 14-19 (A0-A5) port C (3)
+#define NOT_A_PIN 0
+#define NOT_A_PORT 0
+#define digitalPinToPort(p) ((uint8_t) ((p) < 8 ? 4 : ((p) < 14 ? 2 : ((p) < 20 ? 3 : NOT_A_PORT))))
+#define digitalPinToBitMask(p) ((uint8_t) (1 << ((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14))))
+#define portOutputRegister(port) ((port) == 2 ? &PORTB : ((port) == 3 ? &PORTC : &PORTD))
+#define portInputRegister(port) ((port) == 2 ? &PINB : ((port) == 3 ? &PINC : &PIND))
+#define portModeRegister(port) ((port) == 2 ? &DDRB : ((port) == 3 ? &DDRC : &DDRD))
+#define digitalPinToPCICR(p) (&PCICR)
+#define digitalPinToPCICRbit(p) ((p) < 8 ? 2 : ((p) < 14 ? 0 : 1))
+#define digitalPinToPCMSK(p) ((p) < 8 ? &PCMSK2 : ((p) < 14 ? &PCMSK0 : &PCMSK1))
+#define digitalPinToPCMSKbit(p) ((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14))
+
+void pinMode (uint8_t pin, uint8_t mode);
+void digitalWrite (uint8_t pin, uint8_t value);
+int digitalRead (uint8_t pin);
+int analogRead (uint8_t pin);
+unsigned long millis ();
+unsigned long micros ();
+void delay (unsigned long ms);
+void delayMicroseconds (unsigned int us);
+long random (long howBig);
+long random (long howSmall, long howBig);
+void randomSeed (unsigned long seed);
+char *dtostrf (double value, signed char width, unsigned char precision, char *buffer);
+
+// Hooks a host tool may set (HostArduino.cpp)
+extern unsigned long (*hostMicros) ();			// time, default the PC clock
+extern void (*hostDelay) (unsigned long us);	// delay(), default waits on micros()
+extern int (*hostAnalogRead) (uint8_t pin);		// default 512
+extern int (*hostSerialRead) ();				// next byte from Serial or -1, default -1
+extern void (*hostSerialWrite) (uint8_t c);		// default stdout
+extern void (*hostWdtReset) ();					// wdt_reset(), default nothing
+extern uint8_t hostEEPROM[];					// EEPROM contents
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *> (string_literal))
+
+class Print
+{
+	public:
+		virtual ~Print () {}
+		virtual size_t write (uint8_t c) = 0;
+		size_t write (const char *str);
+		virtual size_t write (const uint8_t *buffer, size_t size);
+		size_t print (const __FlashStringHelper *str);
+		size_t print (const char *str);
+		size_t print (char c);
+		size_t print (unsigned char value, int base = DEC);
+		size_t print (int value, int base = DEC);
+		size_t print (unsigned int value, int base = DEC);
+		size_t print (long value, int base = DEC);
+		size_t print (unsigned long value, int base = DEC);
+		size_t print (double value, int digits = 2);
+		size_t println (const __FlashStringHelper *str);
+		size_t println (const char *str);
+		size_t println (char c);
+		size_t println (unsigned char value, int base = DEC);
+		size_t println (int value, int base = DEC);
+		size_t println (unsigned int value, int base = DEC);
+		size_t println (long value, int base = DEC);
+		size_t println (unsigned long value, int base = DEC);
+		size_t println (double value, int digits = 2);
+		size_t println ();
+		virtual void flush () {}
+	protected:
+		void setWriteError (int err = 1) {}
+	private:
+		size_t printNumber (unsigned long value, uint8_t base);
+		size_t printFloat (float value, uint8_t digits);
+};
+
+class Stream : public Print
+{
+	public:
+		virtual int available () = 0;
+		virtual int read () = 0;
+		virtual int peek () = 0;
+};
+
+class HardwareSerial : public Stream
+{
+	public:
+		HardwareSerial ();
+		void begin (unsigned long baud);
+		void end ();
+		virtual size_t write (uint8_t c);
+		virtual int available ();
+		virtual int read ();
+		virtual int peek ();
+		operator bool () { return true; }
+		using Print::write;
+	private:
+		int _peek;
+};
+
+extern HardwareSerial Serial;
+
+#endif
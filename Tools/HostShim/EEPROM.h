@@ -0,0 +1,26 @@
+/*
+ Title: EEPROM.h (Host Shim)
+  Description: EEPROM library stand-in for host tools. The
+	contents are the hostEEPROM array (HostArduino.cpp), erased
+	(0xFF) at start up like a new part.
+*/
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include "Arduino.h"
+
+#define EEPROM_SIZE 1024	// ATmega328P
+
+class EEPROMClass
+{
+	public:
+		uint8_t read (int address) { return hostEEPROM[address]; }
+		void write (int address, uint8_t value) { hostEEPROM[address] = value; }
+		void update (int address, uint8_t value) { hostEEPROM[address] = value; }
+		uint8_t &operator[] (int address) { return hostEEPROM[address]; }
+		uint16_t length () { return EEPROM_SIZE; }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
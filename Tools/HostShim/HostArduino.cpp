@@ -0,0 +1,384 @@
+/*
+ Title: HostArduino.cpp (Host Shim)
+  Description: The Arduino core functions declared in the host
+	Arduino.h, for tools that run a whole sketch on a PC (eg.
+	Tools/TraceReplay). digitalWrite sets the PORT bit of the
+	pin, digitalRead returns LOW and time, analog inputs and the serial port go through the
+	host* hooks so a tool can drive them. Print follows the
+	Arduino core (Print.cpp) digit for digit, including floats
+	being worked out in single precision as on the AVR.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include "Arduino.h"
+#include "EEPROM.h"
+
+volatile uint8_t SREG, MCUSR, WDTCSR, ADMUX, ADCSRB, ADCL, ADCH;
+volatile uint8_t PORTB, PORTC, PORTD, PINB, PINC, PIND, DDRB, DDRC, DDRD;
+volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2, TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t OCR1A, OCR1B, TCNT1, ICR1;
+HostAdcControl ADCSRA;
+
+uint8_t hostEEPROM[EEPROM_SIZE];
+EEPROMClass EEPROM;
+HardwareSerial Serial;
+
+/*
+	Microseconds since the first call from the PC's clock
+*/
+static unsigned long clockMicros ()
+{
+	static struct timespec start;
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	if ((start.tv_sec == 0) && (start.tv_nsec == 0))
+		start = now;
+	return (unsigned long) ((now.tv_sec - start.tv_sec) * 1000000L + (now.tv_nsec - start.tv_nsec) / 1000);
+}
+
+/*
+	Waits until micros() has moved on by 'us'
+*/
+static void waitMicros (unsigned long us)
+{
+	unsigned long start = micros ();
+	while ((micros () - start) < us);
+}
+
+static int defaultAnalogRead (uint8_t pin)
+{
+	return 512;
+}
+
+static int defaultSerialRead ()
+{
+	return -1;
+}
+
+static void defaultSerialWrite (uint8_t c)
+{
+	putchar (c);
+}
+
+static void defaultWdtReset ()
+{
+}
+
+unsigned long (*hostMicros) () = clockMicros;
+void (*hostDelay) (unsigned long us) = waitMicros;
+int (*hostAnalogRead) (uint8_t pin) = defaultAnalogRead;
+int (*hostSerialRead) () = defaultSerialRead;
+void (*hostSerialWrite) (uint8_t c) = defaultSerialWrite;
+void (*hostWdtReset) () = defaultWdtReset;
+
+/*
+	Fills the EEPROM with 0xFF before anything runs
+*/
+static struct EraseEEPROM
+{
+	EraseEEPROM () { memset (hostEEPROM, 0xFF, EEPROM_SIZE); }
+} eraseEEPROM;
+
+void pinMode (uint8_t pin, uint8_t mode) {}
+
+void digitalWrite (uint8_t pin, uint8_t value)
+{
+	uint8_t port = digitalPinToPort (pin);
+	if (port == NOT_A_PORT)
+		return;
+	volatile uint8_t *out = portOutputRegister (port);
+	if (value == LOW)
+		*out &= ~digitalPinToBitMask (pin);
+	else
+		*out |= digitalPinToBitMask (pin);
+}
+
+int digitalRead (uint8_t pin)
+{
+	return LOW;
+}
+
+int analogRead (uint8_t pin)
+{
+	return hostAnalogRead (pin);
+}
+
+/*
+	Time. On the AVR these are 32 bit counters, so they wrap
+	the same way here.
+*/
+unsigned long micros ()
+{
+	return (uint32_t) hostMicros ();
+}
+
+unsigned long millis ()
+{
+	return (uint32_t) (hostMicros () / 1000);
+}
+
+void delay (unsigned long ms)
+{
+	hostDelay (ms * 1000);
+}
+
+void delayMicroseconds (unsigned int us)
+{
+	hostDelay (us);
+}
+
+long random (long howBig)
+{
+	if (howBig == 0)
+		return 0;
+	return rand () % howBig;
+}
+
+long random (long howSmall, long howBig)
+{
+	if (howSmall >= howBig)
+		return howSmall;
+	return random (howBig - howSmall) + howSmall;
+}
+
+void randomSeed (unsigned long seed)
+{
+	if (seed != 0)
+		srand (seed);
+}
+
+char *dtostrf (double value, signed char width, unsigned char precision, char *buffer)
+{
+	sprintf (buffer, "%*.*f", width, precision, (float) value);
+	return buffer;
+}
+
+/*
+	Print (as the Arduino core)
+*/
+size_t Print::write (const char *str)
+{
+	if (str == NULL)
+		return 0;
+	return write ((const uint8_t *) str, strlen (str));
+}
+
+size_t Print::write (const uint8_t *buffer, size_t size)
+{
+	size_t n = 0;
+	while (size--)
+		n += write (*buffer++);
+	return n;
+}
+
+size_t Print::print (const __FlashStringHelper *str)
+{
+	return write ((const char *) str);
+}
+
+size_t Print::print (const char *str)
+{
+	return write (str);
+}
+
+size_t Print::print (char c)
+{
+	return write ((uint8_t) c);
+}
+
+size_t Print::print (unsigned char value, int base)
+{
+	return print ((unsigned long) value, base);
+}
+
+size_t Print::print (int value, int base)
+{
+	return print ((long) value, base);
+}
+
+size_t Print::print (unsigned int value, int base)
+{
+	return print ((unsigned long) value, base);
+}
+
+/*
+	Longs are 32 bits on the AVR, so a negative number in any base
+	but 10 prints as its 32 bit two's complement
+*/
+size_t Print::print (long value, int base)
+{
+	int32_t n = (int32_t) value;
+	if (base == 0)
+		return write ((uint8_t) n);
+	if ((base == 10) && (n < 0))
+	{
+		size_t t = print ('-');
+		return printNumber ((uint32_t) -(int64_t) n, 10) + t;
+	}
+	return printNumber ((uint32_t) n, base);
+}
+
+size_t Print::print (unsigned long value, int base)
+{
+	if (base == 0)
+		return write ((uint8_t) value);
+	return printNumber ((uint32_t) value, base);
+}
+
+size_t Print::print (double value, int digits)
+{
+	return printFloat ((float) value, digits);
+}
+
+size_t Print::println (const __FlashStringHelper *str)
+{
+	size_t n = print (str);
+	return n + println ();
+}
+
+size_t Print::println (const char *str)
+{
+	size_t n = print (str);
+	return n + println ();
+}
+
+size_t Print::println (char c)
+{
+	size_t n = print (c);
+	return n + println ();
+}
+
+size_t Print::println (unsigned char value, int base)
+{
+	size_t n = print (value, base);
+	return n + println ();
+}
+
+size_t Print::println (int value, int base)
+{
+	size_t n = print (value, base);
+	return n + println ();
+}
+
+size_t Print::println (unsigned int value, int base)
+{
+	size_t n = print (value, base);
+	return n + println ();
+}
+
+size_t Print::println (long value, int base)
+{
+	size_t n = print (value, base);
+	return n + println ();
+}
+
+size_t Print::println (unsigned long value, int base)
+{
+	size_t n = print (value, base);
+	return n + println ();
+}
+
+size_t Print::println (double value, int digits)
+{
+	size_t n = print (value, digits);
+	return n + println ();
+}
+
+size_t Print::println ()
+{
+	size_t n = print ('\r');
+	return n + print ('\n');
+}
+
+size_t Print::printNumber (unsigned long value, uint8_t base)
+{
+	char buf[8 * sizeof (uint32_t) + 1];
+	char *str = &buf[sizeof (buf) - 1];
+	*str = '\0';
+	if (base < 2)
+		base = 10;
+	do
+	{
+		unsigned long m = value;
+		value /= base;
+		char c = m - base * value;
+		*--str = c < 10 ? c + '0' : c + 'A' - 10;
+	} while (value);
+	return write (str);
+}
+
+/*
+	Arduino's printFloat with float arithmetic (an AVR double is a
+	float)
+*/
+size_t Print::printFloat (float value, uint8_t digits)
+{
+	size_t n = 0;
+	if (isnan (value))
+		return print ("nan");
+	if (isinf (value))
+		return print ("inf");
+	if (value > 4294967040.0f)
+		return print ("ovf");
+	if (value < -4294967040.0f)
+		return print ("ovf");
+	if (value < 0.0f)
+	{
+		n += print ('-');
+		value = -value;
+	}
+	float rounding = 0.5f;
+	for (uint8_t i = 0; i < digits; ++i)
+		rounding /= 10.0f;
+	value += rounding;
+	unsigned long intPart = (unsigned long) value;
+	float remainder = value - (float) intPart;
+	n += print (intPart);
+	if (digits > 0)
+		n += print ('.');
+	while (digits-- > 0)
+	{
+		remainder *= 10.0f;
+		unsigned int toPrint = (unsigned int) remainder;
+		n += print (toPrint);
+		remainder -= toPrint;
+	}
+	return n;
+}
+
+/*
+	Serial goes through hostSerialRead and hostSerialWrite
+*/
+HardwareSerial::HardwareSerial ()
+{
+	_peek = -1;
+}
+
+void HardwareSerial::begin (unsigned long baud) {}
+void HardwareSerial::end () {}
+
+size_t HardwareSerial::write (uint8_t c)
+{
+	hostSerialWrite (c);
+	return 1;
+}
+
+int HardwareSerial::available ()
+{
+	return (peek () >= 0) ? 1 : 0;
+}
+
+int HardwareSerial::read ()
+{
+	int c = peek ();
+	_peek = -1;
+	return c;
+}
+
+int HardwareSerial::peek ()
+{
+	if (_peek < 0)
+		_peek = hostSerialRead ();
+	return _peek;
+}
@@ -0,0 +1,5 @@
+/*
+ Title: Stream.h (Host Shim)
+  Description: Stream is declared in the host Arduino.h
+*/
+#include "Arduino.h"
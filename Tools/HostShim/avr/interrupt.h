@@ -0,0 +1,7 @@
+/*
+ Title: avr/interrupt.h (Host Shim)
+  Description: cli(), sei() and ISR() are declared in the host
+	Arduino.h. Interrupts never run on the host unless a tool
+	calls the vector.
+*/
+#include "Arduino.h"
@@ -0,0 +1,5 @@
+/*
+ Title: avr/pgmspace.h (Host Shim)
+  Description: PROGMEM is declared in the host Arduino.h
+*/
+#include "Arduino.h"
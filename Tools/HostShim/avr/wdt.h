@@ -0,0 +1,33 @@
+/*
+ Title: avr/wdt.h (Host Shim)
+  Description: Watchdog stand-in. The mode and prescaler are
+	kept in WDTCSR as on the AVR and every reset calls the
+	hostWdtReset hook. Nothing times out on its own; a tool that
+	simulates the watchdog (Tools/FailSafeSim) does that.
+*/
+#ifndef wdt_h
+#define wdt_h
+
+#include "Arduino.h"
+
+#define WDTO_15MS 0
+#define WDTO_30MS 1
+#define WDTO_60MS 2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+#define WDTO_4S 8
+#define WDTO_8S 9
+
+inline void wdt_reset () { hostWdtReset (); }
+inline void wdt_disable () { WDTCSR = 0; }
+
+inline void wdt_enable (uint8_t timeout)
+{
+	hostWdtReset ();
+	WDTCSR = _BV(WDE) | (timeout & 0x07) | ((timeout & 0x08) ? _BV(WDP3) : 0);
+}
+
+#endif
@@ -0,0 +1,8 @@
+/*
+ Title: util/delay.h (Host Shim)
+  Description: Busy wait delays
+*/
+#include "Arduino.h"
+
+#define _delay_us(us) delayMicroseconds (us)
+#define _delay_ms(ms) delay (ms)
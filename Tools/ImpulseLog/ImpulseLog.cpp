@@ -0,0 +1,133 @@
+/*
+ Title: ImpulseLog.cpp
+  Description: Host tool that integrates a burn recorded from
+	the EngineController serial output and prints the total 
+	impulse, propellant mass, Isp, C* and O/F ratio. It uses 
+	the same ImpulseCalc library that runs on the Arduino so the
+	numbers match what the controller reported at the end of
+	the burn.
+	
+	The log is read from the first line starting with "Millis,"
+	and any lines that don't parse as data (eg. status messages)
+	are skipped. A new header line starts a new burn.
+	
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../ImpulseCalc ImpulseLog.cpp ../../ImpulseCalc/ImpulseCalc.cpp -o ImpulseLog
+	Usage:
+		ImpulseLog [-t] [aThroat m^2] < burn.csv
+			-t	use the trapezoidal rule instead of Simpson's rule
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include "Arduino.h"
+#include "ImpulseCalc.h"
+
+/*
+	Splits a CSV line into its fields
+*/
+static std::vector<std::string> splitCSV (const char *line)
+{
+	std::vector<std::string> fields;
+	std::string field;
+	for (const char *p = line; *p && *p != '\n' && *p != '\r'; p++)
+	{
+		if (*p == ',')
+		{
+			fields.push_back (field);
+			field.clear();
+		}
+		else
+			field += *p;
+	}
+	fields.push_back (field);
+	return fields;
+}
+
+/*
+	Returns the index of the column whose name starts with 'name'
+*/
+static int findColumn (const std::vector<std::string> &header, const char *name)
+{
+	for (size_t i = 0; i < header.size(); i++)
+		if (header[i].compare (0, strlen (name), name) == 0)
+			return (int) i;
+	return -1;
+}
+
+static void printSummary (int burnNo, ImpulseCalc &burn)
+{
+	printf ("Burn %d\n", burnNo);
+	printf ("  Burn Time (sec):          %.3f\n", burn.getBurnTime());
+	printf ("  Total Impulse (N-sec):    %.3f\n", burn.getImpulse());
+	printf ("  Calc. Impulse (N-sec):    %.3f\n", burn.getImpulseCalc());
+	printf ("  Fuel Mass (kg):           %.5f\n", burn.getFuelMass());
+	printf ("  Ox Mass (kg):             %.5f\n", burn.getOxMass());
+	printf ("  Isp (sec):                %.2f\n", burn.getIsp());
+	printf ("  Calc. Isp (sec):          %.2f\n", burn.getIspCalc());
+	printf ("  C* (m/sec):               %.2f\n", burn.getCStar());
+	printf ("  O/F:                      %.3f\n", burn.getMixtureRatio());
+}
+
+int main (int argc, char **argv)
+{
+	float aThroat = 0.00017;	// engine throat area (m^2), matches EngineController
+	byte method = IMPULSE_SIMPSON;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp (argv[i], "-t") == 0)
+			method = IMPULSE_TRAPEZOID;
+		else
+			aThroat = atof (argv[i]);
+	}
+
+	ImpulseCalc burn (aThroat, method);
+	char line[1024];
+	int cMillis = -1, cFuel = -1, cOx = -1, cPc = -1, cCalc = -1, cSensor = -1;
+	int burnNo = 0;
+	long samples = 0;
+	while (fgets (line, sizeof (line), stdin))
+	{
+		if (strncmp (line, "Millis,", 7) == 0)
+		{
+			if (samples > 0)
+				printSummary (burnNo, burn);
+			std::vector<std::string> header = splitCSV (line);
+			cMillis = findColumn (header, "Millis");
+			cFuel = findColumn (header, "fuelFlow");
+			cOx = findColumn (header, "oxFlow");
+			cPc = findColumn (header, "enginePSI");
+			cCalc = findColumn (header, "engineForceCalc");
+			cSensor = findColumn (header, "engineForceSensor");
+			if (cMillis < 0 || cFuel < 0 || cOx < 0 || cPc < 0 || cCalc < 0 || cSensor < 0)
+			{
+				fprintf (stderr, "missing column in header: %s", line);
+				return 1;
+			}
+			burn.reset();
+			burnNo++;
+			samples = 0;
+			continue;
+		}
+		if (cMillis < 0)
+			continue;
+		std::vector<std::string> f = splitCSV (line);
+		if ((int) f.size() <= cSensor)
+			continue;
+		char *end;
+		unsigned long t = strtoul (f[cMillis].c_str(), &end, 10);
+		if (*end != '\0')
+			continue;
+		burn.addSample (t, atof (f[cSensor].c_str()), atof (f[cCalc].c_str()),
+						atof (f[cFuel].c_str()), atof (f[cOx].c_str()), atof (f[cPc].c_str()));
+		samples++;
+	}
+	if (samples > 0)
+		printSummary (burnNo, burn);
+	else
+		fprintf (stderr, "no samples found\n");
+	return 0;
+}
@@ -0,0 +1,385 @@
+/*
+ Title: JournalDecode.cpp
+  Description: Host tool that decodes the actuator events the
+	EventJournal library sends with the EngineController
+	telemetry ('{...}' lines, see EventJournal.h). Each event is
+	put on the telemetry clock (the Millis column) using the
+	JOURNAL_SYNC event logged with every CSV header, so it can be
+	lined up with the sensor readings to the millisecond.
+	By default the log is printed back with the InputTrace chunks
+	taken out and every journal line replaced by one line per
+	event, so the events sit between the sensor rows they fell
+	between:
+		event,<Millis>,<source>,<type>,<actuator>,<value>
+	(Millis is empty before the first header). -e prints only the
+	events, as a CSV table of their own.
+	Pins are named after the EngineController defaults (-pins
+	changes them); servo channels are printed as servo<n>.
+	Queue overflows (events dropped on the controller) are
+	counted and reported on stderr.
+
+	-test runs the EventJournal code itself on the PC (through
+	the host shim) and checks the round trip: every field of
+	every event type and source decodes as logged, the queue
+	keeps the oldest events and counts the ones dropped when it
+	is full, and JOURNAL_SYNC puts events on the right ms (past
+	65.5s too, the sync holds 24 bits of ms). Each
+	check prints PASS or FAIL and the exit status is the number
+	of failures.
+
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../BufferArena -I../../EventJournal JournalDecode.cpp ../HostShim/HostArduino.cpp ../../BufferArena/BufferArena.cpp ../../EventJournal/EventJournal.cpp -o JournalDecode
+	Usage:
+		JournalDecode [-e] [-pins pin=name,...] < log.txt
+			eg. JournalDecode -e < burn.txt > events.csv
+			default pins: 10=igniter,9=fuelSolenoid,8=oxSolenoid
+		JournalDecode -test
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "EventJournal.h"
+
+static int failures = 0;
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-56s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+static const char *typeNames[] = { "pin", "target", "speed", "accel", "home", "sync" };
+static const char *sourceNames[] = { "sequencer", "abort", "safety", "watchdog" };
+static std::map<int, std::string> pinNames;
+
+struct Event
+{
+	unsigned long micros;
+	int type;
+	int source;
+	int actuator;
+	unsigned int value;
+};
+
+/*
+	Reads 'digits' upper case hex digits. Returns false if they
+	are not all there.
+*/
+static bool readHex (const char *&p, int digits, unsigned long *value)
+{
+	*value = 0;
+	for (int i = 0; i < digits; i++, p++)
+	{
+		if ((*p >= '0') && (*p <= '9'))
+			*value = (*value << 4) | (*p - '0');
+		else if ((*p >= 'A') && (*p <= 'F'))
+			*value = (*value << 4) | (*p - 'A' + 10);
+		else
+			return false;
+	}
+	return true;
+}
+
+/*
+	Finds a journal line in 'line' and decodes its events. Returns
+	false if there isn't one (or it is damaged).
+*/
+static bool decodeLine (const char *line, std::vector<Event> &events, int *lost)
+{
+	const char *p = strchr (line, '{');
+	if (p == NULL)
+		return false;
+	p++;
+	unsigned long value;
+	if (!readHex (p, 2, &value))
+		return false;
+	*lost = value;
+	events.clear ();
+	while (*p != '}')
+	{
+		Event e;
+		unsigned long kind, actuator, v;
+		if (!readHex (p, 8, &value) || !readHex (p, 2, &kind) || !readHex (p, 2, &actuator) || !readHex (p, 4, &v))
+			return false;
+		e.micros = value;
+		e.type = kind >> 4;
+		e.source = kind & 0x0F;
+		e.actuator = actuator;
+		e.value = v;
+		events.push_back (e);
+	}
+	return true;
+}
+
+/*
+	Telemetry clock (ms) of a JOURNAL_SYNC event: the low 16 bits
+	are in value, the next 8 in actuator
+*/
+static unsigned long syncMillis (const Event &e)
+{
+	return ((unsigned long) e.actuator << 16) | e.value;
+}
+
+/*
+	Telemetry clock (ms) of an event, from the last sync
+*/
+struct SyncClock
+{
+	bool synced;
+	unsigned long micros;
+	unsigned long ms;
+	SyncClock () : synced (false), micros (0), ms (0) {}
+	void add (const Event &e)
+	{
+		if (e.type != JOURNAL_SYNC)
+			return;
+		synced = true;
+		micros = e.micros;
+		ms = syncMillis (e);
+	}
+	std::string millis (const Event &e)
+	{
+		if (!synced)
+			return "";
+		char text[32];
+		long since = (long) (int32_t) (e.micros - micros);		// wraps every 71 minutes
+		snprintf (text, sizeof (text), "%.3f", ms + since / 1000.0);
+		return text;
+	}
+};
+
+static std::string actuatorName (const Event &e)
+{
+	if (e.type == JOURNAL_HOME || e.type == JOURNAL_SYNC)
+		return "";
+	if (e.type == JOURNAL_PIN)
+	{
+		std::map<int, std::string>::iterator name = pinNames.find (e.actuator);
+		if (name != pinNames.end ())
+			return name->second;
+		return "pin" + std::to_string (e.actuator);
+	}
+	return "servo" + std::to_string (e.actuator);
+}
+
+static std::string eventLine (const Event &e, SyncClock &clock)
+{
+	char text[160];
+	snprintf (text, sizeof (text), "event,%s,%s,%s,%s,%lu", clock.millis (e).c_str (),
+		(e.source < 4) ? sourceNames[e.source] : "?", (e.type < 6) ? typeNames[e.type] : "?",
+		actuatorName (e).c_str (), (e.type == JOURNAL_SYNC) ? syncMillis (e) : (unsigned long) e.value);
+	return text;
+}
+
+/*
+	Reads pin=name,... into pinNames
+*/
+static void setPins (const char *list)
+{
+	pinNames.clear ();
+	std::string s (list);
+	size_t start = 0;
+	while (start < s.size ())
+	{
+		size_t end = s.find (',', start);
+		if (end == std::string::npos)
+			end = s.size ();
+		std::string item = s.substr (start, end - start);
+		size_t equals = item.find ('=');
+		if (equals != std::string::npos)
+			pinNames[atoi (item.c_str ())] = item.substr (equals + 1);
+		start = end + 1;
+	}
+}
+
+/*
+	Takes the InputTrace chunks ('~...~') out of a line
+*/
+static std::string stripTrace (const char *line, bool *inChunk)
+{
+	std::string out;
+	for (const char *p = line; *p; p++)
+	{
+		if (*p == '~')
+			*inChunk = !*inChunk;
+		else if (!*inChunk)
+			out += *p;
+	}
+	return out;
+}
+
+static int decode (bool eventsOnly)
+{
+	char line[4096];
+	SyncClock clock;
+	bool inChunk = false;
+	long events = 0, lost = 0, damaged = 0;
+	if (eventsOnly)
+		printf ("Millis,source,event,actuator,value,micros\n");
+	while (fgets (line, sizeof (line), stdin))
+	{
+		std::string text = stripTrace (line, &inChunk);
+		std::vector<Event> decoded;
+		int dropped;
+		if (text.find ('{') == std::string::npos)
+		{
+			if (!eventsOnly)
+				fputs (text.c_str (), stdout);
+			continue;
+		}
+		if (!decodeLine (text.c_str (), decoded, &dropped))
+		{
+			damaged++;
+			continue;
+		}
+		lost += dropped;
+		if (dropped > 0 && !eventsOnly)
+			printf ("event,,,lost,,%d\n", dropped);
+		for (size_t i = 0; i < decoded.size (); i++)
+		{
+			clock.add (decoded[i]);
+			std::string e = eventLine (decoded[i], clock);
+			if (eventsOnly)
+				printf ("%s,%lu\n", e.c_str () + 6, decoded[i].micros);
+			else
+				printf ("%s\n", e.c_str ());
+			events++;
+		}
+	}
+	fprintf (stderr, "%ld events, %ld dropped on the controller, %ld damaged lines\n", events, lost, damaged);
+	return 0;
+}
+
+/*
+	Print that keeps what is written, for the tests
+*/
+class Capture : public Print
+{
+	public:
+		size_t write (uint8_t c) { text += (char) c; return 1; }
+		using Print::write;
+		std::string text;
+};
+
+static unsigned long testMicros = 0;
+static unsigned long fakeMicros () { return testMicros; }
+
+static int test ()
+{
+	hostMicros = fakeMicros;
+	Capture out;
+	std::vector<Event> events;
+	int dropped;
+	char check[96];
+
+	// every type and source
+	testMicros = 0xFFFFFF00UL;						// about to wrap
+	journal.setSource (JOURNAL_SEQUENCER);
+	journal.sync (1234);
+	testMicros += 250;
+	journal.digitalWrite (10, HIGH);
+	testMicros += 1500;
+	journal.setSource (JOURNAL_ABORT);
+	journal.log (JOURNAL_TARGET, 1, 1600);
+	journal.setSource (JOURNAL_SAFETY);
+	journal.log (JOURNAL_SPEED, 23, 0x3FFF);
+	journal.setSource (JOURNAL_WATCHDOG);
+	journal.log (JOURNAL_ACCEL, 5, 3);
+	journal.log (JOURNAL_HOME, 0, 0);
+	journal.flush (out);
+	result ("one line per flush", (out.text.size () > 0) && (out.text[0] == '{') && (out.text.find ("}\r\n") == out.text.size () - 3));
+	result ("decodes", decodeLine (out.text.c_str (), events, &dropped) && (events.size () == 6) && (dropped == 0));
+	if (events.size () == 6)
+	{
+		int types[] = { JOURNAL_SYNC, JOURNAL_PIN, JOURNAL_TARGET, JOURNAL_SPEED, JOURNAL_ACCEL, JOURNAL_HOME };
+		int sources[] = { JOURNAL_SEQUENCER, JOURNAL_SEQUENCER, JOURNAL_ABORT, JOURNAL_SAFETY, JOURNAL_WATCHDOG, JOURNAL_WATCHDOG };
+		int actuators[] = { 0, 10, 1, 23, 5, 0 };
+		unsigned int values[] = { 1234, HIGH, 1600, 0x3FFF, 3, 0 };
+		unsigned long times[] = { 0xFFFFFF00UL, 0xFFFFFFFAUL, 0x5D6, 0x5D6, 0x5D6, 0x5D6 };
+		bool same = true;
+		for (int i = 0; i < 6; i++)
+			same = same && (events[i].type == types[i]) && (events[i].source == sources[i]) && (events[i].actuator == actuators[i])
+				&& (events[i].value == values[i]) && (events[i].micros == times[i]);
+		result ("every field of every type and source", same);
+		SyncClock clock;
+		clock.add (events[0]);
+		result ("sync: pin at 1234.250 ms, target 1235.750 ms (wraps)",
+			(clock.millis (events[1]) == "1234.250") && (clock.millis (events[2]) == "1235.750"));
+		pinNames[10] = "igniter";
+		result ("names", eventLine (events[1], clock) == "event,1234.250,sequencer,pin,igniter,1");
+	}
+
+	// a sync past 65.5s (16 bits of ms)
+	out.text.clear ();
+	testMicros = 5000;
+	journal.setSource (JOURNAL_SEQUENCER);
+	journal.sync (4000000UL);						// 66:40 into a session
+	testMicros += 1250;
+	journal.digitalWrite (9, HIGH);
+	journal.flush (out);
+	if (decodeLine (out.text.c_str (), events, &dropped) && (events.size () == 2))
+	{
+		SyncClock clock;
+		clock.add (events[0]);
+		result ("sync at 4000000 ms: pin at 4000001.250 ms", clock.millis (events[1]) == "4000001.250");
+		result ("sync value printed in full", eventLine (events[0], clock) == "event,4000000.000,sequencer,sync,,4000000");
+	}
+	else
+		result ("sync at 4000000 ms decodes", false);
+
+	// nothing queued, nothing sent
+	out.text.clear ();
+	journal.flush (out);
+	result ("empty flush sends nothing", out.text.empty ());
+
+	// overflow keeps the oldest and counts the rest
+	journal.setSource (JOURNAL_SEQUENCER);
+	for (int i = 0; i < ARENA_JOURNAL_EVENTS + 5; i++)
+	{
+		testMicros = 1000 * i;
+		journal.log (JOURNAL_TARGET, 0, 1000 + i);
+	}
+	snprintf (check, sizeof (check), "full queue keeps %d, counts 5 dropped", ARENA_JOURNAL_EVENTS);
+	result (check, journal.getCount () == ARENA_JOURNAL_EVENTS);
+	journal.flush (out);
+	bool ok = decodeLine (out.text.c_str (), events, &dropped) && (dropped == 5) && (events.size () == ARENA_JOURNAL_EVENTS);
+	for (size_t i = 0; ok && (i < events.size ()); i++)
+		ok = (events[i].value == 1000 + i) && (events[i].micros == 1000 * i);
+	result ("oldest events sent in order, then the drop count clears", ok);
+	out.text.clear ();
+	journal.log (JOURNAL_PIN, 8, LOW);
+	journal.flush (out);
+	result ("queue reused after a flush", decodeLine (out.text.c_str (), events, &dropped) && (dropped == 0) && (events.size () == 1));
+
+	snprintf (check, sizeof (check), "%d bytes an event on the link (%d in RAM)", (int) (out.text.size () - 6), JOURNAL_EVENT_SIZE);
+	result (check, out.text.size () - 6 == 2 * JOURNAL_EVENT_SIZE);
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
+
+int main (int argc, char *argv[])
+{
+	bool eventsOnly = false;
+	setPins ("10=igniter,9=fuelSolenoid,8=oxSolenoid");
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp (argv[i], "-test") == 0)
+			return test ();
+		else if (strcmp (argv[i], "-e") == 0)
+			eventsOnly = true;
+		else if ((strcmp (argv[i], "-pins") == 0) && (i + 1 < argc))
+			setPins (argv[++i]);
+		else
+		{
+			fprintf (stderr, "usage: JournalDecode [-e] [-pins pin=name,...] < log.txt\n       JournalDecode -test\n");
+			return 1;
+		}
+	}
+	return decode (eventsOnly);
+}
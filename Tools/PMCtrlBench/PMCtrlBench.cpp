@@ -0,0 +1,315 @@
+/*
+ Title: PMCtrlBench.cpp
+  Description: Host tool that runs the PMCtrl library (the same
+	code that runs on the Arduino) against a loopback simulator of
+	the Pololu Maestro serial protocol:
+		(1) protocol - every command is sent over each port type
+			and the simulator checks the bytes it decodes (start
+			byte, device id, channel, 7 bit value halves). Replies
+			to getPosition and getErrors, and a Maestro that does
+			not answer (isReadOk false, 0 returned), are checked
+			the same way
+		(2) the byte stream is the same whatever the port
+		(3) commands per second on this PC for each port:
+			PMCtrlT<MaestroSim>		port type known when compiling
+			PMCtrl					SoftwareSerial (stubbed here
+									onto the simulator)
+			PMCtrlT<PMStreamPort>	Stream picked at run time (a
+									virtual call per byte)
+			and the most the serial line itself can carry at the
+			baud rate, which is what limits the real thing
+	Each check prints PASS or FAIL and the exit status is the
+	number of failures.
+
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../BufferArena -I../../EventJournal -I../../SoftwareSerial -I../../PMCtrl PMCtrlBench.cpp ../HostShim/HostArduino.cpp ../../BufferArena/BufferArena.cpp ../../EventJournal/EventJournal.cpp ../../PMCtrl/PMCtrl.cpp -o PMCtrlBench
+	Usage:
+		PMCtrlBench [baud]
+			baud for the line rate, default 57600 (EngineController)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Arduino.h"
+#include "SoftwareSerial.h"
+#include "PMCtrl.h"
+
+static int failures = 0;
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-48s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+#define SIM_CHANNELS 24
+#define SIM_LOG 64
+
+/*
+	Maestro on the end of the line. Commands are decoded a byte at
+	a time as the Maestro does; anything out of place counts as a
+	protocol error. The last SIM_LOG bytes received are kept so the
+	streams of different ports can be compared. A port type for
+	PMCtrlT: plain (not virtual) write, available and read.
+*/
+class MaestroSim
+{
+	public:
+		MaestroSim (int deviceID)
+		{
+			_deviceID = deviceID;
+			reset ();
+		}
+		void reset ()
+		{
+			memset (targets, 0, sizeof (targets));
+			memset (speeds, 0, sizeof (speeds));
+			memset (accelerations, 0, sizeof (accelerations));
+			errors = 0;
+			protocolErrors = 0;
+			commands = 0;
+			answer = true;
+			bytes = 0;
+			_length = 0;
+			_replyLength = 0;
+			memset (_command, 0, sizeof (_command));
+		}
+		size_t write (uint8_t b)
+		{
+			log[bytes++ % SIM_LOG] = b;
+			if (b == 0xAA)
+				_length = 0;
+			else if ((_length == 0) || (b & 0x80))	// data bytes are 7 bit
+			{
+				protocolErrors++;
+				_length = 0;
+				return 1;
+			}
+			_command[_length++] = b;
+			if ((_length >= 2) && (_command[1] != _deviceID))
+			{
+				protocolErrors++;
+				_length = 0;
+				return 1;
+			}
+			if (_length >= 3)
+				decode ();
+			return 1;
+		}
+		int available ()
+		{
+			return _replyLength;
+		}
+		int read ()
+		{
+			if (_replyLength == 0)
+				return -1;
+			return _reply[2 - _replyLength--];
+		}
+		unsigned int targets[SIM_CHANNELS];		// quarter us
+		unsigned int speeds[SIM_CHANNELS];
+		unsigned int accelerations[SIM_CHANNELS];
+		unsigned int errors;
+		long protocolErrors;
+		long commands;
+		boolean answer;							// false = never replies
+		unsigned long bytes;
+		uint8_t log[SIM_LOG];
+	private:
+		/*
+			Acts on a command once all of its bytes are in
+		*/
+		void decode ()
+		{
+			byte channel = _command[3];
+			unsigned int value = _command[4] | (_command[5] << 7);
+			switch (_command[2])
+			{
+				case 0x04:
+				case 0x07:
+				case 0x09:
+					if (_length < 6)
+						return;
+					if (channel >= SIM_CHANNELS)
+						protocolErrors++;
+					else if (_command[2] == 0x04)
+						targets[channel] = value;
+					else if (_command[2] == 0x07)
+						speeds[channel] = value;
+					else
+						accelerations[channel] = value;
+					break;
+				case 0x10:
+					if (_length < 4)
+						return;
+					if (channel >= SIM_CHANNELS)
+						protocolErrors++;
+					else
+						reply (targets[channel]);
+					break;
+				case 0x21:
+					reply (errors);
+					errors = 0;					// reading clears the errors
+					break;
+				case 0x22:
+					memset (targets, 0, sizeof (targets));
+					break;
+				default:
+					protocolErrors++;
+			}
+			commands++;
+			_length = 0;
+		}
+		void reply (unsigned int value)
+		{
+			if (!answer)
+				return;
+			_reply[0] = value & 0xFF;
+			_reply[1] = value >> 8;
+			_replyLength = 2;
+		}
+		int _deviceID;
+		uint8_t _command[6];
+		byte _length;
+		uint8_t _reply[2];
+		byte _replyLength;
+};
+
+/*
+	The simulator behind a Stream, for PMStreamPort
+*/
+class MaestroStream : public Stream
+{
+	public:
+		MaestroStream (MaestroSim &sim) : _sim (sim) {}
+		size_t write (uint8_t b) { return _sim.write (b); }
+		int available () { return _sim.available (); }
+		int read () { return _sim.read (); }
+		int peek () { return -1; }
+		using Print::write;
+	private:
+		MaestroSim &_sim;
+};
+
+/*
+	SoftwareSerial onto the simulator, for PMCtrl
+*/
+static MaestroSim *softSerialSim = NULL;
+
+SoftwareSerial::SoftwareSerial (uint8_t receivePin, uint8_t transmitPin, bool inverse_logic) {}
+SoftwareSerial::~SoftwareSerial () {}
+void SoftwareSerial::begin (long speed) {}
+bool SoftwareSerial::listen () { return true; }
+void SoftwareSerial::end () {}
+void SoftwareSerial::flush () {}
+size_t SoftwareSerial::write (uint8_t b) { return softSerialSim->write (b); }
+int SoftwareSerial::available () { return softSerialSim->available (); }
+int SoftwareSerial::peek () { return -1; }
+int SoftwareSerial::read () { return softSerialSim->read (); }
+
+#define DEVICE_ID 12
+
+/*
+	Sends every command through 'ctrl' to 'sim' and checks what
+	the simulator made of them
+*/
+static void protocol (const char *name, PMCtrlBase &ctrl, MaestroSim &sim)
+{
+	char check[64];
+	sim.reset ();
+	ctrl.setTarget (1500, 0, DEVICE_ID);
+	ctrl.setTarget (2400, 5, DEVICE_ID);
+	ctrl.setServoSpeed (140, 1, DEVICE_ID);
+	ctrl.setAcceleration (3, 2, DEVICE_ID);
+	ctrl.setServoSpeed (0x3FFF, 23, DEVICE_ID);		// largest 14 bit value
+	snprintf (check, sizeof (check), "%s: set commands decoded", name);
+	result (check, (sim.targets[0] == 6000) && (sim.targets[5] == 9600) && (sim.speeds[1] == 140)
+		&& (sim.accelerations[2] == 3) && (sim.speeds[23] == 0x3FFF) && (sim.protocolErrors == 0));
+
+	unsigned int pos = ctrl.getPosition (5, DEVICE_ID);
+	snprintf (check, sizeof (check), "%s: getPosition", name);
+	result (check, (pos == 2400) && ctrl.isReadOk ());
+
+	sim.errors = 0x0102;
+	unsigned int errors = ctrl.getErrors (0, DEVICE_ID);
+	snprintf (check, sizeof (check), "%s: getErrors", name);
+	result (check, (errors == 0x0102) && ctrl.isReadOk ());
+
+	sim.answer = false;
+	pos = ctrl.getPosition (5, DEVICE_ID);
+	snprintf (check, sizeof (check), "%s: no reply times out", name);
+	result (check, (pos == 0) && !ctrl.isReadOk ());
+	sim.answer = true;
+
+	ctrl.goHome (DEVICE_ID);
+	snprintf (check, sizeof (check), "%s: goHome", name);
+	result (check, (sim.targets[0] == 0) && (sim.targets[5] == 0) && (sim.protocolErrors == 0) && (sim.commands == 9));
+}
+
+/*
+	Commands per second through 'ctrl' on this PC: setTarget sweeps
+	(6 bytes each) and getPosition round trips (4 out, 2 back)
+*/
+static void commandRate (PMCtrlBase &ctrl, double *setRate, double *getRate)
+{
+	const long sets = 20000000;
+	const long gets = 5000000;
+	clock_t start = clock ();
+	for (long i = 0; i < sets; i++)
+		ctrl.setTarget (1000 + (i & 1023), i % SIM_CHANNELS, DEVICE_ID);
+	*setRate = sets / ((double) (clock () - start) / CLOCKS_PER_SEC);
+	volatile unsigned int sink = 0;
+	start = clock ();
+	for (long i = 0; i < gets; i++)
+		sink += ctrl.getPosition (i % SIM_CHANNELS, DEVICE_ID);
+	*getRate = gets / ((double) (clock () - start) / CLOCKS_PER_SEC);
+	(void) sink;
+}
+
+int main (int argc, char *argv[])
+{
+	long baud = (argc > 1) ? atol (argv[1]) : 57600;
+
+	MaestroSim simT (DEVICE_ID);
+	MaestroSim simSoft (DEVICE_ID);
+	MaestroSim simStream (DEVICE_ID);
+	softSerialSim = &simSoft;
+	MaestroStream stream (simStream);
+	PMStreamPort streamPort (stream);
+
+	PMCtrlT<MaestroSim> ctrlT (simT);
+	PMCtrl ctrlSoft (11, 3, baud);
+	PMCtrlT<PMStreamPort> ctrlStream (streamPort);
+
+	protocol ("PMCtrlT<MaestroSim>", ctrlT, simT);
+	protocol ("PMCtrl (SoftwareSerial)", ctrlSoft, simSoft);
+	protocol ("PMCtrlT<PMStreamPort>", ctrlStream, simStream);
+	result ("same bytes on every port", (simT.bytes == simSoft.bytes) && (simT.bytes == simStream.bytes)
+		&& (memcmp (simT.log, simSoft.log, SIM_LOG) == 0) && (memcmp (simT.log, simStream.log, SIM_LOG) == 0));
+	printf ("\n");
+
+	struct { const char *name; PMCtrlBase *ctrl; MaestroSim *sim; } ports[] = {
+		{ "PMCtrlT<MaestroSim>", &ctrlT, &simT },
+		{ "PMCtrl (SoftwareSerial)", &ctrlSoft, &simSoft },
+		{ "PMCtrlT<PMStreamPort>", &ctrlStream, &simStream } };
+	printf ("commands per second on this PC:\n");
+	printf ("%-26s %14s %14s\n", "port", "setTarget", "getPosition");
+	long protocolErrors = 0;
+	for (unsigned int i = 0; i < sizeof (ports) / sizeof (ports[0]); i++)
+	{
+		double setRate, getRate;
+		ports[i].sim->reset ();
+		commandRate (*ports[i].ctrl, &setRate, &getRate);
+		protocolErrors += ports[i].sim->protocolErrors;
+		printf ("%-26s %14.0f %14.0f\n", ports[i].name, setRate, getRate);
+	}
+	// 10 bits a byte (start, 8 data, stop), 6 bytes a command
+	printf ("serial line at %-6ld baud   %14.0f %14.0f\n", baud, baud / 10.0 / 6, baud / 10.0 / 6);
+	result ("no protocol errors while timing", protocolErrors == 0);
+
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
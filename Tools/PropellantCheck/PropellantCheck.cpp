@@ -0,0 +1,318 @@
+/*
+ Title: PropellantCheck.cpp
+  Description: Host tool that checks the Propellant library
+	tables against the models they were made from, using the
+	same code that runs on the Arduino:
+		(1) the models are checked at 1 atm, where the gases
+			are nearly ideal, and against published liquid
+			densities
+		(2) getGasZ, getGasK and getGasDensity are compared with
+			the model every 1K and 5psi over the whole grid
+		(3) getLiquidDensity is compared with the correlation
+			every 0.1K
+	Each check prints PASS or FAIL and the exit status is the
+	number of failures.
+
+	Gas models: the Peng-Robinson equation of state with the
+	ideal gas heat capacity from the NIST Shomate equations.
+	Z is the vapour root of the cubic and k the isentropic
+	exponent, from Cp / Cv (with the real gas Cv departure and
+	Cp - Cv from the equation of state) times the isothermal
+	one. Air is treated as one gas with pseudo critical
+	constants and 79% N2 / 21% O2 heat capacity.
+	Liquid models: DIPPR equation 105 for ethanol and Kell's
+	(1975) equation for water.
+
+	With -g the tables for Propellant.cpp are printed instead.
+
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../Propellant PropellantCheck.cpp ../../Propellant/Propellant.cpp -o PropellantCheck
+	Usage:
+		PropellantCheck [-g]
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "Arduino.h"
+#include "Propellant.h"
+
+#define R_MOLAR 8.314462618		// J/(mol K)
+#define PSI2PA 6894.75729
+#define ATM_PSI 14.696
+
+static int failures = 0;
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-48s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+typedef struct
+{
+	const char *name;
+	double tc;					// critical temperature (K)
+	double pc;					// critical pressure (Pa)
+	double omega;				// acentric factor
+	double m;					// molecular mass (g/mol)
+	double n2;					// fraction of N2 heat capacity (rest O2)
+} GasModel;
+
+// In the order of PROP_O2, PROP_N2, PROP_AIR
+static const GasModel gases[PROP_GASES] =
+{
+	{ "O2",		154.58,		5.043e6,	0.022,		31.999,		0.0 },
+	{ "N2",		126.19,		3.396e6,	0.037,		28.013,		1.0 },
+	{ "air",	132.63,		3.786e6,	0.035,		28.97,		0.79 }
+};
+
+// Shomate coefficients (NIST), Cp = A + B t + C t^2 + D t^3 + E / t^2, t = T / 1000
+static const double shomateO2[] = {31.32234, -20.23531, 57.86644, -36.50624, -0.007374};
+static const double shomateN2[] = {28.98641, 1.853978, -9.647459, 16.63537, 0.000117};
+
+static double shomate (const double *c, double kelvin)
+{
+	double t = kelvin / 1000.0;
+	return c[0] + c[1] * t + c[2] * t * t + c[3] * t * t * t + c[4] / (t * t);
+}
+
+/*
+	Ideal gas molar heat capacity (J/(mol K))
+*/
+static double idealCp (const GasModel &gas, double kelvin)
+{
+	return gas.n2 * shomate (shomateN2, kelvin) + (1.0 - gas.n2) * shomate (shomateO2, kelvin);
+}
+
+/*
+	Peng-Robinson Z and k at 'kelvin' and 'psi' (absolute). k is
+	the isentropic exponent -(v/p)(dp/dv)s, which is Cp / Cv for an
+	ideal gas and the value that keeps the ideal gas orifice
+	equations right for a real one.
+*/
+static void pengRobinson (const GasModel &gas, double kelvin, double psi, double *z, double *k)
+{
+	if (psi <= 0)
+	{
+		*z = 1.0;
+		*k = idealCp (gas, kelvin) / (idealCp (gas, kelvin) - R_MOLAR);
+		return;
+	}
+	double p = psi * PSI2PA;
+	double a = 0.45724 * R_MOLAR * R_MOLAR * gas.tc * gas.tc / gas.pc;
+	double b = 0.07780 * R_MOLAR * gas.tc / gas.pc;
+	double kappa = 0.37464 + 1.54226 * gas.omega - 0.26992 * gas.omega * gas.omega;
+	double s = sqrt (kelvin / gas.tc);
+	double alpha = pow (1.0 + kappa * (1.0 - s), 2);
+	double aT = a * alpha;
+	double daT = -a * kappa * (1.0 + kappa * (1.0 - s)) / sqrt (kelvin * gas.tc);
+	double d2aT = a * kappa * (1.0 + kappa) / (2.0 * sqrt (gas.tc) * pow (kelvin, 1.5));
+
+	// vapour (largest) root of Z^3 - (1 - B) Z^2 + (A - 3B^2 - 2B) Z - (AB - B^2 - B^3)
+	double A = aT * p / pow (R_MOLAR * kelvin, 2);
+	double B = b * p / (R_MOLAR * kelvin);
+	double c2 = -(1.0 - B), c1 = A - 3 * B * B - 2 * B, c0 = -(A * B - B * B - B * B * B);
+	double zz = 1.5;
+	for (int i = 0; i < 100; i++)
+	{
+		double f = ((zz + c2) * zz + c1) * zz + c0;
+		double df = (3 * zz + 2 * c2) * zz + c1;
+		double step = f / df;
+		zz -= step;
+		if (fabs (step) < 1e-12)
+			break;
+	}
+	*z = zz;
+
+	double v = zz * R_MOLAR * kelvin / p;
+	double denom = v * v + 2 * b * v - b * b;
+	double dPdT = R_MOLAR / (v - b) - daT / denom;
+	double dPdv = -R_MOLAR * kelvin / pow (v - b, 2) + aT * (2 * v + 2 * b) / (denom * denom);
+	double cvDeparture = kelvin * d2aT / (2 * sqrt (2.0) * b)
+		* log ((zz + (1 + sqrt (2.0)) * B) / (zz + (1 - sqrt (2.0)) * B));
+	double cv = idealCp (gas, kelvin) - R_MOLAR + cvDeparture;
+	double cp = cv - kelvin * dPdT * dPdT / dPdv;
+	*k = -(v / p) * (cp / cv) * dPdv;
+}
+
+/*
+	Liquid density (kg/m^3)
+*/
+static double liquidDensity (byte liquid, double kelvin)
+{
+	if (liquid == PROP_ETHANOL)
+	{
+		// DIPPR 105: kmol/m^3 times the molecular mass
+		return 1.648 / pow (0.27627, 1.0 + pow (1.0 - kelvin / 513.92, 0.2331)) * 46.069;
+	}
+	double t = fmax (kelvin - 273.15, 0.0);	// taken as at 0C below freezing
+	return (999.83952 + 16.945176 * t - 7.9870401e-3 * t * t - 46.170461e-6 * pow (t, 3)
+		+ 105.56302e-9 * pow (t, 4) - 280.54253e-12 * pow (t, 5)) / (1.0 + 16.879850e-3 * t);
+}
+
+static double gridKelvin (int i)
+{
+	return PROP_GAS_MIN_K + (PROP_GAS_MAX_K - PROP_GAS_MIN_K) * i / (PROP_GAS_T_STEPS - 1);
+}
+
+static double gridPSI (int j)
+{
+	return PROP_GAS_MAX_PSI * j / (PROP_GAS_P_STEPS - 1);
+}
+
+static double liquidKelvin (int i)
+{
+	return PROP_LIQUID_MIN_K + (PROP_LIQUID_MAX_K - PROP_LIQUID_MIN_K) * i / (PROP_LIQUID_T_STEPS - 1);
+}
+
+/*
+	Prints the tables used by Propellant.cpp. Rows are temperature,
+	columns pressure.
+*/
+static void generate ()
+{
+	const char *tables[] = { "propGasZ", "propGasK" };
+	for (int t = 0; t < 2; t++)
+	{
+		printf ("const uint16_t %s[PROP_GASES][PROP_GAS_T_STEPS][PROP_GAS_P_STEPS] PROGMEM =\n{\n", tables[t]);
+		for (int g = 0; g < PROP_GASES; g++)
+		{
+			printf ("\t{\t// %s\n", gases[g].name);
+			for (int i = 0; i < PROP_GAS_T_STEPS; i++)
+			{
+				printf ("\t\t{");
+				for (int j = 0; j < PROP_GAS_P_STEPS; j++)
+				{
+					double z, k;
+					pengRobinson (gases[g], gridKelvin (i), gridPSI (j), &z, &k);
+					printf ("%s%.0f", (j > 0) ? ", " : "", ((t == 0) ? z : k) * PROP_GAS_SCALE);
+				}
+				printf ("}%s\t// %.0fK\n", (i < PROP_GAS_T_STEPS - 1) ? "," : "", gridKelvin (i));
+			}
+			printf ("\t}%s\n", (g < PROP_GASES - 1) ? "," : "");
+		}
+		printf ("};\n\n");
+	}
+	printf ("const uint16_t propLiquidDensity[PROP_LIQUIDS][PROP_LIQUID_T_STEPS] PROGMEM =\n{\n");
+	const char *liquids[] = { "ethanol", "water" };
+	for (int l = 0; l < PROP_LIQUIDS; l++)
+	{
+		printf ("\t{");
+		for (int i = 0; i < PROP_LIQUID_T_STEPS; i++)
+			printf ("%s%.0f", (i > 0) ? ", " : "", liquidDensity (l + 1, liquidKelvin (i)) * PROP_LIQUID_SCALE);
+		printf ("}%s\t// %s\n", (l < PROP_LIQUIDS - 1) ? "," : "", liquids[l]);
+	}
+	printf ("};\n");
+}
+
+/*
+	Models against values they must reproduce
+*/
+static void checkModels ()
+{
+	bool pass = true;
+	for (int g = 0; g < PROP_GASES; g++)
+	{
+		double z, k;
+		pengRobinson (gases[g], 300.0, ATM_PSI, &z, &k);
+		printf ("  %-4s 300K 1atm: Z %.5f k %.4f\n", gases[g].name, z, k);
+		if ((fabs (z - 1.0) > 0.002) || (fabs (k - 1.40) > 0.006))
+			pass = false;
+	}
+	result ("gases nearly ideal at 1 atm (Z 1, k 1.40)", pass);
+
+	// published densities (CRC Handbook)
+	static const double published[][3] = { {PROP_ETHANOL, 293.15, 789.3}, {PROP_WATER, 277.13, 999.97},
+		{PROP_WATER, 293.15, 998.21}, {PROP_WATER, 333.15, 983.2} };
+	pass = true;
+	for (unsigned i = 0; i < sizeof (published) / sizeof (published[0]); i++)
+	{
+		double den = liquidDensity (published[i][0], published[i][1]);
+		printf ("  %-7s %.2fK: %.2f kg/m^3, published %.2f\n", (published[i][0] == PROP_ETHANOL) ? "ethanol" : "water",
+			published[i][1], den, published[i][2]);
+		if (fabs (den / published[i][2] - 1.0) > 0.002)
+			pass = false;
+	}
+	result ("liquid densities within 0.2% of published", pass);
+}
+
+static void checkGases ()
+{
+	for (int g = 0; g < PROP_GASES; g++)
+	{
+		double worstZ = 0, worstK = 0, worstDen = 0;
+		double zAt[2] = {0, 0}, kAt[2] = {0, 0};
+		for (double kelvin = PROP_GAS_MIN_K; kelvin <= PROP_GAS_MAX_K; kelvin += 1.0)
+			for (double psi = ATM_PSI; psi <= PROP_GAS_MAX_PSI; psi += 5.0)
+			{
+				double z, k;
+				pengRobinson (gases[g], kelvin, psi, &z, &k);
+				double den = psi * PSI2PA * gases[g].m / 1000.0 / (z * R_MOLAR * kelvin);
+				double errorZ = fabs (Propellant::getGasZ (g + 1, kelvin, psi) / z - 1.0);
+				double errorK = fabs (Propellant::getGasK (g + 1, kelvin, psi) / k - 1.0);
+				double errorDen = fabs (Propellant::getGasDensity (g + 1, kelvin, psi) / den - 1.0);
+				if (errorZ > worstZ)
+				{
+					worstZ = errorZ;
+					zAt[0] = kelvin;
+					zAt[1] = psi;
+				}
+				if (errorK > worstK)
+				{
+					worstK = errorK;
+					kAt[0] = kelvin;
+					kAt[1] = psi;
+				}
+				worstDen = fmax (worstDen, errorDen);
+			}
+		printf ("%s: worst error Z %.3f%% (%.0fK %.0fpsi), k %.3f%% (%.0fK %.0fpsi), density %.3f%%\n",
+			gases[g].name, worstZ * 100, zAt[0], zAt[1], worstK * 100, kAt[0], kAt[1], worstDen * 100);
+		char check[64];
+		sprintf (check, "%s Z, density and k within 0.5%%", gases[g].name);
+		result (check, (worstZ < 0.005) && (worstDen < 0.005) && (worstK < 0.005));
+	}
+	result ("gas lookups clamp outside the grid",
+		(Propellant::getGasZ (PROP_O2, 100, -50) == Propellant::getGasZ (PROP_O2, PROP_GAS_MIN_K, 0)) &&
+		(Propellant::getGasK (PROP_N2, 400, 2000) == Propellant::getGasK (PROP_N2, PROP_GAS_MAX_K, PROP_GAS_MAX_PSI)));
+	result ("PROP_FIXED gas gives NAN", isnan (Propellant::getGasZ (PROP_FIXED, 300, 500)));
+}
+
+static void checkLiquids ()
+{
+	for (int l = 1; l <= PROP_LIQUIDS; l++)
+	{
+		double worst = 0, worstAt = 0;
+		for (double kelvin = PROP_LIQUID_MIN_K; kelvin <= PROP_LIQUID_MAX_K; kelvin += 0.1)
+		{
+			double error = fabs (Propellant::getLiquidDensity (l, kelvin) - liquidDensity (l, kelvin));
+			if (error > worst)
+			{
+				worst = error;
+				worstAt = kelvin;
+			}
+		}
+		const char *name = (l == PROP_ETHANOL) ? "ethanol" : "water";
+		printf ("%s: worst error %.3f kg/m^3 at %.1fK\n", name, worst, worstAt);
+		char check[64];
+		sprintf (check, "%s density within 0.5 kg/m^3", name);
+		result (check, worst < 0.5);
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	if (argc > 1 && strcmp (argv[1], "-g") == 0)
+	{
+		generate ();
+		return 0;
+	}
+	checkModels ();
+	printf ("\n");
+	checkGases ();
+	printf ("\n");
+	checkLiquids ();
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
@@ -0,0 +1,256 @@
+/*
+ Title: SafetyCheck.cpp
+  Description: Host tool that checks the EngineController redlines
+	(the dangerRules table, SafetyMonitor) trip where and when they
+	should. The sketch and its libraries are compiled for the PC
+	(as in Tools/TraceReplay) and isDanger() is called once per
+	sensor tick (every TICK_MS, the rate of the CSV output while
+	firing) on a virtual clock, with the igniter and engine
+	readings held at safe values except for the fault injected
+	into one channel:
+		over limit	a reading past its min or max from one sample
+		rate		readings that swing by more than the rule's
+					maxRate between two samples
+		persistence	violations shorter than the rule's persistence,
+					broken by a good sample, which must never trip
+	For each fault the rule that trips, the reason, the sample and
+	the tick (StopWatch time) are compared with what the table
+	says: the first violating sample plus persistence - 1, and a
+	reported latency of (persistence - 1) ticks. Each isDanger()
+	mode is checked with the rules it should and should not arm
+	(eg. the no-go limits are off while pressure builds and the
+	engine limits are on while the main valves open). A reading
+	that is not a number (a failed sensor) must trip its armed
+	rules like a violation and must not trip a disarmed one.
+	Each check prints PASS or FAIL and the exit status is the
+	number of failures.
+
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../BufferArena -I../../InputTrace -I../../EventJournal -I../../EngineMath -I../../Transducer -I../../ThermocoupleBank -I../../ChannelTable -I../../StopWatch -I../../SoftwareSerial -I../../PMCtrl -I../../ServoProfile -I../../LoadCell -I../../ImpulseCalc -I../../SafetyMonitor -I../../FastStop -I../../FailSafe -I../../SensorHealth -I../../SupplyMonitor -I../../SensorFilter -I../../TypeK -I../../ConfigStore -I../../ThrottleControl -I../../Propellant -x c++ -include Arduino.h ../../EngineController/EngineController.ino -x none SafetyCheck.cpp ../HostShim/HostArduino.cpp ../../BufferArena/BufferArena.cpp ../../InputTrace/InputTrace.cpp ../../EventJournal/EventJournal.cpp ../../EngineMath/EngineMath.cpp ../../Transducer/Transducer.cpp ../../Transducer/TransducerCal.cpp ../../ThermocoupleBank/ThermocoupleBank.cpp ../../ChannelTable/ChannelTable.cpp ../../StopWatch/StopWatch.cpp ../../PMCtrl/PMCtrl.cpp ../../ServoProfile/ServoProfile.cpp ../../LoadCell/LoadCell.cpp ../../ImpulseCalc/ImpulseCalc.cpp ../../SafetyMonitor/SafetyMonitor.cpp ../../FastStop/FastStop.cpp ../../FailSafe/FailSafe.cpp ../../SensorHealth/SensorHealth.cpp ../../SupplyMonitor/SupplyMonitor.cpp ../../SensorFilter/SensorFilter.cpp ../../TypeK/TypeK.cpp ../../ConfigStore/ConfigStore.cpp ../../ThrottleControl/ThrottleControl.cpp ../../Propellant/Propellant.cpp -o SafetyCheck
+	Usage:
+		SafetyCheck
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "Arduino.h"
+#include "StopWatch.h"
+#include "SafetyMonitor.h"
+#include "SoftwareSerial.h"
+
+// EngineController.ino
+extern StopWatch sw;
+extern SafetyMonitor safety;
+extern float sensorValues[];
+boolean isDanger (int toCheck);
+
+// EngineController channels (CH_ numbers) and isDanger() modes
+#define CH_IGNITER_PSI 6
+#define CH_IGNITER_TEMP 7
+#define CH_ENGINE_PSI 9
+#define CH_ENGINE_TEMP 11
+#define CHECK_ALL 0
+#define CHECK_IGNITER 1
+#define CHECK_ENGINE 2
+#define CHECK_EXCESS 3
+#define CHECK_MAIN_VALVES 4
+
+#define TICK_MS 25				// sensor tick while firing (one CSV line)
+#define FAULT_SAMPLE 20			// first sample of the fault
+#define SAMPLES 200
+
+static int failures = 0;
+static unsigned long long virtualMicros = 0;
+static std::string output;
+
+// the Maestro link is not used by isDanger()
+SoftwareSerial::SoftwareSerial (uint8_t receivePin, uint8_t transmitPin, bool inverse_logic) {}
+SoftwareSerial::~SoftwareSerial () {}
+void SoftwareSerial::begin (long speed) {}
+bool SoftwareSerial::listen () { return true; }
+void SoftwareSerial::end () {}
+void SoftwareSerial::flush () {}
+size_t SoftwareSerial::write (uint8_t b) { return 1; }
+int SoftwareSerial::available () { return 0; }
+int SoftwareSerial::peek () { return -1; }
+int SoftwareSerial::read () { return -1; }
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-76s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+static unsigned long simMicros ()
+{
+	return (unsigned long) virtualMicros;
+}
+
+static void simSerialWrite (uint8_t c)
+{
+	output += (char) c;
+}
+
+/*
+	Reading of the faulty channel at sample 'n' (the fault starts at
+	FAULT_SAMPLE)
+*/
+typedef float (*FaultShape) (int n, float safe, float fault);
+
+static float step (int n, float safe, float fault)
+{
+	return (n >= FAULT_SAMPLE) ? fault : safe;
+}
+
+// two bad samples in every three: never 'persistence' 3 in a row
+static float pulses (int n, float safe, float fault)
+{
+	return ((n >= FAULT_SAMPLE) && ((n - FAULT_SAMPLE) % 3 != 2)) ? fault : safe;
+}
+
+// swings between safe and fault every sample
+static float oscillate (int n, float safe, float fault)
+{
+	return ((n >= FAULT_SAMPLE) && ((n - FAULT_SAMPLE) % 2 == 1)) ? fault : safe;
+}
+
+// not a number from the fault on
+static float missing (int n, float safe, float fault)
+{
+	return (n >= FAULT_SAMPLE) ? NAN : safe;
+}
+
+struct Trip
+{
+	int sample;				// -1 = no trip
+	unsigned long tick;		// StopWatch time of the trip
+	int rule;
+	byte reason;
+	unsigned long latency;
+};
+
+/*
+	Runs SAMPLES ticks of isDanger(mode) with the fault on one
+	channel and returns the first trip
+*/
+static Trip run (int mode, int channel, FaultShape shape, float fault)
+{
+	// safe readings: inside every limit and above the no-go limits
+	float safe[] = { 100, 200, 100, 200 };
+	int channels[] = { CH_IGNITER_PSI, CH_IGNITER_TEMP, CH_ENGINE_PSI, CH_ENGINE_TEMP };
+	Trip trip = { -1, 0, SAFETY_OK, 0, 0 };
+	virtualMicros = 0;
+	safety.reset ();
+	sw.startTimer (SAMPLES * TICK_MS);
+	output.clear ();
+	for (int n = 0; n < SAMPLES; n++)
+	{
+		virtualMicros = (unsigned long long) n * TICK_MS * 1000;
+		for (int i = 0; i < 4; i++)
+			sensorValues[channels[i]] = (channels[i] == channel) ? shape (n, safe[i], fault) : safe[i];
+		if (isDanger (mode) == true)
+		{
+			trip.sample = n;
+			trip.tick = sw.timeElapsed ();
+			trip.rule = safety.lastTrip ();
+			trip.reason = safety.lastTripReason ();
+			trip.latency = safety.lastTripLatency ();
+			return trip;
+		}
+	}
+	return trip;
+}
+
+/*
+	A fault that must trip 'rule' for 'reason' at 'sample'
+*/
+static void expectTrip (const char *name, int mode, int channel, FaultShape shape, float fault,
+						int rule, byte reason, int sample)
+{
+	char check[160];
+	Trip trip = run (mode, channel, shape, fault);
+	unsigned long latency = (unsigned long) (sample - (FAULT_SAMPLE + ((shape == oscillate) ? 1 : 0))) * TICK_MS;
+	snprintf (check, sizeof (check), "%s: rule %d at sample %d, %lums (latency %lums)", name, trip.rule, trip.sample,
+		trip.tick, trip.latency);
+	result (check, (trip.rule == rule) && (trip.reason == reason) && (trip.sample == sample) &&
+		(trip.tick == (unsigned long) sample * TICK_MS) && (trip.latency == latency) &&
+		(output.find ("DANGER: ") != std::string::npos));
+}
+
+/*
+	A fault that must not trip
+*/
+static void expectNoTrip (const char *name, int mode, int channel, FaultShape shape, float fault)
+{
+	char check[160];
+	Trip trip = run (mode, channel, shape, fault);
+	snprintf (check, sizeof (check), "%s: no trip in %d samples", name, SAMPLES);
+	result (check, trip.sample < 0);
+}
+
+int main (int argc, char *argv[])
+{
+	hostMicros = simMicros;
+	hostSerialWrite = simSerialWrite;
+
+	// dangerRules rows: 0 igniterPSI max 150 (3), 1 igniterTemp max 400 (3),
+	// 2 igniterPSI min 50 (no-go, 3), 3 enginePSI max 200 (3),
+	// 4 enginePSI rate 5000/s (2), 5 engineTemp max 400 (3),
+	// 6 enginePSI min 50 (no-go, 3). Persistence 3 trips on the 3rd
+	// violating sample.
+	for (int mode = CHECK_ALL; mode <= CHECK_MAIN_VALVES; mode++)
+	{
+		char name[64];
+		snprintf (name, sizeof (name), "mode %d, safe readings", mode);
+		expectNoTrip (name, mode, -1, step, 0);
+	}
+
+	// over limit
+	expectTrip ("enginePSI 250 (max 200)", CHECK_ENGINE, CH_ENGINE_PSI, step, 250, 3, SAFETY_TRIP_HIGH, FAULT_SAMPLE + 2);
+	expectTrip ("engineTemp 450 (max 400)", CHECK_ENGINE, CH_ENGINE_TEMP, step, 450, 5, SAFETY_TRIP_HIGH, FAULT_SAMPLE + 2);
+	expectTrip ("igniterPSI 160 (max 150)", CHECK_IGNITER, CH_IGNITER_PSI, step, 160, 0, SAFETY_TRIP_HIGH, FAULT_SAMPLE + 2);
+	expectTrip ("igniterTemp 450 (max 400)", CHECK_IGNITER, CH_IGNITER_TEMP, step, 450, 1, SAFETY_TRIP_HIGH, FAULT_SAMPLE + 2);
+	expectTrip ("igniterPSI 30 (no-go 50)", CHECK_IGNITER, CH_IGNITER_PSI, step, 30, 2, SAFETY_TRIP_LOW, FAULT_SAMPLE + 2);
+	expectTrip ("enginePSI 30 (no-go 50)", CHECK_ENGINE, CH_ENGINE_PSI, step, 30, 6, SAFETY_TRIP_LOW, FAULT_SAMPLE + 2);
+	expectTrip ("all: enginePSI 250", CHECK_ALL, CH_ENGINE_PSI, step, 250, 3, SAFETY_TRIP_HIGH, FAULT_SAMPLE + 2);
+
+	// rate: 100 <-> 30 is 2800/s, 100 <-> 240 is 5600/s (limit 5000/s).
+	// The first swing is at FAULT_SAMPLE + 1, persistence 2.
+	expectNoTrip ("enginePSI swings 2800/s (rate 5000/s)", CHECK_EXCESS, CH_ENGINE_PSI, oscillate, 30);
+	expectTrip ("enginePSI swings 5600/s (rate 5000/s)", CHECK_EXCESS, CH_ENGINE_PSI, oscillate, 240, 4,
+		SAFETY_TRIP_RATE, FAULT_SAMPLE + 2);
+
+	// persistence (enginePSI 210 so the steps stay under the rate limit)
+	expectNoTrip ("enginePSI 210 for 2 samples in 3", CHECK_ENGINE, CH_ENGINE_PSI, pulses, 210);
+	expectNoTrip ("igniterTemp 450 for 2 samples in 3", CHECK_IGNITER, CH_IGNITER_TEMP, pulses, 450);
+
+	// failed sensor: every armed enginePSI rule is violated, the rate
+	// rule (persistence 2) trips first
+	expectTrip ("enginePSI not a number", CHECK_ALL, CH_ENGINE_PSI, missing, 0, 4, SAFETY_TRIP_INVALID, FAULT_SAMPLE + 1);
+	expectTrip ("engineTemp not a number", CHECK_ENGINE, CH_ENGINE_TEMP, missing, 0, 5, SAFETY_TRIP_INVALID,
+		FAULT_SAMPLE + 2);
+	expectTrip ("igniterPSI not a number", CHECK_IGNITER, CH_IGNITER_PSI, missing, 0, 0, SAFETY_TRIP_INVALID,
+		FAULT_SAMPLE + 2);
+	expectNoTrip ("igniter only: engineTemp not a number", CHECK_IGNITER, CH_ENGINE_TEMP, missing, 0);
+
+	// the phases arm the right rules
+	expectNoTrip ("excess only: igniterPSI 30 (no-go off)", CHECK_EXCESS, CH_IGNITER_PSI, step, 30);
+	expectNoTrip ("excess only: enginePSI 30 (no-go off)", CHECK_EXCESS, CH_ENGINE_PSI, step, 30);
+	expectTrip ("excess only: enginePSI 250", CHECK_EXCESS, CH_ENGINE_PSI, step, 250, 3, SAFETY_TRIP_HIGH, FAULT_SAMPLE + 2);
+	expectNoTrip ("igniter only: enginePSI 250", CHECK_IGNITER, CH_ENGINE_PSI, step, 250);
+	expectNoTrip ("engine only: igniterTemp 450", CHECK_ENGINE, CH_IGNITER_TEMP, step, 450);
+	expectTrip ("main valves: enginePSI 250", CHECK_MAIN_VALVES, CH_ENGINE_PSI, step, 250, 3, SAFETY_TRIP_HIGH,
+		FAULT_SAMPLE + 2);
+	expectTrip ("main valves: engineTemp 450", CHECK_MAIN_VALVES, CH_ENGINE_TEMP, step, 450, 5, SAFETY_TRIP_HIGH,
+		FAULT_SAMPLE + 2);
+	expectTrip ("main valves: enginePSI swings 5600/s", CHECK_MAIN_VALVES, CH_ENGINE_PSI, oscillate, 240, 4,
+		SAFETY_TRIP_RATE, FAULT_SAMPLE + 2);
+	expectTrip ("main valves: igniterPSI 30 (no-go on)", CHECK_MAIN_VALVES, CH_IGNITER_PSI, step, 30, 2, SAFETY_TRIP_LOW,
+		FAULT_SAMPLE + 2);
+	expectNoTrip ("main valves: enginePSI 30 (no-go off)", CHECK_MAIN_VALVES, CH_ENGINE_PSI, step, 30);
+
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
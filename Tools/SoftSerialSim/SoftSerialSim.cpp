@@ -0,0 +1,343 @@
+/*
+ Title: SoftSerialSim.cpp
+  Description: Host tool that checks the Timer1 compare interrupt
+	receive of the SoftwareSerial library (_SS_TIMER_RX) bit by bit,
+	using the library code that runs on the Arduino. The RX line of
+	pin 11 (PB3, PCINT0) is driven with random bytes from a sender
+	whose clock is off by a given error, in CPU cycles at F_CPU.
+	The pin change and compare interrupts are called when the AVR
+	would call them: after the edge or when TCNT1 (clk/8) reaches
+	OCR1A, plus _SS_RX_ISR_CYCLES, and later still if one of the
+	background interrupts below is running:
+		quiet	Timer0 overflow (millis) every 1024us, 5us long
+		busy	quiet plus a HardwareSerial receive interrupt for
+				every byte of a full 57600 baud stream, 4us long
+	TCNT1 and PINB are set for the time the ISR runs. A compare
+	set for a time already gone is not seen until the timer wraps,
+	as on the AVR.
+	Checks, each printing PASS or FAIL (the exit status is the
+	number of failures):
+		(1) at 9600-57600 baud with the sender's clock up to +-2%
+			off: no byte errors when quiet, under 0.1% when busy
+			(a sample can be late by two background interrupts
+			at 57600)
+		(2) each byte costs one pin change and nine compare
+			interrupts (edges within a byte are not seen)
+		(3) a byte with no stop bit is dropped
+	followed by the byte error rate against clock error for each
+	baud and the ISR time per byte next to the old receive, which
+	busy waited in the pin change interrupt for ~9.5 bit times.
+
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../BufferArena -I../../SoftwareSerial SoftSerialSim.cpp ../HostShim/HostArduino.cpp ../../BufferArena/BufferArena.cpp ../../SoftwareSerial/SoftwareSerial.cpp -o SoftSerialSim
+	Usage:
+		SoftSerialSim [bytes]
+			bytes sent per baud, clock error and load (default 5000)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "Arduino.h"
+#include "SoftwareSerial.h"
+
+#if !_SS_TIMER_RX
+#error SoftSerialSim checks the _SS_TIMER_RX receive
+#endif
+
+extern "C" void PCINT0_vect (void);
+extern "C" void TIMER1_COMPA_vect (void);
+
+#define RX_PIN 11
+#define RX_MASK 0x08				// PB3
+#define TIMER_CYCLES 8				// Timer1 clk/8
+#define ISR_BODY_CYCLES 60			// our ISRs hold the CPU this long (estimate)
+
+static int failures = 0;
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-48s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+/*
+	An interrupt that keeps the CPU from ours for 'length' cycles
+	every 'period' cycles
+*/
+struct Background
+{
+	double period;
+	double length;
+	double phase;
+};
+
+/*
+	The RX line: level changes (cycles) and the frames sent
+*/
+struct Frame
+{
+	double start;
+	uint8_t value;
+	bool stopBit;
+	bool received;
+};
+
+struct Line
+{
+	std::vector<double> edgeTime;
+	std::vector<uint8_t> edgeLevel;
+	std::vector<Frame> frames;
+	double bitCycles;
+
+	/*
+		Level at time t (idle high)
+	*/
+	uint8_t level (double t, size_t &cursor) const
+	{
+		while ((cursor < edgeTime.size ()) && (edgeTime[cursor] <= t))
+			cursor++;
+		return (cursor == 0) ? 1 : edgeLevel[cursor - 1];
+	}
+};
+
+static void addLevel (Line &line, double t, uint8_t level)
+{
+	uint8_t last = line.edgeLevel.empty () ? 1 : line.edgeLevel.back ();
+	if (level != last)
+	{
+		line.edgeTime.push_back (t);
+		line.edgeLevel.push_back (level);
+	}
+}
+
+/*
+	'count' random bytes at 'baud' from a sender whose clock is
+	'clockError' (fraction) fast, with 0 - 2 idle bits between them.
+	Every 'badStopEvery'th byte (0 = none) has its stop bit low.
+*/
+static Line makeLine (long baud, double clockError, int count, int badStopEvery)
+{
+	Line line;
+	line.bitCycles = F_CPU / (baud * (1.0 + clockError));
+	double t = 20.0 * line.bitCycles;
+	for (int i = 0; i < count; i++)
+	{
+		Frame f;
+		f.start = t;
+		f.value = rand () & 0xFF;
+		f.stopBit = (badStopEvery == 0) || ((i % badStopEvery) != badStopEvery - 1);
+		f.received = false;
+		addLevel (line, t, 0);
+		for (int b = 0; b < 8; b++)
+			addLevel (line, t + (b + 1) * line.bitCycles, (f.value >> b) & 1);
+		addLevel (line, t + 9 * line.bitCycles, f.stopBit);
+		addLevel (line, t + 10 * line.bitCycles, 1);
+		line.frames.push_back (f);
+		t += (10 + (rand () % 3)) * line.bitCycles;
+	}
+	return line;
+}
+
+/*
+	When an ISR wanted at 't' can start, after any background
+	interrupt running then
+*/
+static double startTime (double t, const std::vector<Background> &load)
+{
+	bool moved = true;
+	while (moved)
+	{
+		moved = false;
+		for (size_t i = 0; i < load.size (); i++)
+		{
+			double since = fmod (t - load[i].phase + 100.0 * load[i].period, load[i].period);
+			if (since < load[i].length - 1e-6)
+			{
+				t += load[i].length - since;
+				moved = true;
+			}
+		}
+	}
+	return t;
+}
+
+struct Outcome
+{
+	long sent;
+	long errors;					// wrong, missing or extra bytes
+	long pinChanges;
+	long compares;
+	long dropped;					// frames sent without a stop bit that were not received
+};
+
+/*
+	Sends 'line' to a SoftwareSerial on RX_PIN and matches what it
+	receives to the frames sent
+*/
+static Outcome run (const Line &line, long baud, const std::vector<Background> &load)
+{
+	Outcome out = { (long) line.frames.size (), 0, 0, 0, 0 };
+	std::vector<Frame> frames = line.frames;
+	PINB = RX_MASK;
+	SoftwareSerial rx (RX_PIN, 3);
+	rx.begin (baud);
+
+	size_t edge = 0;				// next edge not yet seen
+	size_t cursor = 0;
+	double cpuFree = 0;
+	double ocrWritten = 0;
+	size_t frame = 0;
+	for (;;)
+	{
+		// next interrupt: a pin change while it is enabled, or the compare
+		bool pcint = (PCMSK0 & RX_MASK) != 0;
+		bool timer = (TIMSK1 & _BV(OCIE1A)) != 0;
+		double pcintAt = (pcint && (edge < line.edgeTime.size ())) ? line.edgeTime[edge] : -1;
+		double compareAt = -1;
+		if (timer)
+		{
+			unsigned long long k0 = (unsigned long long) (ocrWritten / TIMER_CYCLES) + 1;
+			unsigned long long k = k0 + (uint16_t) (OCR1A - (uint16_t) k0);
+			compareAt = (double) k * TIMER_CYCLES;
+		}
+		if ((pcintAt < 0) && (compareAt < 0))
+			break;
+		bool isCompare = (pcintAt < 0) || ((compareAt >= 0) && (compareAt < pcintAt));
+		double event = isCompare ? compareAt : pcintAt;
+		double isr = startTime ((event > cpuFree) ? event : cpuFree, load) + _SS_RX_ISR_CYCLES;
+		TCNT1 = (uint16_t) (unsigned long long) (isr / TIMER_CYCLES);
+		PINB = line.level (isr, cursor) ? RX_MASK : 0;
+		if (isCompare)
+		{
+			out.compares++;
+			TIMER1_COMPA_vect ();
+		}
+		else
+		{
+			out.pinChanges++;
+			PCINT0_vect ();
+		}
+		// edges up to the ISR were one pin change, or came while it was off
+		while ((edge < line.edgeTime.size ()) && (line.edgeTime[edge] <= isr))
+			edge++;
+		ocrWritten = isr;
+		cpuFree = isr + ISR_BODY_CYCLES;
+
+		while (rx.available ())
+		{
+			uint8_t b = rx.read ();
+			// the frame being sent when the byte was saved
+			while ((frame + 1 < frames.size ()) && (frames[frame + 1].start <= isr))
+				frame++;
+			if ((frames[frame].start <= isr) && (b == frames[frame].value) && !frames[frame].received
+				&& frames[frame].stopBit)
+				frames[frame].received = true;
+			else
+				out.errors++;		// wrong or extra
+		}
+	}
+	for (size_t i = 0; i < frames.size (); i++)
+	{
+		if (!frames[i].stopBit)
+			out.dropped += frames[i].received ? 0 : 1;
+		else if (!frames[i].received)
+			out.errors++;			// missing
+	}
+	rx.end ();
+	return out;
+}
+
+/*
+	Background interrupts at random phases
+*/
+static std::vector<Background> makeLoad (bool busy)
+{
+	std::vector<Background> load;
+	Background millisTick = { 1024.0 * F_CPU / 1000000.0, 5.0 * F_CPU / 1000000.0, 0 };
+	millisTick.phase = (rand () % 1000) / 1000.0 * millisTick.period;
+	load.push_back (millisTick);
+	if (busy)
+	{
+		Background uart = { 10.0 * F_CPU / 57600.0, 4.0 * F_CPU / 1000000.0, 0 };
+		uart.phase = (rand () % 1000) / 1000.0 * uart.period;
+		load.push_back (uart);
+	}
+	return load;
+}
+
+int main (int argc, char *argv[])
+{
+	int count = (argc > 1) ? atoi (argv[1]) : 5000;
+	const long bauds[] = { 9600, 19200, 38400, 57600 };
+	const double clockErrors[] = { -0.04, -0.03, -0.02, -0.01, 0, 0.01, 0.02, 0.03, 0.04 };
+	const int nBauds = sizeof (bauds) / sizeof (bauds[0]);
+	const int nErrors = sizeof (clockErrors) / sizeof (clockErrors[0]);
+	srand (1);
+
+	double rate[2][nBauds][nErrors];
+	bool isrCount = true;
+	for (int busy = 0; busy < 2; busy++)
+	{
+		for (int b = 0; b < nBauds; b++)
+		{
+			double worst = 0;
+			for (int e = 0; e < nErrors; e++)
+			{
+				Line line = makeLine (bauds[b], clockErrors[e], count, 0);
+				Outcome out = run (line, bauds[b], makeLoad (busy));
+				rate[busy][b][e] = 100.0 * out.errors / out.sent;
+				if (fabs (clockErrors[e]) <= 0.02 + 1e-9)
+				{
+					if (rate[busy][b][e] > worst)
+						worst = rate[busy][b][e];
+					if ((out.errors == 0) && ((out.pinChanges != out.sent) || (out.compares != 9 * out.sent)))
+						isrCount = false;
+				}
+			}
+			char check[64];
+			if (busy)
+			{
+				snprintf (check, sizeof (check), "%ld baud, +-2%% clock, busy: errors < 0.1%%", bauds[b]);
+				result (check, worst < 0.1);
+			}
+			else
+			{
+				snprintf (check, sizeof (check), "%ld baud, +-2%% clock, quiet: no byte errors", bauds[b]);
+				result (check, worst == 0);
+			}
+		}
+	}
+	result ("1 pin change + 9 compare interrupts per byte", isrCount);
+
+	Line line = makeLine (57600, 0, count, 7);
+	Outcome out = run (line, 57600, makeLoad (false));
+	result ("bytes without a stop bit dropped", (out.errors == 0) && (out.dropped == count / 7));
+
+	printf ("\nbyte error rate (%%) against the sender's clock error, %d bytes each\n", count);
+	for (int busy = 0; busy < 2; busy++)
+	{
+		printf ("%-6s", busy ? "busy" : "quiet");
+		for (int e = 0; e < nErrors; e++)
+			printf ("%7.0f%%", 100.0 * clockErrors[e]);
+		printf ("\n");
+		for (int b = 0; b < nBauds; b++)
+		{
+			printf ("%6ld", bauds[b]);
+			for (int e = 0; e < nErrors; e++)
+				printf ("%8.2f", rate[busy][b][e]);
+			printf ("\n");
+		}
+	}
+
+	printf ("\nISR time per byte (us, %d cycles an ISR assumed for the timer receive):\n", ISR_BODY_CYCLES + _SS_RX_ISR_CYCLES);
+	printf ("%6s %12s %12s\n", "baud", "busy wait", "timer");
+	for (int b = 0; b < nBauds; b++)
+		printf ("%6ld %12.1f %12.1f\n", bauds[b], 9.5e6 / bauds[b],
+			10.0 * (ISR_BODY_CYCLES + _SS_RX_ISR_CYCLES) * 1e6 / F_CPU);
+
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
@@ -0,0 +1,222 @@
+/*
+ Title: SupplySag.cpp
+  Description: Host tool that checks the sensor conversions stay
+	within tolerance while Vcc (the ADC reference and the sensor
+	supply) sags and recovers. SupplyMonitor runs on the PC through
+	Tools/HostShim with its bandgap readings replaced through its
+	input hook (setInputHook) by those of a simulated supply:
+		bandgap reading = bandgap * 1023 / Vcc
+	SupplyMonitor.update() is called once per sensor read, as in
+	EngineController, and the measured Vcc is fed into an SSI
+	(regulated, non-ratiometric), an MSI (ratiometric) transducer
+	and the load cell. Their ADC counts are worked out from the
+	true Vcc, the true pressure and force, and are read back with
+	the same calibrations EngineController uses. Each profile is
+	a slow ramp down and back or a step (eg. the igniter or the
+	valves switching on):
+		5.0V -> 4.5V -> 5.0V	ramp over 64 measurements
+		5.0V -> 4.5V -> 5.0V	step
+		5.0V -> 4.2V			step (worst case USB supply)
+	The readings must stay within tolerance on every sensor read
+	of a ramp, and within tolerance after SETTLE_MEASUREMENTS
+	measurements of a step. The uncorrected SSI reading (5V
+	assumed) is checked to be out of tolerance, so the check would
+	notice the correction being lost.
+	Each check prints PASS or FAIL and the exit status is the
+	number of failures.
+
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../SupplyMonitor -I../../Transducer -I../../LoadCell -I../../ConfigStore SupplySag.cpp ../HostShim/HostArduino.cpp ../../SupplyMonitor/SupplyMonitor.cpp ../../Transducer/TransducerCal.cpp ../../LoadCell/LoadCell.cpp ../../ConfigStore/ConfigStore.cpp -o SupplySag
+	Usage:
+		SupplySag [-v]
+			-v prints Vcc and the readings at every measurement
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "Arduino.h"
+#include "SupplyMonitor.h"
+#include "TransducerCal.h"
+#include "LoadCell.h"
+
+// EngineController defaults
+#define VCC_INTERVAL 64			// sensor reads between Vcc measurements (vccInterval)
+#define BANDGAP 1.1				// bandgapV
+#define LOAD_CELL_INV 5.0		// inV
+#define LOAD_CELL_ZERO_V 0.547	// noLoadCalcV
+#define LOAD_CELL_SPAN_V 4.0	// loadMassV
+#define LOAD_CELL_SPAN_LBF 100.0	// loadMassLBF
+
+#define PSI 500.0				// true pressure
+#define LBF 60.0				// true force
+#define PSI_TOLERANCE 5.0		// 1% of reading
+#define LBF_TOLERANCE 0.6		// 1% of reading
+#define SETTLE_MEASUREMENTS 16	// after a step (0.75^16 = 1% of the step left)
+#define HOLD_MEASUREMENTS 32	// at each supply level
+
+static int failures = 0;
+static boolean verbose = false;
+static unsigned long long virtualMicros = 0;
+static float vccTrue = 5.0;
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-66s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+static unsigned long simMicros ()
+{
+	virtualMicros += 4;
+	return (unsigned long) virtualMicros;
+}
+
+static void simDelay (unsigned long us)
+{
+	virtualMicros += us;
+}
+
+/*
+	SupplyMonitor input hook: the bandgap reading against the true
+	Vcc in place of the one read
+*/
+static int bandgapReading (int raw)
+{
+	return (int) ((BANDGAP * 1023.0 / vccTrue) + 0.5);
+}
+
+/*
+	ADC counts of a sensor output 'volts' with the reference at
+	the true Vcc
+*/
+static int adc (float volts)
+{
+	long raw = (long) ((volts * 1023.0 / vccTrue) + 0.5);
+	return (raw > 1023) ? 1023 : raw;
+}
+
+struct Errors
+{
+	float ssi;
+	float msi;
+	float loadCell;
+	float ssiUncorrected;
+};
+
+/*
+	Runs 'reads' sensor reads with Vcc going from 'from' to 'to'
+	in a straight line (from == to holds it). Keeps the worst
+	errors over the reads from measurement 'skip' on.
+*/
+static void run (SupplyMonitor &supply, float from, float to, unsigned int reads, unsigned int skip, Errors &worst)
+{
+	static TransducerCal ssi (TRANSDUCER_SSI);
+	static TransducerCal ssiFixed (TRANSDUCER_SSI);		// 5V assumed
+	static TransducerCal msi (TRANSDUCER_MSI);
+	static LoadCell loadCell (LOAD_CELL_INV, LOAD_CELL_ZERO_V, LOAD_CELL_SPAN_V, LOAD_CELL_SPAN_LBF);
+	memset (&worst, 0, sizeof (worst));
+	for (unsigned int n = 0; n < reads; n++)
+	{
+		vccTrue = from + (to - from) * n / reads;
+		if (supply.update () == true)
+		{
+			float vcc = supply.getVcc ();
+			ssi.setReferenceVoltage (vcc);
+			ssi.setSupplyVoltage (vcc);
+			msi.setReferenceVoltage (vcc);
+			msi.setSupplyVoltage (vcc);
+			loadCell.setReferenceVoltage (vcc);
+			loadCell.setSupplyVoltage (vcc);
+		}
+		// SSI output is regulated, MSI and the load cell scale with Vcc
+		int ssiRaw = adc ((PSI + 108.69) / 246.375);
+		int msiRaw = adc ((((PSI - 14.69) * 0.004) + 0.5) * vccTrue / 5.0);
+		int loadCellRaw = adc ((LOAD_CELL_ZERO_V * vccTrue / LOAD_CELL_INV) +
+			(LBF * (LOAD_CELL_SPAN_V / LOAD_CELL_SPAN_LBF) * vccTrue / 5.0));
+		float ssiPSI = ssi.getPSI (ssiRaw);
+		float msiPSI = msi.getPSI (msiRaw);
+		float force = loadCell.getForce (loadCellRaw);
+		if (verbose && ((n % VCC_INTERVAL) == 0))
+			printf ("  Vcc %.3f measured %.3f: SSI %.1f MSI %.1f psi, load cell %.2f lbf\n", vccTrue, supply.getVcc (),
+				ssiPSI, msiPSI, force);
+		if (n < skip * VCC_INTERVAL)
+			continue;
+		worst.ssi = fmaxf (worst.ssi, (float) fabs (ssiPSI - PSI));
+		worst.msi = fmaxf (worst.msi, (float) fabs (msiPSI - PSI));
+		worst.loadCell = fmaxf (worst.loadCell, (float) fabs (force - LBF));
+		worst.ssiUncorrected = fmaxf (worst.ssiUncorrected, (float) fabs (ssiFixed.getPSI (ssiRaw) - PSI));
+	}
+}
+
+static void expect (const char *name, const Errors &worst)
+{
+	char check[160];
+	snprintf (check, sizeof (check), "%s: SSI %.2f psi", name, worst.ssi);
+	result (check, worst.ssi <= PSI_TOLERANCE);
+	snprintf (check, sizeof (check), "%s: MSI %.2f psi", name, worst.msi);
+	result (check, worst.msi <= PSI_TOLERANCE);
+	snprintf (check, sizeof (check), "%s: load cell %.3f lbf", name, worst.loadCell);
+	result (check, worst.loadCell <= LBF_TOLERANCE);
+}
+
+/*
+	A sag as a ramp: every read is checked
+*/
+static void ramp (float low)
+{
+	char name[64];
+	Errors down, hold, up;
+	SupplyMonitor supply (VCC_INTERVAL, BANDGAP);
+	vccTrue = 5.0;
+	run (supply, 5.0, 5.0, HOLD_MEASUREMENTS * VCC_INTERVAL, 0, hold);
+	run (supply, 5.0, low, 64 * VCC_INTERVAL, 0, down);
+	snprintf (name, sizeof (name), "ramp 5.0V to %.1fV", low);
+	expect (name, down);
+	run (supply, low, low, HOLD_MEASUREMENTS * VCC_INTERVAL, 0, hold);
+	snprintf (name, sizeof (name), "hold %.1fV", low);
+	expect (name, hold);
+	snprintf (name, sizeof (name), "hold %.1fV uncorrected: SSI %.2f psi out", low, hold.ssiUncorrected);
+	result (name, hold.ssiUncorrected > PSI_TOLERANCE);
+	run (supply, low, 5.0, 64 * VCC_INTERVAL, 0, up);
+	snprintf (name, sizeof (name), "ramp %.1fV to 5.0V", low);
+	expect (name, up);
+}
+
+/*
+	A sag as a step: checked once SETTLE_MEASUREMENTS have been taken
+*/
+static void step (float low)
+{
+	char name[64];
+	Errors down, up;
+	SupplyMonitor supply (VCC_INTERVAL, BANDGAP);
+	vccTrue = 5.0;
+	run (supply, 5.0, 5.0, HOLD_MEASUREMENTS * VCC_INTERVAL, 0, up);
+	snprintf (name, sizeof (name), "steady 5.0V");
+	expect (name, up);
+	run (supply, low, low, HOLD_MEASUREMENTS * VCC_INTERVAL, SETTLE_MEASUREMENTS, down);
+	snprintf (name, sizeof (name), "step to %.1fV, settled", low);
+	expect (name, down);
+	snprintf (name, sizeof (name), "step to %.1fV uncorrected: SSI %.2f psi out", low, down.ssiUncorrected);
+	result (name, down.ssiUncorrected > PSI_TOLERANCE);
+	run (supply, 5.0, 5.0, HOLD_MEASUREMENTS * VCC_INTERVAL, SETTLE_MEASUREMENTS, up);
+	snprintf (name, sizeof (name), "step %.1fV to 5.0V, settled", low);
+	expect (name, up);
+}
+
+int main (int argc, char *argv[])
+{
+	verbose = (argc > 1) && (strcmp (argv[1], "-v") == 0);
+	hostMicros = simMicros;
+	hostDelay = simDelay;
+	SupplyMonitor::setInputHook (bandgapReading);
+
+	ramp (4.5);
+	step (4.5);
+	step (4.2);
+
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
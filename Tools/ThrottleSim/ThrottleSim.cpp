@@ -0,0 +1,508 @@
+/*
+ Title: ThrottleSim.cpp
+  Description: Host tool that runs the ThrottleControl library
+	(the same code that runs on the Arduino) against a model of
+	the engine and reports how well it holds a chamber pressure
+	and mixture ratio. The model, stepped every 1ms:
+		servos
+			move toward their target at the Maestro speed limit
+			(0.25us per 10ms per unit of speed)
+		valves
+			flow area rises with the square of the opening (a
+			quarter turn ball valve is roughly quadratic)
+		feed system
+			tank -> servo valve -> transducer -> orifice ->
+			chamber. The liquid is solved in closed form and the
+			gas by bisection using EngineMath, so the flow
+			equations are the ones EngineController uses.
+		chamber
+			first order lag (tau) towards the pressure that
+			passes the propellant flow through the throat at a
+			C* that falls off either side of the best O/F
+		sensors
+			sampled at 40Hz, quantised to 10 bit counts with 1
+			count of noise and filtered with SensorFilter as in
+			EngineController. The flows fed to the controller
+			are calculated from the filtered pressures with
+			EngineMath, again as in EngineController.
+	Scenarios start at full throttle (as the main valves are
+	left by runEngine) and step the targets. For each step the
+	settling time (to within 3% and staying there), overshoot and
+	the peak to peak pressure over the last second (sustained
+	oscillation) are printed. The nominal plant is then run
+	with the tank pressures, discharge coefficients and C*
+	changed to check that the same gains stay stable. Each
+	check prints PASS or FAIL and the exit status is the number
+	of failures.
+
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../ThrottleControl -I../../EngineMath -I../../SensorFilter ThrottleSim.cpp ../../ThrottleControl/ThrottleControl.cpp ../../EngineMath/EngineMath.cpp ../../SensorFilter/SensorFilter.cpp -o ThrottleSim
+	Usage:
+		ThrottleSim [-csv] [-gains kp ki kpMR kiMR]
+			-csv prints the nominal run (time, targets,
+			 measured and true values) for plotting instead
+			-gains replaces the ThrottleControl default gains
+			 (see setPressureGains and setMixtureGains)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "Arduino.h"
+#include "EngineMath.h"
+#include "SensorFilter.h"
+#include "ThrottleControl.h"
+
+#define PSI2PA 6894.75729
+#define AMBIENT_PSI 14.696
+
+static int failures = 0;
+static EngineMath em;
+static float gains[4] =				// pressure kp, ki, mixture kp, ki
+{
+	THROTTLE_PRESSURE_KP, THROTTLE_PRESSURE_KI, THROTTLE_MIXTURE_KP, THROTTLE_MIXTURE_KI
+};
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-56s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+/*
+	Orifice area (m^2) of a diameter in inches (as EngineController)
+*/
+static double orificeArea (double d)
+{
+	return M_PI * pow (d / 2, 2) * 0.00064516;
+}
+
+struct Plant
+{
+	// feed system
+	double fuelTankPSI, oxTankPSI;
+	double lcd, lden, ld;					// fuel orifice (EngineController names)
+	double gcd, gk, gz, gtemp, gm, gd;		// ox orifice
+	double valveCd;							// servo valves
+	double fuelValveArea, oxValveArea;		// fully open (m^2)
+	// chamber
+	double aThroat;							// m^2
+	double cStarMax, bestMR;				// m/sec, O/F
+	double tau;								// sec
+	// servos
+	int closedPos, openedPos;				// us
+	double fuelSpeed, oxSpeed;				// Maestro speed units
+};
+
+/*
+	EngineController's settings with tank pressures and orifices
+	that give ~220psi at full throttle and O/F ~1.2
+*/
+static Plant nominalPlant ()
+{
+	Plant p;
+	p.fuelTankPSI = 400;
+	p.oxTankPSI = 500;
+	p.lcd = 0.7;
+	p.lden = 800;
+	p.ld = 0.075;
+	p.gcd = 0.32;
+	p.gk = 1.40;
+	p.gz = 0.98;
+	p.gtemp = 277.0;
+	p.gm = 32;
+	p.gd = 0.265;
+	p.valveCd = 0.6;
+	p.fuelValveArea = orificeArea (0.11);
+	p.oxValveArea = orificeArea (0.25);
+	p.aThroat = 0.00017;
+	p.cStarMax = 1500;
+	p.bestMR = 1.4;
+	p.tau = 0.02;
+	p.closedPos = 800;
+	p.openedPos = 1600;
+	p.fuelSpeed = 100;			// EngineController throttleServoSpeed
+	p.oxSpeed = 100;
+	return p;
+}
+
+struct State
+{
+	double fuelPos, oxPos;		// us
+	double pc;					// chamber psi
+	double fuelPSI, oxPSI;		// at the transducers
+	double fuelFlow, oxFlow;	// kg/sec
+};
+
+static double valveOpening (const Plant &p, double pos)
+{
+	double x = (pos - p.closedPos) / (p.openedPos - p.closedPos);
+	if (x <= 0)
+		return 0;
+	if (x > 1)
+		x = 1;
+	return x * x;
+}
+
+/*
+	Liquid through the valve then the orifice. Returns the flow
+	and sets the pressure between them.
+*/
+static double fuelFeed (const Plant &p, double valveA, double pc, double *p1)
+{
+	double cdaValve = p.valveCd * valveA;
+	double cdaOrifice = p.lcd * orificeArea (p.ld);
+	if (cdaValve <= 0 || p.fuelTankPSI <= pc)
+	{
+		*p1 = pc;
+		return 0;
+	}
+	double cda = 1.0 / sqrt (1.0 / (cdaValve * cdaValve) + 1.0 / (cdaOrifice * cdaOrifice));
+	double flow = cda * sqrt (2.0 * p.lden * (p.fuelTankPSI - pc) * PSI2PA);
+	*p1 = pc + pow (flow / cdaOrifice, 2) / (2.0 * p.lden) / PSI2PA;
+	return flow;
+}
+
+/*
+	Gas through the valve then the orifice, solved by bisection on
+	the pressure between them
+*/
+static double oxFeed (const Plant &p, double valveA, double pc, double *p1)
+{
+	const double g = 9.80665;
+	double ga = orificeArea (p.gd);
+	if (valveA <= 0 || p.oxTankPSI <= pc)
+	{
+		*p1 = pc;
+		return 0;
+	}
+	double lo = pc, hi = p.oxTankPSI, mid = pc, flow = 0;
+	for (int i = 0; i < 40; i++)
+	{
+		mid = 0.5 * (lo + hi);
+		double valveFlow = em.GasMassFlow (p.valveCd, g, p.gk, p.gz, p.gtemp, p.gm, p.oxTankPSI, mid, valveA);
+		double orificeFlow = em.GasMassFlow (p.gcd, g, p.gk, p.gz, p.gtemp, p.gm, mid, pc, ga);
+		flow = 0.5 * (valveFlow + orificeFlow);
+		if (valveFlow > orificeFlow)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	*p1 = mid;
+	return flow;
+}
+
+/*
+	Advances the model by dt seconds towards the servo targets
+*/
+static void step (const Plant &p, State &s, int fuelTarget, int oxTarget, double dt)
+{
+	double fuelRate = p.fuelSpeed * 0.25 / 0.010 * dt;	// us per step
+	double oxRate = p.oxSpeed * 0.25 / 0.010 * dt;
+	s.fuelPos += fmax (-fuelRate, fmin (fuelRate, fuelTarget - s.fuelPos));
+	s.oxPos += fmax (-oxRate, fmin (oxRate, oxTarget - s.oxPos));
+
+	s.fuelFlow = fuelFeed (p, p.fuelValveArea * valveOpening (p, s.fuelPos), s.pc, &s.fuelPSI);
+	s.oxFlow = oxFeed (p, p.oxValveArea * valveOpening (p, s.oxPos), s.pc, &s.oxPSI);
+	double flow = s.fuelFlow + s.oxFlow;
+	double mr = (s.fuelFlow > 0) ? s.oxFlow / s.fuelFlow : 0;
+	double cStar = p.cStarMax * fmax (0.5, 1.0 - 0.1 * pow (mr - p.bestMR, 2));
+	double pcSteady = fmax (AMBIENT_PSI, flow * cStar / p.aThroat / PSI2PA);
+	s.pc += (pcSteady - s.pc) * dt / p.tau;
+}
+
+/*
+	0 - 1000psi transducer (0.5 - 4.5V) read by a 10 bit ADC
+*/
+static int toCounts (double psi)
+{
+	int raw = (int) lround (102.3 + psi * 0.8184 + (rand () % 3 - 1));
+	return raw < 0 ? 0 : (raw > 1023 ? 1023 : raw);
+}
+
+static double toPSI (int raw)
+{
+	return (raw - 102.3) / 0.8184;
+}
+
+struct Segment
+{
+	double seconds;
+	double targetPSI;
+	double targetMR;
+};
+
+struct Response
+{
+	double settle;		// sec to within 3% (and staying), <0 = never
+	double overshoot;	// % of the step
+	double ripple;		// peak to peak over the last second, % of target
+	double error;		// mean error over the last second, % of target
+	double mrSettle;
+	double mrError;
+};
+
+/*
+	Runs the segments from full throttle at steady state and fills
+	in a Response per segment. 'csv' prints every sample.
+*/
+static void simulate (const Plant &p, const Segment *seg, int segments, Response *resp, bool csv,
+					  unsigned int periodMs = 50)
+{
+	const double dt = 0.001;
+	const int sampleMs = 25;
+	State s;
+	memset (&s, 0, sizeof (s));
+	s.fuelPos = p.openedPos;
+	s.oxPos = p.openedPos;
+	s.pc = AMBIENT_PSI;
+	for (int i = 0; i < 2000; i++)
+		step (p, s, p.openedPos, p.openedPos, dt);
+
+	SensorFilter fuelFilter (3, 10.0, 40.0), oxFilter (3, 10.0, 40.0), engineFilter (3, 10.0, 40.0);
+	ThrottleControl throttle (p.closedPos, p.openedPos, periodMs);
+	throttle.setPressureGains (gains[0], gains[1]);
+	throttle.setMixtureGains (gains[2], gains[3]);
+	throttle.start (0, 1.0, 1.0);
+	int fuelTarget = p.openedPos, oxTarget = p.openedPos;
+	double measPSI = s.pc, measFuel = s.fuelFlow, measOx = s.oxFlow;
+	double la = orificeArea (p.ld), ga = orificeArea (p.gd);
+	unsigned long ms = 0;
+	if (csv)
+		printf ("ms,targetPSI,targetMR,enginePSI,truePSI,mr,trueMR,fuelPos,oxPos,throttle,ratio\n");
+
+	for (int k = 0; k < segments; k++)
+	{
+		throttle.setTarget (seg[k].targetPSI, seg[k].targetMR);
+		double startPSI = s.pc;
+		double startMR = s.oxFlow / s.fuelFlow;
+		int samples = (int) (seg[k].seconds * 1000);
+		double lastOut = -1, lastMROut = -1, peak = 0, lo = 1e9, hi = -1e9, sum = 0, mrSum = 0;
+		int tail = 0;
+		for (int i = 0; i < samples; i++, ms++)
+		{
+			step (p, s, fuelTarget, oxTarget, dt);
+			if (ms % sampleMs == 0)
+			{
+				int fuelRaw = fuelFilter.filter (toCounts (s.fuelPSI));
+				int oxRaw = oxFilter.filter (toCounts (s.oxPSI));
+				int engineRaw = engineFilter.filter (toCounts (s.pc));
+				measPSI = toPSI (engineRaw);
+				measFuel = em.LiquidMassFlow (p.lcd, p.lden, toPSI (fuelRaw), measPSI, la);
+				measOx = em.GasMassFlow (p.gcd, 9.80665, p.gk, p.gz, p.gtemp, p.gm, toPSI (oxRaw), measPSI, ga);
+			}
+			if (throttle.update (ms, measPSI, measFuel, measOx) == true)
+			{
+				fuelTarget = throttle.getFuelTarget ();
+				oxTarget = throttle.getOxTarget ();
+			}
+			double mr = s.oxFlow / s.fuelFlow;
+			double target = seg[k].targetPSI;
+			if (fabs (s.pc - target) > 0.03 * target)
+				lastOut = i;
+			if (seg[k].targetMR > 0 && fabs (mr - seg[k].targetMR) > 0.03 * seg[k].targetMR)
+				lastMROut = i;
+			double over = (target > startPSI) ? s.pc - target : target - s.pc;
+			peak = fmax (peak, over);
+			if (i >= samples - 1000)
+			{
+				lo = fmin (lo, s.pc);
+				hi = fmax (hi, s.pc);
+				sum += s.pc - target;
+				mrSum += mr - seg[k].targetMR;
+				tail++;
+			}
+			if (csv && ms % sampleMs == 0)
+				printf ("%lu,%.1f,%.2f,%.2f,%.2f,%.3f,%.3f,%.0f,%.0f,%.3f,%.3f\n", ms, target, seg[k].targetMR,
+						measPSI, s.pc, measOx / measFuel, mr, s.fuelPos, s.oxPos, throttle.getThrottle (), throttle.getRatio ());
+		}
+		resp[k].settle = (lastOut >= samples - 1000) ? -1 : (lastOut + 1) / 1000.0;
+		double change = fabs (seg[k].targetPSI - startPSI);
+		resp[k].overshoot = (change < 0.05 * seg[k].targetPSI) ? 0 : 100.0 * peak / change;
+		resp[k].ripple = 100.0 * (hi - lo) / seg[k].targetPSI;
+		resp[k].error = 100.0 * sum / tail / seg[k].targetPSI;
+		resp[k].mrSettle = (seg[k].targetMR <= 0) ? 0 :
+			((lastMROut >= samples - 1000) ? -1 : (lastMROut + 1) / 1000.0);
+		resp[k].mrError = (seg[k].targetMR <= 0) ? 0 : 100.0 * mrSum / tail / seg[k].targetMR;
+		(void) startMR;
+	}
+}
+
+static const Segment steps[] =
+{
+	// seconds	psi		O/F
+	{ 4.0,		150,	0 },
+	{ 4.0,		120,	0 },
+	{ 4.0,		170,	0 },
+	{ 4.0,		150,	1.2 },
+	{ 4.0,		150,	1.6 },
+};
+#define STEPS (int) (sizeof (steps) / sizeof (steps[0]))
+
+/*
+	Prints the response to each step and checks it settles in
+	'maxSettle' seconds with no sustained oscillation
+*/
+static bool report (const char *name, const Response *r, double maxSettle, bool print)
+{
+	bool pass = true;
+	for (int k = 0; k < STEPS; k++)
+	{
+		if (print)
+			printf ("  %5.0f psi %4.1f O/F: settle %6.2fs overshoot %5.1f%% ripple %4.1f%% error %5.2f%%"
+					"  O/F settle %5.2fs error %5.2f%%\n", steps[k].targetPSI, steps[k].targetMR,
+					r[k].settle, r[k].overshoot, r[k].ripple, r[k].error, r[k].mrSettle, r[k].mrError);
+		if (r[k].settle < 0 || r[k].settle > maxSettle || r[k].ripple > 3.0 || fabs (r[k].error) > 1.5)
+			pass = false;
+		if (r[k].mrSettle < 0 || r[k].mrSettle > maxSettle || fabs (r[k].mrError) > 3.0)
+			pass = false;
+	}
+	char check[80];
+	snprintf (check, sizeof (check), "%s settles < %.1fs, no oscillation", name, maxSettle);
+	result (check, pass);
+	return pass;
+}
+
+/*
+	The nominal plant with one parameter scaled
+*/
+static void robustness ()
+{
+	struct { const char *name; double Plant::*field; double scale; } cases[] =
+	{
+		{ "fuel tank -20%", &Plant::fuelTankPSI, 0.8 },
+		{ "fuel tank +20%", &Plant::fuelTankPSI, 1.2 },
+		{ "ox tank -20%", &Plant::oxTankPSI, 0.8 },
+		{ "ox tank +20%", &Plant::oxTankPSI, 1.2 },
+		{ "fuel Cd -30%", &Plant::lcd, 0.7 },
+		{ "ox Cd +30%", &Plant::gcd, 1.3 },
+		{ "C* -10%", &Plant::cStarMax, 0.9 },
+		{ "chamber tau x3", &Plant::tau, 3.0 },
+		{ "slow fuel servo (speed 25)", &Plant::fuelSpeed, 0.25 },
+		{ "slow ox servo (speed 25)", &Plant::oxSpeed, 0.25 },
+	};
+	Response r[STEPS];
+	for (unsigned int i = 0; i < sizeof (cases) / sizeof (cases[0]); i++)
+	{
+		Plant p = nominalPlant ();
+		p.*cases[i].field *= cases[i].scale;
+		simulate (p, steps, STEPS, r, false);
+		if (report (cases[i].name, r, 3.0, false) == false)
+			report (cases[i].name, r, 3.0, true);
+	}
+}
+
+/*
+	A failed pressure reading (NAN) must hold the valves, a stall must
+	not be made up and a stopped controller must not tick
+*/
+static void sensorFault ()
+{
+	ThrottleControl t (800, 1600, 50);
+	t.setTarget (150, 1.4);
+	t.start (0, 0.8, 1.2);
+	int fuel = t.getFuelTarget (), ox = t.getOxTarget ();
+	bool held = true;
+	for (unsigned long ms = 50; ms <= 1000; ms += 50)
+	{
+		t.update (ms, NAN, NAN, NAN);
+		held = held && (t.getFuelTarget () == fuel) && (t.getOxTarget () == ox);
+	}
+	result ("NAN readings hold the valves", held);
+
+	ThrottleControl late (800, 1600, 50);
+	late.setTarget (150, 0);
+	late.start (0, 1.0, 1.0);
+	int ticks = 0;
+	for (unsigned long ms = 0; ms <= 1000; ms++)
+	{
+		if (ms == 100)
+			ms = 500;	// the run loop stalled
+		ticks += late.update (ms, 200, 0, 0);
+	}
+	result ("ticks missed during a stall are not made up", ticks == 1 + 11);
+
+	ThrottleControl stopped (800, 1600, 50);
+	stopped.setTarget (150, 0);
+	stopped.start (0, 1.0, 1.0);
+	stopped.stop ();
+	ticks = 0;
+	for (unsigned long ms = 0; ms <= 1000; ms += 10)
+		ticks += stopped.update (ms, 200, 0, 0);
+	result ("a stopped controller makes no ticks", (ticks == 0) && (stopped.isRunning () == false));
+}
+
+/*
+	Nanoseconds per control tick on this PC
+*/
+static void benchmark ()
+{
+	ThrottleControl t (800, 1600, 1);
+	t.setTarget (150, 1.4);
+	t.start (0, 0.8, 1.0);
+	const int ticks = 10000000;
+	volatile int sink = 0;
+	clock_t start = clock ();
+	for (int i = 1; i <= ticks; i++)
+	{
+		t.update (i, 150 + (i & 7), 0.05, 0.07);
+		sink += t.getFuelTarget () + t.getOxTarget ();
+	}
+	(void) sink;
+	printf ("cost per control tick on this PC (ns): %.1f\n", 1e9 * (clock () - start) / CLOCKS_PER_SEC / ticks);
+}
+
+int main (int argc, char *argv[])
+{
+	Plant p = nominalPlant ();
+	Response r[STEPS];
+	bool csv = false;
+	srand (1);
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp (argv[i], "-csv") == 0)
+			csv = true;
+		else if (strcmp (argv[i], "-gains") == 0 && i + 4 < argc)
+		{
+			for (int j = 0; j < 4; j++)
+				gains[j] = atof (argv[++i]);
+		}
+	}
+	if (csv)
+	{
+		simulate (p, steps, STEPS, r, true);
+		return 0;
+	}
+
+	State s;
+	memset (&s, 0, sizeof (s));
+	s.pc = AMBIENT_PSI;
+	for (int i = 0; i < 2000; i++)
+		step (p, s, p.openedPos, p.openedPos, 0.001);
+	printf ("full throttle: %.1f psi, fuel %.4f kg/sec @ %.0f psi, ox %.4f kg/sec @ %.0f psi, O/F %.2f\n\n",
+			s.pc, s.fuelFlow, s.fuelPSI, s.oxFlow, s.oxPSI, s.oxFlow / s.fuelFlow);
+
+	printf ("nominal plant, 50ms control period:\n");
+	simulate (p, steps, STEPS, r, false);
+	report ("nominal", r, 2.0, true);
+	printf ("\nnominal plant, 100ms control period:\n");
+	simulate (p, steps, STEPS, r, false, 100);
+	report ("100ms period", r, 3.0, true);
+	printf ("\nrobustness (failures are printed):\n");
+	robustness ();
+	printf ("\ngain margin, nominal plant (failures are printed):\n");
+	for (int j = 0; j < 4; j++)
+		gains[j] *= 1.5;
+	simulate (p, steps, STEPS, r, false);
+	if (report ("gains x1.5", r, 3.0, false) == false)
+		report ("gains x1.5", r, 3.0, true);
+	printf ("\n");
+	sensorFault ();
+	printf ("\n");
+	benchmark ();
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
@@ -0,0 +1,568 @@
+/*
+ Title: TraceReplay.cpp
+  Description: Host tool that replays a session recorded with
+	InputTrace (EngineController parameter traceInputs=1) through
+	the same EngineController and library code compiled for the
+	PC, and checks that it prints the same output. The log is
+	the serial output of the board as captured by the ground
+	station (any terminal log will do). The trace chunks are
+	taken out of it, the EEPROM image is loaded and every input
+	the code reads (time, ADC, thermocouples, Maestro replies,
+	operator bytes) is fed back from the trace. The replay stops
+	when a trace stream runs out (the records after the last
+	flush are not in the log) and every complete line printed
+	up to then is compared with the log. This allows a failure
+	seen on the test stand to be stepped through in a debugger,
+	and a change to the code to be checked against real runs:
+	a change that alters what is printed shows up as the first
+	line that differs. Chunks found in the middle of a line are
+	counted and reported (an input read while a line was being
+	printed filled the buffer, see InputTrace.h).
+
+	Numbers that differ only in the last printed digit are
+	counted as close rather than different: the PC works in
+	double precision where the AVR works in single (the host
+	Print formats in single precision, so most lines match
+	exactly). Ints are 16 bits on the AVR and 32 here, so code
+	that relies on an int overflowing will not replay. The
+	watchdog interrupt is not replayed.
+
+	-record runs the sketch against a simple model instead (a
+	virtual clock advanced by what each call costs on the AVR,
+	slowly varying ADC readings and a Maestro that reports the
+	last target as the position), types the given operator
+	input with keep alive characters and writes the log with
+	the trace to stdout. Replaying that log checks the tool and
+	the tracing end to end.
+
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../BufferArena -I../../InputTrace -I../../EventJournal -I../../EngineMath -I../../Transducer -I../../ThermocoupleBank -I../../ChannelTable -I../../StopWatch -I../../SoftwareSerial -I../../PMCtrl -I../../ServoProfile -I../../LoadCell -I../../ImpulseCalc -I../../SafetyMonitor -I../../FastStop -I../../FailSafe -I../../SensorHealth -I../../SupplyMonitor -I../../SensorFilter -I../../TypeK -I../../ConfigStore -I../../ThrottleControl -I../../Propellant -x c++ -include Arduino.h ../../EngineController/EngineController.ino -x none TraceReplay.cpp ../HostShim/HostArduino.cpp ../../BufferArena/BufferArena.cpp ../../InputTrace/InputTrace.cpp ../../EventJournal/EventJournal.cpp ../../EngineMath/EngineMath.cpp ../../Transducer/Transducer.cpp ../../Transducer/TransducerCal.cpp ../../ThermocoupleBank/ThermocoupleBank.cpp ../../ChannelTable/ChannelTable.cpp ../../StopWatch/StopWatch.cpp ../../PMCtrl/PMCtrl.cpp ../../ServoProfile/ServoProfile.cpp ../../LoadCell/LoadCell.cpp ../../ImpulseCalc/ImpulseCalc.cpp ../../SafetyMonitor/SafetyMonitor.cpp ../../FastStop/FastStop.cpp ../../FailSafe/FailSafe.cpp ../../SensorHealth/SensorHealth.cpp ../../SupplyMonitor/SupplyMonitor.cpp ../../SensorFilter/SensorFilter.cpp ../../TypeK/TypeK.cpp ../../ConfigStore/ConfigStore.cpp ../../ThrottleControl/ThrottleControl.cpp ../../Propellant/Propellant.cpp -o TraceReplay
+	Usage:
+		TraceReplay [-v] log.txt
+			replays the first session in the log. -v prints the
+			replayed output as well. The exit status is the
+			number of lines that differ.
+		TraceReplay -record "operator input" [seconds] > log.txt
+			runs the model, typing the input one character per
+			50ms ('#' waits a second) and stops 'seconds' (default
+			2) after the last character
+		eg. TraceReplay -record "6/list/exit/1/###Q" > log.txt
+*/
+
+#include <stdio.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "SoftwareSerial.h"
+#include "InputTrace.h"
+
+// EngineController.ino
+void setup ();
+void loop ();
+extern byte traceInputs;
+
+#define MAX_DIFFS_SHOWN 5
+
+typedef struct
+{
+	unsigned int count;		// reads of the previous value before this one
+	long value;				// new value (change for the time streams)
+} TraceRecord;
+
+typedef struct
+{
+	std::vector<TraceRecord> records;
+	size_t next;			// record being read
+	unsigned int used;		// repeats of it already read
+	long last;				// last value read
+	unsigned long reads;
+} TraceStream;
+
+struct TraceEnd { byte type; };		// thrown when a stream runs out
+struct RecordEnd {};				// thrown when a -record run is over
+
+static TraceStream streams[TRACE_TYPES];
+static std::string recordedOutput;	// log without the trace chunks
+static unsigned long chunksInLine = 0;	// chunks that split a line of the log
+static std::string replayedOutput;
+static boolean echo = false;
+
+/*
+	Reads an upper case hex number from 'p'. An empty number is 0.
+*/
+static unsigned long parseHex (const char *&p)
+{
+	unsigned long value = 0;
+	while ((*p >= '0' && *p <= '9') || (*p >= 'A' && *p <= 'F'))
+	{
+		value = (value << 4) | (*p <= '9' ? *p - '0' : *p - 'A' + 10);
+		p++;
+	}
+	return value;
+}
+
+/*
+	Adds the records in one chunk to their streams
+*/
+static boolean parseRecords (const std::string &chunk)
+{
+	const char *letters = TRACE_LETTERS;
+	const char *p = chunk.c_str ();
+	while (*p != '\0')
+	{
+		const char *letter = strchr (letters, *p);
+		if ((letter == NULL) || (*p == '\0'))
+		{
+			fprintf (stderr, "Bad trace record at '%.16s'\n", p);
+			return false;
+		}
+		p++;
+		TraceRecord record;
+		record.count = 0;
+		boolean negative = (*p == '-');
+		if (negative)
+			p++;
+		unsigned long value = parseHex (p);
+		if ((*p == ':') && (negative == false))
+		{
+			p++;
+			record.count = value;
+			negative = (*p == '-');
+			if (negative)
+				p++;
+			value = parseHex (p);
+		}
+		record.value = negative ? -(long) value : (long) value;
+		streams[letter - letters].records.push_back (record);
+	}
+	return true;
+}
+
+/*
+	Loads the trace header (EEPROM image) into the host EEPROM
+*/
+static boolean parseHeader (const std::string &chunk)
+{
+	const char *p = chunk.c_str () + 1;
+	unsigned long version = parseHex (p);
+	if ((version != TRACE_VERSION) || (*p++ != ':'))
+	{
+		fprintf (stderr, "Trace version %lu is not supported (expected %d)\n", version, TRACE_VERSION);
+		return false;
+	}
+	unsigned long size = parseHex (p);
+	if ((*p++ != ':') || (size > EEPROM_SIZE) || (strlen (p) != size * 2))
+	{
+		fprintf (stderr, "Bad trace header\n");
+		return false;
+	}
+	for (unsigned long i = 0; i < size; i++)
+	{
+		const char digits[3] = { p[0], p[1], '\0' };
+		const char *d = digits;
+		hostEEPROM[i] = parseHex (d);
+		p += 2;
+	}
+	return true;
+}
+
+/*
+	Splits a log into the EEPROM image, the trace streams and the
+	normal output of the first session (from its header to the
+	next header or the end of the log)
+*/
+static boolean parseLog (const char *fileName)
+{
+	FILE *file = fopen (fileName, "rb");
+	if (file == NULL)
+	{
+		fprintf (stderr, "Can't open %s\n", fileName);
+		return false;
+	}
+	std::string chunk;
+	boolean inChunk = false;
+	boolean started = false;
+	int c;
+	while ((c = fgetc (file)) != EOF)
+	{
+		if (c == '~')
+		{
+			if (inChunk && (chunk.size () > 0) && (chunk[0] == '!'))
+			{
+				if (started)
+					break;
+				if (parseHeader (chunk) == false)
+					return false;
+				started = true;
+			}
+			else if (inChunk && started)
+			{
+				if (parseRecords (chunk) == false)
+					return false;
+			}
+			if ((inChunk == false) && started && (recordedOutput.size () > 0) && (recordedOutput[recordedOutput.size () - 1] != '\n'))
+				chunksInLine++;
+			inChunk = !inChunk;
+			chunk.clear ();
+		}
+		else if (inChunk)
+			chunk += (char) c;
+		else if (started)
+			recordedOutput += (char) c;
+	}
+	fclose (file);
+	if (started == false)
+	{
+		fprintf (stderr, "No trace in %s (was traceInputs set to 1?)\n", fileName);
+		return false;
+	}
+	return true;
+}
+
+/*
+	InputTrace replay function: the next value of a stream
+*/
+static long nextInput (byte type)
+{
+	TraceStream &s = streams[type];
+	if (s.next >= s.records.size ())
+	{
+		TraceEnd end = { type };
+		throw end;
+	}
+	s.reads++;
+	const TraceRecord &record = s.records[s.next];
+	if (s.used < record.count)
+	{
+		s.used++;
+		return s.last;
+	}
+	s.next++;
+	s.used = 0;
+	if (type <= TRACE_MICROS)
+		s.last = (long) (uint32_t) (s.last + record.value);
+	else
+		s.last = record.value;
+	return s.last;
+}
+
+/*
+	Host hooks while replaying. The inputs come from the trace, so
+	the pins are only read to be replaced (InputTrace::input). Time
+	stands at the last traced time and delays take no time.
+*/
+static unsigned long replayMicros ()
+{
+	return (unsigned long) streams[TRACE_MILLIS].last * 1000UL;
+}
+
+static void replayDelay (unsigned long us)
+{
+}
+
+static void replayWrite (uint8_t c)
+{
+	if (inputTrace.isRunning () == false)
+		return;
+	replayedOutput += (char) c;
+	if (echo)
+		putchar (c);
+}
+
+/*
+	Maestro stand-in on the SoftwareSerial link: set target (0x04)
+	commands are remembered and get position (0x10) answers with
+	the last target. Replies only matter to -record; in a replay
+	they come from the trace.
+*/
+static byte maestroCommand[6];
+static byte maestroLength = 0;
+static unsigned int maestroTargets[24];
+static byte maestroReply[2];
+static byte maestroReplyLength = 0;
+
+SoftwareSerial::SoftwareSerial (uint8_t receivePin, uint8_t transmitPin, bool inverse_logic) {}
+SoftwareSerial::~SoftwareSerial () {}
+void SoftwareSerial::begin (long speed) {}
+bool SoftwareSerial::listen () { return true; }
+void SoftwareSerial::end () {}
+void SoftwareSerial::flush () {}
+
+size_t SoftwareSerial::write (uint8_t b)
+{
+	if ((b == 0xAA) || (maestroLength >= sizeof (maestroCommand)))
+		maestroLength = 0;
+	maestroCommand[maestroLength++] = b;
+	byte channel = maestroCommand[3] % 24;
+	if ((maestroLength == 6) && (maestroCommand[2] == 0x04))
+		maestroTargets[channel] = maestroCommand[4] | (maestroCommand[5] << 7);
+	else if ((maestroLength == 4) && (maestroCommand[2] == 0x10))
+	{
+		maestroReply[0] = maestroTargets[channel] & 0xFF;
+		maestroReply[1] = maestroTargets[channel] >> 8;
+		maestroReplyLength = 2;
+	}
+	else if ((maestroLength == 3) && (maestroCommand[2] == 0x21))
+	{
+		maestroReply[0] = 0;
+		maestroReply[1] = 0;
+		maestroReplyLength = 2;
+	}
+	return 1;
+}
+
+int SoftwareSerial::available ()
+{
+	return maestroReplyLength;
+}
+
+int SoftwareSerial::peek ()
+{
+	return (maestroReplyLength > 0) ? maestroReply[2 - maestroReplyLength] : -1;
+}
+
+int SoftwareSerial::read ()
+{
+	int b = peek ();
+	if (maestroReplyLength > 0)
+		maestroReplyLength--;
+	return b;
+}
+
+/*
+	-record model. The virtual clock is advanced by roughly what
+	each call takes on the AVR.
+*/
+static unsigned long long virtualMicros = 0;
+static const char *operatorInput = "";
+static unsigned long long nextKeyMicros = 1000000;
+static unsigned long long nextKeepAliveMicros = 0;
+static unsigned long long endMicros = 0;
+static double recordSeconds;
+static unsigned long noise = 1;
+
+static unsigned long recordMicros ()
+{
+	virtualMicros += 4;
+	return (unsigned long) virtualMicros;
+}
+
+static void recordDelay (unsigned long us)
+{
+	virtualMicros += us;
+}
+
+/*
+	Each input wanders slowly around its own level with a count
+	or two of noise
+*/
+static int recordAnalogRead (uint8_t pin)
+{
+	virtualMicros += 112;		// one conversion
+	noise = noise * 1103515245UL + 12345;
+	double t = virtualMicros / 1e6;
+	int value = 150 + 70 * (pin % 12) + (int) (20 * sin (t * (1 + pin % 5))) + (int) ((noise >> 16) % 3) - 1;
+	return constrain (value, 0, 1023);
+}
+
+/*
+	Operator: the input one key per 50ms and a keep alive every
+	100ms. A key waiting to be read goes first (the link buffer
+	is not modelled).
+*/
+static int recordSerialRead ()
+{
+	virtualMicros += 4;
+	if ((*operatorInput == '\0') && (virtualMicros >= endMicros))
+		throw RecordEnd ();
+	if ((*operatorInput != '\0') && (virtualMicros >= nextKeyMicros))
+	{
+		char key = *operatorInput++;
+		nextKeyMicros = virtualMicros + (key == '#' ? 1000000 : 50000);
+		if (*operatorInput == '\0')
+			endMicros = virtualMicros + (unsigned long long) (recordSeconds * 1e6);
+		if (key != '#')
+			return key;
+	}
+	if (virtualMicros >= nextKeepAliveMicros)
+	{
+		nextKeepAliveMicros = virtualMicros + 100000;
+		return 'K';
+	}
+	return -1;
+}
+
+static void recordWrite (uint8_t c)
+{
+	virtualMicros += 174;		// one character at 57600 baud
+	putchar (c);
+}
+
+/*
+	Runs the model and writes the log to stdout
+*/
+static int record (const char *input, double seconds)
+{
+	operatorInput = input;
+	recordSeconds = seconds;
+	endMicros = (unsigned long long) (seconds * 1e6);
+	hostMicros = recordMicros;
+	hostDelay = recordDelay;
+	hostAnalogRead = recordAnalogRead;
+	hostSerialRead = recordSerialRead;
+	hostSerialWrite = recordWrite;
+	traceInputs = 1;
+	try
+	{
+		setup ();
+		for (;;)
+			loop ();
+	}
+	catch (RecordEnd &)
+	{
+	}
+	inputTrace.flush ();
+	fprintf (stderr, "Recorded %.3f s\n", virtualMicros / 1e6);
+	return 0;
+}
+
+/*
+	Splits text into lines without their line endings
+*/
+static std::vector<std::string> splitLines (const std::string &text, boolean completeOnly)
+{
+	std::vector<std::string> lines;
+	size_t start = 0;
+	for (;;)
+	{
+		size_t end = text.find ('\n', start);
+		if (end == std::string::npos)
+		{
+			if ((completeOnly == false) && (start < text.size ()))
+				lines.push_back (text.substr (start));
+			return lines;
+		}
+		std::string line = text.substr (start, end - start);
+		while ((line.size () > 0) && (line[line.size () - 1] == '\r'))
+			line.erase (line.size () - 1);
+		lines.push_back (line);
+		start = end + 1;
+	}
+}
+
+/*
+	Returns true if two lines differ only in numbers that are
+	within 2 in their last printed digit (float rounding)
+*/
+static boolean isClose (const char *a, const char *b)
+{
+	while ((*a != '\0') && (*b != '\0'))
+	{
+		boolean numA = isdigit (*a) || ((*a == '-') && isdigit (a[1]));
+		boolean numB = isdigit (*b) || ((*b == '-') && isdigit (b[1]));
+		if (numA && numB)
+		{
+			char *endA;
+			char *endB;
+			double x = strtod (a, &endA);
+			double y = strtod (b, &endB);
+			const char *point = (const char *) memchr (a, '.', endA - a);
+			int decimals = (point == NULL) ? 0 : (int) (endA - point - 1);
+			if (fabs (x - y) > 2.01 * pow (10.0, -decimals) + 1e-6 * fabs (x))
+				return false;
+			a = endA;
+			b = endB;
+		}
+		else if (*a++ != *b++)
+			return false;
+	}
+	return (*a == '\0') && (*b == '\0');
+}
+
+/*
+	Replays a log and compares the output
+*/
+static int replay (const char *fileName)
+{
+	if (parseLog (fileName) == false)
+		return 1;
+	hostMicros = replayMicros;
+	hostDelay = replayDelay;
+	hostSerialWrite = replayWrite;
+	inputTrace.replay (nextInput);
+	traceInputs = 1;
+
+	int endType = -1;
+	clock_t start = clock ();
+	try
+	{
+		setup ();
+		for (;;)
+			loop ();
+	}
+	catch (TraceEnd &end)
+	{
+		endType = end.type;
+	}
+	double cpuSeconds = (double) (clock () - start) / CLOCKS_PER_SEC;
+	if (echo)
+		printf ("\n");
+
+	std::vector<std::string> logLines = splitLines (recordedOutput, false);
+	std::vector<std::string> replayLines = splitLines (replayedOutput, true);
+	unsigned long same = 0;
+	unsigned long close = 0;
+	unsigned long different = 0;
+	for (size_t i = 0; i < replayLines.size (); i++)
+	{
+		const char *logLine = (i < logLines.size ()) ? logLines[i].c_str () : "(end of log)";
+		if (replayLines[i] == logLine)
+			same++;
+		else if (isClose (replayLines[i].c_str (), logLine))
+			close++;
+		else
+		{
+			if (different < MAX_DIFFS_SHOWN)
+				printf ("Line %lu differs\n  log:    %s\n  replay: %s\n", (unsigned long) i + 1, logLine, replayLines[i].c_str ());
+			different++;
+		}
+	}
+
+	printf ("Stream   records     reads\n");
+	for (byte i = 0; i < TRACE_TYPES; i++)
+		printf ("%c      %9lu %9lu\n", TRACE_LETTERS[i], (unsigned long) streams[i].records.size (), streams[i].reads);
+	double engineSeconds = (uint32_t) streams[TRACE_MILLIS].last / 1000.0;
+	printf ("Replayed %.3f s of the session in %.3f s (%.0fx) until stream '%c' ran out\n",
+		engineSeconds, cpuSeconds, (cpuSeconds > 0) ? engineSeconds / cpuSeconds : 0.0,
+		(endType >= 0) ? TRACE_LETTERS[endType] : '?');
+	printf ("Lines: %lu of %lu compared, %lu identical, %lu close (last digit), %lu different\n",
+		(unsigned long) replayLines.size (), (unsigned long) logLines.size (), same, close, different);
+	if (chunksInLine > 0)
+		printf ("%lu trace chunk(s) sent in the middle of a line (the log's CSV is split there)\n", chunksInLine);
+	printf ("%s\n", (different == 0) ? "PASS" : "FAIL");
+	return (different > 255) ? 255 : (int) different;
+}
+
+int main (int argc, char *argv[])
+{
+	if ((argc >= 3) && (strcmp (argv[1], "-record") == 0))
+		return record (argv[2], (argc >= 4) ? atof (argv[3]) : 2.0);
+	int arg = 1;
+	if ((argc >= 2) && (strcmp (argv[1], "-v") == 0))
+	{
+		echo = true;
+		arg++;
+	}
+	if (arg != argc - 1)
+	{
+		fprintf (stderr, "Usage: TraceReplay [-v] log.txt\n       TraceReplay -record \"operator input\" [seconds] > log.txt\n");
+		return 1;
+	}
+	return replay (argv[arg]);
+}
@@ -0,0 +1,169 @@
+/*
+ Title: TransducerFit.cpp
+  Description: Host tool that builds a TransducerCal table from
+	a calibration run. The input is CSV lines of:
+		raw,psi
+	where raw is the analog reading (taken with a 5.0V supply, 
+	or already scaled to it) and psi the reference pressure 
+	(psia). Lines that don't parse are skipped so a raw serial 
+	capture can be used directly.
+	
+	Readings taken at the same reference pressure (within 
+	0.5 psi) are averaged into one point. Points are then 
+	removed one at a time, always the one whose removal adds 
+	the least interpolation error, until the table fits in 
+	TRANSDUCER_MAX_POINTS. The end points are always kept.
+	
+	The table is printed as C arrays ready to paste into the
+	TransducerCal example sketch, along with the worst case 
+	error against the calibration points.
+	
+	Build (from this directory):
+		g++ -O2 TransducerFit.cpp -o TransducerFit
+	Usage:
+		TransducerFit [maxPoints] < calibration.csv
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#define TRANSDUCER_MAX_POINTS 8		// must match TransducerCal.h
+
+struct Point
+{
+	double raw;
+	double psi;
+	int n;
+};
+
+static bool byPSI (const Point &a, const Point &b)
+{
+	return a.psi < b.psi;
+}
+
+static bool byRaw (const Point &a, const Point &b)
+{
+	return a.raw < b.raw;
+}
+
+/*
+	Linear interpolation of 'raw' through the table
+*/
+static double interpolate (const std::vector<Point> &table, double raw)
+{
+	size_t i = 0;
+	while ((i < table.size() - 2) && (raw >= table[i + 1].raw))
+		i++;
+	double slope = (table[i + 1].psi - table[i].psi) / (table[i + 1].raw - table[i].raw);
+	return table[i].psi + slope * (raw - table[i].raw);
+}
+
+/*
+	Worst case error of the table against all the calibration points
+*/
+static double maxError (const std::vector<Point> &table, const std::vector<Point> &points)
+{
+	double worst = 0;
+	for (size_t i = 0; i < points.size(); i++)
+		worst = std::max (worst, fabs (interpolate (table, points[i].raw) - points[i].psi));
+	return worst;
+}
+
+int main (int argc, char **argv)
+{
+	size_t maxPoints = TRANSDUCER_MAX_POINTS;
+	if (argc > 1)
+		maxPoints = atoi (argv[1]);
+	if (maxPoints < 2 || maxPoints > TRANSDUCER_MAX_POINTS)
+	{
+		fprintf (stderr, "maxPoints must be 2 - %d\n", TRANSDUCER_MAX_POINTS);
+		return 1;
+	}
+
+	std::vector<Point> samples;
+	char line[256];
+	while (fgets (line, sizeof (line), stdin))
+	{
+		Point p;
+		if (sscanf (line, "%lf,%lf", &p.raw, &p.psi) == 2)
+		{
+			p.n = 1;
+			samples.push_back (p);
+		}
+	}
+	if (samples.empty())
+	{
+		fprintf (stderr, "no calibration points found\n");
+		return 1;
+	}
+
+	// average the readings taken at each reference pressure
+	std::sort (samples.begin(), samples.end(), byPSI);
+	std::vector<Point> points;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		if (!points.empty() && fabs (samples[i].psi - points.back().psi / points.back().n) < 0.5)
+		{
+			points.back().raw += samples[i].raw;
+			points.back().psi += samples[i].psi;
+			points.back().n++;
+		}
+		else
+			points.push_back (samples[i]);
+	}
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		points[i].raw /= points[i].n;
+		points[i].psi /= points[i].n;
+	}
+	std::sort (points.begin(), points.end(), byRaw);
+	for (size_t i = 1; i < points.size(); i++)
+	{
+		if ((int) lround (points[i].raw) <= (int) lround (points[i - 1].raw))
+		{
+			fprintf (stderr, "raw readings must increase with pressure (%.1f psi)\n", points[i].psi);
+			return 1;
+		}
+	}
+	if (points.size() < 2)
+	{
+		fprintf (stderr, "need at least 2 reference pressures\n");
+		return 1;
+	}
+
+	// drop the point that costs the least until the table fits
+	std::vector<Point> table = points;
+	for (size_t i = 0; i < table.size(); i++)
+		table[i].raw = lround (table[i].raw);
+	while (table.size() > maxPoints)
+	{
+		size_t best = 1;
+		double bestError = 1e30;
+		for (size_t i = 1; i < table.size() - 1; i++)
+		{
+			std::vector<Point> trial = table;
+			trial.erase (trial.begin() + i);
+			double e = maxError (trial, points);
+			if (e < bestError)
+			{
+				bestError = e;
+				best = i;
+			}
+		}
+		table.erase (table.begin() + best);
+	}
+
+	printf ("// %zu calibration pressures, %zu table points, max error %.2f psi\n", 
+			points.size(), table.size(), maxError (table, points));
+	printf ("const int rawPoints[] = { ");
+	for (size_t i = 0; i < table.size(); i++)
+		printf ("%s%d", i ? ", " : "", (int) table[i].raw);
+	printf (" };\nconst float psiPoints[] = { ");
+	for (size_t i = 0; i < table.size(); i++)
+		printf ("%s%.2f", i ? ", " : "", table[i].psi);
+	printf (" };\n");
+	return 0;
+}
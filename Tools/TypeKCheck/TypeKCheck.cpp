@@ -0,0 +1,255 @@
+/*
+ Title: TypeKCheck.cpp
+  Description: Host tool that checks the TypeK library against
+	the NIST ITS-90 type K reference function (NIST Monograph 
+	175), using the same code that runs on the Arduino:
+		(1) the reference function used here is checked against
+			values from the published NIST table
+		(2) getCelsius is checked every 0.1C from -200C to 1372C
+		(3) getMillivolts is checked every 0.1C from -55C to 125C
+		(4) a MAX31855 is simulated (41.276uV/C, 0.25C and 
+			0.0625C resolution) at cold junction temperatures
+			from -20C to 85C and compensate() is compared with
+			the chip's linear reading
+	Each check prints PASS or FAIL and the exit status is the
+	number of failures.
+	
+	With -g the segment tables for TypeK.cpp are fitted (least 
+	squares cubic per segment against the exact inverse of the 
+	reference function) and printed instead.
+	
+	Build (from this directory):
+		g++ -O2 -I../HostShim -I../../TypeK TypeKCheck.cpp ../../TypeK/TypeK.cpp -o TypeKCheck
+	Usage:
+		TypeKCheck [-g]
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "Arduino.h"
+#include "TypeK.h"
+
+static int failures = 0;
+
+static void result (const char *check, bool pass)
+{
+	printf ("%-48s %s\n", check, pass ? "PASS" : "FAIL");
+	if (!pass)
+		failures++;
+}
+
+// NIST reference function coefficients, E (mV) = sum c[i] * t^i
+static const double negCoef[] = {0.000000000000E+00, 0.394501280250E-01, 0.236223735980E-04,
+	-0.328589067840E-06, -0.499048287770E-08, -0.675090591730E-10, -0.574103274280E-12,
+	-0.310888728940E-14, -0.104516093650E-16, -0.198892668780E-19, -0.163226974860E-22};
+static const double posCoef[] = {-0.176004136860E-01, 0.389212049750E-01, 0.185587700320E-04,
+	-0.994575928740E-07, 0.318409457190E-09, -0.560728448890E-12, 0.560750590590E-15,
+	-0.320207200030E-18, 0.971511471520E-22, -0.121047212750E-25};
+static const double expCoef[] = {0.118597600000E+00, -0.118343200000E-03, 0.126968600000E+03};
+
+/*
+	NIST reference function: temperature (C) to voltage (mV)
+*/
+static double referenceMV (double t)
+{
+	double e = 0;
+	if (t < 0)
+	{
+		for (int i = 10; i >= 0; i--)
+			e = e * t + negCoef[i];
+	}
+	else
+	{
+		for (int i = 9; i >= 0; i--)
+			e = e * t + posCoef[i];
+		e += expCoef[0] * exp (expCoef[1] * (t - expCoef[2]) * (t - expCoef[2]));
+	}
+	return e;
+}
+
+/*
+	Exact inverse of the reference function (Newton's method)
+*/
+static double referenceC (double mv)
+{
+	double t = mv * 25.0;
+	for (int i = 0; i < 50; i++)
+	{
+		double slope = (referenceMV (t + 1e-4) - referenceMV (t - 1e-4)) / 2e-4;
+		double step = (referenceMV (t) - mv) / slope;
+		t -= step;
+		if (fabs (step) < 1e-9)
+			break;
+	}
+	return t;
+}
+
+/*
+	Least squares cubic fit of f over [x0, x1] in u = x - offset
+*/
+static void fitCubic (double (*f) (double), double x0, double x1, double offset, double c[4])
+{
+	double a[4][5];
+	memset (a, 0, sizeof (a));
+	for (int k = 0; k <= 1000; k++)
+	{
+		double x = x0 + (x1 - x0) * k / 1000.0;
+		double p[4] = {1, x - offset, 0, 0};
+		p[2] = p[1] * p[1];
+		p[3] = p[2] * p[1];
+		double y = f (x);
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+				a[i][j] += p[i] * p[j];
+			a[i][4] += p[i] * y;
+		}
+	}
+	for (int i = 0; i < 4; i++)
+		for (int r = i + 1; r < 4; r++)
+		{
+			double m = a[r][i] / a[i][i];
+			for (int j = i; j < 5; j++)
+				a[r][j] -= m * a[i][j];
+		}
+	for (int i = 3; i >= 0; i--)
+	{
+		double s = a[i][4];
+		for (int j = i + 1; j < 4; j++)
+			s -= a[i][j] * c[j];
+		c[i] = s / a[i][i];
+	}
+}
+
+static void printCubic (const double c[4], const char *end)
+{
+	printf ("\t{%.9g, %.9g, %.9g, %.9g}%s\n", c[0], c[1], c[2], c[3], end);
+}
+
+/*
+	Prints the tables used by TypeK.cpp. The segment start points
+	must be computed the same way as in TypeK::getCelsius.
+*/
+static void generate ()
+{
+	double c[4];
+	int segments = TYPEK_NEG_SEGMENTS + TYPEK_POS_SEGMENTS;
+	printf ("const float typeKSegments[TYPEK_NEG_SEGMENTS + TYPEK_POS_SEGMENTS][4] PROGMEM =\n{\n");
+	for (int s = 0; s < segments; s++)
+	{
+		double start, width;
+		if (s < TYPEK_NEG_SEGMENTS)
+		{
+			width = -TYPEK_MIN_MV / TYPEK_NEG_SEGMENTS;
+			start = TYPEK_MIN_MV + s * width;
+		}
+		else
+		{
+			width = TYPEK_MAX_MV / TYPEK_POS_SEGMENTS;
+			start = (s - TYPEK_NEG_SEGMENTS) * width;
+		}
+		fitCubic (referenceC, start, start + width, start, c);
+		printCubic (c, (s < segments - 1) ? "," : "");
+	}
+	printf ("};\n\n");
+	fitCubic (referenceMV, -55.0, 125.0, 0.0, c);
+	printf ("const float typeKColdJunction[4] PROGMEM =\n");
+	printCubic (c, ";");
+}
+
+/*
+	Reference function against values from the published table
+*/
+static void checkReference ()
+{
+	static const double table[][2] = {{-200, -5.891}, {-100, -3.554}, {0, 0.000}, {25, 1.000},
+		{100, 4.096}, {200, 8.138}, {400, 16.397}, {500, 20.644}, {800, 33.275},
+		{1000, 41.276}, {1200, 48.838}, {1372, 54.886}};
+	bool pass = true;
+	for (unsigned i = 0; i < sizeof (table) / sizeof (table[0]); i++)
+		if (fabs (referenceMV (table[i][0]) - table[i][1]) > 0.0005)
+		{
+			printf ("  %.0fC: %.4fmV, table %.3fmV\n", table[i][0], referenceMV (table[i][0]), table[i][1]);
+			pass = false;
+		}
+	result ("reference function matches NIST table", pass);
+}
+
+static void checkCelsius ()
+{
+	double worst = 0, worstAt = 0;
+	for (int i = -2000; i <= 13720; i++)
+	{
+		double t = i / 10.0;
+		double error = fabs (TypeK::getCelsius (referenceMV (t)) - t);
+		if (error > worst)
+		{
+			worst = error;
+			worstAt = t;
+		}
+	}
+	printf ("getCelsius: worst error %.4fC at %.1fC\n", worst, worstAt);
+	result ("getCelsius within 0.03C (-200C to 1372C)", worst < 0.03);
+	result ("getCelsius NAN out of range", isnan (TypeK::getCelsius (-6.0)) && isnan (TypeK::getCelsius (55.0)));
+}
+
+static void checkMillivolts ()
+{
+	double worst = 0, worstAt = 0;
+	for (int i = -550; i <= 1250; i++)
+	{
+		double t = i / 10.0;
+		// in C using the local sensitivity
+		double error = fabs (TypeK::getMillivolts (t) - referenceMV (t)) / 0.04;
+		if (error > worst)
+		{
+			worst = error;
+			worstAt = t;
+		}
+	}
+	printf ("getMillivolts: worst error %.4fC at %.1fC\n", worst, worstAt);
+	result ("getMillivolts within 0.03C (-55C to 125C)", worst < 0.03);
+}
+
+static void checkMAX31855 ()
+{
+	double temps[] = {-150, -50, 0, 100, 250, 500, 750, 1000, 1250, 1350};
+	double coldJunctions[] = {-20, 0, 25, 50, 85};
+	double worstLinear = 0, worstCompensated = 0;
+	printf ("%8s %8s %10s %12s\n", "T(C)", "Tcj(C)", "linear", "compensated");
+	for (unsigned i = 0; i < sizeof (temps) / sizeof (temps[0]); i++)
+		for (unsigned j = 0; j < sizeof (coldJunctions) / sizeof (coldJunctions[0]); j++)
+		{
+			double t = temps[i], tcj = coldJunctions[j];
+			double linear = tcj + (referenceMV (t) - referenceMV (tcj)) / TYPEK_LINEAR_MV_PER_C;
+			linear = floor (linear / 0.25) * 0.25;
+			double internal = floor (tcj / 0.0625) * 0.0625;
+			double compensated = TypeK::compensate (linear, internal);
+			if (tcj == 25)
+				printf ("%8.0f %8.0f %10.2f %12.2f\n", t, tcj, linear, compensated);
+			worstLinear = fmax (worstLinear, fabs (linear - t));
+			worstCompensated = fmax (worstCompensated, fabs (compensated - t));
+		}
+	printf ("MAX31855: worst error linear %.2fC, compensated %.2fC\n", worstLinear, worstCompensated);
+	// the chip's resolution is 0.25C, about 0.4C at the cold end
+	result ("MAX31855 compensated within 0.5C", worstCompensated < 0.5);
+}
+
+int main (int argc, char *argv[])
+{
+	if (argc > 1 && strcmp (argv[1], "-g") == 0)
+	{
+		generate ();
+		return 0;
+	}
+	checkReference ();
+	printf ("\n");
+	checkCelsius ();
+	printf ("\n");
+	checkMillivolts ();
+	printf ("\n");
+	checkMAX31855 ();
+	printf ("\n%d failure(s)\n", failures);
+	return failures;
+}
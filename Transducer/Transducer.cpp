@@ -23,10 +23,27 @@
 #include "Arduino.h"
 #include "Transducer.h"
 
-//Empty Constructor
+//Defaults to a 5V supply and ADC reference
 Transducer::Transducer()
 {
+  _vSupply = 5.0;
+  _vRef = 5.0;
+}
 
+/*
+  Sets the measured transducer supply voltage (Vp)
+*/
+void Transducer::setSupplyVoltage (float vSupply)
+{
+  _vSupply = vSupply;
+}
+
+/*
+  Sets the measured ADC reference voltage
+*/
+void Transducer::setReferenceVoltage (float vRef)
+{
+  _vRef = vRef;
 }
 
 /*
@@ -44,7 +61,7 @@ void Transducer::getPressures (int analogSignalF, float pressures[])
 
 float Transducer::getVoltage (float analogSignal)
 {
-  float voltage = ((5.0 * analogSignal) / 1023.0);
+  float voltage = ((_vRef * analogSignal) / 1023.0);
   return voltage;
   
 }
@@ -67,9 +84,11 @@ float Transducer::getVoltage (float analogSignal)
 	output voltage will be 4.5V 90mV.
 	Calculated as: 
 	PSI = ((Vin/(1+Radj))-.05)/((4.5-0.5)/1000)
-		Where Radj = (.02/0.25)*(Vpmeasure-Vpnominal)
+		Where Radj = (Vpmeasure-Vpnominal)/Vpnominal
 			Where 	Vpmeasured = Voltage power supply measure and
 					Vpmonminal = Voltage nominal power supply (eg. 5V)
+		(the output scales with the supply, so this is the 
+		fractional change in supply voltage)
 */
 float Transducer::getPSI (float voltage)
 {
@@ -79,7 +98,7 @@ float Transducer::getPSI (float voltage)
   //float psi = (246.375 * voltage) - 108.69;
   
   // MSI (1000 PSI ratiometric)
-  float radj = (0.2 / 0.25) * (5.0 - 5); //I'm hard coding the Vp measured for now...)
+  float radj = (_vSupply - 5.0) / 5.0;
   float psi = (((voltage / (1 + radj)) -0.5) / 0.004) + 14.69;
   return psi;
 }
@@ -33,6 +33,11 @@ class Transducer
     float getPSI (float voltage);
 	float getPa (float psi);
 	float getMPa (float psi);
+	void setSupplyVoltage (float vSupply);
+	void setReferenceVoltage (float vRef);
+  private:
+	float _vSupply;
+	float _vRef;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,272 @@
+/*
+ Title: TransducerCal.cpp
+  Description: Per channel calibration for a pressure 
+	transducer. Converts a raw analog reading (0 - 1023) to 
+	PSI (absolute) using one of the following models:
+		TRANSDUCER_SSI
+			SSI 1000psi absolute gauge transducer (linear,
+			internally regulated so not ratiometric)
+		TRANSDUCER_MSI
+			MSI 1000psi ratiometric transducer
+		TRANSDUCER_TABLE
+			piecewise linear table of up to 
+			TRANSDUCER_MAX_POINTS (raw, psi) points taken from
+			a calibration run. See Tools/TransducerFit.
+	Ratiometric models (MSI and TABLE) are corrected for the
+	measured sensor supply voltage, and all models for the 
+	measured ADC reference voltage (both default to 5.0V).
+	
+	Table points are stored as raw readings at the nominal 
+	5.0V supply. A table is written to EEPROM with saveTable()
+	and stays there: conversions read the points they need 
+	from EEPROM, so a table costs no RAM whatever its length.
+	Only a coarse index from reading to segment is held, built
+	when the table is loaded, so a conversion is a bin lookup,
+	the two points of that segment (12 EEPROM reads) and one
+	divide. Don't write over the EEPROM of a loaded table.
+	
+	The model (and table) can be saved to and loaded from 
+	EEPROM. Each saved channel uses TRANSDUCER_CAL_EEPROM_SIZE
+	bytes and is checked with a CRC when loaded.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+
+#include "Arduino.h"
+#include <EEPROM.h>
+#include <ConfigStore.h>
+#include "TransducerCal.h"
+
+#define TRANSDUCER_CAL_MAGIC 0x54	// 'T'
+
+/*
+	EEPROM address of table point 'point' of the channel saved
+	at 'address' (see load() for the layout)
+*/
+static int pointAddress (int address, byte point)
+{
+	return address + 3 + point * 6;
+}
+
+/*
+	The raw reading and psi of the table point at 'point'
+*/
+static int readRaw (int point)
+{
+	return EEPROM.read (point) | (EEPROM.read (point + 1) << 8);
+}
+
+static float readPSI (int point)
+{
+	float psi;
+	byte *p = (byte *) &psi;
+	for (byte j = 0; j < sizeof (float); j++)
+		p[j] = EEPROM.read (point + 2 + j);
+	return psi;
+}
+
+/*
+	Writes a channel with its CRC. Points past 'points' are 
+	written as 0.
+*/
+static void writeChannel (int address, byte model, const int raw[], const float psi[], byte points)
+{
+	EEPROM.write (address, TRANSDUCER_CAL_MAGIC);
+	EEPROM.write (address + 1, model);
+	EEPROM.write (address + 2, points);
+	for (byte i = 0; i < TRANSDUCER_MAX_POINTS; i++)
+	{
+		int pointRaw = (i < points) ? raw[i] : 0;
+		float pointPSI = (i < points) ? psi[i] : 0;
+		byte *p = (byte *) &pointPSI;
+		int point = pointAddress (address, i);
+		EEPROM.write (point, pointRaw & 0xFF);
+		EEPROM.write (point + 1, (pointRaw >> 8) & 0xFF);
+		for (byte j = 0; j < sizeof (float); j++)
+			EEPROM.write (point + 2 + j, p[j]);
+	}
+	EEPROM.write (address + TRANSDUCER_CAL_EEPROM_SIZE - 1, 
+				  eepromCRC (address, TRANSDUCER_CAL_EEPROM_SIZE - 1));
+}
+
+/*
+	There is no table until saveTable or load is called
+*/
+TransducerCal::TransducerCal (byte model)
+{
+	_model = model;
+	_points = 0;
+	_address = 0;
+	_vRef = 5.0;
+	_vSupply = 5.0;
+	_scale = 1.0;
+}
+
+void TransducerCal::setModel (byte model)
+{
+	_model = model;
+}
+
+byte TransducerCal::getModel ()
+{
+	return _model;
+}
+
+/*
+	Saves a piecewise linear table to EEPROM at 'eepromAddress' 
+	and loads it. 'raw' are the readings at the nominal 5.0V 
+	supply and must be strictly increasing. Returns false (and
+	writes nothing) if the table is not usable. The model is 
+	switched to TRANSDUCER_TABLE.
+*/
+boolean TransducerCal::saveTable (int eepromAddress, const int raw[], const float psi[], byte points)
+{
+	if ((points < 2) || (points > TRANSDUCER_MAX_POINTS))
+		return false;
+	for (byte i = 1; i < points; i++)
+		if (raw[i] <= raw[i - 1])
+			return false;
+	writeChannel (eepromAddress, TRANSDUCER_TABLE, raw, psi, points);
+	return load (eepromAddress);
+}
+
+/*
+	Works out, for each bin of raw readings, the segment its 
+	lowest reading falls in
+*/
+void TransducerCal::buildIndex ()
+{
+	byte seg = 0;
+	int next = readRaw (pointAddress (_address, 1));
+	for (byte b = 0; b < TRANSDUCER_BINS; b++)
+	{
+		int binStart = b << TRANSDUCER_BIN_SHIFT;
+		while ((seg < _points - 2) && (binStart >= next))
+		{
+			seg++;
+			next = readRaw (pointAddress (_address, seg + 1));
+		}
+		_bin[b] = seg;
+	}
+}
+
+/*
+	Loads a channel saved with save() or saveTable(). Returns 
+	false if there is no valid channel at 'eepromAddress' (the
+	current model and table are kept). A table is used from 
+	where it is.
+	Layout: magic, model, points, 
+			TRANSDUCER_MAX_POINTS * (raw (2 bytes), psi (4 bytes)), crc
+*/
+boolean TransducerCal::load (int eepromAddress)
+{
+	if (EEPROM.read (eepromAddress) != TRANSDUCER_CAL_MAGIC)
+		return false;
+	if (eepromCRC (eepromAddress, TRANSDUCER_CAL_EEPROM_SIZE - 1) != 
+		EEPROM.read (eepromAddress + TRANSDUCER_CAL_EEPROM_SIZE - 1))
+		return false;
+	byte model = EEPROM.read (eepromAddress + 1);
+	byte points = EEPROM.read (eepromAddress + 2);
+	if (model != TRANSDUCER_TABLE)
+	{
+		_model = model;
+		return true;
+	}
+	if ((points < 2) || (points > TRANSDUCER_MAX_POINTS))
+		return false;
+	for (byte i = 1; i < points; i++)
+		if (readRaw (pointAddress (eepromAddress, i)) <= readRaw (pointAddress (eepromAddress, i - 1)))
+			return false;
+	_address = eepromAddress;
+	_points = points;
+	_model = TRANSDUCER_TABLE;
+	buildIndex ();
+	return true;
+}
+
+/*
+	Saves the model to EEPROM. With TRANSDUCER_TABLE the loaded 
+	table is already there and is copied if 'eepromAddress' is 
+	somewhere else.
+*/
+void TransducerCal::save (int eepromAddress)
+{
+	if (_model != TRANSDUCER_TABLE)
+		writeChannel (eepromAddress, _model, NULL, NULL, 0);
+	else if ((_points >= 2) && (eepromAddress != _address))
+	{
+		for (int i = 0; i < TRANSDUCER_CAL_EEPROM_SIZE; i++)
+			EEPROM.write (eepromAddress + i, EEPROM.read (_address + i));
+	}
+}
+
+/*
+	Sets the measured sensor supply voltage
+*/
+void TransducerCal::setSupplyVoltage (float vSupply)
+{
+	_vSupply = vSupply;
+	_scale = _vRef / _vSupply;
+}
+
+/*
+	Sets the measured ADC reference voltage
+*/
+void TransducerCal::setReferenceVoltage (float vRef)
+{
+	_vRef = vRef;
+	_scale = _vRef / _vSupply;
+}
+
+/*
+	Returns the measured sensor output voltage
+*/
+float TransducerCal::getVoltage (int raw)
+{
+	return (_vRef * raw) / 1023.0;
+}
+
+/*
+	Returns PSI (absolute). See Transducer.cpp for the SSI and 
+	MSI formulas. Readings outside a table are extrapolated from 
+	the end segments.
+*/
+float TransducerCal::getPSI (int raw)
+{
+	switch (_model)
+	{
+		case TRANSDUCER_SSI:
+			return (246.375 * getVoltage (raw)) - 108.69;
+		case TRANSDUCER_TABLE:
+		{
+			if (_points < 2)
+				return NAN;
+			float x = raw * _scale;		// reading at nominal supply
+			int bin = ((int) x) >> TRANSDUCER_BIN_SHIFT;
+			if (bin < 0)
+				bin = 0;
+			else if (bin >= TRANSDUCER_BINS)
+				bin = TRANSDUCER_BINS - 1;
+			byte seg = _bin[bin];
+			int point = pointAddress (_address, seg);
+			int raw0 = readRaw (point);
+			int raw1 = readRaw (point + 6);
+			while ((seg < _points - 2) && (x >= raw1))
+			{
+				seg++;
+				point += 6;
+				raw0 = raw1;
+				raw1 = readRaw (point + 6);
+			}
+			float psi0 = readPSI (point);
+			return psi0 + (readPSI (point + 6) - psi0) * (x - raw0) / (raw1 - raw0);
+		}
+		default: // TRANSDUCER_MSI
+		{
+			float v = (5.0 * raw * _scale) / 1023.0;	// output at nominal supply
+			return ((v - 0.5) / 0.004) + 14.69;
+		}
+	}
+}
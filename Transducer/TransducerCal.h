@@ -0,0 +1,74 @@
+/*
+ Title: TransducerCal.h
+  Description: Per channel calibration for a pressure 
+	transducer. Converts a raw analog reading (0 - 1023) to 
+	PSI (absolute) using one of the following models:
+		TRANSDUCER_SSI
+			SSI 1000psi absolute gauge transducer (linear,
+			internally regulated so not ratiometric)
+		TRANSDUCER_MSI
+			MSI 1000psi ratiometric transducer
+		TRANSDUCER_TABLE
+			piecewise linear table of up to 
+			TRANSDUCER_MAX_POINTS (raw, psi) points taken from
+			a calibration run. See Tools/TransducerFit.
+	Ratiometric models (MSI and TABLE) are corrected for the
+	measured sensor supply voltage, and all models for the 
+	measured ADC reference voltage (both default to 5.0V).
+	
+	Table points are stored as raw readings at the nominal 
+	5.0V supply. A table is written to EEPROM with saveTable()
+	and stays there: conversions read the points they need 
+	from EEPROM, so a table costs no RAM whatever its length.
+	Only a coarse index from reading to segment is held, built
+	when the table is loaded, so a conversion is a bin lookup,
+	the two points of that segment (12 EEPROM reads) and one
+	divide. Don't write over the EEPROM of a loaded table.
+	
+	The model (and table) can be saved to and loaded from 
+	EEPROM. Each saved channel uses TRANSDUCER_CAL_EEPROM_SIZE
+	bytes and is checked with a CRC when loaded.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+#ifndef TransducerCal_h
+#define TransducerCal_h
+
+#include "Arduino.h"
+
+#define TRANSDUCER_SSI 0
+#define TRANSDUCER_MSI 1
+#define TRANSDUCER_TABLE 2
+
+#define TRANSDUCER_MAX_POINTS 8
+#define TRANSDUCER_BIN_SHIFT 7			// 1024 / 2^7 = 8 bins
+#define TRANSDUCER_BINS (1024 >> TRANSDUCER_BIN_SHIFT)
+#define TRANSDUCER_CAL_EEPROM_SIZE (4 + TRANSDUCER_MAX_POINTS * 6)
+
+class TransducerCal
+{
+	public:
+		TransducerCal (byte model = TRANSDUCER_MSI);
+		void setModel (byte model);
+		byte getModel ();
+		boolean saveTable (int eepromAddress, const int raw[], const float psi[], byte points);
+		boolean load (int eepromAddress);
+		void save (int eepromAddress);
+		void setSupplyVoltage (float vSupply);
+		void setReferenceVoltage (float vRef);
+		float getVoltage (int raw);
+		float getPSI (int raw);
+	private:
+		void buildIndex ();
+		byte _model;
+		byte _points;						// table points (0 = no table)
+		int _address;						// EEPROM address of the table
+		float _scale;						// raw -> raw at nominal supply
+		float _vRef;
+		byte _bin[TRANSDUCER_BINS];
+		float _vSupply;
+};
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ Title: TransducerCal (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the TransducerCal library. It writes a 
+	calibration table to EEPROM (where the object reads it 
+	from) and then prints the PSI each model gives for a sweep
+	of raw readings plus the live reading on A0.
+	
+	To calibrate a transducer replace rawPoints/psiPoints with
+	the output of Tools/TransducerFit, set calAddress to the 
+	channel's EEPROM address and run this sketch once.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <EEPROM.h>
+#include <TransducerCal.h>
+
+int sensorPin = A0;
+int calAddress = 0;			// EEPROM address of this channel's table
+
+// Table from Tools/TransducerFit (raw reading at 5.0V supply, psia)
+const int rawPoints[] = { 102, 205, 409, 614, 818, 921 };
+const float psiPoints[] = { 14.5, 140.2, 392.8, 645.1, 895.9, 1000.0 };
+
+TransducerCal ssi (TRANSDUCER_SSI);
+TransducerCal msi (TRANSDUCER_MSI);
+TransducerCal table;
+
+void setup ()
+{
+	Serial.begin(57600);
+	if (table.saveTable (calAddress, rawPoints, psiPoints, sizeof(rawPoints) / sizeof(rawPoints[0])) == false)
+		Serial.println (F("Table not usable!"));
+	Serial.println (F("Signal,SSI(psi),MSI(psi),Table(psi)"));
+	for (int raw = 0; raw <= 1023; raw += 64)
+		printRow (raw);
+}
+
+void printRow (int raw)
+{
+	Serial.print (raw);
+	Serial.print ((char) ',');
+	Serial.print (ssi.getPSI (raw));
+	Serial.print ((char) ',');
+	Serial.print (msi.getPSI (raw));
+	Serial.print ((char) ',');
+	Serial.println (table.getPSI (raw));
+}
+
+void loop ()
+{
+	printRow (analogRead (sensorPin));
+	delay (2000);
+}
@@ -0,0 +1,127 @@
+/*
+ Title: TypeK.cpp
+  Description: NIST ITS-90 type K thermocouple conversions:
+		getCelsius:
+			thermocouple voltage (mV, cold junction at 0C) to 
+			temperature. Valid from -200C (-5.891mV) to 1372C 
+			(54.886mV), NAN outside that.
+		getMillivolts:
+			temperature to voltage for the cold junction. Valid
+			from -55C to 125C (the range of the MAX31855's 
+			internal sensor).
+		compensate:
+			converts a reading from an amplifier that assumes a
+			constant 41.276uV/C (eg. the MAX31855) back to the 
+			thermocouple voltage and linearises it. Needs the
+			cold junction temperature used by the amplifier.
+	The NIST reference function is a 10th order polynomial with
+	an exponential term, and its inverse a 9th order polynomial
+	in 3 ranges. Instead, getCelsius uses TYPEK_NEG_SEGMENTS +
+	TYPEK_POS_SEGMENTS cubic segments of equal width (stored in
+	PROGMEM) fitted to the exact inverse of the reference 
+	function, and getMillivolts one cubic. Each is evaluated by
+	Horner's rule (3 multiplies and 3 adds, no pow()) and is 
+	within 0.03C of the reference function. Tools/TypeK.cppeck
+	checks this against the NIST tables and regenerates the 
+	segments.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+
+#include "Arduino.h"
+#include "TypeK.h"
+
+// Generated by Tools/TypeKCheck -g. Each row of typeKSegments is the
+// cubic for one segment in u = millivolts - (start of the segment) and
+// typeKColdJunction is in C.
+const float typeKSegments[TYPEK_NEG_SEGMENTS + TYPEK_POS_SEGMENTS][4] PROGMEM =
+{
+	{-199.948943, 64.7749932, -20.582334, 7.06411703},
+	{-160.605368, 45.4254205, -6.941037, 1.58671881},
+	{-130.286949, 37.7045424, -3.6441057, 0.643625485},
+	{-104.241641, 33.3597637, -2.27203806, 0.336452723},
+	{-80.7741266, 30.550217, -1.5451071, 0.201958758},
+	{-59.0349505, 28.597494, -1.1058946, 0.129272782},
+	{-38.5245681, 27.1762568, -0.826701464, 0.0920662739},
+	{-18.9242584, 26.1097912, -0.635892864, 0.106150459},
+	{-0.000885350823, 25.3519743, -0.397800017, 0.0410132016},
+	{83.9551173, 24.0016811, 0.125170431, 0.00632017652},
+	{167.995041, 25.0470418, 0.0278979137, -0.0215961882},
+	{253.382144, 24.5257665, -0.125647288, 0.00758505694},
+	{336.341459, 23.9235308, -0.0543446807, 0.00191872452},
+	{417.845904, 23.6187273, -0.0357039892, 0.00242101977},
+	{498.544674, 23.4598329, -0.0101738772, 0.0027689697},
+	{579.012817, 23.4873143, 0.0187404484, 0.00247779006},
+	{659.903693, 23.7022504, 0.0444427722, 0.00180406558},
+	{741.807091, 24.069608, 0.0629292631, 0.00104660373},
+	{825.157572, 24.5375833, 0.0732657453, 0.000602036509},
+	{910.217031, 25.0619471, 0.0787700978, 0.000864888266},
+	{997.150654, 25.6346984, 0.087074026, 0.00195403628},
+	{1086.19082, 26.3034079, 0.107290509, 0.0034073474},
+	{1177.82179, 27.1599255, 0.14447052, 0.0036598046},
+	{1272.83938, 28.2713281, 0.189035478, -0.00134620353}
+};
+
+const float typeKColdJunction[4] PROGMEM =
+	{-0.000395686953, 0.0394159887, 2.68653444e-05, -1.13707545e-07};
+
+/*
+	Thermocouple voltage (mV, cold junction at 0C) to temperature
+	(C). Returns NAN outside -200C to 1372C.
+*/
+float TypeK::getCelsius (float millivolts)
+{
+	if (!(millivolts >= TYPEK_MIN_MV && millivolts <= TYPEK_MAX_MV))
+		return NAN;
+	
+	byte segment;
+	float start;
+	if (millivolts < 0)
+	{
+		segment = (millivolts - TYPEK_MIN_MV) * (TYPEK_NEG_SEGMENTS / -TYPEK_MIN_MV);
+		if (segment >= TYPEK_NEG_SEGMENTS)
+			segment = TYPEK_NEG_SEGMENTS - 1;
+		start = TYPEK_MIN_MV + segment * (-TYPEK_MIN_MV / TYPEK_NEG_SEGMENTS);
+	}
+	else
+	{
+		segment = millivolts * (TYPEK_POS_SEGMENTS / TYPEK_MAX_MV);
+		if (segment >= TYPEK_POS_SEGMENTS)
+			segment = TYPEK_POS_SEGMENTS - 1;
+		start = segment * (TYPEK_MAX_MV / TYPEK_POS_SEGMENTS);
+		segment += TYPEK_NEG_SEGMENTS;
+	}
+	
+	const float *c = typeKSegments[segment];
+	float u = millivolts - start;
+	return ((pgm_read_float (c + 3) * u + pgm_read_float (c + 2)) * u 
+			+ pgm_read_float (c + 1)) * u + pgm_read_float (c);
+}
+
+/*
+	Temperature (C) to thermocouple voltage (mV) for a cold 
+	junction between -55C and 125C
+*/
+float TypeK::getMillivolts (float celsius)
+{
+	const float *c = typeKColdJunction;
+	return ((pgm_read_float (c + 3) * celsius + pgm_read_float (c + 2)) * celsius 
+			+ pgm_read_float (c + 1)) * celsius + pgm_read_float (c);
+}
+
+/*
+	Linearises a reading from an amplifier that converts the 
+	thermocouple voltage with a constant TYPEK_LINEAR_MV_PER_C and
+	adds its cold junction temperature (eg. the MAX31855):
+		linearCelsius = coldJunctionCelsius + Vtc / 0.041276
+	Vtc is recovered, the cold junction voltage added back (per 
+	the reference function rather than the linear one) and the
+	total converted to a temperature.
+*/
+float TypeK::compensate (float linearCelsius, float coldJunctionCelsius)
+{
+	float millivolts = (linearCelsius - coldJunctionCelsius) * TYPEK_LINEAR_MV_PER_C;
+	return getCelsius (millivolts + getMillivolts (coldJunctionCelsius));
+}
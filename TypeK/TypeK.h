@@ -0,0 +1,51 @@
+/*
+ Title: TypeK.h
+  Description: NIST ITS-90 type K thermocouple conversions:
+		getCelsius:
+			thermocouple voltage (mV, cold junction at 0C) to 
+			temperature. Valid from -200C (-5.891mV) to 1372C 
+			(54.886mV), NAN outside that.
+		getMillivolts:
+			temperature to voltage for the cold junction. Valid
+			from -55C to 125C (the range of the MAX31855's 
+			internal sensor).
+		compensate:
+			converts a reading from an amplifier that assumes a
+			constant 41.276uV/C (eg. the MAX31855) back to the 
+			thermocouple voltage and linearises it. Needs the
+			cold junction temperature used by the amplifier.
+	The NIST reference function is a 10th order polynomial with
+	an exponential term, and its inverse a 9th order polynomial
+	in 3 ranges. Instead, getCelsius uses TYPEK_NEG_SEGMENTS +
+	TYPEK_POS_SEGMENTS cubic segments of equal width (stored in
+	PROGMEM) fitted to the exact inverse of the reference 
+	function, and getMillivolts one cubic. Each is evaluated by
+	Horner's rule (3 multiplies and 3 adds, no pow()) and is 
+	within 0.03C of the reference function. Tools/TypeKCheck
+	checks this against the NIST tables and regenerates the 
+	segments.
+	
+    Note that this library will not setup any pins. It
+	is expected that these will be defined by the calling 
+	program.
+*/
+#ifndef TypeK_h
+#define TypeK_h
+
+#include "Arduino.h"
+
+#define TYPEK_NEG_SEGMENTS 8		// cubic segments from TYPEK_MIN_MV to 0mV
+#define TYPEK_POS_SEGMENTS 16		// cubic segments from 0mV to TYPEK_MAX_MV
+#define TYPEK_MIN_MV -5.891			// -200C
+#define TYPEK_MAX_MV 54.886			// 1372C
+#define TYPEK_LINEAR_MV_PER_C 0.041276	// MAX31855 sensitivity
+
+class TypeK
+{
+	public:
+		static float getCelsius (float millivolts);
+		static float getMillivolts (float celsius);
+		static float compensate (float linearCelsius, float coldJunctionCelsius);
+};
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ Title: TypeK (Demo)
+  Description: This is a demo library that shows how to
+	use the features of the TypeK library. It prints the 
+	temperature for a range of thermocouple voltages, what a
+	MAX31855 at a 25C cold junction would report (linear) and
+	the compensated temperature, and the time each conversion
+	takes on this micro.
+
+	Function descriptions can be found in the .cpp file
+	of the same name.
+*/
+
+#include <TypeK.h>
+
+void setup ()
+{
+	Serial.begin(57600);
+	Serial.println (F("mV,Celsius,MAX31855 linear(C),compensated(C)"));
+	float coldJunction = 25.0;
+	for (float mv = -5.0; mv < 55.0; mv += 5.0)
+	{
+		float celsius = TypeK::getCelsius (mv);
+		float linear = coldJunction + (mv - TypeK::getMillivolts (coldJunction)) / TYPEK_LINEAR_MV_PER_C;
+		Serial.print (mv, 3);
+		Serial.print (',');
+		Serial.print (celsius, 2);
+		Serial.print (',');
+		Serial.print (linear, 2);
+		Serial.print (',');
+		Serial.println (TypeK::compensate (linear, coldJunction), 2);
+	}
+	
+	volatile float out;
+	unsigned long start = micros();
+	for (int i = 0; i < 1000; i++)
+		out = TypeK::getCelsius (i * 0.05);
+	Serial.print (F("getCelsius: "));
+	Serial.print ((micros() - start) / 1000.0, 1);
+	Serial.println (F(" us"));
+	start = micros();
+	for (int i = 0; i < 1000; i++)
+		out = TypeK::compensate (i, 25.0);
+	Serial.print (F("compensate: "));
+	Serial.print ((micros() - start) / 1000.0, 1);
+	Serial.println (F(" us"));
+}
+
+void loop ()
+{
+}